@@ -1,58 +1,60 @@
-
 #include "ByteArray.h"
 #include <cassert>
+#include <cstring>
+#include "MappedFile.h"
+#include <stdexcept>
 
 using namespace Realisim;
 using namespace Core;
 using namespace std;
 
-ByteArray::ByteArray() : mpGuts(nullptr)
+ByteArray::ByteArray() : mpGuts(nullptr),
+mOffset(0),
+mSize(0),
+mIsSlice(false)
 {
-    makeGuts();
+    mInlineData[0] = '\0';
 }
 
 //-------------------------------------------------------
 ByteArray::ByteArray(const char* iData, int iLength /*= -1*/) :
-mpGuts(nullptr)
+ByteArray()
 {
-    makeGuts();
     if(iData != nullptr)
     {
         if(iLength > 0)
-        { mpGuts->mData = string(iData, iLength); }
+        { assign(iData, (size_t)iLength); }
         else
-        { mpGuts->mData = iData; }
+        { assign(iData, strlen(iData)); }
     }
     
 }
 
 //-------------------------------------------------------
 ByteArray::ByteArray(const std::string& iData) :
-mpGuts(nullptr)
+ByteArray()
 {
-    makeGuts();
-    mpGuts->mData = iData;
+    assign(iData.data(), iData.size());
 }
 
 //-------------------------------------------------------
 ByteArray::ByteArray(const ByteArray& iOther) :
-mpGuts(nullptr)
+ByteArray()
 {
-    shareGuts(iOther.mpGuts);
+    shareGuts(iOther);
 }
 
 //-------------------------------------------------------
 ByteArray& ByteArray::operator=(const ByteArray& iOther)
 {
-    shareGuts(iOther.mpGuts);
+    shareGuts(iOther);
     return *this;
 }
 
 //-------------------------------------------------------
 ByteArray& ByteArray::operator=(const char* iData)
 {
-    detachGuts();
-    mpGuts->mData = iData;
+    assign(iData, strlen(iData));
     return *this;
 }
 
@@ -65,46 +67,90 @@ ByteArray::~ByteArray()
 //-------------------------------------------------------
 ByteArray& ByteArray::append(const char* iData)
 {
-    detachGuts();
-    mpGuts->mData += iData;
+    appendData(iData, strlen(iData));
     return *this;
 }
 
 //-------------------------------------------------------
 ByteArray& ByteArray::append(const char* iData, int iLength)
 {
-    detachGuts();
-    mpGuts->mData += string(iData, iLength);
+    appendData(iData, (size_t)iLength);
     return *this;
 }
 
 //-------------------------------------------------------
 ByteArray& ByteArray::append(const std::string& iData)
 {
-    detachGuts();
-    mpGuts->mData += iData;
+    appendData(iData.data(), iData.size());
     return *this;
 }
 
 //-------------------------------------------------------
 ByteArray& ByteArray::append(const ByteArray& iOther)
 {
-    detachGuts();
-    // we recreate a string to remove the trailing \0 from iOther.
-    mpGuts->mData += string(iOther.mpGuts->mData.c_str(), iOther.size());
+    // a shallow copy keeps the data alive when appending
+    // to itself.
+    const ByteArray other(iOther);
+    appendData(other.dataBegin(), other.size());
     return *this;
 }
 
+//-------------------------------------------------------
+// Small data are appended inline, otherwise the data is
+// moved to unshared guts.
+//
+void ByteArray::appendData(const char *ipData, size_t iSize)
+{
+    if (mpGuts == nullptr && mSize + iSize <= kInlineCapacity)
+    {
+        memmove(mInlineData + mSize, ipData, iSize);
+        mSize += iSize;
+        mInlineData[mSize] = '\0';
+        return;
+    }
+
+    makeGuts();
+    mpGuts->mData.append(ipData, iSize);
+}
+
+//-------------------------------------------------------
+// Replaces the data by a copy of ipData. ipData can point
+// in the current data, it is copied before the current
+// guts are released.
+//
+void ByteArray::assign(const char *ipData, size_t iSize)
+{
+    if (iSize <= kInlineCapacity)
+    {
+        if (iSize > 0) { memmove(mInlineData, ipData, iSize); }
+        mInlineData[iSize] = '\0';
+        deleteGuts();
+    }
+    else
+    {
+        Guts *g = new Guts();
+        g->mData.assign(ipData, iSize);
+        deleteGuts();
+        mpGuts = g;
+    }
+    mOffset = 0;
+    mSize = iSize;
+    mIsSlice = false;
+}
+
 //-------------------------------------------------------
 char ByteArray::at(size_t i) const
 {
-    return mpGuts->mData.at(i);
+    if (i >= size())
+    { throw out_of_range("ByteArray::at"); }
+    return dataBegin()[i];
 }
 
 //-------------------------------------------------------
 size_t ByteArray::capacity() const
 {
-    return mpGuts->mData.capacity();
+    if (mpGuts == nullptr) { return kInlineCapacity; }
+    return mIsSlice ? mSize : mpGuts->mData.capacity();
 }
 
 //-------------------------------------------------------
@@ -118,37 +164,37 @@ size_t ByteArray::capLength(int iLength) const
     return l;
 }
 //-------------------------------------------------------
-// Removes all data from mData and will release allocated
+// Removes all data and will release allocated
 // memory. Thus empty() will be true. Size will be 0 and
-// capacity will be 0.
+// capacity will be the inline capacity.
 //
 void ByteArray::clear()
 {
-    detachGuts();
-    // We do not use std::string::clear() as it does not
-    // deallocate memory. It only removes data.
-    mpGuts->mData = string();
+    assign(nullptr, 0);
 }
 
 //-------------------------------------------------------
 // Returns a const pointer to the data. This is guaranteed
 // to never make a copy of the data.
 //
+// The data of views (see mid()) and raw data (see fromRawData())
+// is not null terminated.
+//
 const char* ByteArray::constData() const
 {
-    // not using c_str() because it adds a '\0'
-    //
-    return &(mpGuts->mData[0]);
+    return dataBegin();
 }
 
 //-------------------------------------------------------
-// Returns a const reference to the data. This is guaranteed
-// to never make a copy of the data. see method nonConstString() for
-// a non const reference with a possible deep copy.
+// Returns a copy of the data as a std::string. The
+// ByteArray itself is never modified, views, raw data and
+// inline data stay as they are.
+// see method nonConstString() for a non const reference
+// that converts them to owned data.
 //
-const std::string& ByteArray::constString() const
+std::string ByteArray::constString() const
 {
-    return mpGuts->mData;
+    return string(dataBegin(), size());
 }
 
 //-------------------------------------------------------
@@ -158,7 +204,17 @@ const std::string& ByteArray::constString() const
 char* ByteArray::data()
 {
     detachGuts();
-    return &(mpGuts->mData[0]);
+    return mpGuts == nullptr ? mInlineData : &(mpGuts->mData[0]);
+}
+
+//-------------------------------------------------------
+// Returns a pointer to the first byte, whatever the storage.
+//
+const char* ByteArray::dataBegin() const
+{
+    if (mpGuts == nullptr) { return mInlineData; }
+    if (mpGuts->mpRawData != nullptr) { return mpGuts->mpRawData + mOffset; }
+    return mpGuts->mData.data() + mOffset;
 }
 
 //-------------------------------------------------------
@@ -172,8 +228,8 @@ void ByteArray::deleteGuts()
     if( atomic_fetch_sub( &(mpGuts->mRefCount), 1 ) == 1 )
     {
         delete mpGuts;
-        mpGuts = nullptr;
     }
+    mpGuts = nullptr;
 }
 
 //-------------------------------------------------------
@@ -182,24 +238,34 @@ void ByteArray::deleteGuts()
 // a deep copy of the existing one thus giving a new
 // instance owned with ref count set to 1.
 //
+// Views and raw data are always copied, small ones
+// to the inline storage. Inline data is never shared.
+//
 void ByteArray::detachGuts()
 {
     //early out.
     if(!mpGuts) return;
 
-    // only perform a deep copy if ref count is greater
-    // than one
-    if( atomic_fetch_sub( &(mpGuts->mRefCount), 1 ) > 1 )
+    if (mIsSlice)
     {
-        //perform a deep copy
-        mpGuts = new Guts(*mpGuts);
+        assign(dataBegin(), mSize);
+        return;
     }
-    else
+
+    // sole owner, nothing to do. Another thread cannot add a
+    // reference concurrently without racing on this object.
+    if (mpGuts->mRefCount.load() == 1)
     {
-        // increment the refcount back to 1 since
-        // we are the only onwer of this guts.
-        atomic_fetch_add( &(mpGuts->mRefCount), 1 );
+        return;
     }
+
+    // perform a deep copy first and release the shared guts
+    // afterwards: the other owners may release them on other
+    // threads at any time, the reference held by this instance
+    // keeps them alive during the copy.
+    Guts *g = new Guts(*mpGuts);
+    deleteGuts();
+    mpGuts = g;
 }
 
 //-------------------------------------------------------
@@ -207,18 +273,48 @@ ByteArray& ByteArray::fill(char iChar, int iLength/*= -1*/)
 {
     size_t l = capLength(iLength);
     
-    auto begin = mpGuts->mData.begin();
-    auto end = begin + l;
+    char *begin = data();
+    char *end = begin + l;
     
     std::fill(begin, end, iChar);
     return *this;
 }
 
-////-------------------------------------------------------
-//ByteArray ByteArray::fromRawData(const char *iData, int iSize)
-//{
-//    return ByteArray();
-//}
+//-------------------------------------------------------
+// Maps the file in memory, see class documentation. Returns
+// an empty ByteArray when the file can't be mapped.
+//
+ByteArray ByteArray::fromMappedFile(const std::string& iFilenamePath)
+{
+    ByteArray r;
+    unique_ptr<MappedFile> mappedFile(new MappedFile());
+    if (mappedFile->open(iFilenamePath))
+    {
+        r.mpGuts = new Guts();
+        r.mpGuts->mpRawData = mappedFile->getData();
+        r.mSize = (size_t)mappedFile->getSize();
+        r.mIsSlice = true;
+        r.mpGuts->mpMappedFile = std::move(mappedFile);
+    }
+    return r;
+}
+
+//-------------------------------------------------------
+// Wraps iSize bytes of ipData without copying them, see class
+// documentation.
+//
+ByteArray ByteArray::fromRawData(const char *ipData, int iSize)
+{
+    ByteArray r;
+    if (ipData != nullptr && iSize > 0)
+    {
+        r.mpGuts = new Guts();
+        r.mpGuts->mpRawData = ipData;
+        r.mSize = (size_t)iSize;
+        r.mIsSlice = true;
+    }
+    return r;
+}
 
 //-------------------------------------------------------
 //ByteArra& insert(int iPos, const char*)
@@ -235,7 +331,7 @@ ByteArray& ByteArray::fill(char iChar, int iLength/*= -1*/)
 //-------------------------------------------------------
 bool ByteArray::isEmpty() const
 {
-    return mpGuts->mData.empty();
+    return size() == 0;
 }
 
 //-------------------------------------------------------
@@ -245,19 +341,50 @@ bool ByteArray::isEmpty() const
 // }
 
 //-------------------------------------------------------
+// Makes sure the data is held in unshared guts owning
+// the whole data as a std::string. Required by all
+// methods modifying the std::string.
+//
 void ByteArray::makeGuts()
 {
-    assert(mpGuts == nullptr);
-    mpGuts = new Guts();
+    detachGuts();
+    if (mpGuts == nullptr)
+    {
+        mpGuts = new Guts();
+        mpGuts->mData.assign(mInlineData, mSize);
+        mOffset = 0;
+        mIsSlice = false;
+    }
 }
 
 //-------------------------------------------------------
 // Returns a subpart of the data starting at byte iPos with a lenght of iLength.
 // If iLenght is -1, it will return a buffer starting at iPos to the end.
 //
-ByteArray ByteArray::mid(size_t iPos, int iLength /*= -1*/) const
+// The returned ByteArray is a view sharing the data, no copy is
+// performed unless it is small enough to be stored inline.
+//
+ByteArray ByteArray::mid(size_t iPos, int64_t iLength /*= -1*/) const
 {
-    return ByteArray( mpGuts->mData.substr(iPos,iLength) );
+    if (iPos > size())
+    { throw out_of_range("ByteArray::mid"); }
+
+    const size_t available = size() - iPos;
+    const size_t l = iLength < 0 ? available : min((size_t)iLength, available);
+
+    ByteArray r;
+    if (l <= kInlineCapacity)
+    {
+        r.assign(dataBegin() + iPos, l);
+    }
+    else
+    {
+        r.shareGuts(*this);
+        r.mOffset = mOffset + iPos;
+        r.mSize = l;
+        r.mIsSlice = true;
+    }
+    return r;
 }
 
 //-------------------------------------------------------
@@ -265,7 +392,7 @@ ByteArray ByteArray::mid(size_t iPos, int iLength /*= -1*/) const
 //
 std::string& ByteArray::nonConstString()
 {
-    detachGuts();
+    makeGuts();
     return mpGuts->mData;
 }
 
@@ -275,86 +402,70 @@ std::string& ByteArray::nonConstString()
 //
 bool ByteArray::operator==(const ByteArray& iOther) const
 {
-    return mpGuts->mData == iOther.mpGuts->mData;
+    return size() == iOther.size() &&
+        memcmp(dataBegin(), iOther.dataBegin(), size()) == 0;
 }
 
 //-------------------------------------------------------
 bool ByteArray::operator!=(const ByteArray& iOther) const
 {
-    return mpGuts->mData != iOther.mpGuts->mData;
+    return !(*this == iOther);
 }
 
 //-------------------------------------------------------
 ByteArray ByteArray::operator+(const ByteArray& iOther) const
 {
-    // we recreate strings using size() to gurarantee
-    // all data (even \0) are taken.
-    //
-    return ByteArray(
-        string(mpGuts->mData.c_str(), size()) +
-        string(iOther.mpGuts->mData.c_str(), iOther.size()));
+    ByteArray r;
+    r.reserve(size() + iOther.size());
+    r.appendData(dataBegin(), size());
+    r.append(iOther);
+    return r;
 }
 
 //-------------------------------------------------------
 ByteArray ByteArray::operator+(const char* iData)
 {
-    // we recreate strings using size() to gurarantee
-    // all data (even \0) are taken.
-    //
-    return ByteArray(
-                     string(mpGuts->mData.c_str(), size()) +
-                     iData );
+    ByteArray r(*this);
+    r.append(iData);
+    return r;
 }
 
 //-------------------------------------------------------
 ByteArray ByteArray::operator+(const std::string& iData)
 {
-    // we recreate strings using size() to gurarantee
-    // all data (even \0) are taken.
-    //
-    return ByteArray(
-                     string(mpGuts->mData.c_str(), size()) +
-                     iData );
+    ByteArray r(*this);
+    r.append(iData);
+    return r;
 }
 
 //-------------------------------------------------------
 ByteArray& ByteArray::operator+=(const ByteArray& iOther)
 {
-    detachGuts();
-    // we recreate strings using size() to gurarantee
-    // all data (even \0) are taken.
-    //
-    mpGuts->mData += string(iOther.mpGuts->mData.c_str(), iOther.size());
-    return *this;
+    return append(iOther);
 }
 
 //-------------------------------------------------------
 ByteArray& ByteArray::operator+=(const char* iData)
 {
-    detachGuts();
-    mpGuts->mData += iData;
-    return *this;
+    return append(iData);
 }
 
 //-------------------------------------------------------
 ByteArray& ByteArray::operator+=(const std::string& iData)
 {
-    detachGuts();
-    mpGuts->mData += iData;
-    return *this;
+    return append(iData);
 }
 
 //-------------------------------------------------------
 char ByteArray::operator[](size_t iIndex) const
 {
-    return mpGuts->mData[iIndex];
+    return dataBegin()[iIndex];
 }
 
 //-------------------------------------------------------
 char& ByteArray::operator[](size_t iIndex)
 {
-    detachGuts();
-    return mpGuts->mData[iIndex];
+    return data()[iIndex];
 }
 
 //-------------------------------------------------------
@@ -374,24 +485,40 @@ char& ByteArray::operator[](size_t iIndex)
 //{}
 
 //-------------------------------------------------------
+// Inline data is never shared, its refCount is 1.
+//
 int ByteArray::refCount() const
 {
-    return mpGuts->mRefCount;
+    return mpGuts == nullptr ? 1 : (int)mpGuts->mRefCount;
 }
 
 //-------------------------------------------------------
 void ByteArray::reserve(size_t iSize)
 {
-    detachGuts();
+    if (mpGuts == nullptr && iSize <= kInlineCapacity)
+    { return; }
+
+    makeGuts();
     mpGuts->mData.reserve(iSize);
 }
 
 //-------------------------------------------------------
 void ByteArray::resize(size_t iSize)
 {
-    if (iSize != mpGuts->mData.size())
+    const size_t currentSize = size();
+    if (iSize == currentSize)
+    { return; }
+
+    if (mpGuts == nullptr && iSize <= kInlineCapacity)
+    {
+        if (iSize > currentSize)
+        { memset(mInlineData + currentSize, 0, iSize - currentSize); }
+        mSize = iSize;
+        mInlineData[mSize] = '\0';
+    }
+    else
     {
-        detachGuts();
+        makeGuts();
         mpGuts->mData.resize(iSize);
     }
 }
@@ -399,46 +526,56 @@ void ByteArray::resize(size_t iSize)
 //-------------------------------------------------------
 void ByteArray::set(const char *ipData, size_t iLength)
 {
-    detachGuts();
-
     if (ipData != nullptr && iLength > 0)
     {
-        mpGuts->mData = string(ipData, iLength);
+        assign(ipData, iLength);
     }
 }
 
 //-------------------------------------------------------
 void ByteArray::set(const std::string &iData)
 {
-    detachGuts();
-    mpGuts->mData = iData;
+    assign(iData.data(), iData.size());
 }
 
 //-------------------------------------------------------
 void ByteArray::set(const ByteArray &iData)
 {
-    detachGuts();
-    shareGuts(iData.mpGuts);
+    shareGuts(iData);
 }
 
 //-------------------------------------------------------
-void ByteArray::shareGuts(Guts *ipShared)
+// Shares the guts of iOther, inline data is copied.
+//
+void ByteArray::shareGuts(const ByteArray& iOther)
 {
     //if same guts do nothing
-    if (mpGuts != ipShared)
+    if (this == &iOther ||
+        (mpGuts != nullptr && mpGuts == iOther.mpGuts && mOffset == iOther.mOffset && mSize == iOther.mSize))
+    { return; }
+
+    if (iOther.mpGuts == nullptr)
     {
-        if (atomic_fetch_add(&(ipShared->mRefCount), 1) > 0)
-        {
-            deleteGuts();
-            mpGuts = ipShared;
-        }
+        assign(iOther.mInlineData, iOther.mSize);
+        return;
     }
+
+    atomic_fetch_add(&(iOther.mpGuts->mRefCount), 1);
+    deleteGuts();
+    mpGuts = iOther.mpGuts;
+    mOffset = iOther.mOffset;
+    mSize = iOther.mSize;
+    mIsSlice = iOther.mIsSlice;
 }
 
 //-------------------------------------------------------
+// mSize is only used by views, raw data and inline data, owned
+// guts keep their size in their std::string (see nonConstString()).
+//
 size_t ByteArray::size() const
 {
-    return mpGuts->mData.size();
+    if (mpGuts != nullptr && !mIsSlice) { return mpGuts->mData.size(); }
+    return mSize;
 }
 
 //-------------------------------------------------------
@@ -446,12 +583,20 @@ size_t ByteArray::size() const
 //-------------------------------------------------------
 ByteArray::Guts::Guts() : 
 mRefCount(1),
-mData()
+mData(),
+mpRawData(nullptr),
+mpMappedFile()
 {}
 
 // deep copy
 //
 ByteArray::Guts::Guts(const Guts& iOther) : 
 mRefCount(1),
-mData( iOther.mData )
+mData( iOther.mData ),
+mpRawData(nullptr),
+mpMappedFile()
+{}
+
+//-------------------------------------------------------
+ByteArray::Guts::~Guts()
 {}
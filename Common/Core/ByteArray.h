@@ -1,12 +1,17 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 
 namespace Realisim
 {
 namespace Core
 {
+    class MappedFile;
+
     /*
     This class eases byte array manipulation. Mostly the memory is carefully 
     handled so it can be shared across different instance (until it is modified,
@@ -39,20 +44,44 @@ namespace Core
         data(), nonConstString() and operator[]. Since they are not const and could be modified,
         the byteArray will perform a deep copy of that data only if it is
         shared with other ByteArray instance. Otherwise, no copy is performed.
-        To gurantee that no copy is performed, constData(), asString() and
-        mid() is the way to go.
+        To gurantee that no copy is performed, constData() and mid() is the
+        way to go, constString() returns a copy.
 
         If the data contained must be passed to C api which expects a \0 terminated
         string, it is advised to use method asString().c_str(). This will guarantee
         that a null terminated string.
 
+    Slices and external buffers
+        mid() does not copy: the returned ByteArray is a view (offset and size)
+        sharing the data of the original one. The whole data is kept alive as long
+        as a view on it exists.
+
+        fromRawData() wraps an external buffer without copying it. The buffer
+        must outlive all ByteArray using it, it is never written: modifying the
+        ByteArray makes a copy first (copy-on-write).
+
+        fromMappedFile() maps a file in memory (read only), see class MappedFile.
+        Only the pages that are read are loaded, writing copies the whole data
+        (copy-on-write). The file is unmapped when the last ByteArray using it
+        is released, it must not be truncated or rewritten until then.
+
+        constData() of a view or of raw data is not null terminated, use
+        constString().c_str() when a '\0' is needed. nonConstString() converts
+        a view, raw data or small data (see below) to owned data first, this
+        copies the bytes of the view once.
+
+    Small data
+        Up to 23 bytes are stored in the ByteArray itself, no memory is allocated
+        and the data is copied instead of being shared (refCount() is 1).
+
     The bytearray can be released by calling clear(). The memory will be released
     when the last instance using the data will be cleared or deleted.
 
     This is class is thread safe.
     
     Note:
-       method constData(), constString() quarantees that no copy will occurs.
+       method constData() quarantees that no copy will occurs.
+       method constString() returns a copy of the content as a std::string.
        method data(), nonConstString() will copy the content since it might be overwritten.*/
     class ByteArray
     {
@@ -73,15 +102,16 @@ namespace Core
         size_t capacity() const;
         void clear();
         const char* constData() const;
-        const std::string& constString() const;
+        std::string constString() const;
         char* data();
         ByteArray& fill(char, int = -1);
-//static ByteArray fromRawData(const char*, int iSize);
+        static ByteArray fromMappedFile(const std::string& iFilenamePath);
+        static ByteArray fromRawData(const char*, int iSize);
 //ByteArra& insert(int iPos, const char*);
 //ByteArra& insert(int iPos, const char*, int iSize);  
 //ByteArra& insert(int iPos, const ByteArray&);
         bool isEmpty() const;
-        ByteArray mid(size_t iPos, int iLength = -1) const;
+        ByteArray mid(size_t iPos, int64_t iLength = -1) const;
         std::string& nonConstString();
         bool operator==(const ByteArray&) const;
         bool operator!=(const ByteArray&) const;
@@ -106,18 +136,25 @@ namespace Core
         size_t size() const;
 
     private:
+        enum { kInlineCapacity = 23 };
+
         struct Guts
         {
             Guts();
             Guts(const Guts&);
             Guts& operator=(const Guts&) = delete;
-            ~Guts() = default;
+            ~Guts();
 
             std::atomic<int> mRefCount;
-            std::string mData; //metre un char* pour supporter fromRawData...
+            std::string mData;
+            const char *mpRawData; // see fromRawData(), null when the data is owned.
+            std::unique_ptr<MappedFile> mpMappedFile; // see fromMappedFile()
         };
 
+        void appendData(const char *ipData, size_t iSize);
+        void assign(const char *ipData, size_t iSize);
         size_t capLength(int iLength) const;
+        const char* dataBegin() const;
 
         // the 4 following methods are for copy-on-write
         // functionnalities.
@@ -125,9 +162,13 @@ namespace Core
         void deleteGuts();
         void detachGuts();
         void makeGuts();
-        void shareGuts(Guts *);
+        void shareGuts(const ByteArray&);
 
-        Guts *mpGuts;
+        Guts *mpGuts; // null when the data is inline
+        size_t mOffset; // views, see mid()
+        size_t mSize; // size of views, raw data and inline data
+        bool mIsSlice; // true for views and raw data
+        char mInlineData[kInlineCapacity + 1];
     };
 }
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+
+#include <cmath>
+#include "Core/ColorRgbaF.h"
+
+#if defined(__F16C__)
+    #define REALISIM_COLOR_RGBA_F_USES_F16C
+    #include <immintrin.h>
+#endif
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+constexpr float ColorRgbaF::kOneOver255;
+
+//------------------------------------------------------------------------------
+// Converts ipSource to half floats.
+//
+void ColorRgbaF::convert(const ColorRgbaF* ipSource, size_t iCount, ColorRgbaF16* opDestination)
+{
+    for (size_t i = 0; i < iCount; ++i)
+    {
+#if defined(REALISIM_COLOR_RGBA_F_USES_F16C)
+        _mm_storel_epi64((__m128i*)&opDestination[i], _mm_cvtps_ph(_mm_loadu_ps(ipSource[i].mV), _MM_FROUND_TO_NEAREST_INT));
+#else
+        opDestination[i] = ipSource[i].toRgbaF16();
+#endif
+    }
+}
+
+//------------------------------------------------------------------------------
+// Converts ipSource to normalized bytes, each channel is clamped to [0, 1]
+// and rounded to the nearest byte.
+//
+void ColorRgbaF::convert(const ColorRgbaF* ipSource, size_t iCount, ColorRgbaUint8* opDestination)
+{
+    size_t i = 0;
+#if defined(REALISIM_COLOR_RGBA_F_USES_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    auto toInt32 = [&](const ColorRgbaF& iC) {
+        return _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(iC.mV), zero), one), scale));
+    };
+
+    // 4 pixels, 16 bytes, at once
+    alignas(16) uint8_t bytes[16];
+    for (; i + 4 <= iCount; i += 4)
+    {
+        const __m128i lo = _mm_packs_epi32(toInt32(ipSource[i]), toInt32(ipSource[i + 1]));
+        const __m128i hi = _mm_packs_epi32(toInt32(ipSource[i + 2]), toInt32(ipSource[i + 3]));
+        _mm_store_si128((__m128i*)bytes, _mm_packus_epi16(lo, hi));
+        for (int j = 0; j < 4; ++j)
+        { opDestination[i + j].set(bytes[4 * j], bytes[4 * j + 1], bytes[4 * j + 2], bytes[4 * j + 3]); }
+    }
+
+    for (; i < iCount; ++i)
+    {
+        const __m128i v = _mm_packs_epi32(toInt32(ipSource[i]), toInt32(ipSource[i]));
+        _mm_store_si128((__m128i*)bytes, _mm_packus_epi16(v, v));
+        opDestination[i].set(bytes[0], bytes[1], bytes[2], bytes[3]);
+    }
+#else
+    for (; i < iCount; ++i)
+    {
+        const ColorRgbaF c = ipSource[i].clamped() * 255.0f;
+        opDestination[i].set((uint8_t)nearbyint(c.mV[0]), (uint8_t)nearbyint(c.mV[1]),
+            (uint8_t)nearbyint(c.mV[2]), (uint8_t)nearbyint(c.mV[3]));
+    }
+#endif
+}
+
+//------------------------------------------------------------------------------
+void ColorRgbaF::convert(const ColorRgbaF16* ipSource, size_t iCount, ColorRgbaF* opDestination)
+{
+    for (size_t i = 0; i < iCount; ++i)
+    {
+#if defined(REALISIM_COLOR_RGBA_F_USES_F16C)
+        _mm_storeu_ps(opDestination[i].mV, _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)&ipSource[i])));
+#else
+        opDestination[i] = ColorRgbaF(ipSource[i]);
+#endif
+    }
+}
+
+//------------------------------------------------------------------------------
+// Converts normalized bytes to opDestination, see
+// ColorRgbaF(const ColorRgbaUint8&).
+//
+void ColorRgbaF::convert(const ColorRgbaUint8* ipSource, size_t iCount, ColorRgbaF* opDestination)
+{
+    size_t i = 0;
+#if defined(REALISIM_COLOR_RGBA_F_USES_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(kOneOver255);
+
+    // 4 pixels, 16 bytes, at once
+    for (; i + 4 <= iCount; i += 4)
+    {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*)&ipSource[i]);
+        const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_ps(opDestination[i].mV, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+        _mm_storeu_ps(opDestination[i + 1].mV, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+        _mm_storeu_ps(opDestination[i + 2].mV, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+        _mm_storeu_ps(opDestination[i + 3].mV, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+    }
+#endif
+
+    for (; i < iCount; ++i)
+    {
+        opDestination[i] = ColorRgbaF(ipSource[i]);
+    }
+}
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <algorithm>
+#include "Core/Color.h"
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define REALISIM_COLOR_RGBA_F_USES_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define REALISIM_COLOR_RGBA_F_USES_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // ColorRgbaF
+    //-------------------------------------------------------------------------
+    // This class is a normalized rgba color of 4 floats, 16 bytes aligned, meant
+    // for shading and accumulation in hot loops. Color (see Color.h) is 4
+    // doubles, 32 bytes, and goes through the 4 channels one by one.
+    //
+    // All arithmetic is done on the 4 channels at once with SSE2 or NEON, when
+    // available, and channel by channel otherwise.
+    //
+    // Conversions are explicit:
+    //      ColorRgbaF c(color);                 // from Color
+    //      Color back = c.toColor();
+    //      ColorRgbaUint8 packed = c.toRgbaUint8(); // 4 bytes, see below
+    //      ColorRgbaF16 half = c.toRgbaF16();       // 8 bytes
+    //
+    //  Packed types:
+    //      ColorRgbaUint8 is normalized to [0, 1] (value / 255) like Color. Going
+    //      to ColorRgbaUint8 clamps to [0, 1] and rounds to the nearest value
+    //      where Color::getRgbaUint8() truncates.
+    //      ColorRgbaF16 holds the same values as ColorRgbaF with half
+    //      precision.
+    //
+    //  convert() does the same conversions on arrays, it is the fast path to
+    //  fill or read image buffers (ex: iifRgbaUint8, iifRgbaF16).
+    //
+    // Image data is not guaranteed to be 16 bytes aligned, so it must not be
+    // reinterpreted as an array of ColorRgbaF: use ColorRgbaF32 for
+    // iifRgbaF32 image data (see toRgbaF32()).
+    //
+    class alignas(16) ColorRgbaF
+    {
+    public:
+        ColorRgbaF();
+        ColorRgbaF(float iR, float iG, float iB, float iA = 0.0f);
+        explicit ColorRgbaF(const Color& iC);
+        explicit ColorRgbaF(const ColorRgbaF16& iC);
+        explicit ColorRgbaF(const ColorRgbaF32& iC);
+        explicit ColorRgbaF(const ColorRgbaUint8& iC);
+        ColorRgbaF(const ColorRgbaF&) = default;
+        ColorRgbaF& operator=(const ColorRgbaF&) = default;
+        ~ColorRgbaF() = default;
+
+        ColorRgbaF& addScaled(const ColorRgbaF& iC, float iS);
+        ColorRgbaF clamped(float iMin = 0.0f, float iMax = 1.0f) const;
+        static void convert(const ColorRgbaF* ipSource, size_t iCount, ColorRgbaF16* opDestination);
+        static void convert(const ColorRgbaF* ipSource, size_t iCount, ColorRgbaUint8* opDestination);
+        static void convert(const ColorRgbaF16* ipSource, size_t iCount, ColorRgbaF* opDestination);
+        static void convert(const ColorRgbaUint8* ipSource, size_t iCount, ColorRgbaF* opDestination);
+        const float* data() const;
+        float getAlpha() const;
+        float getBlue() const;
+        float getGreen() const;
+        float getRed() const;
+
+        bool operator==(const ColorRgbaF& iC) const;
+        bool operator!=(const ColorRgbaF& iC) const;
+
+        ColorRgbaF operator+(const ColorRgbaF& iC) const;
+        ColorRgbaF& operator+=(const ColorRgbaF& iC);
+        ColorRgbaF operator-(const ColorRgbaF& iC) const;
+        ColorRgbaF& operator-=(const ColorRgbaF& iC);
+        ColorRgbaF operator*(const ColorRgbaF& iC) const;
+        ColorRgbaF& operator*=(const ColorRgbaF& iC);
+        ColorRgbaF operator/(const ColorRgbaF& iC) const;
+        ColorRgbaF& operator/=(const ColorRgbaF& iC);
+        ColorRgbaF operator*(float iS) const;
+        ColorRgbaF& operator*=(float iS);
+        ColorRgbaF operator/(float iS) const;
+        ColorRgbaF& operator/=(float iS);
+
+        void set(float iR, float iG, float iB, float iA);
+        void setAlpha(float iV);
+        void setBlue(float iV);
+        void setGreen(float iV);
+        void setRed(float iV);
+        Color toColor() const;
+        float toLuma() const;
+        ColorRgbaF16 toRgbaF16() const;
+        ColorRgbaF32 toRgbaF32() const;
+        ColorRgbaUint8 toRgbaUint8() const;
+
+    protected:
+        static constexpr float kOneOver255 = 1.0f / 255.0f;
+
+        float mV[4]; // r, g, b, a
+    };
+
+    static_assert(sizeof(ColorRgbaF) == 16, "ColorRgbaF must be 4 packed floats");
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF::ColorRgbaF() :
+        mV{ 0.0f, 0.0f, 0.0f, 0.0f }
+    {}
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF::ColorRgbaF(float iR, float iG, float iB, float iA /*= 0.0f*/) :
+        mV{ iR, iG, iB, iA }
+    {}
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF::ColorRgbaF(const Color& iC) :
+        mV{ (float)iC.getRed(), (float)iC.getGreen(), (float)iC.getBlue(), (float)iC.getAlpha() }
+    {}
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF::ColorRgbaF(const ColorRgbaF16& iC) :
+        mV{ (float)iC.getRed(), (float)iC.getGreen(), (float)iC.getBlue(), (float)iC.getAlpha() }
+    {}
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF::ColorRgbaF(const ColorRgbaF32& iC) :
+        mV{ iC.getRed(), iC.getGreen(), iC.getBlue(), iC.getAlpha() }
+    {}
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF::ColorRgbaF(const ColorRgbaUint8& iC) :
+        mV{ iC.getRed() * kOneOver255, iC.getGreen() * kOneOver255, iC.getBlue() * kOneOver255, iC.getAlpha() * kOneOver255 }
+    {}
+
+    //-------------------------------------------------------------------------
+    // *this += iC * iS
+    //
+    inline ColorRgbaF& ColorRgbaF::addScaled(const ColorRgbaF& iC, float iS)
+    {
+#if defined(REALISIM_COLOR_RGBA_F_USES_SSE2)
+        _mm_store_ps(mV, _mm_add_ps(_mm_load_ps(mV), _mm_mul_ps(_mm_load_ps(iC.mV), _mm_set1_ps(iS))));
+#elif defined(REALISIM_COLOR_RGBA_F_USES_NEON)
+        vst1q_f32(mV, vmlaq_n_f32(vld1q_f32(mV), vld1q_f32(iC.mV), iS));
+#else
+        for (int i = 0; i < 4; ++i) { mV[i] += iC.mV[i] * iS; }
+#endif
+        return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF ColorRgbaF::clamped(float iMin /*= 0.0f*/, float iMax /*= 1.0f*/) const
+    {
+        ColorRgbaF r;
+#if defined(REALISIM_COLOR_RGBA_F_USES_SSE2)
+        _mm_store_ps(r.mV, _mm_min_ps(_mm_max_ps(_mm_load_ps(mV), _mm_set1_ps(iMin)), _mm_set1_ps(iMax)));
+#elif defined(REALISIM_COLOR_RGBA_F_USES_NEON)
+        vst1q_f32(r.mV, vminq_f32(vmaxq_f32(vld1q_f32(mV), vdupq_n_f32(iMin)), vdupq_n_f32(iMax)));
+#else
+        for (int i = 0; i < 4; ++i) { r.mV[i] = std::min(std::max(mV[i], iMin), iMax); }
+#endif
+        return r;
+    }
+
+    //-------------------------------------------------------------------------
+    inline const float* ColorRgbaF::data() const
+    { return mV; }
+
+    //-------------------------------------------------------------------------
+    inline float ColorRgbaF::getAlpha() const
+    { return mV[3]; }
+
+    //-------------------------------------------------------------------------
+    inline float ColorRgbaF::getBlue() const
+    { return mV[2]; }
+
+    //-------------------------------------------------------------------------
+    inline float ColorRgbaF::getGreen() const
+    { return mV[1]; }
+
+    //-------------------------------------------------------------------------
+    inline float ColorRgbaF::getRed() const
+    { return mV[0]; }
+
+    //-------------------------------------------------------------------------
+    inline bool ColorRgbaF::operator==(const ColorRgbaF& iC) const
+    {
+        return mV[0] == iC.mV[0] && mV[1] == iC.mV[1] &&
+            mV[2] == iC.mV[2] && mV[3] == iC.mV[3];
+    }
+
+    //-------------------------------------------------------------------------
+    inline bool ColorRgbaF::operator!=(const ColorRgbaF& iC) const
+    { return !operator==(iC); }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF ColorRgbaF::operator+(const ColorRgbaF& iC) const
+    {
+        ColorRgbaF r;
+#if defined(REALISIM_COLOR_RGBA_F_USES_SSE2)
+        _mm_store_ps(r.mV, _mm_add_ps(_mm_load_ps(mV), _mm_load_ps(iC.mV)));
+#elif defined(REALISIM_COLOR_RGBA_F_USES_NEON)
+        vst1q_f32(r.mV, vaddq_f32(vld1q_f32(mV), vld1q_f32(iC.mV)));
+#else
+        for (int i = 0; i < 4; ++i) { r.mV[i] = mV[i] + iC.mV[i]; }
+#endif
+        return r;
+    }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF& ColorRgbaF::operator+=(const ColorRgbaF& iC)
+    { return *this = *this + iC; }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF ColorRgbaF::operator-(const ColorRgbaF& iC) const
+    {
+        ColorRgbaF r;
+#if defined(REALISIM_COLOR_RGBA_F_USES_SSE2)
+        _mm_store_ps(r.mV, _mm_sub_ps(_mm_load_ps(mV), _mm_load_ps(iC.mV)));
+#elif defined(REALISIM_COLOR_RGBA_F_USES_NEON)
+        vst1q_f32(r.mV, vsubq_f32(vld1q_f32(mV), vld1q_f32(iC.mV)));
+#else
+        for (int i = 0; i < 4; ++i) { r.mV[i] = mV[i] - iC.mV[i]; }
+#endif
+        return r;
+    }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF& ColorRgbaF::operator-=(const ColorRgbaF& iC)
+    { return *this = *this - iC; }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF ColorRgbaF::operator*(const ColorRgbaF& iC) const
+    {
+        ColorRgbaF r;
+#if defined(REALISIM_COLOR_RGBA_F_USES_SSE2)
+        _mm_store_ps(r.mV, _mm_mul_ps(_mm_load_ps(mV), _mm_load_ps(iC.mV)));
+#elif defined(REALISIM_COLOR_RGBA_F_USES_NEON)
+        vst1q_f32(r.mV, vmulq_f32(vld1q_f32(mV), vld1q_f32(iC.mV)));
+#else
+        for (int i = 0; i < 4; ++i) { r.mV[i] = mV[i] * iC.mV[i]; }
+#endif
+        return r;
+    }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF& ColorRgbaF::operator*=(const ColorRgbaF& iC)
+    { return *this = *this * iC; }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF ColorRgbaF::operator/(const ColorRgbaF& iC) const
+    {
+        ColorRgbaF r;
+#if defined(REALISIM_COLOR_RGBA_F_USES_SSE2)
+        _mm_store_ps(r.mV, _mm_div_ps(_mm_load_ps(mV), _mm_load_ps(iC.mV)));
+#elif defined(REALISIM_COLOR_RGBA_F_USES_NEON) && defined(__aarch64__)
+        vst1q_f32(r.mV, vdivq_f32(vld1q_f32(mV), vld1q_f32(iC.mV)));
+#else
+        for (int i = 0; i < 4; ++i) { r.mV[i] = mV[i] / iC.mV[i]; }
+#endif
+        return r;
+    }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF& ColorRgbaF::operator/=(const ColorRgbaF& iC)
+    { return *this = *this / iC; }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF ColorRgbaF::operator*(float iS) const
+    {
+        ColorRgbaF r;
+#if defined(REALISIM_COLOR_RGBA_F_USES_SSE2)
+        _mm_store_ps(r.mV, _mm_mul_ps(_mm_load_ps(mV), _mm_set1_ps(iS)));
+#elif defined(REALISIM_COLOR_RGBA_F_USES_NEON)
+        vst1q_f32(r.mV, vmulq_n_f32(vld1q_f32(mV), iS));
+#else
+        for (int i = 0; i < 4; ++i) { r.mV[i] = mV[i] * iS; }
+#endif
+        return r;
+    }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF& ColorRgbaF::operator*=(float iS)
+    { return *this = *this * iS; }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF ColorRgbaF::operator/(float iS) const
+    { return *this * (1.0f / iS); }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF& ColorRgbaF::operator/=(float iS)
+    { return *this = *this / iS; }
+
+    //-------------------------------------------------------------------------
+    inline void ColorRgbaF::set(float iR, float iG, float iB, float iA)
+    {
+        mV[0] = iR;
+        mV[1] = iG;
+        mV[2] = iB;
+        mV[3] = iA;
+    }
+
+    //-------------------------------------------------------------------------
+    inline void ColorRgbaF::setAlpha(float iV)
+    { mV[3] = iV; }
+
+    //-------------------------------------------------------------------------
+    inline void ColorRgbaF::setBlue(float iV)
+    { mV[2] = iV; }
+
+    //-------------------------------------------------------------------------
+    inline void ColorRgbaF::setGreen(float iV)
+    { mV[1] = iV; }
+
+    //-------------------------------------------------------------------------
+    inline void ColorRgbaF::setRed(float iV)
+    { mV[0] = iV; }
+
+    //-------------------------------------------------------------------------
+    inline Color ColorRgbaF::toColor() const
+    { return Color((double)mV[0], (double)mV[1], (double)mV[2], (double)mV[3]); }
+
+    //-------------------------------------------------------------------------
+    // see ColorRgba::toLuma()
+    //
+    inline float ColorRgbaF::toLuma() const
+    { return 0.2126f*mV[0] + 0.7152f*mV[1] + 0.0722f*mV[2]; }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF16 ColorRgbaF::toRgbaF16() const
+    {
+        return ColorRgbaF16(half_float::half(mV[0]), half_float::half(mV[1]),
+            half_float::half(mV[2]), half_float::half(mV[3]));
+    }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaF32 ColorRgbaF::toRgbaF32() const
+    { return ColorRgbaF32(mV[0], mV[1], mV[2], mV[3]); }
+
+    //-------------------------------------------------------------------------
+    inline ColorRgbaUint8 ColorRgbaF::toRgbaUint8() const
+    {
+        ColorRgbaUint8 r;
+        convert(this, 1, &r);
+        return r;
+    }
+}
+}
@@ -0,0 +1,42 @@
+
+#include "Core/CycleCounter.h"
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    const int kCalibrationDurationInMs = 10;
+
+    // Counts the ticks elapsed while steady_clock advances by
+    // kCalibrationDurationInMs.
+    //
+    double calibrateNanosecondsPerTick()
+    {
+#ifdef REALISIM_CYCLE_COUNTER_USES_TSC
+        using namespace std::chrono;
+        const steady_clock::time_point start = steady_clock::now();
+        const uint64_t startTick = CycleCounter::now();
+
+        steady_clock::time_point end = start;
+        while (end - start < milliseconds(kCalibrationDurationInMs))
+        {
+            end = steady_clock::now();
+        }
+        const uint64_t endTick = CycleCounter::now();
+
+        const double elapsedInNs = (double)duration_cast<nanoseconds>(end - start).count();
+        return endTick > startTick ? elapsedInNs / (endTick - startTick) : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+}
+
+//-----------------------------------------------------------------------------
+double CycleCounter::getNanosecondsPerTick()
+{
+    static const double sNanosecondsPerTick = calibrateNanosecondsPerTick();
+    return sNanosecondsPerTick;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define REALISIM_CYCLE_COUNTER_USES_TSC
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+#endif
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // Reads the time stamp counter of the processor (rdtsc). Reading it
+    // costs a few nanoseconds, much less than a call to the system clock.
+    //
+    // The counter ticks at a constant rate on every processor we target
+    // (invariant TSC). The rate is calibrated once against
+    // std::chrono::steady_clock, the first time a conversion is requested.
+    // This takes about 10 ms.
+    //
+    // On platforms without a time stamp counter, now() falls back to
+    // steady_clock and a tick is a nanosecond.
+    //
+    // Ticks are only meaningful as differences: now() - previousNow().
+    //
+    class CycleCounter
+    {
+    public:
+        CycleCounter() = delete;
+
+        static double getNanosecondsPerTick();
+        static uint64_t now();
+        static int64_t toNanoseconds(uint64_t iTicks);
+        static double toSeconds(uint64_t iTicks);
+    };
+
+    //-------------------------------------------------------------------------
+    inline uint64_t CycleCounter::now()
+    {
+#ifdef REALISIM_CYCLE_COUNTER_USES_TSC
+        return __rdtsc();
+#else
+        using namespace std::chrono;
+        return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    inline int64_t CycleCounter::toNanoseconds(uint64_t iTicks)
+    {
+        return (int64_t)(iTicks * getNanosecondsPerTick());
+    }
+
+    //-------------------------------------------------------------------------
+    inline double CycleCounter::toSeconds(uint64_t iTicks)
+    {
+        return iTicks * getNanosecondsPerTick() * 1e-9;
+    }
+}
+}
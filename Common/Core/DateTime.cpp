@@ -15,6 +15,7 @@ using namespace std;
 namespace
 {
     const double kSecondsToHours = 1.0/3600.0;
+    const char kMillisecondsToken[] = "zzz";
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -206,6 +207,16 @@ DateTime DateTime::fromMillisecondsSinceEpoch(int64_t iV)
     return t;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+// Returns mLocalTimeInfo formatted by strftime, "zzz" is not replaced.
+//
+std::string DateTime::formatLocalTimeInfo(const std::string& iFormat) const
+{
+    char buffer[80];
+    const size_t size = iFormat.empty() ? 0 : strftime(buffer, sizeof(buffer), iFormat.c_str(), &mLocalTimeInfo);
+    return string(buffer, size);
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 void DateTime::fromUtcTime_t(const time_t& iUtcTime)
 {
@@ -331,9 +342,29 @@ void DateTime::makeUtcTimeFromLocalInfo()
 //---------------------------------------------------------------------------------------------------------------------
 int64_t DateTime::millisecondsSinceEpoch()
 {
-    DateTime dt;
-    dt.now();
-    return dt.toMillisecondsSinceEpoch();
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Same as millisecondsSinceEpoch() but from a monotonic clock: the system clock is read once, as an anchor, and the
+// time elapsed since is measured with std::chrono::steady_clock. The returned values never go backward, adjustments
+// of the system clock after the anchor are not reflected.
+//
+int64_t DateTime::monotonicMillisecondsSinceEpoch()
+{
+    using namespace std::chrono;
+    struct Anchor
+    {
+        Anchor() : mSystemTime(system_clock::now()), mSteadyTime(steady_clock::now()) {}
+
+        const system_clock::time_point mSystemTime;
+        const steady_clock::time_point mSteadyTime;
+    };
+    static const Anchor anchor;
+
+    const auto elapsed = steady_clock::now() - anchor.mSteadyTime;
+    return duration_cast<milliseconds>(anchor.mSystemTime.time_since_epoch() + elapsed).count();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -507,12 +538,10 @@ string DateTime::toString() const
 //
 string DateTime::DateTime::toString(const std::string& iFormat) const 
 {
-    char buffer[80];
-    strftime(buffer, 80, iFormat.c_str(), &mLocalTimeInfo);
-    string t(buffer);
+    string t = formatLocalTimeInfo(iFormat);
 
     // add milliseconds
-    const size_t pos = t.find("zzz", 0);
+    const size_t pos = t.find(kMillisecondsToken, 0);
     if (pos != string::npos)
     {
         char millis[4];
@@ -557,3 +586,91 @@ time_t DateTime::utcTimeToLocalTime(time_t iUtcTime)
 {
     return  iUtcTime - mLocalTimeOffsetFromUtcInSeconds + mOffsetFromUtcInSeconds;
 }
+
+//---------------------------------------------------------------------------------------------------------------------
+//  DateTimeFormatter
+//---------------------------------------------------------------------------------------------------------------------
+DateTimeFormatter::DateTimeFormatter() :
+    DateTimeFormatter("%Y-%m-%d %H:%M:%S.zzz")
+{}
+
+//---------------------------------------------------------------------------------------------------------------------
+DateTimeFormatter::DateTimeFormatter(const std::string& iFormat) :
+    mFormat(),
+    mFormatBeforeMilliseconds(),
+    mFormatAfterMilliseconds(),
+    mHasMilliseconds(false),
+    mCachedSecond(0),
+    mMillisecondsPosition(0),
+    mCache()
+{
+    setFormat(iFormat);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Returns the local time of iMillisecondsSinceEpoch, see DateTime::toString(const std::string&).
+//
+const std::string& DateTimeFormatter::format(int64_t iMillisecondsSinceEpoch)
+{
+    int64_t second = iMillisecondsSinceEpoch / 1000;
+    int millisecond = (int)(iMillisecondsSinceEpoch - second * 1000);
+    if (millisecond < 0)
+    {
+        --second;
+        millisecond += 1000;
+    }
+
+    if (second != mCachedSecond || mCache.empty())
+    {
+        // strftime and the local time of the second, the milliseconds are
+        // a placeholder.
+        const DateTime dt = DateTime::fromMillisecondsSinceEpoch(second * 1000);
+        mCache = dt.formatLocalTimeInfo(mFormatBeforeMilliseconds);
+        mMillisecondsPosition = mCache.size();
+        if (mHasMilliseconds)
+        {
+            mCache += kMillisecondsToken;
+            mCache += dt.formatLocalTimeInfo(mFormatAfterMilliseconds);
+        }
+        mCachedSecond = second;
+    }
+
+    if (mHasMilliseconds)
+    {
+        mCache[mMillisecondsPosition] = (char)('0' + millisecond / 100);
+        mCache[mMillisecondsPosition + 1] = (char)('0' + (millisecond / 10) % 10);
+        mCache[mMillisecondsPosition + 2] = (char)('0' + millisecond % 10);
+    }
+    return mCache;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Returns the current time, see DateTime::monotonicMillisecondsSinceEpoch().
+//
+const std::string& DateTimeFormatter::formatNow()
+{
+    return format(DateTime::monotonicMillisecondsSinceEpoch());
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+const std::string& DateTimeFormatter::getFormat() const
+{
+    return mFormat;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// iFormat is the format of DateTime::toString(const std::string&). Like
+// DateTime::toString(), only the first "zzz" is replaced by the milliseconds.
+//
+void DateTimeFormatter::setFormat(const std::string& iFormat)
+{
+    mFormat = iFormat;
+
+    // "zzz" is looked for in the format instead of the formatted string, it
+    // is the same as long as no conversion (ex: %Z) expands to "zzz".
+    const size_t pos = mFormat.find(kMillisecondsToken);
+    mHasMilliseconds = pos != string::npos;
+    mFormatBeforeMilliseconds = mHasMilliseconds ? mFormat.substr(0, pos) : mFormat;
+    mFormatAfterMilliseconds = mHasMilliseconds ? mFormat.substr(pos + 3) : string();
+    mCache.clear();
+}
@@ -116,6 +116,7 @@ namespace Core
         bool hasDaylightSavingTimeFlag() const;
         bool isDaylightSavingTimeApplied() const;
         static int64_t millisecondsSinceEpoch();
+        static int64_t monotonicMillisecondsSinceEpoch();
         void now();
 
         void setDate(int iYear, int iMonth, int iDay);
@@ -137,6 +138,9 @@ namespace Core
         DateTime toUtc() const;
 
     protected:
+        friend class DateTimeFormatter;
+
+        std::string formatLocalTimeInfo(const std::string& iFormat) const;
         time_t localTimeToUtcTime(time_t iLocalTime);
         time_t utcTimeToLocalTime(time_t iUtcTime);
 
@@ -152,5 +156,45 @@ namespace Core
         bool mHasDaylightSavingTimeFlag;
         bool mApplyDaylightSavingTime;
     };
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // This class formats many timestamps with the same format, ex: one per log line. The result is the same as
+    //
+    //      DateTime::fromMillisecondsSinceEpoch(ms).toString(format)
+    //
+    // but the calendar math, the timezone handling and strftime are done once per second: the formatted second is
+    // cached and only the milliseconds ("zzz" in the format) are rewritten for timestamps in the same second.
+    //
+    // Usage:
+    //      DateTimeFormatter formatter("%Y-%m-%d %H:%M:%S.zzz");
+    //      const std::string& t = formatter.format(DateTime::monotonicMillisecondsSinceEpoch());
+    //      const std::string& n = formatter.formatNow();
+    //
+    // The returned string is valid until the next call. This class is not thread safe, use one formatter per
+    // thread.
+    //
+    class DateTimeFormatter
+    {
+    public:
+        DateTimeFormatter();
+        explicit DateTimeFormatter(const std::string& iFormat);
+        DateTimeFormatter(const DateTimeFormatter&) = default;
+        DateTimeFormatter& operator=(const DateTimeFormatter&) = default;
+        ~DateTimeFormatter() = default;
+
+        const std::string& format(int64_t iMillisecondsSinceEpoch);
+        const std::string& formatNow();
+        const std::string& getFormat() const;
+        void setFormat(const std::string& iFormat);
+
+    protected:
+        std::string mFormat;
+        std::string mFormatBeforeMilliseconds;
+        std::string mFormatAfterMilliseconds;
+        bool mHasMilliseconds;
+        int64_t mCachedSecond;
+        size_t mMillisecondsPosition;
+        std::string mCache;
+    };
 }
 }
\ No newline at end of file
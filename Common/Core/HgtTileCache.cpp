@@ -0,0 +1,399 @@
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "Core/FileInfo.h"
+#include "Core/HgtTileCache.h"
+#include "Core/ImageSupport/HgtImage.h"
+#include "Core/Path.h"
+#include "Core/ThreadPool.h"
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    const int16_t kVoidSample = -32768;
+    const uint64_t kDefaultMemoryBudgetInBytes = 512ull * 1024 * 1024;
+}
+
+//-----------------------------------------------------------------------------
+HgtTileCache::HgtTileCache() :
+    mMutex(),
+    mNoLoaderCondition(),
+    mEntries(),
+    mKeyToFilenamePath(),
+    mLru(),
+    mQueue(),
+    mFolderPath(),
+    mMemoryBudgetInBytes(kDefaultMemoryBudgetInBytes),
+    mMemoryUsageInBytes(0),
+    mNumberOfLoaders(0),
+    mpThreadPool(&ThreadPool::getGlobalInstance())
+{}
+
+//-----------------------------------------------------------------------------
+// Tiles that are queued are dropped, the ones being loaded are waited for.
+//
+HgtTileCache::~HgtTileCache()
+{
+    clear();
+}
+
+//-----------------------------------------------------------------------------
+// Registers the file of a tile, the key of the tile comes from the file name
+// (ex: N45W072.hgt), see HgtImage::getLowerLeftCornerFromFileName().
+// Returns false when the file name has no lower left corner.
+//
+bool HgtTileCache::addTile(const std::string& iFilenamePath)
+{
+    bool isValid = false;
+    const Math::Vector2 lowerLeft = HgtImage::getLowerLeftCornerFromFileName(iFilenamePath, &isValid);
+    if (isValid)
+    {
+        unique_lock<mutex> lock(mMutex);
+        mKeyToFilenamePath[Key((int)lowerLeft.y(), (int)lowerLeft.x())] = iFilenamePath;
+    }
+    return isValid;
+}
+
+//-----------------------------------------------------------------------------
+// Releases all the tiles. Registered files (see addTile()), the folder path
+// and the memory budget are kept.
+//
+void HgtTileCache::clear()
+{
+    unique_lock<mutex> lock(mMutex);
+    dropQueuedTiles();
+    mNoLoaderCondition.wait(lock, [this]() { return mNumberOfLoaders == 0; });
+
+    mEntries.clear();
+    mLru.clear();
+    mMemoryUsageInBytes = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Removes the queued tiles from the cache. mMutex must be locked.
+//
+void HgtTileCache::dropQueuedTiles()
+{
+    for (const Key &key : mQueue)
+    {
+        auto it = mEntries.find(key);
+        if (it != mEntries.end() && it->second.mState == tsQueued)
+        { mEntries.erase(it); }
+    }
+    mQueue.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Queues a tile that is not in the cache. mMutex must be locked, see
+// startLoaders().
+//
+void HgtTileCache::enqueue(const Key& iKey, bool iFirstInLine)
+{
+    if (mEntries.find(iKey) != mEntries.end())
+    { return; }
+
+    Entry &e = mEntries[iKey];
+    e.mState = tsQueued;
+    iFirstInLine ? mQueue.push_front(iKey) : mQueue.push_back(iKey);
+}
+
+//-----------------------------------------------------------------------------
+// Releases the least recently sampled tiles until the memory usage fits the
+// budget. The most recent tile is always kept. mMutex must be locked.
+//
+void HgtTileCache::evictTiles()
+{
+    while (mMemoryUsageInBytes > mMemoryBudgetInBytes && mLru.size() > 1)
+    {
+        auto it = mEntries.find(mLru.back());
+        mMemoryUsageInBytes -= it->second.mpTile->mData.size();
+        mEntries.erase(it);
+        mLru.pop_back();
+    }
+}
+
+//-----------------------------------------------------------------------------
+std::string HgtTileCache::getFilenamePath(const Key& iKey) const
+{
+    auto it = mKeyToFilenamePath.find(iKey);
+    if (it != mKeyToFilenamePath.end())
+    { return it->second; }
+    return mFolderPath.empty() ? string() : Path::join(mFolderPath, getTileFileName(iKey.first, iKey.second));
+}
+
+//-----------------------------------------------------------------------------
+std::string HgtTileCache::getFolderPath() const
+{
+    unique_lock<mutex> lock(mMutex);
+    return mFolderPath;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t HgtTileCache::getMemoryBudgetInBytes() const
+{
+    unique_lock<mutex> lock(mMutex);
+    return mMemoryBudgetInBytes;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t HgtTileCache::getMemoryUsageInBytes() const
+{
+    unique_lock<mutex> lock(mMutex);
+    return mMemoryUsageInBytes;
+}
+
+//-----------------------------------------------------------------------------
+int HgtTileCache::getNumberOfLoadedTiles() const
+{
+    unique_lock<mutex> lock(mMutex);
+    return (int)mLru.size();
+}
+
+//-----------------------------------------------------------------------------
+// Returns the number of tiles queued or being loaded.
+//
+int HgtTileCache::getNumberOfPendingTiles() const
+{
+    unique_lock<mutex> lock(mMutex);
+    return (int)count_if(mEntries.begin(), mEntries.end(), [](const pair<const Key, Entry>& iEntry) {
+        return iEntry.second.mState == tsQueued || iEntry.second.mState == tsLoading;
+    });
+}
+
+//-----------------------------------------------------------------------------
+// Returns the SRTM file name of a tile, ex: N45W072.hgt for the tile whose
+// lower left corner is at latitude 45 and longitude -72.
+//
+std::string HgtTileCache::getTileFileName(int iLatitude, int iLongitude)
+{
+    ostringstream oss;
+    oss << (iLatitude >= 0 ? 'N' : 'S') << setfill('0') << setw(2) << abs(iLatitude)
+        << (iLongitude >= 0 ? 'E' : 'W') << setw(3) << abs(iLongitude) << ".hgt";
+    return oss.str();
+}
+
+//-----------------------------------------------------------------------------
+bool HgtTileCache::isTileLoaded(int iLatitude, int iLongitude) const
+{
+    unique_lock<mutex> lock(mMutex);
+    auto it = mEntries.find(Key(iLatitude, iLongitude));
+    return it != mEntries.end() && it->second.mState == tsLoaded;
+}
+
+//-----------------------------------------------------------------------------
+// Returns nullptr when the file does not exist or is not a square hgt.
+//
+std::shared_ptr<HgtTileCache::Tile> HgtTileCache::loadTile(const std::string& iFilenamePath)
+{
+    if (iFilenamePath.empty() || !FileInfo(iFilenamePath).isFile())
+    { return nullptr; }
+
+    HgtImage hgt;
+    hgt.setFilenamePath(iFilenamePath);
+    hgt.setMemoryMappingEnabled(true);
+    hgt.load();
+    if (!hgt.isValid() || hgt.getWidthInPixel() != hgt.getHeightInPixel() || hgt.getWidthInPixel() < 2)
+    { return nullptr; }
+
+    shared_ptr<Tile> pTile = make_shared<Tile>();
+    pTile->mData = hgt.getImageData();
+    pTile->mSize = hgt.getWidthInPixel();
+    pTile->mSamplesPerDegree = 1.0 / hgt.getResolutionPerSampleInDegrees();
+    return pTile;
+}
+
+//-----------------------------------------------------------------------------
+// Body of the loader tasks, loads queued tiles until the queue is empty.
+// Files are read without holding mMutex.
+//
+void HgtTileCache::loaderLoop()
+{
+    unique_lock<mutex> lock(mMutex);
+    while (!mQueue.empty())
+    {
+        const Key key = mQueue.front();
+        mQueue.pop_front();
+        auto it = mEntries.find(key);
+        if (it == mEntries.end() || it->second.mState != tsQueued)
+        { continue; }
+
+        it->second.mState = tsLoading;
+        const string filenamePath = getFilenamePath(key);
+        lock.unlock();
+        shared_ptr<const Tile> pTile = loadTile(filenamePath);
+        lock.lock();
+
+        // entries being loaded are never removed.
+        Entry &e = mEntries[key];
+        if (pTile)
+        {
+            e.mState = tsLoaded;
+            e.mpTile = pTile;
+            mLru.push_front(key);
+            e.mLruPosition = mLru.begin();
+            mMemoryUsageInBytes += pTile->mData.size();
+            evictTiles();
+        }
+        else
+        { e.mState = tsMissing; }
+    }
+
+    if (--mNumberOfLoaders == 0)
+    { mNoLoaderCondition.notify_all(); }
+}
+
+//-----------------------------------------------------------------------------
+// Queues the tiles of the square of 2 * iRadiusInTiles + 1 tiles centered on
+// the tile under the point of interest, see class documentation.
+//
+void HgtTileCache::prefetch(double iLatitude, double iLongitude, int iRadiusInTiles)
+{
+    const Key center((int)floor(iLatitude), (int)floor(iLongitude));
+    vector<pair<double, Key>> keys;
+    for (int lat = center.first - iRadiusInTiles; lat <= center.first + iRadiusInTiles; ++lat)
+        for (int lon = center.second - iRadiusInTiles; lon <= center.second + iRadiusInTiles; ++lon)
+        {
+            const double dLat = lat + 0.5 - iLatitude, dLon = lon + 0.5 - iLongitude;
+            keys.push_back(make_pair(dLat * dLat + dLon * dLon, Key(lat, lon)));
+        }
+    sort(keys.begin(), keys.end());
+
+    {
+        unique_lock<mutex> lock(mMutex);
+        dropQueuedTiles();
+        for (const auto &k : keys)
+        { enqueue(k.second, false); }
+    }
+    startLoaders();
+}
+
+//-----------------------------------------------------------------------------
+// Writes the elevation, in meters, at (iLatitude, iLongitude) in
+// opElevation. Returns false when the tile is not loaded yet, is missing or
+// when the point has no elevation, see class documentation.
+//
+bool HgtTileCache::sampleElevation(double iLatitude, double iLongitude, double* opElevation)
+{
+    const Key key((int)floor(iLatitude), (int)floor(iLongitude));
+    shared_ptr<const Tile> pTile;
+    bool isQueued = false;
+    {
+        unique_lock<mutex> lock(mMutex);
+        auto it = mEntries.find(key);
+        if (it == mEntries.end())
+        {
+            enqueue(key, true);
+            isQueued = true;
+        }
+        else if (it->second.mState == tsLoaded)
+        {
+            pTile = it->second.mpTile;
+            mLru.splice(mLru.begin(), mLru, it->second.mLruPosition);
+        }
+    }
+
+    if (isQueued)
+    { startLoaders(); }
+
+    return pTile &&
+        pTile->sample((iLongitude - key.second) * pTile->mSamplesPerDegree,
+            (iLatitude - key.first) * pTile->mSamplesPerDegree, opElevation);
+}
+
+//-----------------------------------------------------------------------------
+// Tiles are looked for in this folder under their SRTM name when they were
+// not registered with addTile().
+//
+void HgtTileCache::setFolderPath(const std::string& iFolderPath)
+{
+    unique_lock<mutex> lock(mMutex);
+    mFolderPath = iFolderPath;
+}
+
+//-----------------------------------------------------------------------------
+void HgtTileCache::setMemoryBudgetInBytes(uint64_t iBudget)
+{
+    unique_lock<mutex> lock(mMutex);
+    mMemoryBudgetInBytes = iBudget;
+    evictTiles();
+}
+
+//-----------------------------------------------------------------------------
+// The pool must outlive the cache, or be changed before it is destroyed.
+//
+void HgtTileCache::setThreadPool(ThreadPool* ipPool)
+{
+    unique_lock<mutex> lock(mMutex);
+    mpThreadPool = ipPool;
+}
+
+//-----------------------------------------------------------------------------
+// Starts loader tasks, up to one per thread of the pool, for the queued
+// tiles. mMutex must not be locked: a pool that is not started runs the task
+// on the calling thread.
+//
+void HgtTileCache::startLoaders()
+{
+    int numberOfLoadersToStart = 0;
+    ThreadPool *pPool = nullptr;
+    {
+        unique_lock<mutex> lock(mMutex);
+        pPool = mpThreadPool;
+        const int maximum = max(pPool->getNumberOfThreads(), 1);
+        numberOfLoadersToStart = max(min(maximum - mNumberOfLoaders, (int)mQueue.size()), 0);
+        mNumberOfLoaders += numberOfLoadersToStart;
+    }
+
+    for (int i = 0; i < numberOfLoadersToStart; ++i)
+    {
+        pPool->submit([this]() { loaderLoop(); });
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Blocks until all queued tiles are loaded (or found missing).
+//
+void HgtTileCache::waitForPendingTiles()
+{
+    unique_lock<mutex> lock(mMutex);
+    mNoLoaderCondition.wait(lock, [this]() { return mNumberOfLoaders == 0; });
+}
+
+//-----------------------------------------------------------------------------
+// (iX, iY) is in samples from the lower left sample.
+//
+bool HgtTileCache::Tile::sample(double iX, double iY, double* opElevation) const
+{
+    const int last = mSize - 1;
+    if (!(iX >= 0.0 && iY >= 0.0 && iX <= last && iY <= last))
+    { return false; }
+
+    const int x0 = min((int)iX, last - 1), y0 = min((int)iY, last - 1);
+    const double tx = iX - x0, ty = iY - y0;
+    const int16_t *p = (const int16_t*)mData.constData() + (size_t)y0 * mSize + x0;
+    const int16_t samples[4] = { p[0], p[1], p[mSize], p[mSize + 1] };
+    const double weights[4] = { (1.0 - tx) * (1.0 - ty), tx * (1.0 - ty), (1.0 - tx) * ty, tx * ty };
+
+    double sum = 0.0, sumOfWeights = 0.0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (samples[i] != kVoidSample)
+        {
+            sum += weights[i] * samples[i];
+            sumOfWeights += weights[i];
+        }
+    }
+
+    if (sumOfWeights <= 0.0)
+    { return false; }
+    if (opElevation)
+    { *opElevation = sum / sumOfWeights; }
+    return true;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Core/ByteArray.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace Realisim
+{
+namespace Core
+{
+    class ThreadPool;
+
+    //-------------------------------------------------------------------------
+    // This class keeps SRTM tiles (see HgtImage) in memory to sample the
+    // elevation of any point covered by them, ex: terrain around a moving
+    // camera.
+    //
+    // Tiles are keyed by the latitude and longitude of their lower left
+    // corner, in degrees. The file of a tile is either registered with
+    // addTile() (the key comes from HgtImage::getLowerLeftCornerFromFileName())
+    // or found in the folder given to setFolderPath() under its SRTM name
+    // (see getTileFileName()).
+    //
+    // Usage:
+    //      HgtTileCache cache;
+    //      cache.setFolderPath("./srtm3");
+    //      cache.setMemoryBudgetInBytes(256 * 1024 * 1024);
+    //
+    //      // each frame
+    //      cache.prefetch(cameraLatitude, cameraLongitude, 2);
+    //      double elevation;
+    //      if (cache.sampleElevation(latitude, longitude, &elevation)) { ... }
+    //
+    // Loading:
+    //      Tiles are loaded (memory mapped) by tasks of a ThreadPool, the
+    //      global one unless setThreadPool() is called. sampleElevation()
+    //      never waits for the disk: when the tile is not in memory, it is
+    //      queued first in line and the call returns false.
+    //
+    //      prefetch() replaces the queued tiles, that are not being loaded
+    //      yet, by the tiles of the square of iRadiusInTiles around the point
+    //      of interest, nearest first. Tiles without a file are remembered
+    //      as missing and are not read again.
+    //
+    // Memory budget:
+    //      When a loaded tile makes the memory usage go over the budget, the
+    //      least recently sampled tiles are released. A tile being sampled
+    //      by another thread stays alive until that sample is done.
+    //
+    // Sampling:
+    //      The elevation, in meters, is interpolated between the 4 samples
+    //      around the point. Void samples (-32768) are ignored, when all 4 are
+    //      void the point has no elevation.
+    //
+    // All methods are thread safe.
+    //
+    class HgtTileCache
+    {
+    public:
+        HgtTileCache();
+        HgtTileCache(const HgtTileCache&) = delete;
+        HgtTileCache& operator=(const HgtTileCache&) = delete;
+        ~HgtTileCache();
+
+        bool addTile(const std::string& iFilenamePath);
+        void clear();
+        std::string getFolderPath() const;
+        uint64_t getMemoryBudgetInBytes() const;
+        uint64_t getMemoryUsageInBytes() const;
+        int getNumberOfLoadedTiles() const;
+        int getNumberOfPendingTiles() const;
+        static std::string getTileFileName(int iLatitude, int iLongitude);
+        bool isTileLoaded(int iLatitude, int iLongitude) const;
+        void prefetch(double iLatitude, double iLongitude, int iRadiusInTiles);
+        bool sampleElevation(double iLatitude, double iLongitude, double* opElevation);
+        void setFolderPath(const std::string& iFolderPath);
+        void setMemoryBudgetInBytes(uint64_t iBudget);
+        void setThreadPool(ThreadPool* ipPool);
+        void waitForPendingTiles();
+
+    protected:
+        // latitude, longitude of the lower left corner
+        typedef std::pair<int, int> Key;
+
+        struct Tile
+        {
+            bool sample(double iX, double iY, double* opElevation) const;
+
+            ByteArray mData; // int16 samples, southernmost line first
+            int mSize; // samples per line and number of lines
+            double mSamplesPerDegree;
+        };
+
+        enum TileState { tsQueued, tsLoading, tsLoaded, tsMissing };
+
+        struct Entry
+        {
+            TileState mState;
+            std::shared_ptr<const Tile> mpTile;
+            std::list<Key>::iterator mLruPosition; // tsLoaded only
+        };
+
+        void dropQueuedTiles();
+        void enqueue(const Key& iKey, bool iFirstInLine);
+        void evictTiles();
+        std::string getFilenamePath(const Key& iKey) const;
+        static std::shared_ptr<Tile> loadTile(const std::string& iFilenamePath);
+        void loaderLoop();
+        void startLoaders();
+
+        mutable std::mutex mMutex;
+        std::condition_variable mNoLoaderCondition;
+        std::map<Key, Entry> mEntries;
+        std::map<Key, std::string> mKeyToFilenamePath; // see addTile()
+        std::list<Key> mLru; // most recently sampled first
+        std::deque<Key> mQueue; // next to load first
+        std::string mFolderPath;
+        uint64_t mMemoryBudgetInBytes;
+        uint64_t mMemoryUsageInBytes;
+        int mNumberOfLoaders;
+        ThreadPool* mpThreadPool;
+    };
+}
+}
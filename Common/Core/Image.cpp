@@ -5,8 +5,11 @@
 #include "Half/half.hpp"
 #include "Image.h"
 #include "ImageSupport/ImageBufferHelpers.h"
+#include "ImageView.h"
 #include "Math/Conversion.h"
 #include "Math/Interpolation.h"
+#include <memory>
+#include "ThreadPool.h"
 
 using namespace Realisim;
     using namespace Core;
@@ -21,7 +24,9 @@ Image::Image() :
     mSizeInPixel(),
     mSizeInBytes(0),
     mInternalFormat(iifUndefined),
-    mIsValid(false)
+    mWrapType(wtClampToBorder),
+    mIsValid(false),
+    mIsMemoryMappingEnabled(false)
 {
 }
 
@@ -32,7 +37,9 @@ Image::Image(const std::string& iFilenamePath) :
     mSizeInPixel(),
     mSizeInBytes(0),
     mInternalFormat(iifUndefined),
-    mIsValid(false)
+    mWrapType(wtClampToBorder),
+    mIsValid(false),
+    mIsMemoryMappingEnabled(false)
 {
 }
 
@@ -88,6 +95,14 @@ bool Image::applyWrapType(int iX, int iY, uint64_t *iPx, uint64_t *iPy) const
     return r;
 }
 
+//-----------------------------------------------------------------------------
+// Copies all of iSource at iDestination, see copyRect().
+//
+void Image::blit(const Image& iSource, const Math::Vector2i& iDestination)
+{
+    copyRect(iSource, Vector2i(0, 0), iSource.getSizeInPixels(), iDestination);
+}
+
 //-----------------------------------------------------------------------------
 void Image::clear()
 {
@@ -110,6 +125,50 @@ void Image::clear()
     mIsValid = false;
 }
 
+//-----------------------------------------------------------------------------
+// Copies the iSize rectangle at iSourceOrigin of iSource at iDestination. The
+// rectangle is clipped to both images. iSource can be this image.
+//
+// Returns false when both images do not have the same internal format,
+// nothing is copied.
+//
+bool Image::copyRect(const Image& iSource, const Math::Vector2i& iSourceOrigin,
+    const Math::Vector2i& iSize, const Math::Vector2i& iDestination)
+{
+    if (iSource.getInternalFormat() != getInternalFormat() ||
+        !hasImageData() || !iSource.hasImageData())
+    { return false; }
+
+    visitImageInternalFormat(getInternalFormat(), [&](auto iFormat) {
+        // the destination is detached first, when iSource is this image,
+        // both views point in the detached data.
+        ImageView<decltype(iFormat)::value> destination(*this);
+        ConstImageView<decltype(iFormat)::value> source(iSource);
+        destination.copyRect(source, iSourceOrigin, iSize, iDestination);
+    });
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void Image::fill(const Color& iCol)
+{
+    fill(Vector2i(0, 0), getSizeInPixels(), iCol);
+}
+
+//-----------------------------------------------------------------------------
+// Sets all pixels of the iSize rectangle at iOrigin to iCol. The color is
+// converted to the internal format once.
+//
+void Image::fill(const Math::Vector2i& iOrigin, const Math::Vector2i& iSize, const Color& iCol)
+{
+    if (!hasImageData()) { return; }
+
+    visitImageInternalFormat(getInternalFormat(), [&](auto iFormat) {
+        ImageView<decltype(iFormat)::value> view(*this);
+        view.fill(iOrigin, iSize, view.makePixel(iCol));
+    });
+}
+
 //----------------------------------------------------------------------------
 // Flips vertically (180 deg around x axis) the content of the ByteArray iBa.
 // Iba must have uncompressed data.
@@ -280,13 +339,7 @@ Color Image::getPixelColor(const Math::Vector2i& iPixel) const
 //
 Color Image::getPixelColor(double iX, double iY) const
 {
-    //pixels that will take part in the bilinear interpolation
-    // 4 pixels ordered in the following manner
-    //
-    // 0: bottomleft
-    // 1: bottomright
-    // 2: topRight
-    // 3: topLeft
+    // The 4 pixels around p take part in the bilinear interpolation:
     //
     //  [3]           [2]
     //  0,1           1,1
@@ -299,81 +352,21 @@ Color Image::getPixelColor(double iX, double iY) const
     //  0,0           1,0
     //  [0]            [1]
     //
-    // Point p, is the x,y position in bilieaner interpolation space, it alsp 
-    // represent the weight of each sample.
+    // Pixel centers are at +0.5, [0] is the pixel whose center is the
+    // closest below and left of p. The position of p relative to the center
+    // of [0] is the weight of each sample.
     //
-
-    vector<Vector2> pixels = { Vector2(0.0, 0.0),
-        Vector2(1.0, 0.0),
-        Vector2(1.0, 1.0),
-        Vector2(0.0, 1.0) };
-    vector<Color> pixelColors(4, Color());
-    vector<Vector2i> samplePositions(4, Vector2i(0));
-
-    //define in which quadrant (from he center of the pixel)
-    //the current sample pixel is and make the 4 color samples
-    // required for the bilinear interpolation
+    // For many samples, see ImageSampler which also avoids the wrap type
+    // and the format switch of each getPixelColor(int, int).
     //
-    const Vector2 pixel(iX, iY);
-    const Vector2i pixelCenterI((int)iX, (int)iY);
-    const Vector2 pixelCenter(pixelCenterI.x() + 0.5, pixelCenterI.y() + 0.5);
-    const Vector2 d = pixel - pixelCenter;
+    const double fx = floor(iX - 0.5), fy = floor(iY - 0.5);
+    const int x0 = (int)fx, y0 = (int)fy;
 
-    //left side
-    if (d.x() <= 0)
-    {
-        //lower left
-        if (d.y() <= 0)
-        {
-            samplePositions[0] = pixelCenterI + Vector2i(-1, -1);
-            samplePositions[1] = pixelCenterI + Vector2i(0, -1);
-            samplePositions[2] = pixelCenterI + Vector2i(0, 0);
-            samplePositions[3] = pixelCenterI + Vector2i(-1, 0);
-        }
-        //upper left
-        else if (d.y() > 0)
-        {
-            samplePositions[0] = pixelCenterI + Vector2i(-1, 0);
-            samplePositions[1] = pixelCenterI + Vector2i(0, 0);
-            samplePositions[2] = pixelCenterI + Vector2i(0, 1);
-            samplePositions[3] = pixelCenterI + Vector2i(-1, 1);
-        }
-    }
-    //right side
-    else
-    {
-        //lower rigth (includes y == 0)!!!
-        if (d.y() <= 0)
-        {
-            samplePositions[0] = pixelCenterI + Vector2i(0, -1);
-            samplePositions[1] = pixelCenterI + Vector2i(1, -1);
-            samplePositions[2] = pixelCenterI + Vector2i(1, 0);
-            samplePositions[3] = pixelCenterI + Vector2i(0, 0);
-        }
-        // upper right
-        else if (d.y() > 0)
-        {
-            samplePositions[0] = pixelCenterI + Vector2i(0, 0);
-            samplePositions[1] = pixelCenterI + Vector2i(1, 0);
-            samplePositions[2] = pixelCenterI + Vector2i(1, 1);
-            samplePositions[3] = pixelCenterI + Vector2i(0, 1);
-        }
-    }
-
-    // fetch all color samples
-    for (int i = 0; i < 4; i++)
-    {
-        pixelColors[i] = getPixelColor(samplePositions[i].x(), samplePositions[i].y());
-    }
-
-    // since we created a normalized rectangle of interpolation, with
-    // samplePosition[0] always being the lower left corner,
-    // we compute de interpoation factor by substracting the requested
-    // pixel position (pixel) to the center (origin) of the lower left
-    // sampling corner.
-    //
-    const Vector2 dxdy = pixel - ((toVector2(samplePositions[0])) + Vector2(0.5)); //point of interpolation in samples normalized space
-    return biLerp(pixelColors[0], pixelColors[1], pixelColors[2], pixelColors[3], fabs(dxdy.x()), fabs(dxdy.y()));
+    return biLerp(getPixelColor(x0, y0),
+        getPixelColor(x0 + 1, y0),
+        getPixelColor(x0 + 1, y0 + 1),
+        getPixelColor(x0, y0 + 1),
+        iX - 0.5 - fx, iY - 0.5 - fy);
 }
 
 //----------------------------------------------------------------------------
@@ -439,6 +432,12 @@ bool Image::hasImageData() const
     return !mImageData.isEmpty();
 }
 
+//----------------------------------------------------------------------------
+bool Image::isMemoryMappingEnabled() const
+{
+    return mIsMemoryMappingEnabled;
+}
+
 //----------------------------------------------------------------------------
 bool Image::isValid() const
 {
@@ -477,8 +476,12 @@ bool Image::load(Format iFormat, bool iHeaderOnly)
         //    case fDds: r = loadDdsImage(getFilenamePath(), false); break;
     case fPng: 
 #ifdef REALISIM_THIRDPARTIES_LODEPNG
-        reader = new PngImage();
-        flipVertical = true;
+    {
+        // rows are flipped while decoding, no flip pass needed.
+        PngImage *png = new PngImage();
+        png->setVerticalFlipOnLoad(true);
+        reader = png;
+    }
 #endif // REALISIM_THIRDPARTIES_LODEPNG
         break;
         //	case fTiff: r = loadTiffImage(getFilenamePath(), false); break;
@@ -493,6 +496,7 @@ bool Image::load(Format iFormat, bool iHeaderOnly)
     if (reader)
     {
         r = load(reader, iHeaderOnly, flipVertical);
+        delete reader;
     }
     else
     {
@@ -509,6 +513,7 @@ bool Image::load(IImageReader *ipReader, bool iHeaderOnly, bool iFlipVertical)
     bool r = false;
     const string &iFilename = getFilenamePath();
     ipReader->setFilenamePath(iFilename);
+    ipReader->setMemoryMappingEnabled(isMemoryMappingEnabled());
     iHeaderOnly ? ipReader->loadHeader() : ipReader->load();
 
     if (ipReader->isValid())
@@ -526,6 +531,21 @@ bool Image::load(IImageReader *ipReader, bool iHeaderOnly, bool iFlipVertical)
     return r;
 }
 
+//----------------------------------------------------------------------------
+// Loads the images at iFilenamePaths in parallel on the global thread pool,
+// see load(). The returned images are in the order of iFilenamePaths, the
+// ones that could not be loaded are invalid (see isValid()).
+//
+std::vector<Image> Image::loadAll(const std::vector<std::string>& iFilenamePaths)
+{
+    std::vector<Image> images(iFilenamePaths.size());
+    ThreadPool::getGlobalInstance().parallelFor((int)images.size(), [&images, &iFilenamePaths](int iIndex) {
+        images[iIndex].set(iFilenamePaths[iIndex]);
+        images[iIndex].load();
+    });
+    return images;
+}
+
 //----------------------------------------------------------------------------
 bool Image::loadHeader()
 { 
@@ -548,6 +568,12 @@ bool Image::loadHeader()
 bool Image::saveAs(const std::string& iFilenamePath, WritableFormat iF)
 {
     bool r = false;
+
+    // the data may be mapped from the file being overwritten, it is
+    // detached (copied) first.
+    if (iFilenamePath == mFilenamePath && hasImageData())
+    { mImageData.data(); }
+
     mFilenamePath = iFilenamePath;
 
     switch (iF)
@@ -563,6 +589,29 @@ bool Image::saveAs(const std::string& iFilenamePath, WritableFormat iF)
     return r;
 }
 
+//----------------------------------------------------------------------------
+// Same as saveAs() but the file is encoded and written by a task of the global
+// thread pool. The image (not its data, see ByteArray) is copied in the task:
+// it can be modified or destroyed right away, the saved file holds the image
+// as it was when saveAsAsync() was called.
+//
+// The returned future gives the result of saveAs().
+//
+std::future<bool> Image::saveAsAsync(const std::string& iFilenamePath, WritableFormat iF)
+{
+    if (iFilenamePath == mFilenamePath && hasImageData())
+    { mImageData.data(); }
+    mFilenamePath = iFilenamePath;
+
+    // std::function must be copyable, the packaged task is shared.
+    auto pTask = make_shared<packaged_task<bool()>>([copy = *this, iFilenamePath, iF]() mutable {
+        return copy.saveAs(iFilenamePath, iF);
+    });
+    std::future<bool> r = pTask->get_future();
+    ThreadPool::getGlobalInstance().submit([pTask]() { (*pTask)(); });
+    return r;
+}
+
 //----------------------------------------------------------------------------
 // Will save the uncompressed image data (mImageData) to png format.
 // The bit depth and number of channels of the original image will be preserved.
@@ -815,6 +864,12 @@ void Image::setPixelColor(Math::Vector2 iPixel, const Color& iCol)
     setPixelColor(Vector2i((int)iPixel.x(), (int)iPixel.y()), iCol);
 }
 
+//----------------------------------------------------------------------------
+void Image::setMemoryMappingEnabled(bool iV)
+{
+    mIsMemoryMappingEnabled = iV;
+}
+
 //----------------------------------------------------------------------------
 void Image::setWrapType(WrapType iWt)
 {
@@ -25,13 +25,18 @@
 #endif // REALISIM_THIRDPARTIES_TGA
 //--- End of ImageSUpport------------------------------------------------------
 
+#include <future>
 #include "Math/Vector.h"
 #include "Math/VectorI.h"
+#include <string>
+#include <vector>
 
 namespace Realisim
 {
 namespace Core
 {
+    template<ImageInternalFormat kFormat, typename ByteType> class ImageView;
+
     /*-------------------------------------------------------------------------
     This class presents a 2d image.
 
@@ -80,8 +85,35 @@ namespace Core
         fTiff:
         fHgt:
     
+    Memory mapping:
+        With setMemoryMappingEnabled(true), fRaw and fHgt files are memory mapped
+        instead of being read (see ByteArray::fromMappedFile()). Only the pages that
+        are accessed are read. The data of a raw image then points directly in the
+        file until it is modified (copy-on-write), the file must not be rewritten by
+        another process while the image uses it.
+
+    Bulk pixel access:
+        getPixelColor() and setPixelColor() switch on the internal format for
+        each pixel. To process many pixels, use an ImageView (see ImageView.h)
+        for the internal format, or fill(), copyRect() and blit() which
+        dispatch on the format once per call.
+
+    Loading many images:
+        loadAll() loads a list of files in parallel on the global thread pool
+        (see ThreadPool::getGlobalInstance()).
+
     Saving images:
-        
+        saveAs() encodes and writes the file on the calling thread.
+        saveAsAsync() does it on the global thread pool and returns a
+        std::future<bool>, the image can be modified as soon as the call
+        returns. The task shares the image data, the first write to the image
+        copies it (copy-on-write, see ByteArray).
+
+            std::future<bool> saved = im.saveAsAsync("frame.png", Image::wfPng);
+            ... render the next frame in im ...
+            saved.get();
+
+        Png are decoded and encoded by PngImage (see ImageSupport/PngImage.h).
 
     Explanation on origin of pixel at (0.5, 0.5)
     Explanantion on interpolation set to clamp to border
@@ -113,7 +145,12 @@ namespace Core
         Image& operator=(const Image&) = default;
         virtual ~Image();
 
+        void blit(const Image& iSource, const Math::Vector2i& iDestination);
         void clear();
+        bool copyRect(const Image& iSource, const Math::Vector2i& iSourceOrigin,
+            const Math::Vector2i& iSize, const Math::Vector2i& iDestination);
+        void fill(const Color& iCol);
+        void fill(const Math::Vector2i& iOrigin, const Math::Vector2i& iSize, const Color& iCol);
         void flipVertical(); //flips 180 deg around x axis
         int getBytesPerChannel() const;
         static std::string getExtensionFromFormat(Format);
@@ -134,13 +171,17 @@ namespace Core
         int getWidth() const;
         WrapType getWrapType() const;
         bool hasImageData() const;
+        bool isMemoryMappingEnabled() const;
         bool isValid() const;
         bool load();
+        static std::vector<Image> loadAll(const std::vector<std::string>& iFilenamePaths);
         bool loadHeader();
         bool saveAs(const std::string& iFilenamePath, WritableFormat iF);
+        std::future<bool> saveAsAsync(const std::string& iFilenamePath, WritableFormat iF);
         //bool saveAs(const std::string& iFilenamePath, const DdsImage::SaveOptions& iSaveOption); //implicitly save as DDS.
         void set(const std::string& iFilenamePath);
         void setFilenamePath(const std::string& iFilenamePath);
+        void setMemoryMappingEnabled(bool iV);
         void set(int iWidth, int iHeight, ImageInternalFormat iIf);
         void set(const Math::Vector2i& iSize, ImageInternalFormat iIf);
         void setData(int iWidth, int iHeight, ImageInternalFormat iIf, const char* ipData);
@@ -151,6 +192,8 @@ namespace Core
         void unloadImageData();
         
     protected:
+        template<ImageInternalFormat kFormat, typename ByteType> friend class ImageView;
+
         bool applyWrapType(int iX, int iY, uint64_t *iPx, uint64_t *iPy) const;
         void flipVertical(ByteArray& iBa);
         Format guessFormatFromFileName() const;
@@ -167,6 +210,7 @@ namespace Core
         ImageInternalFormat mInternalFormat;
         WrapType mWrapType;
         bool mIsValid;
+        bool mIsMemoryMappingEnabled;
     };
 }
 }
\ No newline at end of file
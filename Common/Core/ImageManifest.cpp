@@ -0,0 +1,126 @@
+
+#include <algorithm>
+#include "Core/ImageManifest.h"
+#include "Core/ThreadPool.h"
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+//------------------------------------------------------------------------------
+ImageManifest::Entry::Entry() :
+    mFilenamePath(),
+    mFormat(Image::fUnsupported),
+    mSizeInPixels(0, 0),
+    mInternalFormat(iifUndefined),
+    mSizeInBytes(0),
+    mIsValid(false)
+{}
+
+//------------------------------------------------------------------------------
+void ImageManifest::clear()
+{
+    mEntries.clear();
+    mFilenamePathToIndex.clear();
+}
+
+//------------------------------------------------------------------------------
+// Returns the entry of iFilenamePath, nullptr when it was not scanned.
+//
+const ImageManifest::Entry* ImageManifest::find(const std::string& iFilenamePath) const
+{
+    auto it = mFilenamePathToIndex.find(iFilenamePath);
+    return it != mFilenamePathToIndex.end() ? &mEntries[it->second] : nullptr;
+}
+
+//------------------------------------------------------------------------------
+const std::vector<ImageManifest::Entry>& ImageManifest::getEntries() const
+{
+    return mEntries;
+}
+
+//------------------------------------------------------------------------------
+const ImageManifest::Entry& ImageManifest::getEntry(int iIndex) const
+{
+    return mEntries[iIndex];
+}
+
+//------------------------------------------------------------------------------
+// Returns the paths of the valid entries sorted by size in bytes. Equal sizes
+// keep the order of the scan.
+//
+std::vector<std::string> ImageManifest::getFilenamePathsBySize(bool iLargestFirst /*= true*/) const
+{
+    vector<int> indices;
+    indices.reserve(mEntries.size());
+    for (int i = 0; i < (int)mEntries.size(); ++i)
+    {
+        if (mEntries[i].mIsValid)
+        { indices.push_back(i); }
+    }
+
+    stable_sort(indices.begin(), indices.end(), [this, iLargestFirst](int iA, int iB) {
+        return iLargestFirst ? mEntries[iA].mSizeInBytes > mEntries[iB].mSizeInBytes :
+            mEntries[iA].mSizeInBytes < mEntries[iB].mSizeInBytes;
+    });
+
+    vector<string> r;
+    r.reserve(indices.size());
+    for (int i : indices)
+    { r.push_back(mEntries[i].mFilenamePath); }
+    return r;
+}
+
+//------------------------------------------------------------------------------
+int ImageManifest::getNumberOfEntries() const
+{
+    return (int)mEntries.size();
+}
+
+//------------------------------------------------------------------------------
+int ImageManifest::getNumberOfValidEntries() const
+{
+    return (int)count_if(mEntries.begin(), mEntries.end(), [](const Entry& iEntry) { return iEntry.mIsValid; });
+}
+
+//------------------------------------------------------------------------------
+// Returns the size in bytes of all valid images once loaded.
+//
+uint64_t ImageManifest::getTotalSizeInBytes() const
+{
+    uint64_t r = 0;
+    for (const Entry& entry : mEntries)
+    {
+        if (entry.mIsValid)
+        { r += entry.mSizeInBytes; }
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------
+ImageManifest ImageManifest::scan(const std::vector<std::string>& iFilenamePaths)
+{
+    ImageManifest r;
+    r.mEntries.resize(iFilenamePaths.size());
+    ThreadPool::getGlobalInstance().parallelFor((int)iFilenamePaths.size(), [&r, &iFilenamePaths](int iIndex) {
+        Entry& entry = r.mEntries[iIndex];
+        entry.mFilenamePath = iFilenamePaths[iIndex];
+        entry.mFormat = Image::getFormatFromFilename(entry.mFilenamePath);
+        if (entry.mFormat == Image::fUnsupported)
+        { return; }
+
+        Image image;
+        image.setFilenamePath(entry.mFilenamePath);
+        if (image.loadHeader())
+        {
+            entry.mSizeInPixels = image.getSizeInPixels();
+            entry.mInternalFormat = image.getInternalFormat();
+            entry.mSizeInBytes = image.getSizeInBytes();
+            entry.mIsValid = true;
+        }
+    });
+
+    for (int i = 0; i < (int)r.mEntries.size(); ++i)
+    { r.mFilenamePathToIndex.emplace(r.mEntries[i].mFilenamePath, i); }
+    return r;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Core/Image.h"
+#include "Core/ImageInternalFormat.h"
+#include "Math/VectorI.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // This class lists image files with the metadata found in their headers
+    // (see Image::loadHeader()), the image data is never read. It is meant to
+    // plan the loading of many images, ex: the textures of a scene, before
+    // paying for it.
+    //
+    // Usage:
+    //      ImageManifest manifest = ImageManifest::scan(filenamePaths);
+    //      if (manifest.getTotalSizeInBytes() > budget) { ... }
+    //
+    //      // largest images first, to balance the threads of Image::loadAll()
+    //      vector<Image> images = Image::loadAll(manifest.getFilenamePathsBySize());
+    //
+    // scan() reads the headers in parallel on the global ThreadPool. Entries
+    // are in the order of the given paths, a file that is missing, of an
+    // unsupported format or with an invalid header has an invalid entry.
+    //
+    class ImageManifest
+    {
+    public:
+        struct Entry
+        {
+            Entry();
+
+            std::string mFilenamePath;
+            Image::Format mFormat;
+            Math::Vector2i mSizeInPixels;
+            ImageInternalFormat mInternalFormat;
+            uint64_t mSizeInBytes; // of the image data once loaded
+            bool mIsValid;
+        };
+
+        ImageManifest() = default;
+        ImageManifest(const ImageManifest&) = default;
+        ImageManifest& operator=(const ImageManifest&) = default;
+        ~ImageManifest() = default;
+
+        void clear();
+        const Entry* find(const std::string& iFilenamePath) const;
+        const std::vector<Entry>& getEntries() const;
+        const Entry& getEntry(int iIndex) const;
+        std::vector<std::string> getFilenamePathsBySize(bool iLargestFirst = true) const;
+        int getNumberOfEntries() const;
+        int getNumberOfValidEntries() const;
+        uint64_t getTotalSizeInBytes() const;
+        static ImageManifest scan(const std::vector<std::string>& iFilenamePaths);
+
+    protected:
+        std::vector<Entry> mEntries;
+        std::map<std::string, int> mFilenamePathToIndex;
+    };
+}
+}
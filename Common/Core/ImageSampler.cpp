@@ -0,0 +1,450 @@
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "Core/ImageSampler.h"
+#include "Core/ImageSupport/ImageBufferHelpers.h"
+#include "Core/ImageView.h"
+#include "Core/ThreadPool.h"
+#include "Half/half.hpp"
+#include <limits>
+#include "Math/Interpolation.h"
+
+using namespace Realisim;
+    using namespace Core;
+    using namespace Math;
+using namespace std;
+
+namespace
+{
+    // Same as normalize() in Color.cpp, the constants are folded for each
+    // channel type.
+    template<typename T>
+    inline double normalizeChannel(T iValue)
+    {
+        const int64_t vMin = std::numeric_limits<T>::min();
+        const int64_t vMax = std::numeric_limits<T>::max();
+        const double oneOverD = 1.0 / (double)(vMax - vMin);
+        const double r = (int64_t)(iValue - vMin) * oneOverD;
+        return vMin < 0 ? r - 0.5 : r;
+    }
+
+    inline double normalizeChannel(float iValue) { return iValue; }
+    inline double normalizeChannel(half_float::half iValue) { return (float)iValue; }
+
+    // The bits of a coordinate inside a tile, spread on the even bits. The
+    // Morton index of texel (x, y) inside a tile is
+    // kMortonSpread[x] | (kMortonSpread[y] << 1).
+    const uint32_t kMortonSpread[ImageSampler::kTileSize] = { 0, 1, 4, 5, 16, 17, 20, 21 };
+    const int kTileSizeLog2 = 3;
+    const int kTexelsPerTileLog2 = 2 * kTileSizeLog2;
+
+    // A tap of the mip level filter, offsets are relative to the top left
+    // texel of the 2x2 texels under the destination texel.
+    struct FilterTap
+    {
+        int mDx;
+        int mDy;
+        double mWeight;
+    };
+
+    //-------------------------------------------------------------------------
+    // Taps of the filter used to halve a level.
+    //
+    // FilterKernelLanczos(5) evaluates the kernel at offsets -2.5 to 1.5 from
+    // its center, which are the offsets of the texel centers of the source
+    // level around the center of a destination texel. The offset 2.5 is
+    // mirrored from -2.5 (the kernel is radial) to get a symmetric 6x6
+    // footprint. Null taps are dropped and the weights sum to 1.
+    //
+    vector<FilterTap> makeMipFilterTaps()
+    {
+        FilterKernelLanczos kernel(5);
+        const int n = kernel.getSize();
+        vector<FilterTap> taps;
+        double sum = 0.0;
+        for (int j = 0; j <= n; ++j)
+            for (int i = 0; i <= n; ++i)
+            {
+                const double w = kernel.evaluate(i == n ? 0 : i, j == n ? 0 : j);
+                if (w > 0.0)
+                {
+                    taps.push_back({ i - n / 2, j - n / 2, w });
+                    sum += w;
+                }
+            }
+
+        for (auto &t : taps)
+        { t.mWeight /= sum; }
+        return taps;
+    }
+}
+
+//-----------------------------------------------------------------------------
+ImageSampler::ImageSampler() :
+    mLevels(),
+    mInternalFormat(iifUndefined),
+    mBytesPerPixel(0),
+    mpDecode(nullptr),
+    mWrapType(Image::wtClampToBorder),
+    mStorageLayout(slRowMajor)
+{}
+
+//-----------------------------------------------------------------------------
+ImageSampler::ImageSampler(const Image& iImage, StorageLayout iLayout /*= slRowMajor*/, bool iGenerateMipLevels /*= false*/) :
+    ImageSampler()
+{
+    if (!iImage.isValid() || !iImage.hasImageData())
+    { return; }
+
+    mInternalFormat = iImage.getInternalFormat();
+    mBytesPerPixel = iImage.getBytesPerChannel() * iImage.getNumberOfChannels();
+    mWrapType = iImage.getWrapType();
+    mStorageLayout = iLayout;
+    visitImageInternalFormat(mInternalFormat, [this](auto iFormat) {
+        mpDecode = &ImageSampler::decodeTexel<decltype(iFormat)::value>;
+    });
+
+    const int w = iImage.getWidth(), h = iImage.getHeight();
+    if (mStorageLayout == slRowMajor)
+    {
+        Level base = makeLevel(w, h);
+        base.mData = iImage.getImageData();
+        mLevels.push_back(base);
+    }
+    else
+    {
+        Level base = makeLevel(w, h);
+        const char *pSource = iImage.getImageData().constData();
+        char *pData = base.mData.data();
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+            {
+                memcpy(pData + getTexelOffset(base, x, y),
+                    pSource + ((size_t)y * w + x) * mBytesPerPixel, mBytesPerPixel);
+            }
+        mLevels.push_back(base);
+    }
+
+    if (iGenerateMipLevels)
+    { generateMipLevels(); }
+}
+
+//-----------------------------------------------------------------------------
+// Same values as getColorFromImageBuffer(): channels absent from single
+// channel formats are 0, the absent alpha of rgb formats is the normalized 0
+// of the channel type.
+//
+template<ImageInternalFormat kFormat>
+void ImageSampler::decodeTexel(const char* ipTexel, double* opRgba)
+{
+    typedef typename PixelTraits<kFormat>::ChannelType T;
+    const int n = PixelTraits<kFormat>::kNumberOfChannels;
+    const T *p = (const T*)ipTexel;
+
+    opRgba[0] = normalizeChannel(p[0]);
+    opRgba[1] = n > 1 ? normalizeChannel(p[1]) : 0.0;
+    opRgba[2] = n > 1 ? normalizeChannel(p[2]) : 0.0;
+    opRgba[3] = n > 3 ? normalizeChannel(p[3]) : (n == 3 ? normalizeChannel(T(0)) : 0.0);
+}
+
+//-----------------------------------------------------------------------------
+// Decodes the texel (iX, iY) of the level, after applying the wrap type.
+//
+void ImageSampler::fetch(const Level& iLevel, int iX, int iY, double* opRgba) const
+{
+    switch (mWrapType)
+    {
+    case Image::wtClampToBorder:
+        if (iX < 0 || iY < 0 || iX >= iLevel.mWidth || iY >= iLevel.mHeight)
+        {
+            std::fill(opRgba, opRgba + 4, 0.0);
+            return;
+        }
+        break;
+    case Image::wtClampToEdge:
+        iX = (int)indexToClampedToEdgeIndex(iX, iLevel.mWidth);
+        iY = (int)indexToClampedToEdgeIndex(iY, iLevel.mHeight);
+        break;
+    case Image::wtRepeat:
+        iX = (int)indexToPeriodicIndex(iX, iLevel.mWidth);
+        iY = (int)indexToPeriodicIndex(iY, iLevel.mHeight);
+        break;
+    default: assert(0); break;
+    }
+    mpDecode(iLevel.mData.constData() + getTexelOffset(iLevel, iX, iY), opRgba);
+}
+
+//-----------------------------------------------------------------------------
+// Builds the mip levels, see class documentation. Levels are in the internal
+// format and the storage layout of the sampler. Texels of the source level
+// outside of it are clamped to its edges, whatever the wrap type.
+//
+// Rows of a level are filtered in parallel on the global thread pool.
+//
+void ImageSampler::generateMipLevels()
+{
+    if (!isValid()) return;
+    mLevels.resize(1);
+
+    const vector<FilterTap> taps = makeMipFilterTaps();
+    const int kRowsPerTask = 16;
+    while (mLevels.back().mWidth > 1 || mLevels.back().mHeight > 1)
+    {
+        const Level source = mLevels.back();
+        Level level = makeLevel(std::max(source.mWidth / 2, 1), std::max(source.mHeight / 2, 1));
+        char *pData = level.mData.data();
+        const char *pSource = source.mData.constData();
+
+        auto filterRows = [&](int iTask)
+        {
+            const int yEnd = std::min((iTask + 1) * kRowsPerTask, level.mHeight);
+            for (int y = iTask * kRowsPerTask; y < yEnd; ++y)
+                for (int x = 0; x < level.mWidth; ++x)
+                {
+                    double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+                    for (const auto &t : taps)
+                    {
+                        const int sx = (int)indexToClampedToEdgeIndex(2 * x + t.mDx, source.mWidth);
+                        const int sy = (int)indexToClampedToEdgeIndex(2 * y + t.mDy, source.mHeight);
+                        double texel[4];
+                        mpDecode(pSource + getTexelOffset(source, sx, sy), texel);
+                        for (int i = 0; i < 4; ++i)
+                        { sum[i] += t.mWeight * texel[i]; }
+                    }
+
+                    Color c;
+                    c.setF64(sum[0], sum[1], sum[2], sum[3]);
+                    setColorToImageBuffer(pData + getTexelOffset(level, x, y), mInternalFormat, c);
+                }
+        };
+
+        const int numberOfTasks = (level.mHeight + kRowsPerTask - 1) / kRowsPerTask;
+        if ((int64_t)level.mWidth * level.mHeight > 64 * 1024)
+        { ThreadPool::getGlobalInstance().parallelFor(numberOfTasks, filterRows); }
+        else
+        {
+            for (int i = 0; i < numberOfTasks; ++i)
+            { filterRows(i); }
+        }
+        mLevels.push_back(level);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Returns the lod of a lookup covering iFootprintInTexels texels of level 0.
+// Magnified lookups (footprint smaller than a texel) are at lod 0.
+//
+double ImageSampler::getLod(double iFootprintInTexels)
+{
+    return iFootprintInTexels > 1.0 ? log2(iFootprintInTexels) : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+int ImageSampler::getNumberOfMipLevels() const
+{
+    return (int)mLevels.size();
+}
+
+//-----------------------------------------------------------------------------
+Math::Vector2i ImageSampler::getSizeInPixels(int iMipLevel /*= 0*/) const
+{
+    if (iMipLevel < 0 || iMipLevel >= getNumberOfMipLevels())
+    { return Vector2i(0, 0); }
+    return Vector2i(mLevels[iMipLevel].mWidth, mLevels[iMipLevel].mHeight);
+}
+
+//-----------------------------------------------------------------------------
+ImageSampler::StorageLayout ImageSampler::getStorageLayout() const
+{
+    return mStorageLayout;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the offset, in bytes, of texel (iX, iY) inside the data of the
+// level. (iX, iY) must be inside the level.
+//
+inline size_t ImageSampler::getTexelOffset(const Level& iLevel, int iX, int iY) const
+{
+    if (mStorageLayout == slRowMajor)
+    { return iY * iLevel.mRowStride + (size_t)iX * mBytesPerPixel; }
+
+    const size_t tile = (size_t)(iY >> kTileSizeLog2) * iLevel.mTilesPerRow + (iX >> kTileSizeLog2);
+    const size_t texelInTile = kMortonSpread[iX & (kTileSize - 1)] | (kMortonSpread[iY & (kTileSize - 1)] << 1);
+    return ((tile << kTexelsPerTileLog2) | texelInTile) * mBytesPerPixel;
+}
+
+//-----------------------------------------------------------------------------
+Image::WrapType ImageSampler::getWrapType() const
+{
+    return mWrapType;
+}
+
+//-----------------------------------------------------------------------------
+bool ImageSampler::isValid() const
+{
+    return !mLevels.empty();
+}
+
+//-----------------------------------------------------------------------------
+// Returns a level of iWidth x iHeight texels with allocated data in the
+// storage layout of the sampler. With slTiled, the level is padded to whole
+// tiles.
+//
+ImageSampler::Level ImageSampler::makeLevel(int iWidth, int iHeight) const
+{
+    Level l;
+    l.mWidth = iWidth;
+    l.mHeight = iHeight;
+    l.mRowStride = (size_t)iWidth * mBytesPerPixel;
+    l.mTilesPerRow = (size_t)(iWidth + kTileSize - 1) >> kTileSizeLog2;
+    const size_t tileRows = (size_t)(iHeight + kTileSize - 1) >> kTileSizeLog2;
+    l.mData.resize(mStorageLayout == slRowMajor ?
+        l.mRowStride * iHeight :
+        (l.mTilesPerRow * tileRows << kTexelsPerTileLog2) * mBytesPerPixel);
+    return l;
+}
+
+//-----------------------------------------------------------------------------
+// Samples level 0 at pixel coordinates (iX, iY), see class documentation.
+//
+Color ImageSampler::sample(double iX, double iY) const
+{
+    return isValid() ? sampleLevel(mLevels[0], iX, iY) : Color();
+}
+
+//-----------------------------------------------------------------------------
+Color ImageSampler::sample(const Math::Vector2& iPixel) const
+{
+    return sample(iPixel.x(), iPixel.y());
+}
+
+//-----------------------------------------------------------------------------
+void ImageSampler::sample(const Math::Vector2* ipPixels, int iCount, Color* opColors) const
+{
+    if (!isValid())
+    {
+        std::fill(opColors, opColors + iCount, Color());
+        return;
+    }
+
+    const Level &level = mLevels[0];
+    for (int i = 0; i < iCount; ++i)
+    {
+        opColors[i] = sampleLevel(level, ipPixels[i].x(), ipPixels[i].y());
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Bilinear interpolation of the 4 texels around (iX, iY). When they are all
+// inside the level, they are read without applying the wrap type.
+//
+Color ImageSampler::sampleLevel(const Level& iLevel, double iX, double iY) const
+{
+    const double fx = floor(iX - 0.5), fy = floor(iY - 0.5);
+    const double tx = iX - 0.5 - fx, ty = iY - 0.5 - fy;
+    const int x0 = (int)fx, y0 = (int)fy;
+
+    double c00[4], c10[4], c11[4], c01[4];
+    if (x0 >= 0 && y0 >= 0 && x0 + 1 < iLevel.mWidth && y0 + 1 < iLevel.mHeight && mStorageLayout == slRowMajor)
+    {
+        const char *p = iLevel.mData.constData() + y0 * iLevel.mRowStride + (size_t)x0 * mBytesPerPixel;
+        mpDecode(p, c00);
+        mpDecode(p + mBytesPerPixel, c10);
+        mpDecode(p + iLevel.mRowStride, c01);
+        mpDecode(p + iLevel.mRowStride + mBytesPerPixel, c11);
+    }
+    else if (x0 >= 0 && y0 >= 0 && x0 + 1 < iLevel.mWidth && y0 + 1 < iLevel.mHeight)
+    {
+        const char *p = iLevel.mData.constData();
+        mpDecode(p + getTexelOffset(iLevel, x0, y0), c00);
+        mpDecode(p + getTexelOffset(iLevel, x0 + 1, y0), c10);
+        mpDecode(p + getTexelOffset(iLevel, x0, y0 + 1), c01);
+        mpDecode(p + getTexelOffset(iLevel, x0 + 1, y0 + 1), c11);
+    }
+    else
+    {
+        fetch(iLevel, x0, y0, c00);
+        fetch(iLevel, x0 + 1, y0, c10);
+        fetch(iLevel, x0, y0 + 1, c01);
+        fetch(iLevel, x0 + 1, y0 + 1, c11);
+    }
+
+    // same operations as biLerp() on colors.
+    double r[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        r[i] = biLerp(c00[i], c10[i], c11[i], c01[i], tx, ty);
+    }
+    Color c;
+    c.setF64(r[0], r[1], r[2], r[3]);
+    return c;
+}
+
+//-----------------------------------------------------------------------------
+// Samples level 0 at iUV, where (0, 0) and (1, 1) are the corners of the
+// image.
+//
+Color ImageSampler::sampleUV(const Math::Vector2& iUV) const
+{
+    return isValid() ?
+        sampleLevel(mLevels[0], iUV.x() * mLevels[0].mWidth, iUV.y() * mLevels[0].mHeight) :
+        Color();
+}
+
+//-----------------------------------------------------------------------------
+// Samples at iUV between the two mip levels around iLod. iLod is clamped to
+// the available levels.
+//
+Color ImageSampler::sampleUV(const Math::Vector2& iUV, double iLod) const
+{
+    if (!isValid()) return Color();
+
+    const double lod = std::min(std::max(iLod, 0.0), (double)(getNumberOfMipLevels() - 1));
+    const int l0 = (int)lod;
+    const int l1 = std::min(l0 + 1, getNumberOfMipLevels() - 1);
+    const double t = lod - l0;
+
+    const Level &level0 = mLevels[l0];
+    const Color c0 = sampleLevel(level0, iUV.x() * level0.mWidth, iUV.y() * level0.mHeight);
+    if (t == 0.0 || l0 == l1)
+    { return c0; }
+
+    const Level &level1 = mLevels[l1];
+    const Color c1 = sampleLevel(level1, iUV.x() * level1.mWidth, iUV.y() * level1.mHeight);
+    return lerp(c0, c1, t);
+}
+
+//-----------------------------------------------------------------------------
+void ImageSampler::sampleUV(const Math::Vector2* ipUVs, int iCount, Color* opColors) const
+{
+    if (!isValid())
+    {
+        std::fill(opColors, opColors + iCount, Color());
+        return;
+    }
+
+    const Level &level = mLevels[0];
+    const double w = level.mWidth, h = level.mHeight;
+    for (int i = 0; i < iCount; ++i)
+    {
+        opColors[i] = sampleLevel(level, ipUVs[i].x() * w, ipUVs[i].y() * h);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void ImageSampler::sampleUV(const Math::Vector2* ipUVs, int iCount, double iLod, Color* opColors) const
+{
+    for (int i = 0; i < iCount; ++i)
+    {
+        opColors[i] = sampleUV(ipUVs[i], iLod);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void ImageSampler::setWrapType(Image::WrapType iWt)
+{
+    mWrapType = iWt;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Core/ByteArray.h"
+#include "Core/Color.h"
+#include "Core/Image.h"
+#include "Core/ImageInternalFormat.h"
+#include "Math/Vector.h"
+#include "Math/VectorI.h"
+#include <vector>
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // This class samples an image with bilinear interpolation, it is meant
+    // for hot loops (ex: texturing in a ray tracer).
+    //
+    // Everything that Image::getPixelColor(double, double) recomputes for
+    // each texel (wrap type, bytes per pixel, row stride, switch on the
+    // internal format) is resolved once when the sampler is bound to an image.
+    // Sampling never allocates and is thread safe.
+    //
+    // Usage:
+    //      ImageSampler sampler(image);
+    //      Color c = sampler.sample(12.3, 45.6);      // pixel coordinates
+    //      Color d = sampler.sampleUV(Vector2(0.5, 0.5)); // [0, 1] coordinates
+    //
+    //      // many samples at once
+    //      sampler.sampleUV(uvs.data(), (int)uvs.size(), colors.data());
+    //
+    // Coordinates follow Image::getPixelColor(double, double): the center of
+    // pixel (i, j) is at (i + 0.5, j + 0.5). Samples outside the image follow
+    // the wrap type of the image, see setWrapType().
+    //
+    // Mip levels:
+    //      generateMipLevels() builds the chain of half size levels down to
+    //      1x1, each level is filtered from the level above with the Lanczos
+    //      kernel of Math::FilterKernelLanczos. sampleUV(uv, lod) interpolates
+    //      between the two levels around lod (trilinear filtering). The lod of
+    //      a minified lookup is getLod(footprint), where footprint is the
+    //      size, in texels of level 0, covered by the lookup.
+    //
+    // Storage layout:
+    //      slRowMajor: level 0 shares the image data (see ByteArray),
+    //          modifying the image afterwards does not affect the sampler.
+    //      slTiled: the levels are copied in tiles of kTileSize x kTileSize
+    //          texels, texels being in Morton order inside a tile. The 4
+    //          texels of a bilinear lookup, and lookups close to each other,
+    //          are then most of the time in the same few cache lines. This
+    //          pays off for random lookups in large textures.
+    //
+    class ImageSampler
+    {
+    public:
+        enum StorageLayout { slRowMajor, slTiled };
+        enum { kTileSize = 8 };
+
+        ImageSampler();
+        explicit ImageSampler(const Image& iImage, StorageLayout iLayout = slRowMajor, bool iGenerateMipLevels = false);
+        ImageSampler(const ImageSampler&) = default;
+        ImageSampler& operator=(const ImageSampler&) = default;
+        ~ImageSampler() = default;
+
+        void generateMipLevels();
+        static double getLod(double iFootprintInTexels);
+        int getNumberOfMipLevels() const;
+        Math::Vector2i getSizeInPixels(int iMipLevel = 0) const;
+        StorageLayout getStorageLayout() const;
+        Image::WrapType getWrapType() const;
+        bool isValid() const;
+        Color sample(double iX, double iY) const;
+        Color sample(const Math::Vector2& iPixel) const;
+        void sample(const Math::Vector2* ipPixels, int iCount, Color* opColors) const;
+        Color sampleUV(const Math::Vector2& iUV) const;
+        Color sampleUV(const Math::Vector2& iUV, double iLod) const;
+        void sampleUV(const Math::Vector2* ipUVs, int iCount, Color* opColors) const;
+        void sampleUV(const Math::Vector2* ipUVs, int iCount, double iLod, Color* opColors) const;
+        void setWrapType(Image::WrapType iWt);
+
+    protected:
+        // writes the normalized rgba of a texel, see Color.
+        typedef void (*DecodeFunction)(const char*, double*);
+
+        struct Level
+        {
+            ByteArray mData;
+            int mWidth;
+            int mHeight;
+            size_t mRowStride; // in bytes, slRowMajor
+            size_t mTilesPerRow; // slTiled
+        };
+
+        template<ImageInternalFormat kFormat> static void decodeTexel(const char* ipTexel, double* opRgba);
+        void fetch(const Level& iLevel, int iX, int iY, double* opRgba) const;
+        size_t getTexelOffset(const Level& iLevel, int iX, int iY) const;
+        Level makeLevel(int iWidth, int iHeight) const;
+        Color sampleLevel(const Level& iLevel, double iX, double iY) const;
+
+        std::vector<Level> mLevels;
+        ImageInternalFormat mInternalFormat;
+        int mBytesPerPixel;
+        DecodeFunction mpDecode;
+        Image::WrapType mWrapType;
+        StorageLayout mStorageLayout;
+    };
+}
+}
@@ -155,7 +155,11 @@ HgtImage::type HgtImage::getType() const
 void HgtImage::load()
 {    
     loadHeader();
-    if (isValid())
+    if (isValid() && isMemoryMappingEnabled())
+    {
+        loadMapped();
+    }
+    else if (isValid())
     {
         mImageData = readFromFile(getFilenamePath());
 
@@ -168,21 +172,7 @@ void HgtImage::load()
         if (StreamUtility::getLocalMachineByteOrder() != StreamUtility::eBigEndian)
         {
             uint64_t numberOfSamples = (uint64_t)getWidthInPixel() * (uint64_t)getHeightInPixel();
-            char *pCursor = (char*)mImageData.data();
-            char *pCursorPlusOne = nullptr;
-            for (size_t i = 0; i < numberOfSamples; ++i)
-            {
-                pCursorPlusOne = pCursor + 1;
-
-                // swap the byte
-                *pCursor ^= *pCursorPlusOne;
-                *pCursorPlusOne ^= *pCursor;
-                *pCursor ^= *pCursorPlusOne;
-
-                // move up one short.
-                pCursor++;
-                pCursor++;
-            }
+            StreamUtility::swapBytes2Array(mImageData.data(), (size_t)numberOfSamples);
         }
 
         flipVertical();
@@ -196,6 +186,33 @@ void HgtImage::load()
     }
 }
 
+//------------------------------------------------------------------------------
+// Byte swaps and flips the samples in a single pass, from the memory mapped
+// file to the image data. The file is never copied as a whole and the data is
+// only written once.
+//
+void HgtImage::loadMapped()
+{
+    const ByteArray file = readFromFile(getFilenamePath(), true);
+
+    const uint64_t lineSize = (uint64_t)getWidthInPixel() * getNumberOfChannels() * getBytesPerChannel();
+    const int h = getHeightInPixel();
+    mIsValid = file.size() >= lineSize * h;
+    if (!isValid()) { return; }
+
+    const bool needsSwapping = StreamUtility::getLocalMachineByteOrder() != StreamUtility::eBigEndian;
+    mImageData.resize((size_t)(lineSize * h));
+    char *pData = mImageData.data();
+    for (int y = 0; y < h; ++y)
+    {
+        // the line is swapped while it is still in the cache.
+        char *pDestination = pData + y * lineSize;
+        memcpy(pDestination, file.constData() + (h - 1 - y) * lineSize, lineSize);
+        if (needsSwapping)
+        { StreamUtility::swapBytes2Array(pDestination, (size_t)(lineSize / 2)); }
+    }
+}
+
 //------------------------------------------------------------------------------
 void HgtImage::loadHeader()
 {
@@ -261,6 +278,7 @@ void HgtImage::loadHeader()
         mIsValid = true;
         // custom type header is completely handle in setCustomType.
         break;
+    case tUndefined: break; // missing file or unknown size, not valid.
     default: assert(0); break;
     }
 
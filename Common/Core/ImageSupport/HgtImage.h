@@ -75,6 +75,7 @@ namespace Core
         
     protected:
         void flipVertical();
+        void loadMapped();
         type mType;
         
         //-- data read from header.
@@ -13,7 +13,8 @@ IImageReader::IImageReader() :
     mBytesPerChannel(0),
     mWidthInPixel(0),
     mHeightInPixel(0),
-    mNumberOfChannels(0)
+    mNumberOfChannels(0),
+    mIsMemoryMappingEnabled(false)
 {}
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -24,7 +25,8 @@ IImageReader::IImageReader(const std::string &iFilenamePath) :
     mBytesPerChannel(0),
     mWidthInPixel(0),
     mHeightInPixel(0),
-    mNumberOfChannels(0)
+    mNumberOfChannels(0),
+    mIsMemoryMappingEnabled(false)
 {}
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -144,6 +146,14 @@ int IImageReader::getWidthInPixel() const
 bool IImageReader::hasImageData() const
 { return !mImageData.isEmpty(); }
 
+//---------------------------------------------------------------------------------------------------------------------
+// see setMemoryMappingEnabled()
+//
+bool IImageReader::isMemoryMappingEnabled() const
+{
+    return mIsMemoryMappingEnabled;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 bool IImageReader::isValid() const
 {
@@ -163,3 +173,14 @@ void IImageReader::setFilenamePath(const std::string& iF)
 {
     mFilenamePath = iF;
 }
+
+//---------------------------------------------------------------------------------------------------------------------
+// When enabled, readers that support it memory map the file instead of reading
+// it, see ByteArray::fromMappedFile(). The image data may then point directly
+// in the file, which must not be rewritten while the data is in use.
+// Disabled by default. Like the filename, this is kept by clear().
+//
+void IImageReader::setMemoryMappingEnabled(bool iV)
+{
+    mIsMemoryMappingEnabled = iV;
+}
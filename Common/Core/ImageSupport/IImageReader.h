@@ -32,10 +32,12 @@ class IImageReader
         virtual uint64_t getSizeInBytes() const;
         virtual int getWidthInPixel() const;
         virtual bool hasImageData() const;
+        virtual bool isMemoryMappingEnabled() const;
         virtual bool isValid() const;
         virtual void load() = 0;
         virtual void loadHeader() = 0;
         virtual void setFilenamePath(const std::string&);
+        virtual void setMemoryMappingEnabled(bool);
 
     protected:
         ByteArray mImageData;
@@ -46,6 +48,7 @@ class IImageReader
         unsigned int mWidthInPixel;
         unsigned int mHeightInPixel;
         int8_t mNumberOfChannels;
+        bool mIsMemoryMappingEnabled;
 };
 
 }
@@ -1,15 +1,314 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include "Core/ImageSupport/ImageBufferHelpers.h"
+#include "Core/ImageView.h"
+#include "Core/ThreadPool.h"
 #include "Half/half.hpp"
 
+#if defined(__AVX2__)
+    #define REALISIM_IMAGE_BUFFER_HELPERS_USES_AVX2
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define REALISIM_IMAGE_BUFFER_HELPERS_USES_SSE2
+    #include <emmintrin.h>
+#endif
+
 namespace Realisim
 {
     namespace Core
     {
+        namespace
+        {
+            // Number of pixels converted at once through the float buffers
+            // of convertRows().
+            const int kBlockSizeInPixels = 256;
+
+            // Images are converted on the global thread pool by groups of
+            // rows of at least that many pixels.
+            const int kMinimumPixelsPerTask = 64 * 1024;
+
+            enum ChannelType { ctUnsupported, ctUint8, ctInt16, ctUint16, ctF16, ctF32 };
+
+            //-----------------------------------------------------------------
+            ChannelType getChannelType(ImageInternalFormat iIif)
+            {
+                switch (iIif)
+                {
+                case iifRUint8: case iifRgbUint8: case iifRgbaUint8: return ctUint8;
+                case iifRInt16: case iifRgbInt16: case iifRgbaInt16: return ctInt16;
+                case iifRUint16: case iifRgbUint16: case iifRgbaUint16: return ctUint16;
+                case iifRF16: case iifRgbF16: case iifRgbaF16: return ctF16;
+                case iifRF32: case iifRgbF32: case iifRgbaF32: return ctF32;
+                default: return ctUnsupported;
+                }
+            }
+
+            //-----------------------------------------------------------------
+            // Describes a conversion handled by the vectorized kernels. Source
+            // channels are mapped to floats with value * mScale + mOffset,
+            // which is the normalization of Color (see Color.cpp) followed by
+            // the optional normalization of convertToInternalFormat().
+            //
+            struct ConversionKernel
+            {
+                ChannelType mSourceType;
+                ChannelType mDestinationType;
+                int mSourceChannels;
+                int mDestinationChannels;
+                float mScale;
+                float mOffset;
+                float mMissingChannelValue; // channels absent from the source
+            };
+
+            //-----------------------------------------------------------------
+            // Returns false when the conversion is not handled by the kernels,
+            // it then goes through Color pixel by pixel.
+            //
+            bool makeConversionKernel(ImageInternalFormat iInput, ImageInternalFormat iOutput,
+                bool iNormalize, double iInputMinValue, double iInputMaxValue, ConversionKernel *opKernel)
+            {
+                ConversionKernel &k = *opKernel;
+                k.mSourceType = getChannelType(iInput);
+                k.mDestinationType = getChannelType(iOutput);
+                k.mSourceChannels = getNumberOfChannels(iInput);
+                k.mDestinationChannels = getNumberOfChannels(iOutput);
+
+                // uint8 is the only integer destination, the float pipeline
+                // truncates to the same values as Color for it.
+                const bool isSourceSupported = k.mSourceType != ctUnsupported && k.mSourceType != ctF16;
+                const bool isDestinationSupported = k.mDestinationType == ctF32 ||
+                    k.mDestinationType == ctF16 || k.mDestinationType == ctUint8;
+                if (!isSourceSupported || !isDestinationSupported)
+                { return false; }
+
+                // see normalize() in Color.cpp. Signed values are centered
+                // on 0.
+                double scale = 1.0, offset = 0.0;
+                switch (k.mSourceType)
+                {
+                case ctUint8: scale = 1.0 / 255.0; break;
+                case ctUint16: scale = 1.0 / 65535.0; break;
+                case ctInt16: scale = 1.0 / 65535.0; offset = 32768.0 / 65535.0 - 0.5; break;
+                default: break;
+                }
+
+                // Color leaves the green, blue and alpha of single channel
+                // formats at 0, the alpha of rgb formats is the normalized 0
+                // of the channel type.
+                double missing = k.mSourceChannels == 3 ? offset : 0.0;
+
+                if (iNormalize)
+                {
+                    const double d = 1.0 / (iInputMaxValue - iInputMinValue);
+                    scale *= d;
+                    offset = (offset - iInputMinValue) * d;
+                    missing = (missing - iInputMinValue) * d;
+                }
+                k.mScale = (float)scale;
+                k.mOffset = (float)offset;
+                k.mMissingChannelValue = (float)missing;
+                return true;
+            }
+
+            //-----------------------------------------------------------------
+            // o[i] = ip[i] * iScale + iOffset, for iCount values.
+            //
+            void decodeUint8(const uint8_t *ip, int iCount, float iScale, float iOffset, float *o)
+            {
+                int i = 0;
+#if defined(REALISIM_IMAGE_BUFFER_HELPERS_USES_AVX2)
+                const __m256 s8 = _mm256_set1_ps(iScale), o8 = _mm256_set1_ps(iOffset);
+                for (; i + 8 <= iCount; i += 8)
+                {
+                    const __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(ip + i)));
+                    _mm256_storeu_ps(o + i, _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(v), s8), o8));
+                }
+#elif defined(REALISIM_IMAGE_BUFFER_HELPERS_USES_SSE2)
+                const __m128 s4 = _mm_set1_ps(iScale), o4 = _mm_set1_ps(iOffset);
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 16 <= iCount; i += 16)
+                {
+                    const __m128i v = _mm_loadu_si128((const __m128i*)(ip + i));
+                    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+                    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+                    const __m128i w[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                        _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+                    for (int j = 0; j < 4; ++j)
+                    { _mm_storeu_ps(o + i + 4 * j, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(w[j]), s4), o4)); }
+                }
+#endif
+                for (; i < iCount; ++i)
+                { o[i] = ip[i] * iScale + iOffset; }
+            }
+
+            //-----------------------------------------------------------------
+            void decodeInt16(const int16_t *ip, int iCount, float iScale, float iOffset, float *o)
+            {
+                int i = 0;
+#if defined(REALISIM_IMAGE_BUFFER_HELPERS_USES_AVX2)
+                const __m256 s8 = _mm256_set1_ps(iScale), o8 = _mm256_set1_ps(iOffset);
+                for (; i + 8 <= iCount; i += 8)
+                {
+                    const __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(ip + i)));
+                    _mm256_storeu_ps(o + i, _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(v), s8), o8));
+                }
+#elif defined(REALISIM_IMAGE_BUFFER_HELPERS_USES_SSE2)
+                const __m128 s4 = _mm_set1_ps(iScale), o4 = _mm_set1_ps(iOffset);
+                for (; i + 8 <= iCount; i += 8)
+                {
+                    const __m128i v = _mm_loadu_si128((const __m128i*)(ip + i));
+                    // sign extension: the value in the high half, shifted back.
+                    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                    _mm_storeu_ps(o + i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(lo), s4), o4));
+                    _mm_storeu_ps(o + i + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), s4), o4));
+                }
+#endif
+                for (; i < iCount; ++i)
+                { o[i] = ip[i] * iScale + iOffset; }
+            }
+
+            //-----------------------------------------------------------------
+            void decodeUint16(const uint16_t *ip, int iCount, float iScale, float iOffset, float *o)
+            {
+                int i = 0;
+#if defined(REALISIM_IMAGE_BUFFER_HELPERS_USES_SSE2) || defined(REALISIM_IMAGE_BUFFER_HELPERS_USES_AVX2)
+                const __m128 s4 = _mm_set1_ps(iScale), o4 = _mm_set1_ps(iOffset);
+                const __m128i zero = _mm_setzero_si128();
+                for (; i + 8 <= iCount; i += 8)
+                {
+                    const __m128i v = _mm_loadu_si128((const __m128i*)(ip + i));
+                    _mm_storeu_ps(o + i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), s4), o4));
+                    _mm_storeu_ps(o + i + 4, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), s4), o4));
+                }
+#endif
+                for (; i < iCount; ++i)
+                { o[i] = ip[i] * iScale + iOffset; }
+            }
+
+            //-----------------------------------------------------------------
+            void decodeF32(const float *ip, int iCount, float iScale, float iOffset, float *o)
+            {
+                int i = 0;
+#if defined(REALISIM_IMAGE_BUFFER_HELPERS_USES_SSE2) || defined(REALISIM_IMAGE_BUFFER_HELPERS_USES_AVX2)
+                const __m128 s4 = _mm_set1_ps(iScale), o4 = _mm_set1_ps(iOffset);
+                for (; i + 4 <= iCount; i += 4)
+                { _mm_storeu_ps(o + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ip + i), s4), o4)); }
+#endif
+                for (; i < iCount; ++i)
+                { o[i] = ip[i] * iScale + iOffset; }
+            }
+
+            //-----------------------------------------------------------------
+            // Same as Color::getRedUint8(), the value is truncated. Values out
+            // of [0, 1] are clamped.
+            //
+            void encodeUint8(const float *ip, int iCount, uint8_t *o)
+            {
+                int i = 0;
+#if defined(REALISIM_IMAGE_BUFFER_HELPERS_USES_SSE2) || defined(REALISIM_IMAGE_BUFFER_HELPERS_USES_AVX2)
+                const __m128 k255 = _mm_set1_ps(255.0f), zero = _mm_setzero_ps();
+                for (; i + 16 <= iCount; i += 16)
+                {
+                    __m128i w[4];
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        const __m128 v = _mm_mul_ps(_mm_loadu_ps(ip + i + 4 * j), k255);
+                        w[j] = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(v, zero), k255));
+                    }
+                    const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(w[0], w[1]), _mm_packs_epi32(w[2], w[3]));
+                    _mm_storeu_si128((__m128i*)(o + i), packed);
+                }
+#endif
+                for (; i < iCount; ++i)
+                { o[i] = (uint8_t)std::min(std::max(ip[i] * 255.0f, 0.0f), 255.0f); }
+            }
+
+            //-----------------------------------------------------------------
+            // Converts the rows [iBeginRow, iEndRow[ of an image of width
+            // iWidth, by blocks of kBlockSizeInPixels pixels.
+            //
+            void convertRows(const ConversionKernel& iK, const char *ipSource, char *opDestination,
+                int iWidth, int iBeginRow, int iEndRow)
+            {
+                float sourceBlock[kBlockSizeInPixels * 4];
+                float destinationBlock[kBlockSizeInPixels * 4];
+
+                const int sc = iK.mSourceChannels, dc = iK.mDestinationChannels;
+                const size_t sourcePixelSize = (size_t)sc *
+                    (iK.mSourceType == ctUint8 ? 1 : (iK.mSourceType == ctF32 ? 4 : 2));
+                const size_t destinationPixelSize = (size_t)dc *
+                    (iK.mDestinationType == ctUint8 ? 1 : (iK.mDestinationType == ctF32 ? 4 : 2));
+
+                for (int y = iBeginRow; y < iEndRow; ++y)
+                {
+                    const char *pSourceRow = ipSource + (size_t)y * iWidth * sourcePixelSize;
+                    char *pDestinationRow = opDestination + (size_t)y * iWidth * destinationPixelSize;
+
+                    for (int x = 0; x < iWidth; x += kBlockSizeInPixels)
+                    {
+                        const int n = std::min(kBlockSizeInPixels, iWidth - x);
+                        const char *pSource = pSourceRow + x * sourcePixelSize;
+                        char *pDestination = pDestinationRow + x * destinationPixelSize;
+
+                        // float destinations with the same channels are decoded
+                        // in place.
+                        const bool isDirect = sc == dc && iK.mDestinationType == ctF32;
+                        float *decoded = isDirect ? (float*)pDestination : sourceBlock;
+                        switch (iK.mSourceType)
+                        {
+                        case ctUint8: decodeUint8((const uint8_t*)pSource, n * sc, iK.mScale, iK.mOffset, decoded); break;
+                        case ctInt16: decodeInt16((const int16_t*)pSource, n * sc, iK.mScale, iK.mOffset, decoded); break;
+                        case ctUint16: decodeUint16((const uint16_t*)pSource, n * sc, iK.mScale, iK.mOffset, decoded); break;
+                        case ctF32: decodeF32((const float*)pSource, n * sc, iK.mScale, iK.mOffset, decoded); break;
+                        default: assert(0); break;
+                        }
+                        if (isDirect) { continue; }
+
+                        // channel mapping, ex: rgb to rgba.
+                        const float *mapped = sourceBlock;
+                        if (sc != dc)
+                        {
+                            for (int p = 0; p < n; ++p)
+                            {
+                                for (int c = 0; c < dc; ++c)
+                                {
+                                    destinationBlock[p * dc + c] = c < sc ?
+                                        sourceBlock[p * sc + c] : iK.mMissingChannelValue;
+                                }
+                            }
+                            mapped = destinationBlock;
+                        }
+
+                        switch (iK.mDestinationType)
+                        {
+                        case ctF32: memcpy(pDestination, mapped, n * dc * sizeof(float)); break;
+                        case ctUint8: encodeUint8(mapped, n * dc, (uint8_t*)pDestination); break;
+                        case ctF16:
+                        {
+                            half_float::half *pHalf = (half_float::half*)pDestination;
+                            for (int i = 0; i < n * dc; ++i)
+                            { pHalf[i] = half_float::half(mapped[i]); }
+                        }break;
+                        default: assert(0); break;
+                        }
+                    }
+                }
+            }
+        }
+
         //---------------------------------------------------------------------
+        // Converts iInput to the internal format iOutput. When iNormalize is
+        // true, all channels are remapped from [iInputMinValue,
+        // iInputMaxValue] to [0, 1].
         //
+        // The conversions from uint8, int16, uint16 and float32 channels to
+        // float32, float16 and uint8 channels are done by vectorized kernels,
+        // on the global thread pool for large images (ex: hgt int16 heights
+        // to RF32, rgb8 to rgba16F). The other conversions go through Color
+        // pixel by pixel.
         //
         Core::Image convertToInternalFormat(const Core::Image& iInput,
             ImageInternalFormat iOutput, bool iNormalize, double iInputMinValue, double iInputMaxValue)
@@ -18,6 +317,31 @@ namespace Realisim
             Image o;
             o.setData(w, h, iOutput, nullptr);
 
+            ConversionKernel kernel;
+            if (iInput.hasImageData() && o.hasImageData() &&
+                makeConversionKernel(iInput.getInternalFormat(), iOutput, iNormalize, iInputMinValue, iInputMaxValue, &kernel))
+            {
+                // keeps the source data alive while the rows are converted.
+                const ByteArray sourceData = iInput.getImageData();
+                char *pDestination = nullptr;
+                visitImageInternalFormat(iOutput, [&o, &pDestination](auto iFormat) {
+                    pDestination = (char*)ImageView<decltype(iFormat)::value>(o).getRow(0);
+                });
+
+                const int rowsPerTask = std::max(1, kMinimumPixelsPerTask / std::max(w, 1));
+                const int numberOfTasks = (h + rowsPerTask - 1) / rowsPerTask;
+                auto convertTask = [&](int iTask) {
+                    convertRows(kernel, sourceData.constData(), pDestination, w,
+                        iTask * rowsPerTask, std::min(h, (iTask + 1) * rowsPerTask));
+                };
+
+                if (numberOfTasks > 1)
+                { ThreadPool::getGlobalInstance().parallelFor(numberOfTasks, convertTask); }
+                else
+                { convertTask(0); }
+                return o;
+            }
+
             Math::Vector2i p;
             Color c;
             const double d = 1.0 / (iInputMaxValue - iInputMinValue);
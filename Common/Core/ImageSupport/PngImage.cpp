@@ -1,20 +1,96 @@
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include "lodepng.h"
 #include "PngImage.h"
+#include "Core/StreamUtility.h"
 #include <vector>
 
 using namespace Realisim;
     using namespace Core;
 using namespace std;
 
+namespace
+{
+    const size_t kSignatureSize = 8;
+    const size_t kIhdrChunkSize = 25;
+    const size_t kChunkOverhead = 12; // length, type and crc
+
+    //--------------------------------------------------------------------------
+    inline unsigned char paethPredictor(int iA, int iB, int iC)
+    {
+        const int p = iA + iB - iC;
+        const int pa = abs(p - iA), pb = abs(p - iB), pc = abs(p - iC);
+        if (pa <= pb && pa <= pc) return (unsigned char)iA;
+        return (unsigned char)(pb <= pc ? iB : iC);
+    }
+
+    //--------------------------------------------------------------------------
+    // Unfilters a scanline of iLength bytes, see the png specification
+    // (section 9). ipPrevious is the unfiltered scanline above, nullptr for the
+    // first one. Returns false on an unknown filter type.
+    //
+    bool unfilterScanline(unsigned char* opScanline, const unsigned char* ipFiltered,
+        const unsigned char* ipPrevious, unsigned char iFilterType, size_t iBytesPerPixel, size_t iLength)
+    {
+        const size_t bpp = iBytesPerPixel;
+        unsigned char *out = opScanline;
+        const unsigned char *in = ipFiltered, *up = ipPrevious;
+        switch (iFilterType)
+        {
+        case 0: memcpy(out, in, iLength); break;
+        case 1:
+            memcpy(out, in, bpp);
+            for (size_t i = bpp; i < iLength; ++i) { out[i] = in[i] + out[i - bpp]; }
+            break;
+        case 2:
+            if (up)
+            { for (size_t i = 0; i < iLength; ++i) { out[i] = in[i] + up[i]; } }
+            else
+            { memcpy(out, in, iLength); }
+            break;
+        case 3:
+            if (up)
+            {
+                for (size_t i = 0; i < bpp; ++i) { out[i] = in[i] + (up[i] >> 1); }
+                for (size_t i = bpp; i < iLength; ++i) { out[i] = in[i] + ((out[i - bpp] + up[i]) >> 1); }
+            }
+            else
+            {
+                memcpy(out, in, bpp);
+                for (size_t i = bpp; i < iLength; ++i) { out[i] = in[i] + (out[i - bpp] >> 1); }
+            }
+            break;
+        case 4:
+            if (up)
+            {
+                for (size_t i = 0; i < bpp; ++i) { out[i] = in[i] + up[i]; }
+                for (size_t i = bpp; i < iLength; ++i) { out[i] = in[i] + paethPredictor(out[i - bpp], up[i], up[i - bpp]); }
+            }
+            else
+            {
+                // the predictor is the left byte when there is no row above.
+                memcpy(out, in, bpp);
+                for (size_t i = bpp; i < iLength; ++i) { out[i] = in[i] + out[i - bpp]; }
+            }
+            break;
+        default: return false;
+        }
+        return true;
+    }
+}
+
 //------------------------------------------------------------------------------
-PngImage::PngImage() : IImageReader()
+PngImage::PngImage() : IImageReader(),
+    mIsVerticalFlipOnLoadEnabled(false)
 {}
 
 //------------------------------------------------------------------------------
-PngImage::PngImage(const std::string& iFilenamePath) : IImageReader(iFilenamePath)
+PngImage::PngImage(const std::string& iFilenamePath) : IImageReader(iFilenamePath),
+    mIsVerticalFlipOnLoadEnabled(false)
 {
     load();
 }
@@ -25,6 +101,174 @@ PngImage::~PngImage()
     clear();
 }
 
+//------------------------------------------------------------------------------
+// Decodes the png in iPng directly in mImageData when its format allows it,
+// see class documentation. Returns false when it does not, nothing is
+// modified then. Sets mIsValid.
+//
+bool PngImage::decodeScanlines(const ByteArray& iPng)
+{
+    const unsigned char *png = (const unsigned char*)iPng.constData();
+    const size_t pngSize = iPng.size();
+
+    unsigned w = 0, h = 0;
+    lodepng::State state;
+    if (lodepng_inspect(&w, &h, &state, png, pngSize) != 0)
+    { return false; }
+
+    const LodePNGColorMode &color = state.info_png.color;
+    int numberOfChannels = 0;
+    switch (color.colortype)
+    {
+    case LCT_GREY: numberOfChannels = 1; break;
+    case LCT_RGB: numberOfChannels = 3; break;
+    case LCT_RGBA: numberOfChannels = 4; break;
+    default: return false;
+    }
+    if ((color.bitdepth != 8 && color.bitdepth != 16) || state.info_png.interlace_method != 0)
+    { return false; }
+
+    // gather the IDAT chunks, a single one is inflated in place.
+    const unsigned char *pIdat = nullptr;
+    size_t idatSize = 0;
+    std::vector<unsigned char> idats;
+    int numberOfIdats = 0;
+    const unsigned char *chunk = png + kSignatureSize + kIhdrChunkSize;
+    while (chunk + kChunkOverhead <= png + pngSize)
+    {
+        const size_t length = lodepng_chunk_length(chunk);
+        if (chunk + kChunkOverhead + length > png + pngSize)
+        { break; }
+
+        if (lodepng_chunk_type_equals(chunk, "IDAT"))
+        {
+            const unsigned char *data = lodepng_chunk_data_const(chunk);
+            if (numberOfIdats++ == 0)
+            { pIdat = data; idatSize = length; }
+            else
+            {
+                if (idats.empty())
+                { idats.assign(pIdat, pIdat + idatSize); }
+                idats.insert(idats.end(), data, data + length);
+            }
+        }
+        else if (lodepng_chunk_type_equals(chunk, "IEND"))
+        { break; }
+        chunk = lodepng_chunk_next_const(chunk);
+    }
+    if (numberOfIdats > 1)
+    { pIdat = idats.data(); idatSize = idats.size(); }
+
+    mWidthInPixel = w;
+    mHeightInPixel = h;
+    mNumberOfChannels = (int8_t)numberOfChannels;
+    mBytesPerChannel = (int8_t)(color.bitdepth / 8);
+    mIsValid = false;
+
+    unsigned char *pFiltered = nullptr;
+    size_t filteredSize = 0;
+    unsigned error = pIdat == nullptr ? 1 :
+        lodepng_zlib_decompress(&pFiltered, &filteredSize, pIdat, idatSize, &lodepng_default_decompress_settings);
+
+    const size_t bytesPerPixel = (size_t)numberOfChannels * mBytesPerChannel;
+    const size_t lineSize = w * bytesPerPixel;
+    if (!error && filteredSize >= (lineSize + 1) * h)
+    {
+        mImageData.resize(lineSize * h);
+        unsigned char *pData = (unsigned char*)mImageData.data();
+        // 16 bits samples are swapped once the next scanline, which is
+        // predicted from the big endian bytes, is unfiltered.
+        const bool needsSwapping = mBytesPerChannel == 2 &&
+            StreamUtility::getLocalMachineByteOrder() == StreamUtility::eLittleEndian;
+        unsigned char *pPrevious = nullptr;
+        bool isOk = true;
+        for (unsigned y = 0; y < h && isOk; ++y)
+        {
+            const unsigned char *pScanline = pFiltered + y * (lineSize + 1);
+            const unsigned row = mIsVerticalFlipOnLoadEnabled ? h - 1 - y : y;
+            unsigned char *pRow = pData + row * lineSize;
+            isOk = unfilterScanline(pRow, pScanline + 1, pPrevious, pScanline[0], bytesPerPixel, lineSize);
+            if (needsSwapping && pPrevious)
+            { StreamUtility::swapBytes2Array(pPrevious, lineSize / 2); }
+            pPrevious = pRow;
+        }
+        if (needsSwapping && pPrevious)
+        { StreamUtility::swapBytes2Array(pPrevious, lineSize / 2); }
+        mIsValid = isOk;
+    }
+    free(pFiltered);
+
+    if (!mIsValid)
+    {
+        std::cout << "error decoding png " << getFilenamePath() << std::endl;
+        clear();
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void PngImage::decodeWithLodepng(const ByteArray& iPng)
+{
+    std::vector<unsigned char> png((const unsigned char*)iPng.constData(), (const unsigned char*)iPng.constData() + iPng.size());
+    std::vector<unsigned char> image; //the raw pixels
+    lodepng::State state; //optionally customize this one
+
+    // by default png will try to decode the image in an rgba format,
+    // see lodepng::state
+    //
+    unsigned error = png.empty() ? 78 : 0; // 78: failed to read the file
+
+    //load the header and customize how we want the raw data.
+    unsigned w = 0, h = 0;
+    if (!error)
+    {
+        error = lodepng_inspect( &w, &h, &state, &png[0], png.size());
+
+        state.info_raw.colortype = state.info_png.color.colortype;
+        state.info_raw.bitdepth = state.info_png.color.bitdepth;        
+    }
+
+    if (!error) error = lodepng::decode(image, w, h, state, png);
+
+    // If there's is no error, grab the bytes...
+    if (error == 0)
+    {
+        //
+		mWidthInPixel = w;
+		mHeightInPixel = h;
+
+        mImageData.set((char*)(&image[0]), (int)image.size());
+
+        // state.info_png contains info about the decoded png...
+        //
+        switch (state.info_raw.colortype)
+        {
+        case LCT_GREY: mNumberOfChannels = 1; break;
+        case LCT_RGB: mNumberOfChannels = 3; break;
+        case LCT_RGBA: mNumberOfChannels = 4; break;
+        default: assert(0); break;
+        }
+
+        switch (state.info_raw.bitdepth)
+        {
+        case 8: mBytesPerChannel = 1; break;
+        case 16: mBytesPerChannel = 2; break;
+        default: assert(0); break;
+        }
+
+        if (mBytesPerChannel == 2 && StreamUtility::getLocalMachineByteOrder() == StreamUtility::eLittleEndian)
+        { StreamUtility::swapBytes2Array(mImageData.data(), mImageData.size() / 2); }
+
+        mIsValid = true;
+        if (mIsVerticalFlipOnLoadEnabled)
+        { flipVertical(); }
+    }
+    else
+    { 
+        std::cout << "error " << error << ": " << lodepng_error_text(error) << std::endl;
+    }
+}
+
 //----------------------------------------------------------------------------
 // flips the image 180 deg around the x axis
 //
@@ -48,7 +292,7 @@ void PngImage::flipVertical()
         memcpy(pTop, pTemp, lineSize);
     }
 
-    delete pTemp;
+    delete[] pTemp;
 }
 
 //------------------------------------------------------------------------------
@@ -101,69 +345,20 @@ void PngImage::load()
 {
     clear();
 
-    std::vector<unsigned char> png;
-    std::vector<unsigned char> image; //the raw pixels
-    lodepng::State state; //optionally customize this one
-
-    // by default png will try to decode the image in an rgba format,
-    // see lodepng::state
-    //
-    unsigned error = lodepng::load_file(png, getFilenamePath()); //load the image file with given filename
-
-    //load the header and customize how we want the raw data.
-    unsigned w = 0, h = 0;
-    if (!error)
+    const ByteArray png = readFromFile(getFilenamePath(), isMemoryMappingEnabled());
+    if (!decodeScanlines(png))
     {
-        error = lodepng_inspect( &w, &h, &state, &png[0], png.size());
-
-        state.info_raw.colortype = state.info_png.color.colortype;
-        state.info_raw.bitdepth = state.info_png.color.bitdepth;        
-    }
-
-    if (!error) error = lodepng::decode(image, w, h, state, png);
-
-    // If there's is no error, grab the bytes...
-    if (error == 0)
-    {
-        //
-		mWidthInPixel = w;
-		mHeightInPixel = h;
-
-        mImageData.set((char*)(&image[0]), (int)image.size());
-
-        // state.info_png contains info about the decoded png...
-        //
-        switch (state.info_raw.colortype)
-        {
-        case LCT_GREY: mNumberOfChannels = 1; break;
-        case LCT_RGB: mNumberOfChannels = 3; break;
-        case LCT_RGBA: mNumberOfChannels = 4; break;
-        default: assert(0); break;
-        }
-
-        switch (state.info_raw.bitdepth)
-        {
-        case 8: mBytesPerChannel = 1; break;
-        case 16: mBytesPerChannel = 2; break;
-        default: assert(0); break;
-        }
-
-        mIsValid = true;
-    }
-    else
-    { 
-        std::cout << "error " << error << ": " << lodepng_error_text(error) << std::endl;
+        decodeWithLodepng(png);
     }
 }
 
 //------------------------------------------------------------------------------
+// Same as setVerticalFlipOnLoad(iFlip) followed by load().
+//
 void PngImage::load(bool iFlip)
 {
+    setVerticalFlipOnLoad(iFlip);
     load();
-    if(iFlip && isValid())
-    {
-        flipVertical();
-    }
 }
 
 //------------------------------------------------------------------------------
@@ -171,8 +366,10 @@ void PngImage::loadHeader()
 {
     clear();
 
-	std::vector<unsigned char> png;
-	unsigned error = lodepng::load_file(png, getFilenamePath()); //load the image file with given filename
+	// only the signature and the IHDR chunk are read.
+	std::vector<unsigned char> png(kSignatureSize + kIhdrChunkSize);
+	std::ifstream ifs(getFilenamePath(), std::ios::binary);
+	unsigned error = ifs.read((char*)png.data(), png.size()) ? 0 : 78;
 	
 	unsigned w = 0, h = 0;
 	lodepng::State state; //optionally customize this one
@@ -210,6 +407,17 @@ void PngImage::loadHeader()
 }
 
 //------------------------------------------------------------------------------
+bool PngImage::isVerticalFlipOnLoadEnabled() const
+{
+    return mIsVerticalFlipOnLoadEnabled;
+}
+
+//------------------------------------------------------------------------------
+// Encodes iByteArray (top row first) and writes it to iFilenamePath. The png
+// has the bit depth of the data. The data is given to lodepng as is, it is
+// only copied to swap 16 bits samples to big endian on little endian
+// machines.
+//
 bool PngImage::save(const std::string& iFilenamePath,
 	int iWidth,
 	int iHeight,
@@ -217,7 +425,6 @@ bool PngImage::save(const std::string& iFilenamePath,
 	int iNumberOfChannels,
 	const ByteArray iByteArray)
 {
-	std::vector<unsigned char> png;
 	lodepng::State state; //optionally customize this one
 
 	switch (iNumberOfChannels)
@@ -251,17 +458,31 @@ bool PngImage::save(const std::string& iFilenamePath,
 	default: assert(0); break;
 	}
     state.encoder.auto_convert = false;
+    state.info_png.color.bitdepth = state.info_raw.bitdepth;
 
-	std::vector<unsigned char> imageData((unsigned char*)iByteArray.constData(), (unsigned char*)iByteArray.constData() + iByteArray.size());
+    ByteArray data = iByteArray;
+    if (iBytesPerChannel == 2 && StreamUtility::getLocalMachineByteOrder() == StreamUtility::eLittleEndian)
+    { StreamUtility::swapBytes2Array(data.data(), data.size() / 2); }
 
-	unsigned error = lodepng::encode(png, imageData, iWidth, iHeight, state);
+	unsigned char *pPng = nullptr;
+	size_t pngSize = 0;
+	unsigned error = lodepng_encode(&pPng, &pngSize, (const unsigned char*)data.constData(), iWidth, iHeight, &state);
 	if (!error)
 	{
-	    lodepng::save_file(png, iFilenamePath);
+	    error = lodepng_save_file(pPng, pngSize, iFilenamePath.c_str());
 	}
+	free(pPng);
 
 	//if there's an error, display it
 	if (error) std::cout << "encoder error " << error << ": " << lodepng_error_text(error) << std::endl;
 
 	return error == 0;
 }
+
+//------------------------------------------------------------------------------
+// When enabled, load() writes the rows bottom up, see class documentation.
+//
+void PngImage::setVerticalFlipOnLoad(bool iV)
+{
+    mIsVerticalFlipOnLoadEnabled = iV;
+}
@@ -6,6 +6,19 @@ namespace Realisim
 {
 namespace Core
 {
+    //-------------------------------------------------------------------------
+    // Non interlaced png with 8 or 16 bits grey, rgb or rgba samples (the
+    // formats written by save()) are decoded directly in the image data: the
+    // file is read (or mapped, see setMemoryMappingEnabled()), the IDAT chunks
+    // are inflated by lodepng and each scanline is unfiltered in its final
+    // row of the image data. With setVerticalFlipOnLoad(true), rows are
+    // written bottom up, which saves the flip pass Image needs.
+    //
+    // Other png (palette, interlaced, ...) go through lodepng::decode().
+    //
+    // Samples of 16 bits are big endian in the file and in the byte order of
+    // the machine in the image data.
+    //
     class PngImage : public IImageReader
     {
 	public:
@@ -20,9 +33,15 @@ namespace Core
         virtual void load() override;
         void load(bool iFlip);
         virtual void loadHeader() override;
+        bool isVerticalFlipOnLoadEnabled() const;
         static bool save(const std::string& iFilenamePath, int iWidth, int iHeight, int iBytesPerChannel, int iNumberOfChannels, const ByteArray iByteArray);
+        void setVerticalFlipOnLoad(bool iV);
         
     protected:
+        bool decodeScanlines(const ByteArray& iPng);
+        void decodeWithLodepng(const ByteArray& iPng);
+
+        bool mIsVerticalFlipOnLoadEnabled;
     };
 
 }
@@ -65,7 +65,21 @@ void RawImage::load()
             
             uint64_t sizeOfData;
             ok &= su.readUint64(ifs, &sizeOfData);
-            ok &= su.readBytes(ifs, sizeOfData, &mImageData.nonConstString());
+            if (ok && isMemoryMappingEnabled())
+            {
+                // the image data is a view in the mapped file, no copy is made.
+                const uint64_t dataOffset = (uint64_t)ifs.tellg();
+                const ByteArray file = readFromFile(getFilenamePath(), true);
+                ok &= file.size() >= dataOffset + sizeOfData;
+                if (ok)
+                {
+                    mImageData = file.mid((size_t)dataOffset, (int64_t)sizeOfData);
+                }
+            }
+            else
+            {
+                ok &= su.readBytes(ifs, sizeOfData, &mImageData.nonConstString());
+            }
 
             mIsValid = ok;
         }
@@ -1,16 +1,21 @@
+#include <atomic>
 #include <cassert>
+#include <fstream>
 #include "RgbImage.h"
-#if defined(_OPENMP)
-#include <omp.h>
-#endif
 #include "Core/StreamUtility.h"
+#include "Core/ThreadPool.h"
 #include <vector>
-#include "Core/Timer.h"
 
 using namespace Realisim;
     using namespace Core;
 using namespace std;
 
+namespace
+{
+    const int kHeaderSize = 512;
+    const int kRowsPerTask = 16;
+}
+
 RgbImage::RgbImage() : IImageReader(),
 mMagicNumber(0),
 mStorage(0),
@@ -55,28 +60,48 @@ void RgbImage::clear()
 }
 
 //------------------------------------------------------------------------------
-void RgbImage::decompress(const std::string &iRleData, unsigned char *iDest)
+// Decompresses the rle scanline ipRle of iRleSize bytes in iWidth bytes of
+// opDest, iDestStride bytes apart (the channels are interleaved in the final
+// buffer). Returns false when a run goes past the scanline or the rle data.
+//
+bool RgbImage::decompress(const unsigned char* ipRle, size_t iRleSize, int iWidth, int iDestStride, unsigned char* opDest)
 {
-    int rleIndex = 0;
-    int count = 0;
-    unsigned char pixel;
-    for (;;) {
-        pixel = iRleData[rleIndex++];
-        count = (int)(pixel & 0x7F);
-        if (!count) {
-            return;
-        }
-        if (pixel & 0x80) {
-            while (count--) {
-                *iDest++ = iRleData[rleIndex++];
+    const unsigned char* pEnd = ipRle + iRleSize;
+    int remaining = iWidth;
+    while (ipRle < pEnd)
+    {
+        const unsigned char pixel = *ipRle++;
+        int count = (int)(pixel & 0x7F);
+        if (!count)
+        { return true; }
+
+        if (count > remaining)
+        { return false; }
+        remaining -= count;
+
+        if (pixel & 0x80)
+        {
+            if (pEnd - ipRle < count)
+            { return false; }
+            while (count--)
+            {
+                *opDest = *ipRle++;
+                opDest += iDestStride;
             }
-        } else {
-            pixel = iRleData[rleIndex++];
-            while (count--) {
-                *iDest++ = pixel;
+        }
+        else
+        {
+            if (ipRle == pEnd)
+            { return false; }
+            const unsigned char value = *ipRle++;
+            while (count--)
+            {
+                *opDest = value;
+                opDest += iDestStride;
             }
         }
     }
+    return true;
 }
 
 //------------------------------------------------------------------------------
@@ -156,79 +181,78 @@ bool RgbImage::isRleEncoded() const
 void RgbImage::load()
 {
     clear();
-    // Parse the file
-    ifstream ifs;
-    ifs.open(getFilenamePath(), ifstream::in | ios_base::binary);
-    if(!ifs.fail())
+
+    // the whole file is read (or mapped) at once, the scanlines are then
+    // decoded straight from it.
+    const ByteArray file = readFromFile(getFilenamePath(), isMemoryMappingEnabled());
+    ByteArrayCursor cursor(file, StreamUtility::eBigEndian);
+    mIsValid = loadHeader(cursor);
+
+    if(isValid())
     {
-        mIsValid = loadHeader(ifs);
-        
-        if(isValid())
+        if(!isRleEncoded())
         {
-            if(!isRleEncoded())
-            {
-                mIsValid = parseAsVerbatim(ifs);
-            }
-            else
-            {
-                mIsValid = parseAsRle(ifs);
-                if(!isValid())
-                {printf("RgbImageLoader::load() - Error while parsing rle data...\n");}
-            }
+            mIsValid = parseAsVerbatim(cursor);
+        }
+        else
+        {
+            mIsValid = parseAsRle(cursor);
+            if(!isValid())
+            {printf("RgbImageLoader::load() - Error while parsing rle data...\n");}
         }
     }
-    ifs.close();
 }
 
 //------------------------------------------------------------------------------
 void RgbImage::loadHeader()
 {
     clear();
-    // Parse the file
+    // Parse the header only
+    string header(kHeaderSize, '\0');
     ifstream ifs;
     ifs.open(getFilenamePath(), ifstream::in | ios_base::binary);
-    if(!ifs.fail())
+    if(ifs.read(&header[0], header.size()))
     {
-        mIsValid = loadHeader(ifs);
+        ByteArrayCursor cursor(ByteArray(header), StreamUtility::eBigEndian);
+        mIsValid = loadHeader(cursor);
     }
     ifs.close();
 }
 
 //------------------------------------------------------------------------------
-bool RgbImage::loadHeader(ifstream& ifs)
+bool RgbImage::loadHeader(ByteArrayCursor& iCursor)
 {
     // see specification
-    Realisim::Core::StreamUtility su;
-    su.setStreamFormat(Realisim::Core::StreamUtility::eBigEndian);
-    
     bool ok = true;
-    ok &= su.readInt16(ifs, &mMagicNumber);
+    ok &= iCursor.read(&mMagicNumber);
     ok &= mMagicNumber == 474;
     
     if(ok)
     {
-        ok &= su.readInt8(ifs, &mStorage);
+        ok &= iCursor.read(&mStorage);
         
         uint16_t width, height, numberOfChannels;
-        ok &= su.readInt8(ifs, &mBytesPerChannel);
-        ok &= su.readUint16(ifs, &mDimension);
-        ok &= su.readUint16(ifs, &width);
+        ok &= iCursor.read(&mBytesPerChannel);
+        ok &= iCursor.read(&mDimension);
+        ok &= iCursor.read(&width);
         mWidthInPixel = width;
-        ok &= su.readUint16(ifs, &height);
+        ok &= iCursor.read(&height);
         mHeightInPixel = height;
-        ok &= su.readUint16(ifs, &numberOfChannels);
+        ok &= iCursor.read(&numberOfChannels);
         mNumberOfChannels = (int8_t)numberOfChannels;
-        ok &= su.readInt32(ifs, &mMinumumPixelValue);
-        ok &= su.readInt32(ifs, &mMaximumPixelValue);
+        ok &= iCursor.read(&mMinumumPixelValue);
+        ok &= iCursor.read(&mMaximumPixelValue);
         
         int32_t dummy;
-        ok &= su.readInt32(ifs, &dummy);
+        ok &= iCursor.read(&dummy);
         
-        ok &= su.readChar(ifs, 80, &mImageName);
-        ok &= su.readInt32(ifs, &mColorMapId);
+        char imageName[81] = {};
+        ok &= iCursor.readBytes(80, imageName);
+        mImageName = imageName;
+        ok &= iCursor.read(&mColorMapId);
     }
     
-    ifs.seekg(512); //go to end of header.
+    ok &= iCursor.seek(kHeaderSize); //go to end of header.
     
     // a few assumption and checks if the image was read properly
     if (ok)
@@ -246,126 +270,87 @@ bool RgbImage::loadHeader(ifstream& ifs)
 
 //------------------------------------------------------------------------------
 // see documentation (link in h file).
-bool RgbImage::parseAsRle(std::ifstream &ifs)
+//
+// The offset table gives, for each channel, the position and length in the
+// file of the rle data of each scanline. Scanlines are then independent, blocks
+// of rows are decoded concurrently on the global ThreadPool straight into the
+// final rgb/rgba buffer.
+//
+bool RgbImage::parseAsRle(ByteArrayCursor& iCursor)
 {
-    bool ok = true;
-    
-    Realisim::Core::StreamUtility su;
-    su.setStreamFormat(Realisim::Core::StreamUtility::eBigEndian);
-    
     const int numChannels = getNumberOfChannels();
     const int sx = getWidthInPixel();
     const int sy = getHeightInPixel();
-    
+
     //--- read offset table
-    int32_t* startTable = nullptr;
-    int32_t* lenghtTable = nullptr;;
-    const int tableLenght = sy * numChannels;
-    
-    startTable = new int32_t[tableLenght];
-    for(int i = 0; i < tableLenght; ++i)
-    {
-        ok &= su.readInt32(ifs, &startTable[i]);
-    }
-    
-    lenghtTable = new int32_t[tableLenght];
-    for(int i = 0; i < tableLenght; ++i)
+    const int tableLength = sy * numChannels;
+    vector<int32_t> startTable(tableLength);
+    vector<int32_t> lengthTable(tableLength);
+    bool ok = iCursor.readArray(tableLength, startTable.data());
+    ok &= iCursor.readArray(tableLength, lengthTable.data());
+
+    // the rle offsets are relative to the file.
+    const ByteArray& file = iCursor.getData();
+    for (int i = 0; i < tableLength && ok; ++i)
     {
-        ok &= su.readInt32(ifs, &lenghtTable[i]);
+        ok &= startTable[i] >= 0 && lengthTable[i] >= 0 &&
+            (uint64_t)startTable[i] + (uint64_t)lengthTable[i] <= file.size();
     }
+    if (!ok)
+    { return false; }
+
+    //--- create final buffer, each channel is decompressed in place at its
+    // offset in the rgb(a) pixels. See parseAsVerbatim for the layout.
+    mImageData.resize((size_t)sx * sy * numChannels);
+    unsigned char* pDest = (unsigned char*)mImageData.data();
+    const unsigned char* pFile = (const unsigned char*)file.constData();
+
+    atomic<bool> decoded(true);
+    auto decodeRows = [&](int iTask) {
+        const int rowEnd = std::min((iTask + 1) * kRowsPerTask, sy);
+        for (int row = iTask * kRowsPerTask; row < rowEnd && decoded; ++row)
+            for (int channelIndex = 0; channelIndex < numChannels; ++channelIndex)
+            {
+                const int tableIndex = row + channelIndex * sy;
+                if (!decompress(pFile + startTable[tableIndex], lengthTable[tableIndex], sx, numChannels,
+                    pDest + (size_t)row * sx * numChannels + channelIndex))
+                {
+                    decoded = false;
+                }
+            }
+    };
+    ThreadPool::getGlobalInstance().parallelFor((sy + kRowsPerTask - 1) / kRowsPerTask, decodeRows);
 
-    // compute remaining size of the stream
-    const std::streampos currentStreamPos = ifs.tellg();
-    ifs.seekg(0, std::ios::end);
-    const size_t remainingSize = ifs.tellg() - currentStreamPos;
-    ifs.seekg(currentStreamPos);
-    
-    // read all image data at once, it is faster and enables openmp usage.
-    // it brings in a twist... the rleOffset from startTable are relative to
-    // the file, so we will need to adjust the rleOffset to be relative to
-    // the rleRawData buffer. (relativeRleOffset = rleOffset - currentStreamPos)
-    // 
-    string rleRawData;
-    ok &= su.readBytes(ifs, (int)remainingSize, &rleRawData);
-
-    //--- create final buffer and recombine channel buffer into a
-    // single rgb/rgba buffer.
-    const int finalSize = sx * sy * numChannels;
-    mImageData.resize(finalSize);
-
-    //--- For each color channel, decompress each scanline and repack rgb(a) into final buffer
-    // see parseAsVerbatim for explanation on packing into final buffer.
-    //vector<unsigned char*> channels(numChannels);
-    unsigned char* scanline = nullptr;
-    int channelIndex = 0;
-    //#pragma omp parallel for num_threads(numChannels) private(channelIndex, scanline) shared(ok)
-    for(channelIndex = 0; channelIndex < numChannels; ++channelIndex)
-    {
-        scanline = new unsigned char[sx];
-        
-        //decompress each scanline of channel n
-        for(int row = 0; row < sy && ok; ++row)
-        {
-            //fetch scanline
-            int32_t rleOffset = startTable[row + channelIndex * sy];
-            int32_t rleLength = lenghtTable[row + channelIndex * sy];
-            
-            // grab the rledata for the current scanline
-            string rleData = rleRawData.substr(rleOffset - currentStreamPos, rleLength);
-            decompress( rleData, &scanline[0] );
-
-            for(int i = 0; i < sx; ++i)
-            { mImageData[ (row * sx * numChannels) + (i * numChannels) + channelIndex] = scanline[i]; }
-        }
-
-        delete[] scanline;
-    }
-    
-    //cleanup
-    delete[] startTable;
-    delete[] lenghtTable;
-    
-    return ok;
+    return decoded;
 }
+
 //------------------------------------------------------------------------------
-bool RgbImage::parseAsVerbatim(std::ifstream &ifs)
+bool RgbImage::parseAsVerbatim(ByteArrayCursor& iCursor)
 {
-    bool ok = true;
-    
-    //each channel is stored one after the other... so lets read each of them
-    //separately and repack them in rgb or rgba format on the fly.
-    Realisim::Core::StreamUtility su;
-    su.setStreamFormat(Realisim::Core::StreamUtility::eBigEndian);
-        
-    //read all data at once, it is faster and enables using openmp
-    string rawData;
-    ok &= su.readBytes(ifs, mWidthInPixel * mHeightInPixel * mNumberOfChannels, &rawData);
-
-    if (ok)
-    {
-        const int n = getNumberOfChannels();
-
-        // create final buffer to recombine channel buffer into a
-        // single rgb/rgba buffer.
-        const int finalSize = getWidthInPixel() * getHeightInPixel() * n;
-        mImageData.resize(finalSize);
-
-        int i = 0;
-        const int sizeOfChannelInBytes = mWidthInPixel * mHeightInPixel;
+    //each channel is stored one after the other... so lets repack them in
+    //rgb or rgba format, straight from the file data.
+    const int n = getNumberOfChannels();
+    const size_t sizeOfChannelInBytes = (size_t)mWidthInPixel * mHeightInPixel;
+    if (iCursor.getNumberOfRemainingBytes() < sizeOfChannelInBytes * n)
+    { return false; }
+
+    // create final buffer to recombine channel buffer into a
+    // single rgb/rgba buffer.
+    mImageData.resize(sizeOfChannelInBytes * n);
+    char* pDest = mImageData.data();
+    const char* pSource = iCursor.getData().constData() + iCursor.getPosition();
 
-        //on channel per thread.
-        #pragma omp parallel for num_threads(n) private(i)
-        for(i = 0; i < n; ++i)
-        {
-            for(int j = 0; j < sizeOfChannelInBytes; ++j)
+    const int sx = getWidthInPixel();
+    const int sy = getHeightInPixel();
+    auto repackRows = [&](int iTask) {
+        const int rowEnd = std::min((iTask + 1) * kRowsPerTask, sy);
+        for (size_t j = (size_t)iTask * kRowsPerTask * sx; j < (size_t)rowEnd * sx; ++j)
+            for (int i = 0; i < n; ++i)
             {
-                mImageData[(j * n) + i] = rawData[ i*sizeOfChannelInBytes + j ];
+                pDest[(j * n) + i] = pSource[i * sizeOfChannelInBytes + j];
             }
-        }
+    };
+    ThreadPool::getGlobalInstance().parallelFor((sy + kRowsPerTask - 1) / kRowsPerTask, repackRows);
 
-    }
-    return ok;
+    return true;
 }
-
-
-
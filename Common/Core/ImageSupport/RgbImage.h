@@ -2,7 +2,7 @@
 #pragma once
 
 #include "Core/ImageSupport/IImageReader.h"
-#include <fstream>
+#include <cstddef>
 #include <stdint.h>
 #include <string>
 
@@ -10,6 +10,7 @@ namespace Realisim
 {
 namespace Core
 {
+class ByteArrayCursor;
 
 /*------------------------------------------------------------------------------
  
@@ -25,6 +26,9 @@ namespace Core
  data, and if ZSIZE is 4, it is assumed to contain RGB data with alpha. The 
  origin for all SGI images is the lower left hand corner. The first scanline 
  (row 0) is always the bottom row of the image.
+
+ RLE scanlines are decoded concurrently on the global ThreadPool (see
+ parseAsRle()).
 ------------------------------------------------------------------------------*/
 class RgbImage : public IImageReader
 {
@@ -48,10 +52,10 @@ public:
     virtual void loadHeader() override;
     
 protected:
-    void decompress(const std::string&, unsigned char*);
-    bool loadHeader(std::ifstream&);
-    bool parseAsRle(std::ifstream&);
-    bool parseAsVerbatim(std::ifstream&);
+    static bool decompress(const unsigned char* ipRle, size_t iRleSize, int iWidth, int iDestStride, unsigned char* opDest);
+    bool loadHeader(ByteArrayCursor&);
+    bool parseAsRle(ByteArrayCursor&);
+    bool parseAsVerbatim(ByteArrayCursor&);
     
     //-- data read from file.
     int16_t mMagicNumber;
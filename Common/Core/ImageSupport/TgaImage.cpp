@@ -8,6 +8,7 @@
 
 
 #include <cassert>
+#include <fstream>
 #include "TgaImage.h"
 #include "tga/v4d8df65/tga.hpp"
 
@@ -57,17 +58,34 @@ void TgaImage::load()
 }
 
 //---------------------------------------------------------------------------------------------------------------------
+// The thirdParty TGA does not support loading only the header, the 18 bytes header is read here with the same
+// rules as tga::TGA::Load().
+//
 void TgaImage::loadHeader()
 {
-    // the current thirdParty TGA does not support loading only the header, so as a cheap workaround
-    // we will load the image and then  flush the image data...
-    //
     clear();
-    tga::TGA tga;
-    if (tga.Load(getFilenamePath()))
-    {
-        mImageData.clear();
-    }
+
+    unsigned char header[18];
+    std::ifstream ifs(getFilenamePath(), std::ios::binary);
+    if (!ifs.read((char*)header, sizeof(header)))
+    { return; }
+
+    const int imageType = header[2];
+    const int colorMapLength = header[5] | (header[6] << 8);
+    const int colorMapEntrySize = header[7];
+    const int width = header[12] | (header[13] << 8);
+    const int height = header[14] | (header[15] << 8);
+    const int bits = header[16];
+
+    const int pixelSize = colorMapLength == 0 ? bits / 8 : colorMapEntrySize / 8;
+    if (imageType == 0 || (pixelSize != 1 && pixelSize != 3 && pixelSize != 4))
+    { return; }
+
+    mWidthInPixel = width;
+    mHeightInPixel = height;
+    mNumberOfChannels = (int8_t)pixelSize;
+    mBytesPerChannel = 1;
+    mIsValid = true;
 }
 
 
@@ -0,0 +1,441 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include "Core/Color.h"
+#include "Core/Image.h"
+#include "Core/ImageInternalFormat.h"
+#include <cstring>
+#include "Half/half.hpp"
+#include "Math/VectorI.h"
+#include <stdint.h>
+#include <type_traits>
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // Channel type and number of channels of an ImageInternalFormat, known at
+    // compile time.
+    //
+    template<typename T, int kChannels>
+    struct PixelTraitsBase
+    {
+        typedef T ChannelType;
+        enum { kNumberOfChannels = kChannels, kBytesPerPixel = (int)sizeof(T) * kChannels };
+    };
+
+    template<ImageInternalFormat kFormat> struct PixelTraits;
+    template<> struct PixelTraits<iifRUint8> : PixelTraitsBase<uint8_t, 1> {};
+    template<> struct PixelTraits<iifRInt8> : PixelTraitsBase<int8_t, 1> {};
+    template<> struct PixelTraits<iifRUint16> : PixelTraitsBase<uint16_t, 1> {};
+    template<> struct PixelTraits<iifRInt16> : PixelTraitsBase<int16_t, 1> {};
+    template<> struct PixelTraits<iifRF16> : PixelTraitsBase<half_float::half, 1> {};
+    template<> struct PixelTraits<iifRUint32> : PixelTraitsBase<uint32_t, 1> {};
+    template<> struct PixelTraits<iifRInt32> : PixelTraitsBase<int32_t, 1> {};
+    template<> struct PixelTraits<iifRF32> : PixelTraitsBase<float, 1> {};
+    template<> struct PixelTraits<iifRgbUint8> : PixelTraitsBase<uint8_t, 3> {};
+    template<> struct PixelTraits<iifRgbInt8> : PixelTraitsBase<int8_t, 3> {};
+    template<> struct PixelTraits<iifRgbUint16> : PixelTraitsBase<uint16_t, 3> {};
+    template<> struct PixelTraits<iifRgbInt16> : PixelTraitsBase<int16_t, 3> {};
+    template<> struct PixelTraits<iifRgbF16> : PixelTraitsBase<half_float::half, 3> {};
+    template<> struct PixelTraits<iifRgbUint32> : PixelTraitsBase<uint32_t, 3> {};
+    template<> struct PixelTraits<iifRgbInt32> : PixelTraitsBase<int32_t, 3> {};
+    template<> struct PixelTraits<iifRgbF32> : PixelTraitsBase<float, 3> {};
+    template<> struct PixelTraits<iifRgbaUint8> : PixelTraitsBase<uint8_t, 4> {};
+    template<> struct PixelTraits<iifRgbaInt8> : PixelTraitsBase<int8_t, 4> {};
+    template<> struct PixelTraits<iifRgbaUint16> : PixelTraitsBase<uint16_t, 4> {};
+    template<> struct PixelTraits<iifRgbaInt16> : PixelTraitsBase<int16_t, 4> {};
+    template<> struct PixelTraits<iifRgbaF16> : PixelTraitsBase<half_float::half, 4> {};
+    template<> struct PixelTraits<iifRgbaUint32> : PixelTraitsBase<uint32_t, 4> {};
+    template<> struct PixelTraits<iifRgbaInt32> : PixelTraitsBase<int32_t, 4> {};
+    template<> struct PixelTraits<iifRgbaF32> : PixelTraitsBase<float, 4> {};
+
+    namespace ImageViewHelpers
+    {
+        // Converts a color to the 4 channels of the given type.
+        inline void getChannels(const Color& iC, uint8_t *o)
+        { o[0] = iC.getRedUint8(); o[1] = iC.getGreenUint8(); o[2] = iC.getBlueUint8(); o[3] = iC.getAlphaUint8(); }
+        inline void getChannels(const Color& iC, int8_t *o)
+        { o[0] = iC.getRedInt8(); o[1] = iC.getGreenInt8(); o[2] = iC.getBlueInt8(); o[3] = iC.getAlphaInt8(); }
+        inline void getChannels(const Color& iC, uint16_t *o)
+        { o[0] = iC.getRedUint16(); o[1] = iC.getGreenUint16(); o[2] = iC.getBlueUint16(); o[3] = iC.getAlphaUint16(); }
+        inline void getChannels(const Color& iC, int16_t *o)
+        { o[0] = iC.getRedInt16(); o[1] = iC.getGreenInt16(); o[2] = iC.getBlueInt16(); o[3] = iC.getAlphaInt16(); }
+        inline void getChannels(const Color& iC, half_float::half *o)
+        { o[0] = iC.getRedF16(); o[1] = iC.getGreenF16(); o[2] = iC.getBlueF16(); o[3] = iC.getAlphaF16(); }
+        inline void getChannels(const Color& iC, uint32_t *o)
+        { o[0] = iC.getRedUint32(); o[1] = iC.getGreenUint32(); o[2] = iC.getBlueUint32(); o[3] = iC.getAlphaUint32(); }
+        inline void getChannels(const Color& iC, int32_t *o)
+        { o[0] = iC.getRedInt32(); o[1] = iC.getGreenInt32(); o[2] = iC.getBlueInt32(); o[3] = iC.getAlphaInt32(); }
+        inline void getChannels(const Color& iC, float *o)
+        { o[0] = iC.getRedF32(); o[1] = iC.getGreenF32(); o[2] = iC.getBlueF32(); o[3] = iC.getAlphaF32(); }
+
+        // Converts iNumberOfChannels channels to a color, the same way as
+        // getColorFromImageBuffer().
+        inline void setColor(const uint8_t *ip, int iNumberOfChannels, Color *o)
+        {
+            switch (iNumberOfChannels)
+            {
+            case 1: o->setRedUint8(ip[0]); break;
+            case 3: o->setUint8(ip[0], ip[1], ip[2]); break;
+            default: o->setUint8(ip[0], ip[1], ip[2], ip[3]); break;
+            }
+        }
+        inline void setColor(const int8_t *ip, int iNumberOfChannels, Color *o)
+        {
+            switch (iNumberOfChannels)
+            {
+            case 1: o->setRedInt8(ip[0]); break;
+            case 3: o->setInt8(ip[0], ip[1], ip[2]); break;
+            default: o->setInt8(ip[0], ip[1], ip[2], ip[3]); break;
+            }
+        }
+        inline void setColor(const uint16_t *ip, int iNumberOfChannels, Color *o)
+        {
+            switch (iNumberOfChannels)
+            {
+            case 1: o->setRedUint16(ip[0]); break;
+            case 3: o->setUint16(ip[0], ip[1], ip[2]); break;
+            default: o->setUint16(ip[0], ip[1], ip[2], ip[3]); break;
+            }
+        }
+        inline void setColor(const int16_t *ip, int iNumberOfChannels, Color *o)
+        {
+            switch (iNumberOfChannels)
+            {
+            case 1: o->setRedInt16(ip[0]); break;
+            case 3: o->setInt16(ip[0], ip[1], ip[2]); break;
+            default: o->setInt16(ip[0], ip[1], ip[2], ip[3]); break;
+            }
+        }
+        inline void setColor(const half_float::half *ip, int iNumberOfChannels, Color *o)
+        {
+            switch (iNumberOfChannels)
+            {
+            case 1: o->setRedF16(ip[0]); break;
+            case 3: o->setF16(ip[0], ip[1], ip[2]); break;
+            default: o->setF16(ip[0], ip[1], ip[2], ip[3]); break;
+            }
+        }
+        inline void setColor(const uint32_t *ip, int iNumberOfChannels, Color *o)
+        {
+            switch (iNumberOfChannels)
+            {
+            case 1: o->setRedUint32(ip[0]); break;
+            case 3: o->setUint32(ip[0], ip[1], ip[2]); break;
+            default: o->setUint32(ip[0], ip[1], ip[2], ip[3]); break;
+            }
+        }
+        inline void setColor(const int32_t *ip, int iNumberOfChannels, Color *o)
+        {
+            switch (iNumberOfChannels)
+            {
+            case 1: o->setRedInt32(ip[0]); break;
+            case 3: o->setInt32(ip[0], ip[1], ip[2]); break;
+            default: o->setInt32(ip[0], ip[1], ip[2], ip[3]); break;
+            }
+        }
+        inline void setColor(const float *ip, int iNumberOfChannels, Color *o)
+        {
+            switch (iNumberOfChannels)
+            {
+            case 1: o->setRedF32(ip[0]); break;
+            case 3: o->setF32(ip[0], ip[1], ip[2]); break;
+            default: o->setF32(ip[0], ip[1], ip[2], ip[3]); break;
+            }
+        }
+
+        // Clips a span [iSource, iSource + ioLength[ copied to
+        // [ioDestination, ioDestination + ioLength[ against both extents.
+        inline void clipSpan(int *ioSource, int *ioDestination, int *ioLength, int iSourceExtent, int iDestinationExtent)
+        {
+            const int shift = std::max(0, std::max(-*ioSource, -*ioDestination));
+            *ioSource += shift;
+            *ioDestination += shift;
+            *ioLength -= shift;
+            *ioLength = std::min(*ioLength, std::min(iSourceExtent - *ioSource, iDestinationExtent - *ioDestination));
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // A typed view on the pixels of an image whose internal format is known at
+    // compile time. Pixels are accessed through row pointers, without the
+    // per-pixel switch on the internal format and without the per-pixel
+    // copy-on-write check of Image::setPixelColor().
+    //
+    // Usage:
+    //      ImageView<iifRgbaUint8> view(image);
+    //      const ImageView<iifRgbaUint8>::Pixel red = view.makePixel(Color(1.0, 0.0, 0.0, 1.0));
+    //      view.fill(Vector2i(8, 8), Vector2i(16, 16), red);
+    //      uint8_t *row = view.getRow(10);
+    //
+    //      ConstImageView<iifRgbaUint8> source(otherImage);
+    //      view.blit(source, Vector2i(32, 0));
+    //
+    // Constructing a mutable view from an image detaches the image data once
+    // (see ByteArray::data()). The view points directly in the image data: it
+    // is invalidated when the image is modified by other means than the view
+    // (set(), setData(), load(), ...) or when it is copied and then modified.
+    //
+    // The image internal format must be kFormat, otherwise the view is
+    // invalid (see isValid()).
+    //
+    // Rectangle operations (fill, copyRect, blit) are clipped to the images.
+    //
+    template<ImageInternalFormat kFormat, typename ByteType = char>
+    class ImageView
+    {
+    public:
+        typedef PixelTraits<kFormat> Traits;
+        typedef typename Traits::ChannelType ChannelType;
+        typedef typename std::conditional<std::is_const<ByteType>::value,
+            const ChannelType, ChannelType>::type ViewChannelType;
+        typedef typename std::conditional<std::is_const<ByteType>::value,
+            const Image, Image>::type ImageType;
+        enum { kNumberOfChannels = Traits::kNumberOfChannels, kBytesPerPixel = Traits::kBytesPerPixel };
+
+        struct Pixel
+        {
+            ChannelType mChannels[kNumberOfChannels];
+        };
+
+        ImageView();
+        ImageView(ByteType *ipData, int iWidth, int iHeight);
+        explicit ImageView(ImageType& iImage);
+        ImageView(const ImageView&) = default;
+        ImageView& operator=(const ImageView&) = default;
+        ~ImageView() = default;
+
+        template<typename SourceByteType>
+        void blit(const ImageView<kFormat, SourceByteType>& iSource, const Math::Vector2i& iDestination);
+        template<typename SourceByteType>
+        void copyRect(const ImageView<kFormat, SourceByteType>& iSource, const Math::Vector2i& iSourceOrigin,
+            const Math::Vector2i& iSize, const Math::Vector2i& iDestination);
+        void fill(const Pixel& iPixel);
+        void fill(const Math::Vector2i& iOrigin, const Math::Vector2i& iSize, const Pixel& iPixel);
+        int getHeight() const { return mHeight; }
+        ViewChannelType* getPixel(int iX, int iY) const;
+        Color getPixelColor(int iX, int iY) const;
+        ViewChannelType* getRow(int iY) const;
+        Math::Vector2i getSizeInPixels() const { return Math::Vector2i(mWidth, mHeight); }
+        int getWidth() const { return mWidth; }
+        bool isValid() const { return mpData != nullptr; }
+        static Pixel makePixel(const Color& iColor);
+        void setPixel(int iX, int iY, const Pixel& iPixel);
+        void setPixelColor(int iX, int iY, const Color& iColor);
+
+    private:
+        static char* getImageData(Image& iImage) { return iImage.mImageData.data(); }
+        static const char* getImageData(const Image& iImage) { return iImage.mImageData.constData(); }
+
+        ByteType *mpData;
+        int mWidth;
+        int mHeight;
+    };
+
+    template<ImageInternalFormat kFormat>
+    using ConstImageView = ImageView<kFormat, const char>;
+
+    //-------------------------------------------------------------------------
+    // Calls iFunctor with a std::integral_constant<ImageInternalFormat, ...>
+    // holding iFormat, this selects a kernel instantiated for each format
+    // once, instead of switching on the format for every pixel.
+    //
+    // Ex:
+    //      visitImageInternalFormat(image.getInternalFormat(), [&](auto iFormat) {
+    //          ImageView<decltype(iFormat)::value> view(image);
+    //          ...
+    //      });
+    //
+    // Returns false, without calling iFunctor, when iFormat is iifUndefined.
+    //
+    template<typename Functor>
+    bool visitImageInternalFormat(ImageInternalFormat iFormat, Functor&& iFunctor)
+    {
+#define REALISIM_VISIT_FORMAT(f) case f: iFunctor(std::integral_constant<ImageInternalFormat, f>()); return true;
+        switch (iFormat)
+        {
+        REALISIM_VISIT_FORMAT(iifRUint8) REALISIM_VISIT_FORMAT(iifRInt8)
+        REALISIM_VISIT_FORMAT(iifRUint16) REALISIM_VISIT_FORMAT(iifRInt16)
+        REALISIM_VISIT_FORMAT(iifRF16) REALISIM_VISIT_FORMAT(iifRUint32)
+        REALISIM_VISIT_FORMAT(iifRInt32) REALISIM_VISIT_FORMAT(iifRF32)
+        REALISIM_VISIT_FORMAT(iifRgbUint8) REALISIM_VISIT_FORMAT(iifRgbInt8)
+        REALISIM_VISIT_FORMAT(iifRgbUint16) REALISIM_VISIT_FORMAT(iifRgbInt16)
+        REALISIM_VISIT_FORMAT(iifRgbF16) REALISIM_VISIT_FORMAT(iifRgbUint32)
+        REALISIM_VISIT_FORMAT(iifRgbInt32) REALISIM_VISIT_FORMAT(iifRgbF32)
+        REALISIM_VISIT_FORMAT(iifRgbaUint8) REALISIM_VISIT_FORMAT(iifRgbaInt8)
+        REALISIM_VISIT_FORMAT(iifRgbaUint16) REALISIM_VISIT_FORMAT(iifRgbaInt16)
+        REALISIM_VISIT_FORMAT(iifRgbaF16) REALISIM_VISIT_FORMAT(iifRgbaUint32)
+        REALISIM_VISIT_FORMAT(iifRgbaInt32) REALISIM_VISIT_FORMAT(iifRgbaF32)
+        default: break;
+        }
+#undef REALISIM_VISIT_FORMAT
+        return false;
+    }
+
+    //-------------------------------------------------------------------------
+    template<ImageInternalFormat kFormat, typename ByteType>
+    ImageView<kFormat, ByteType>::ImageView() :
+        mpData(nullptr),
+        mWidth(0),
+        mHeight(0)
+    {}
+
+    //-------------------------------------------------------------------------
+    template<ImageInternalFormat kFormat, typename ByteType>
+    ImageView<kFormat, ByteType>::ImageView(ByteType *ipData, int iWidth, int iHeight) :
+        mpData(ipData),
+        mWidth(ipData != nullptr ? iWidth : 0),
+        mHeight(ipData != nullptr ? iHeight : 0)
+    {}
+
+    //-------------------------------------------------------------------------
+    template<ImageInternalFormat kFormat, typename ByteType>
+    ImageView<kFormat, ByteType>::ImageView(ImageType& iImage) :
+        ImageView()
+    {
+        assert(!iImage.hasImageData() || iImage.getInternalFormat() == kFormat);
+        if (iImage.hasImageData() && iImage.getInternalFormat() == kFormat)
+        {
+            mpData = getImageData(iImage);
+            mWidth = iImage.getWidth();
+            mHeight = iImage.getHeight();
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    template<ImageInternalFormat kFormat, typename ByteType>
+    template<typename SourceByteType>
+    void ImageView<kFormat, ByteType>::blit(const ImageView<kFormat, SourceByteType>& iSource,
+        const Math::Vector2i& iDestination)
+    {
+        copyRect(iSource, Math::Vector2i(0, 0), iSource.getSizeInPixels(), iDestination);
+    }
+
+    //-------------------------------------------------------------------------
+    // Copies the iSize rectangle at iSourceOrigin of iSource at iDestination.
+    // iSource can be this view, overlapping rectangles are handled.
+    //
+    template<ImageInternalFormat kFormat, typename ByteType>
+    template<typename SourceByteType>
+    void ImageView<kFormat, ByteType>::copyRect(const ImageView<kFormat, SourceByteType>& iSource,
+        const Math::Vector2i& iSourceOrigin, const Math::Vector2i& iSize, const Math::Vector2i& iDestination)
+    {
+        int sx = iSourceOrigin.x(), sy = iSourceOrigin.y();
+        int dx = iDestination.x(), dy = iDestination.y();
+        int w = iSize.x(), h = iSize.y();
+        ImageViewHelpers::clipSpan(&sx, &dx, &w, iSource.getWidth(), getWidth());
+        ImageViewHelpers::clipSpan(&sy, &dy, &h, iSource.getHeight(), getHeight());
+        if (w <= 0 || h <= 0) { return; }
+
+        // when copying downward in the same image, rows are copied from the
+        // last one so that source rows are read before being overwritten.
+        const bool isBackward = (const void*)iSource.getRow(0) == (const void*)getRow(0) && dy > sy;
+        const size_t rowSizeInBytes = (size_t)w * kBytesPerPixel;
+        for (int i = 0; i < h; ++i)
+        {
+            const int y = isBackward ? h - 1 - i : i;
+            memmove(getPixel(dx, dy + y), iSource.getPixel(sx, sy + y), rowSizeInBytes);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    template<ImageInternalFormat kFormat, typename ByteType>
+    void ImageView<kFormat, ByteType>::fill(const Pixel& iPixel)
+    {
+        fill(Math::Vector2i(0, 0), getSizeInPixels(), iPixel);
+    }
+
+    //-------------------------------------------------------------------------
+    // The first row of the rectangle is written pixel by pixel, the following
+    // rows are copies of it.
+    //
+    template<ImageInternalFormat kFormat, typename ByteType>
+    void ImageView<kFormat, ByteType>::fill(const Math::Vector2i& iOrigin,
+        const Math::Vector2i& iSize, const Pixel& iPixel)
+    {
+        const int x0 = std::max(iOrigin.x(), 0), y0 = std::max(iOrigin.y(), 0);
+        const int x1 = std::min(iOrigin.x() + iSize.x(), mWidth);
+        const int y1 = std::min(iOrigin.y() + iSize.y(), mHeight);
+        if (x1 <= x0 || y1 <= y0) { return; }
+
+        ChannelType *first = getPixel(x0, y0);
+        for (int x = 0; x < x1 - x0; ++x)
+        {
+            for (int c = 0; c < kNumberOfChannels; ++c)
+            { first[x * kNumberOfChannels + c] = iPixel.mChannels[c]; }
+        }
+
+        const size_t rowSizeInBytes = (size_t)(x1 - x0) * kBytesPerPixel;
+        for (int y = y0 + 1; y < y1; ++y)
+        {
+            memcpy(getPixel(x0, y), first, rowSizeInBytes);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Returns a pointer to the first channel of pixel (iX, iY). No bound
+    // checking is done.
+    //
+    template<ImageInternalFormat kFormat, typename ByteType>
+    typename ImageView<kFormat, ByteType>::ViewChannelType*
+        ImageView<kFormat, ByteType>::getPixel(int iX, int iY) const
+    {
+        assert(iX >= 0 && iX < mWidth && iY >= 0 && iY < mHeight);
+        return (ViewChannelType*)(mpData + ((size_t)iY * mWidth + iX) * kBytesPerPixel);
+    }
+
+    //-------------------------------------------------------------------------
+    template<ImageInternalFormat kFormat, typename ByteType>
+    Color ImageView<kFormat, ByteType>::getPixelColor(int iX, int iY) const
+    {
+        Color r;
+        ImageViewHelpers::setColor(getPixel(iX, iY), kNumberOfChannels, &r);
+        return r;
+    }
+
+    //-------------------------------------------------------------------------
+    template<ImageInternalFormat kFormat, typename ByteType>
+    typename ImageView<kFormat, ByteType>::ViewChannelType*
+        ImageView<kFormat, ByteType>::getRow(int iY) const
+    {
+        assert(iY >= 0 && iY < mHeight);
+        return (ViewChannelType*)(mpData + (size_t)iY * mWidth * kBytesPerPixel);
+    }
+
+    //-------------------------------------------------------------------------
+    // Converts the color to the channels of kFormat, once, so it can be
+    // written many times with setPixel() or fill().
+    //
+    template<ImageInternalFormat kFormat, typename ByteType>
+    typename ImageView<kFormat, ByteType>::Pixel
+        ImageView<kFormat, ByteType>::makePixel(const Color& iColor)
+    {
+        ChannelType channels[4];
+        ImageViewHelpers::getChannels(iColor, channels);
+
+        Pixel r;
+        for (int c = 0; c < kNumberOfChannels; ++c)
+        { r.mChannels[c] = channels[c]; }
+        return r;
+    }
+
+    //-------------------------------------------------------------------------
+    template<ImageInternalFormat kFormat, typename ByteType>
+    void ImageView<kFormat, ByteType>::setPixel(int iX, int iY, const Pixel& iPixel)
+    {
+        ChannelType *p = getPixel(iX, iY);
+        for (int c = 0; c < kNumberOfChannels; ++c)
+        { p[c] = iPixel.mChannels[c]; }
+    }
+
+    //-------------------------------------------------------------------------
+    template<ImageInternalFormat kFormat, typename ByteType>
+    void ImageView<kFormat, ByteType>::setPixelColor(int iX, int iY, const Color& iColor)
+    {
+        setPixel(iX, iY, makePixel(iColor));
+    }
+}
+}
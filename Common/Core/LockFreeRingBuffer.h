@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // This class is a bounded multi-producers/multi-consumers FIFO that does
+    // not use any mutex. It is based on Dmitry Vyukov's bounded MPMC queue:
+    // each cell of the ring holds a sequence number that tells producers and
+    // consumers if the cell is ready to be written or read. A single
+    // compare-and-swap on the enqueue (or dequeue) position is required to
+    // claim a cell.
+    //
+    // The capacity is rounded up to the next power of two so the position can
+    // be wrapped with a mask instead of a modulo.
+    //
+    // tryPush() returns false when the ring is full and tryPop() returns false
+    // when it is empty, neither of them ever block.
+    //
+    // getApproximateSize() is, as the name suggest, only a snapshot of the
+    // number of elements. It can be off when other threads are pushing or
+    // popping at the same time.
+    //
+    // T is expected to be cheap to copy, typically a pointer.
+    //
+    template<typename T>
+    class LockFreeRingBuffer
+    {
+    public:
+        explicit LockFreeRingBuffer(int iCapacity = 1024);
+        LockFreeRingBuffer(const LockFreeRingBuffer&) = delete;
+        LockFreeRingBuffer& operator=(const LockFreeRingBuffer&) = delete;
+        ~LockFreeRingBuffer() = default;
+
+        int getApproximateSize() const;
+        int getCapacity() const;
+        bool isEmpty() const;
+        bool tryPop(T* opValue);
+        bool tryPush(const T& iValue);
+
+    protected:
+        struct Cell
+        {
+            Cell() : mSequence(0), mValue() {}
+            std::atomic<size_t> mSequence;
+            T mValue;
+        };
+
+        // 64 bytes is the cache line size on every platform we build on.
+        // The positions are padded so that producers and consumers do
+        // not invalidate each other cache line.
+        //
+        enum { kCacheLineSize = 64 };
+
+        std::vector<Cell> mCells;
+        size_t mMask;
+        char mPadding0[kCacheLineSize];
+        std::atomic<size_t> mEnqueuePosition;
+        char mPadding1[kCacheLineSize - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> mDequeuePosition;
+        char mPadding2[kCacheLineSize - sizeof(std::atomic<size_t>)];
+    };
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    LockFreeRingBuffer<T>::LockFreeRingBuffer(int iCapacity) :
+        mCells(),
+        mMask(0),
+        mEnqueuePosition(0),
+        mDequeuePosition(0)
+    {
+        size_t capacity = 2;
+        while (capacity < (size_t)iCapacity)
+        {
+            capacity <<= 1;
+        }
+
+        mCells = std::vector<Cell>(capacity);
+        mMask = capacity - 1;
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            mCells[i].mSequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    int LockFreeRingBuffer<T>::getApproximateSize() const
+    {
+        const size_t dequeuePos = mDequeuePosition.load(std::memory_order_acquire);
+        const size_t enqueuePos = mEnqueuePosition.load(std::memory_order_acquire);
+        return enqueuePos > dequeuePos ? (int)(enqueuePos - dequeuePos) : 0;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    int LockFreeRingBuffer<T>::getCapacity() const
+    {
+        return (int)mCells.size();
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    bool LockFreeRingBuffer<T>::isEmpty() const
+    {
+        return getApproximateSize() == 0;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    bool LockFreeRingBuffer<T>::tryPop(T* opValue)
+    {
+        assert(opValue != nullptr);
+
+        Cell *cell = nullptr;
+        size_t pos = mDequeuePosition.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &mCells[pos & mMask];
+            const size_t seq = cell->mSequence.load(std::memory_order_acquire);
+            const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (mDequeuePosition.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                { break; }
+            }
+            else if (diff < 0)
+            {
+                // the cell has not been written yet, the ring is empty.
+                return false;
+            }
+            else
+            {
+                pos = mDequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        *opValue = cell->mValue;
+        cell->mSequence.store(pos + mMask + 1, std::memory_order_release);
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    bool LockFreeRingBuffer<T>::tryPush(const T& iValue)
+    {
+        Cell *cell = nullptr;
+        size_t pos = mEnqueuePosition.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &mCells[pos & mMask];
+            const size_t seq = cell->mSequence.load(std::memory_order_acquire);
+            const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+            if (diff == 0)
+            {
+                if (mEnqueuePosition.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                { break; }
+            }
+            else if (diff < 0)
+            {
+                // the cell has not been read yet, the ring is full.
+                return false;
+            }
+            else
+            {
+                pos = mEnqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->mValue = iValue;
+        cell->mSequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+}
+}
@@ -1,10 +1,13 @@
-
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include "Core/DateTime.h"
 #include "Core/Logger.h"
 #include "Core/StringUtilities.h"
 #include <iostream>
 #include <cstdarg>
+#include <vector>
 
 #ifdef WIN32
 #pragma warning(disable:4996)
@@ -17,6 +20,223 @@ using namespace std;
 
 namespace {
     const string kTimeFormat("%Y-%m-%d %H:%M:%S.zzz");
+    const string kNoTimestamp;
+
+    // entries fitting in this size are formatted without any allocation.
+    const int kEntryBufferSizeInBytes = 1024;
+
+    // asynchronous mode: the writer thread wakes up at this interval, or as
+    // soon as this many bytes are pending.
+    const int kWriteIntervalInMs = 50;
+    const size_t kPendingSizeToWakeWriterInBytes = 64 * 1024;
+
+    // An entry in the pending buffer is this header followed by the
+    // formatted entry.
+    struct EntryHeader
+    {
+        int64_t mMillisecondsSinceEpoch;
+        int mSizeInBytes;
+    };
+
+    //--- binary format
+    //
+    // The file starts with kBinaryMagic and is followed by records:
+    //      'F' uint32 formatId, uint32 size, format (size bytes)
+    //      'E' int64 millisecondsSinceEpoch (-1 when there is no timestamp),
+    //          uint32 formatId, uint8 numberOfArguments, arguments
+    //
+    // Each argument is a type tag followed by its value:
+    //      'i' int64, 'u' uint64, 'd' double, 'p' uint64 (address),
+    //      's' uint32 size, characters (size bytes)
+    //
+    const char kBinaryMagic[] = { 'R', 'L', 'O', 'G', 'B', 'I', 'N', '1' };
+
+    // entries logged with log() are formatted and logged as a single string
+    // argument of this format.
+    const char kPreformattedEntryFormat[] = "%s";
+
+    template<typename T>
+    void appendPod(std::string* opBuffer, const T& iValue)
+    {
+        opBuffer->append((const char*)&iValue, sizeof(T));
+    }
+
+    // Reads the binary log sequentially, every read fails once the end of the
+    // data is reached.
+    //
+    class BinaryReader
+    {
+    public:
+        explicit BinaryReader(const std::string& iData) : mData(iData), mPosition(0) {}
+        BinaryReader(const BinaryReader&) = delete;
+        BinaryReader& operator=(const BinaryReader&) = delete;
+
+        bool isAtEnd() const { return mPosition >= mData.size(); }
+
+        template<typename T>
+        bool read(T* oValue)
+        {
+            if (mData.size() - mPosition < sizeof(T)) return false;
+            memcpy(oValue, mData.data() + mPosition, sizeof(T));
+            mPosition += sizeof(T);
+            return true;
+        }
+
+        bool readString(uint32_t iSizeInBytes, std::string* oValue)
+        {
+            if (mData.size() - mPosition < iSizeInBytes) return false;
+            oValue->assign(mData.data() + mPosition, iSizeInBytes);
+            mPosition += iSizeInBytes;
+            return true;
+        }
+
+    private:
+        const std::string& mData;
+        size_t mPosition;
+    };
+
+    struct BinaryArgument
+    {
+        BinaryArgument() : mType(0), mInteger(0), mDouble(0.0), mString() {}
+
+        int64_t asInteger() const { return mType == 'd' ? (int64_t)mDouble : mInteger; }
+        double asDouble() const { return mType == 'd' ? mDouble : (double)mInteger; }
+
+        char mType;
+        int64_t mInteger; // 'i', 'u' and 'p'
+        double mDouble;
+        std::string mString;
+    };
+
+    bool readBinaryArgument(BinaryReader& iReader, BinaryArgument* oArgument)
+    {
+        if (!iReader.read(&oArgument->mType)) return false;
+        switch (oArgument->mType)
+        {
+        case 'i':
+        case 'u':
+        case 'p': return iReader.read(&oArgument->mInteger);
+        case 'd': return iReader.read(&oArgument->mDouble);
+        case 's':
+        {
+            uint32_t size = 0;
+            return iReader.read(&size) && iReader.readString(size, &oArgument->mString);
+        }
+        default: return false;
+        }
+    }
+
+    template<typename T>
+    void appendFormatted(std::string* opEntry, const std::string& iSpecification, T iValue)
+    {
+        char buffer[256];
+        const int size = snprintf(buffer, sizeof(buffer), iSpecification.c_str(), iValue);
+        if (size < 0) return;
+        if (size < (int)sizeof(buffer))
+        {
+            opEntry->append(buffer, size);
+        }
+        else
+        {
+            std::string longValue(size + 1, '\0');
+            snprintf(&longValue[0], size + 1, iSpecification.c_str(), iValue);
+            opEntry->append(longValue.c_str(), size);
+        }
+    }
+
+    // Formats the entry the way printf would have. All integers were stored
+    // on 64 bits, so the length modifiers of the format are replaced.
+    //
+    // Returns false if the format does not match the arguments.
+    //
+    bool formatBinaryEntry(const std::string& iFormat, const std::vector<BinaryArgument>& iArguments, std::string* opEntry)
+    {
+        size_t argumentIndex = 0;
+        auto nextArgument = [&]() -> const BinaryArgument* {
+            return argumentIndex < iArguments.size() ? &iArguments[argumentIndex++] : nullptr; };
+
+        const size_t n = iFormat.size();
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (iFormat[i] != '%')
+            {
+                opEntry->push_back(iFormat[i]);
+                continue;
+            }
+
+            if (i + 1 < n && iFormat[i + 1] == '%')
+            {
+                opEntry->push_back('%');
+                ++i;
+                continue;
+            }
+
+            std::string specification("%");
+            ++i;
+            while (i < n && strchr("-+ #0", iFormat[i]) != nullptr)
+            { specification += iFormat[i++]; }
+
+            // width and precision, '*' takes the value from the arguments.
+            for (int part = 0; part < 2; ++part)
+            {
+                if (part == 1)
+                {
+                    if (i >= n || iFormat[i] != '.') break;
+                    specification += iFormat[i++];
+                }
+
+                if (i < n && iFormat[i] == '*')
+                {
+                    const BinaryArgument *a = nextArgument();
+                    if (a == nullptr) return false;
+                    specification += std::to_string(a->asInteger());
+                    ++i;
+                }
+                while (i < n && isdigit((unsigned char)iFormat[i]))
+                { specification += iFormat[i++]; }
+            }
+
+            while (i < n && strchr("hlLqjzt", iFormat[i]) != nullptr)
+            { ++i; }
+            if (i >= n) return false;
+
+            const char conversion = iFormat[i];
+            const BinaryArgument *a = nextArgument();
+            if (a == nullptr) return false;
+
+            switch (conversion)
+            {
+            case 'd': case 'i':
+                specification += "ll";
+                specification += conversion;
+                appendFormatted(opEntry, specification, (long long)a->asInteger());
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                specification += "ll";
+                specification += conversion;
+                appendFormatted(opEntry, specification, (unsigned long long)a->asInteger());
+                break;
+            case 'c':
+                specification += conversion;
+                appendFormatted(opEntry, specification, (int)a->asInteger());
+                break;
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                specification += conversion;
+                appendFormatted(opEntry, specification, a->asDouble());
+                break;
+            case 's':
+                specification += conversion;
+                appendFormatted(opEntry, specification, a->mType == 's' ? a->mString.c_str() : "(null)");
+                break;
+            case 'p':
+                specification += conversion;
+                appendFormatted(opEntry, specification, (void*)(uintptr_t)a->asInteger());
+                break;
+            default: return false;
+            }
+        }
+        return true;
+    }
 }
 
 // static initialization
@@ -24,18 +244,85 @@ Logger* Logger::mpInstance = nullptr;
 
 //---------------------------------------------------------------------------------------------------------------------
 Logger::Logger() :
-    mpLogFile(nullptr)
+    mpLogFile(nullptr),
+    mNumberOfBytesWrittenToFile(0),
+    mTimestampFormatter(kTimeFormat),
+    mMutex(),
+    mWriterThread(),
+    mPendingEntries(),
+    mEntriesBeingWritten(),
+    mNumberOfFlushRequests(0),
+    mNumberOfCompletedFlushes(0),
+    mIsWriterStopping(false),
+    mBinaryFormatIds(),
+    mBinaryRecord()
 {}
 
 //---------------------------------------------------------------------------------------------------------------------
 Logger::~Logger()
 {
+    stopWriterThread();
     closeLogFile();
 
     delete mpInstance;
     mpInstance = nullptr;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+void Logger::appendBinaryArgument(std::string* opArguments, char* iValue)
+{
+    appendBinaryArgument(opArguments, (const char*)iValue);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Logger::appendBinaryArgument(std::string* opArguments, const char* iValue)
+{
+    if (iValue == nullptr)
+    {
+        appendBinaryPointer(opArguments, nullptr);
+        return;
+    }
+
+    const uint32_t size = (uint32_t)strlen(iValue);
+    opArguments->push_back('s');
+    appendPod(opArguments, size);
+    opArguments->append(iValue, size);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Logger::appendBinaryArgument(std::string* opArguments, const std::string& iValue)
+{
+    appendBinaryArgument(opArguments, iValue.c_str());
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Logger::appendBinaryDouble(std::string* opArguments, double iValue)
+{
+    opArguments->push_back('d');
+    appendPod(opArguments, iValue);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Logger::appendBinaryInteger(std::string* opArguments, int64_t iValue)
+{
+    opArguments->push_back('i');
+    appendPod(opArguments, iValue);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Logger::appendBinaryPointer(std::string* opArguments, const void* iValue)
+{
+    opArguments->push_back('p');
+    appendPod(opArguments, (uint64_t)(uintptr_t)iValue);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Logger::appendBinaryUnsignedInteger(std::string* opArguments, uint64_t iValue)
+{
+    opArguments->push_back('u');
+    appendPod(opArguments, iValue);
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 void Logger::closeLogFile()
 {
@@ -48,17 +335,125 @@ void Logger::closeLogFile()
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-Logger& Logger::getInstance()
+// Turns a log written in binary format into the text log that the text format
+// would have produced. Returns false if the file can't be read or is not a
+// binary log, what could be decoded is written anyway.
+//
+bool Logger::decodeBinaryLog(const std::string& iBinaryFilepath, const std::string& iTextFilepath)
 {
-    if (mpInstance == nullptr) {
-        mpInstance = new Logger();
+    FILE *in = fopen(iBinaryFilepath.c_str(), "rb");
+    if (in == nullptr) return false;
+
+    std::string data;
+    char buffer[64 * 1024];
+    size_t n = 0;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    { data.append(buffer, n); }
+    fclose(in);
+
+    if (data.size() < sizeof(kBinaryMagic) ||
+        memcmp(data.data(), kBinaryMagic, sizeof(kBinaryMagic)) != 0)
+    { return false; }
+
+    FILE *out = fopen(iTextFilepath.c_str(), "w");
+    if (out == nullptr) return false;
+
+    std::unordered_map<uint32_t, std::string> formats;
+    std::vector<BinaryArgument> arguments;
+    std::string entry;
+    DateTimeFormatter timestampFormatter(kTimeFormat);
+    bool isValid = true;
+
+    BinaryReader reader(data);
+    reader.readString(sizeof(kBinaryMagic), &entry);
+    while (isValid && !reader.isAtEnd())
+    {
+        char recordType = 0;
+        reader.read(&recordType);
+        if (recordType == 'F')
+        {
+            uint32_t formatId = 0, size = 0;
+            isValid = reader.read(&formatId) && reader.read(&size) &&
+                reader.readString(size, &formats[formatId]);
+        }
+        else if (recordType == 'E')
+        {
+            int64_t millisecondsSinceEpoch = 0;
+            uint32_t formatId = 0;
+            uint8_t numberOfArguments = 0;
+            isValid = reader.read(&millisecondsSinceEpoch) && reader.read(&formatId) &&
+                reader.read(&numberOfArguments);
+
+            arguments.resize(numberOfArguments);
+            for (int i = 0; isValid && i < numberOfArguments; ++i)
+            {
+                arguments[i] = BinaryArgument();
+                isValid = readBinaryArgument(reader, &arguments[i]);
+            }
+
+            auto it = formats.find(formatId);
+            entry.clear();
+            isValid = isValid && it != formats.end() &&
+                formatBinaryEntry(it->second, arguments, &entry);
+            if (isValid)
+            {
+                if (millisecondsSinceEpoch >= 0)
+                {
+                    fprintf(out, "%s - ", timestampFormatter.format(millisecondsSinceEpoch).c_str());
+                }
+                fwrite(entry.data(), 1, entry.size(), out);
+                fputc('\n', out);
+            }
+        }
+        else
+        {
+            isValid = false;
+        }
     }
-    return *mpInstance;
+
+    fclose(out);
+    return isValid;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// The arguments of an entry in binary format are encoded in a buffer local to
+// the calling thread. It is returned empty.
+//
+std::string& Logger::getBinaryArgumentBuffer()
+{
+    thread_local std::string tArguments;
+    tArguments.clear();
+    return tArguments;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
+// Returns the formatted timestamp, see DateTimeFormatter.
+//
+// Must be called with the mutex held, or from the writer thread.
+//
+const std::string& Logger::getTimestamp(int64_t iMillisecondsSinceEpoch)
+{
+    return mTimestampFormatter.format(iMillisecondsSinceEpoch);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// In asynchronous mode, this blocks until all entries logged prior to the call
+// are written.
+//
 void Logger::flush()
 {
+    if (mWriterThread.joinable())
+    {
+        std::unique_lock<std::mutex> lk(mMutex);
+        const uint64_t flushRequest = ++mNumberOfFlushRequests;
+        mWriterCondition.notify_one();
+        mFlushedCondition.wait(lk, [this, flushRequest]()
+            {return mNumberOfCompletedFlushes >= flushRequest; });
+        return;
+    }
+
+    std::lock_guard<std::mutex> lk(mMutex);
+    fflush(stdout);
     if (mpLogFile)
         fflush(mpLogFile);
 }
@@ -83,6 +478,61 @@ void Logger::log(int iLogLevel, const char* iFormat, ...)
     va_end(args);
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+// Appends the entry in binary format to the pending entries (asynchronous
+// mode) or writes it (synchronous mode). The format is written the first time
+// it is used.
+//
+void Logger::logBinary(int iLogLevel, const char* iFormat, int iNumberOfArguments, const std::string& iArguments)
+{
+    if ((iLogLevel & mConfig.mLogLevel) == 0) return;
+
+    const int64_t now = mConfig.mAddTimestampToLogEntry ? DateTime::monotonicMillisecondsSinceEpoch() : -1;
+
+    std::unique_lock<std::mutex> lk(mMutex);
+    std::string &record = mConfig.mIsAsynchronous ? mPendingEntries : mBinaryRecord;
+    const bool wasBelowWakeSize = record.size() < kPendingSizeToWakeWriterInBytes;
+
+    uint32_t formatId = 0;
+    auto it = mBinaryFormatIds.find(iFormat);
+    if (it == mBinaryFormatIds.end())
+    {
+        formatId = (uint32_t)mBinaryFormatIds.size();
+        mBinaryFormatIds[iFormat] = formatId;
+
+        const uint32_t size = (uint32_t)strlen(iFormat);
+        record.push_back('F');
+        appendPod(&record, formatId);
+        appendPod(&record, size);
+        record.append(iFormat, size);
+    }
+    else
+    {
+        formatId = it->second;
+    }
+
+    record.push_back('E');
+    appendPod(&record, now);
+    appendPod(&record, formatId);
+    appendPod(&record, (uint8_t)iNumberOfArguments);
+    record.append(iArguments);
+
+    if (mConfig.mIsAsynchronous)
+    {
+        const bool mustWakeWriter = wasBelowWakeSize &&
+            record.size() >= kPendingSizeToWakeWriterInBytes;
+        lk.unlock();
+
+        if (mustWakeWriter)
+        { mWriterCondition.notify_one(); }
+    }
+    else
+    {
+        writeBinary(record.data(), record.size());
+        record.clear();
+    }
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 void Logger::logInternal(int iLogLevel, const char* iFormat, va_list iArgs)
 {
@@ -91,38 +541,92 @@ void Logger::logInternal(int iLogLevel, const char* iFormat, va_list iArgs)
     //
     if ((iLogLevel & mConfig.mLogLevel) == 0) return;
 
-    std::string format(iFormat);
+    const int64_t now = mConfig.mAddTimestampToLogEntry ? DateTime::monotonicMillisecondsSinceEpoch() : 0;
 
-    if (mConfig.mLogToStdOut) {
-        if (mConfig.mAddTimestampToLogEntry)
-            printf("%s - ", DateTime::currentDateTime().toString(kTimeFormat).c_str());
-        vprintf(format.c_str(), iArgs);
-        printf("\n");
-    }
+    // format in a buffer local to the calling thread. Entries too long for it
+    // are formatted in a string.
+    //
+    thread_local char tEntryBuffer[kEntryBufferSizeInBytes];
+    va_list args;
+    va_copy(args, iArgs);
+    const int size = vsnprintf(tEntryBuffer, kEntryBufferSizeInBytes, iFormat, args);
+    va_end(args);
+    if (size < 0) return;
 
-    if (mConfig.mLogToFile) {
-        if (mConfig.mAddTimestampToLogEntry)
-            fprintf(mpLogFile, "%s - ", DateTime::currentDateTime().toString(kTimeFormat).c_str());
-        vfprintf(mpLogFile, format.c_str(), iArgs);
-        fprintf(mpLogFile, "\n");
+    const char *entry = tEntryBuffer;
+    string longEntry;
+    if (size >= kEntryBufferSizeInBytes)
+    {
+        longEntry.resize(size + 1);
+        vsnprintf(&longEntry[0], size + 1, iFormat, iArgs);
+        entry = longEntry.c_str();
     }
 
-    rotateLog();
+    if (mConfig.mLogFormat == lfBinary)
+    {
+        std::string &arguments = getBinaryArgumentBuffer();
+        arguments.push_back('s');
+        appendPod(&arguments, (uint32_t)size);
+        arguments.append(entry, size);
+        logBinary(iLogLevel, kPreformattedEntryFormat, 1, arguments);
+    }
+    else if (mConfig.mIsAsynchronous)
+    {
+        postEntry(now, entry, size);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        write(mConfig.mAddTimestampToLogEntry ? getTimestamp(now) : kNoTimestamp, entry, size);
+        rotateLog();
+    }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 void Logger::openLogFile(const std::string& iFilepath)
 {
-    mpLogFile = fopen(iFilepath.c_str(), "w");
+    const bool isBinary = mConfig.mLogFormat == lfBinary;
+    mpLogFile = fopen(iFilepath.c_str(), isBinary ? "wb" : "w");
     mFileInfo.setFile(iFilepath);
-    mFileInfo.setCached(false);
+    mNumberOfBytesWrittenToFile = 0;
     assert(mpLogFile);
+
+    // the formats are written again in each file.
+    mBinaryFormatIds.clear();
+    if (mpLogFile && isBinary)
+    {
+        writeBinary(kBinaryMagic, sizeof(kBinaryMagic));
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Appends the entry to the pending entries, the writer thread is woken up
+// when enough entries are pending.
+//
+void Logger::postEntry(int64_t iMillisecondsSinceEpoch, const char* ipEntry, int iSizeInBytes)
+{
+    EntryHeader header;
+    header.mMillisecondsSinceEpoch = iMillisecondsSinceEpoch;
+    header.mSizeInBytes = iSizeInBytes;
+
+    std::unique_lock<std::mutex> lk(mMutex);
+    const bool wasBelowWakeSize = mPendingEntries.size() < kPendingSizeToWakeWriterInBytes;
+    mPendingEntries.append((const char*)&header, sizeof(header));
+    mPendingEntries.append(ipEntry, iSizeInBytes);
+    const bool mustWakeWriter = wasBelowWakeSize &&
+        mPendingEntries.size() >= kPendingSizeToWakeWriterInBytes;
+    lk.unlock();
+
+    if (mustWakeWriter)
+    { mWriterCondition.notify_one(); }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 void Logger::rotateLog()
 {
-    if (mFileInfo.getSize() >= mConfig.mMaximumSizeInBytes)
+    if (mConfig.mLogFormat == lfBinary) return;
+
+    if (mpLogFile && mNumberOfBytesWrittenToFile >= mConfig.mMaximumSizeInBytes)
     {
         const std::string timestamp = DateTime::currentDateTime().toString();
         std::string newLogFilename = mFileInfo.getCompleteBaseName() + "_" + timestamp + "." + mFileInfo.getSuffix();
@@ -140,10 +644,16 @@ void Logger::rotateLog()
 }
 
 //---------------------------------------------------------------------------------------------------------------------
+// Entries pending with the previous configuration are written before the new
+// configuration is applied.
+//
 void Logger::setConfig(const Config& iConfig)
 {
+    stopWriterThread();
+
     if (mConfig.mLogToFile != iConfig.mLogToFile || 
-        mConfig.mFilepath != iConfig.mFilepath)
+        mConfig.mFilepath != iConfig.mFilepath ||
+        mConfig.mLogFormat != iConfig.mLogFormat)
     {
         if (mpLogFile) {
             closeLogFile();
@@ -156,6 +666,141 @@ void Logger::setConfig(const Config& iConfig)
     {
         openLogFile(mConfig.mFilepath);
     }
+
+    if (mConfig.mIsAsynchronous)
+    {
+        startWriterThread();
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void Logger::startWriterThread()
+{
+    // make sure pending entries are written when the application exits.
+    static bool sIsFlushAtExitRegistered = false;
+    if (!sIsFlushAtExitRegistered)
+    {
+        atexit([]() { Logger::getInstance().flush(); });
+        sIsFlushAtExitRegistered = true;
+    }
+
+    mIsWriterStopping = false;
+    mWriterThread = std::thread(&Logger::writerLoop, this);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes all pending entries and joins the writer thread.
+//
+void Logger::stopWriterThread()
+{
+    if (!mWriterThread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        mIsWriterStopping = true;
+    }
+    mWriterCondition.notify_one();
+    mWriterThread.join();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Writes a single entry to stdout and/or the log file.
+//
+void Logger::write(const std::string& iTimestamp, const char* ipEntry, int iSizeInBytes)
+{
+    if (mConfig.mLogToStdOut) {
+        if (!iTimestamp.empty())
+        {
+            fwrite(iTimestamp.c_str(), 1, iTimestamp.size(), stdout);
+            fwrite(" - ", 1, 3, stdout);
+        }
+        fwrite(ipEntry, 1, iSizeInBytes, stdout);
+        fputc('\n', stdout);
+    }
+
+    if (mConfig.mLogToFile && mpLogFile) {
+        if (!iTimestamp.empty())
+        {
+            fwrite(iTimestamp.c_str(), 1, iTimestamp.size(), mpLogFile);
+            fwrite(" - ", 1, 3, mpLogFile);
+            mNumberOfBytesWrittenToFile += iTimestamp.size() + 3;
+        }
+        fwrite(ipEntry, 1, iSizeInBytes, mpLogFile);
+        fputc('\n', mpLogFile);
+        mNumberOfBytesWrittenToFile += iSizeInBytes + 1;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Binary format: records are written as is, to the file only.
+//
+void Logger::writeBinary(const char* ipData, size_t iSizeInBytes)
+{
+    if (mConfig.mLogToFile && mpLogFile) {
+        fwrite(ipData, 1, iSizeInBytes, mpLogFile);
+        mNumberOfBytesWrittenToFile += iSizeInBytes;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// This is the function executed by the writer thread in asynchronous mode.
+// The pending entries are swapped with an empty buffer under the lock and
+// written without holding it, so that log() is never blocked by the io.
+//
+void Logger::writerLoop()
+{
+    std::unique_lock<std::mutex> lk(mMutex);
+    for (;;)
+    {
+        mWriterCondition.wait_for(lk, std::chrono::milliseconds(kWriteIntervalInMs), [this]()
+            {
+                return mPendingEntries.size() >= kPendingSizeToWakeWriterInBytes ||
+                    mNumberOfFlushRequests > mNumberOfCompletedFlushes ||
+                    mIsWriterStopping;
+            });
+
+        mPendingEntries.swap(mEntriesBeingWritten);
+        const uint64_t flushRequests = mNumberOfFlushRequests;
+        const bool isStopping = mIsWriterStopping;
+        lk.unlock();
+
+        const char *data = mEntriesBeingWritten.data();
+        size_t pos = 0;
+        if (mConfig.mLogFormat == lfBinary)
+        {
+            writeBinary(data, mEntriesBeingWritten.size());
+            pos = mEntriesBeingWritten.size();
+        }
+        while (pos < mEntriesBeingWritten.size())
+        {
+            EntryHeader header;
+            memcpy(&header, data + pos, sizeof(header));
+            pos += sizeof(header);
+
+            write(mConfig.mAddTimestampToLogEntry ? getTimestamp(header.mMillisecondsSinceEpoch) : kNoTimestamp,
+                data + pos, header.mSizeInBytes);
+            pos += header.mSizeInBytes;
+        }
+        mEntriesBeingWritten.clear();
+        rotateLog();
+
+        if (flushRequests > mNumberOfCompletedFlushes || isStopping)
+        {
+            fflush(stdout);
+            if (mpLogFile)
+                fflush(mpLogFile);
+        }
+
+        lk.lock();
+        if (flushRequests > mNumberOfCompletedFlushes)
+        {
+            mNumberOfCompletedFlushes = flushRequests;
+            mFlushedCondition.notify_all();
+        }
+
+        if (isStopping && mPendingEntries.empty())
+        { break; }
+    }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -163,6 +808,8 @@ Logger::Config::Config() :
     mLogToFile(false),
     mLogToStdOut(true),
     mAddTimestampToLogEntry(true),
+    mIsAsynchronous(false),
+    mLogFormat(Logger::lfText),
     mLogLevel(Logger::llNormal),
     mMaximumSizeInBytes(256 * 1024 * 1024),
     mFilepath()
@@ -1,21 +1,44 @@
 #pragma once 
 
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
 #include "Core/DateTime.h"
 #include "Core/FileInfo.h"
+#include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 
+// Mask of the log levels compiled in the program. LOG_TRACE and LOG_TRACE_ERROR
+// of a level outside the mask are removed by the compiler, their arguments are
+// never evaluated. Define it before including this file or on the command line,
+// ex: -DREALISIM_COMPILED_LOG_LEVELS=1 keeps only Logger::llNormal.
+//
+#ifndef REALISIM_COMPILED_LOG_LEVELS
+#define REALISIM_COMPILED_LOG_LEVELS (~0)
+#endif
+
+// The level is tested before anything else, a disabled entry costs a branch:
+// the arguments are not evaluated and nothing is formatted.
+//
 #define LOG_TRACE(iLogLevel, iFormat, ...) \
 do { \
-    Realisim::Core::Logger &_logTraceLogger = Realisim::Core::Logger::getInstance(); \
-    std::string format = std::string("[%s] ") + iFormat; \
-    _logTraceLogger.log(iLogLevel, format.c_str(), __FUNCTION__, ##__VA_ARGS__); \
+    if (((iLogLevel) & (REALISIM_COMPILED_LOG_LEVELS)) != 0) { \
+        Realisim::Core::Logger &_logTraceLogger = Realisim::Core::Logger::getInstance(); \
+        if (_logTraceLogger.isLogLevelEnabled(iLogLevel)) { \
+            _logTraceLogger.logTrace(iLogLevel, "[%s] " iFormat, __FUNCTION__, ##__VA_ARGS__); } \
+    } \
 } while(0);
 
 #define LOG_TRACE_ERROR(iLogLevel, iFormat, ...) \
 do { \
-    Realisim::Core::Logger &_logTraceLogger = Realisim::Core::Logger::getInstance(); \
-    std::string format = std::string("-ERROR- [%s] ") + iFormat; \
-    _logTraceLogger.log(iLogLevel, format.c_str(), __FUNCTION__, ##__VA_ARGS__); \
+    if (((iLogLevel) & (REALISIM_COMPILED_LOG_LEVELS)) != 0) { \
+        Realisim::Core::Logger &_logTraceLogger = Realisim::Core::Logger::getInstance(); \
+        if (_logTraceLogger.isLogLevelEnabled(iLogLevel)) { \
+            _logTraceLogger.logTrace(iLogLevel, "-ERROR- [%s] " iFormat, __FUNCTION__, ##__VA_ARGS__); } \
+    } \
 } while(0);
 
 
@@ -31,6 +54,43 @@ namespace Core
     //      at the begining (first line) of your main.cpp. This will keep the instance of the Logger alive as long as possible,
     //      which might be useful if you try to log stuff while exiting the application.
     //
+    //      LOG_TRACE and LOG_TRACE_ERROR expect a string literal as format.
+    //
+    // Thread safety:
+    //      log() can be called from any thread, entries are never interleaved.
+    //      setConfig() must not be called while other threads are logging.
+    //
+    // Asynchronous mode (Config::mIsAsynchronous):
+    //      The calling thread only formats the entry, in a buffer local to the
+    //      thread, and appends it to a pending buffer. A background thread
+    //      swaps the pending buffer and writes all its entries to stdout and
+    //      the file in one go, outside of any lock. This keeps the latency of
+    //      log() well under a microsecond, at the cost of entries showing up a
+    //      bit later (about 50 ms).
+    //
+    //      flush() blocks until all entries logged so far are written. It is
+    //      invoked automatically when the application exits.
+    //
+    //      The timestamp is taken when log() is called, it is formatted by the
+    //      background thread.
+    //
+    // Timestamps are read from DateTime::monotonicMillisecondsSinceEpoch(),
+    // they never go backward within a run, and are formatted by a
+    // DateTimeFormatter that formats each second once and only rewrites the
+    // milliseconds for consecutive entries.
+    //
+    // Binary format (Config::mLogFormat = lfBinary):
+    //      Entries logged via LOG_TRACE are not formatted at all: the raw
+    //      arguments are written to the file along with an id of the format
+    //      string. Each format string is written once per file. The file is
+    //      turned into a regular text log offline with decodeBinaryLog().
+    //
+    //      In this mode, the entries are only written to the file (never to
+    //      stdout) and the file is not rotated. Strings, integers, floating
+    //      point values and pointers are supported as arguments. The format
+    //      must be a string literal, since it is identified by its address.
+    //      The file is written in the byte order of the machine.
+    //
     class Logger
     {
     public:
@@ -43,38 +103,155 @@ namespace Core
             llVerbose = 1 << 1, 
             llUserDefined };
 
+        enum LogFormat{lfText, lfBinary};
+
         struct Config {
             Config();
 
             bool mLogToFile;
             bool mLogToStdOut;
             bool mAddTimestampToLogEntry;
+            bool mIsAsynchronous;
+            LogFormat mLogFormat;
             int mLogLevel;
             int mMaximumSizeInBytes; // a new files is created when max is reached.
             std::string mFilepath;
         };
 
+        static bool decodeBinaryLog(const std::string& iBinaryFilepath, const std::string& iTextFilepath);
         void flush();
         const Config& getConfig() const { return mConfig; }
+        bool isLogLevelEnabled(int iLogLevel) const { return (iLogLevel & mConfig.mLogLevel) != 0; }
         void log(const char* format, ...);
         void log(int iLogLevel, const char* format, ...);
+        template<typename... Args>
+        void logTrace(int iLogLevel, const char* iFormat, Args... iArgs);
         
         void setConfig(const Config& iConfig);
 
     protected:
         Logger();
 
+        static void appendBinaryArgument(std::string* opArguments, char* iValue);
+        static void appendBinaryArgument(std::string* opArguments, const char* iValue);
+        static void appendBinaryArgument(std::string* opArguments, const std::string& iValue);
+        template<typename T>
+        static void appendBinaryArgument(std::string* opArguments, T iValue);
+        template<typename T>
+        static void appendBinaryNumber(std::string* opArguments, T iValue, std::integral_constant<int, 0>);
+        template<typename T>
+        static void appendBinaryNumber(std::string* opArguments, T iValue, std::integral_constant<int, 1>);
+        template<typename T>
+        static void appendBinaryNumber(std::string* opArguments, T iValue, std::integral_constant<int, 2>);
+        template<typename T>
+        static void appendBinaryNumber(std::string* opArguments, T iValue, std::integral_constant<int, 3>);
+        static void appendBinaryDouble(std::string* opArguments, double iValue);
+        static void appendBinaryInteger(std::string* opArguments, int64_t iValue);
+        static void appendBinaryPointer(std::string* opArguments, const void* iValue);
+        static void appendBinaryUnsignedInteger(std::string* opArguments, uint64_t iValue);
         void closeLogFile();
+        static std::string& getBinaryArgumentBuffer();
+        const std::string& getTimestamp(int64_t iMillisecondsSinceEpoch);
+        void logBinary(int iLogLevel, const char* iFormat, int iNumberOfArguments, const std::string& iArguments);
         void logInternal(int iLogLevel, const char* format, va_list iArgs);
         void openLogFile(const std::string& iFilepath);
+        void postEntry(int64_t iMillisecondsSinceEpoch, const char* ipEntry, int iSizeInBytes);
         void rotateLog();
+        void startWriterThread();
+        void stopWriterThread();
+        void write(const std::string& iTimestamp, const char* ipEntry, int iSizeInBytes);
+        void writeBinary(const char* ipData, size_t iSizeInBytes);
+        void writerLoop();
 
         static Logger* mpInstance; //Singleton instance.
 
         Config mConfig;
         FILE* mpLogFile;
         Core::FileInfo mFileInfo;
+        int64_t mNumberOfBytesWrittenToFile;
+
+        // formats the timestamps, see getTimestamp().
+        Core::DateTimeFormatter mTimestampFormatter;
+
+        // Synchronous mode: serializes the writes.
+        // Asynchronous mode: protects the pending buffer and the writer state.
+        std::mutex mMutex;
+
+        // asynchronous mode
+        std::thread mWriterThread;
+        std::condition_variable mWriterCondition;
+        std::condition_variable mFlushedCondition;
+        std::string mPendingEntries;
+        std::string mEntriesBeingWritten;
+        uint64_t mNumberOfFlushRequests;
+        uint64_t mNumberOfCompletedFlushes;
+        bool mIsWriterStopping;
+
+        // binary format: id of the format strings already written to the
+        // file, and the record being built in synchronous mode.
+        std::unordered_map<const char*, uint32_t> mBinaryFormatIds;
+        std::string mBinaryRecord;
     };
 
+    //-----------------------------------------------------------------------------------------------------------------
+    // The singleton is tested inline, LOG_TRACE calls this for every entry.
+    //
+    inline Logger& Logger::getInstance()
+    {
+        if (mpInstance == nullptr) {
+            mpInstance = new Logger();
+        }
+        return *mpInstance;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    // In text format, this is log(). In binary format, the arguments are
+    // copied as is, nothing is formatted.
+    //
+    template<typename... Args>
+    void Logger::logTrace(int iLogLevel, const char* iFormat, Args... iArgs)
+    {
+        if (mConfig.mLogFormat == lfBinary)
+        {
+            std::string &arguments = getBinaryArgumentBuffer();
+            int expand[] = { 0, (appendBinaryArgument(&arguments, iArgs), 0)... };
+            (void)expand;
+            logBinary(iLogLevel, iFormat, (int)sizeof...(Args), arguments);
+        }
+        else
+        {
+            log(iLogLevel, iFormat, iArgs...);
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    template<typename T>
+    void Logger::appendBinaryArgument(std::string* opArguments, T iValue)
+    {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+            "Unsupported argument type for the binary log format.");
+        appendBinaryNumber(opArguments, iValue, std::integral_constant<int,
+            std::is_floating_point<T>::value ? 0 :
+            std::is_pointer<T>::value ? 1 :
+            std::is_unsigned<T>::value ? 2 : 3>());
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------
+    template<typename T>
+    void Logger::appendBinaryNumber(std::string* opArguments, T iValue, std::integral_constant<int, 0>)
+    { appendBinaryDouble(opArguments, (double)iValue); }
+
+    template<typename T>
+    void Logger::appendBinaryNumber(std::string* opArguments, T iValue, std::integral_constant<int, 1>)
+    { appendBinaryPointer(opArguments, (const void*)iValue); }
+
+    template<typename T>
+    void Logger::appendBinaryNumber(std::string* opArguments, T iValue, std::integral_constant<int, 2>)
+    { appendBinaryUnsignedInteger(opArguments, (uint64_t)iValue); }
+
+    template<typename T>
+    void Logger::appendBinaryNumber(std::string* opArguments, T iValue, std::integral_constant<int, 3>)
+    { appendBinaryInteger(opArguments, (int64_t)iValue); }
+
 }
 }
\ No newline at end of file
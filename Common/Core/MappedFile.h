@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // Maps a whole file in memory, read only. Pages are loaded by the system
+    // when they are first touched, so reading only a header or a few samples
+    // of a large file does not read the rest of it.
+    //
+    // The file must not be truncated or rewritten while it is mapped.
+    //
+    // See ByteArray::fromMappedFile() to share the mapping between ByteArrays.
+    //
+    // The implementation is platform specific, see mac/MappedFile.cpp and
+    // windows/MappedFile.cpp.
+    //
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        void close();
+        const char* getData() const { return mpData; }
+        uint64_t getSize() const { return mSize; }
+        bool isOpen() const { return mpData != nullptr; }
+        bool open(const std::string& iFilenamePath);
+
+    private:
+        const char* mpData;
+        uint64_t mSize;
+    };
+}
+}
@@ -0,0 +1,389 @@
+
+#include <atomic>
+#include <cassert>
+#include "Core/MemoryPool.h"
+#include <mutex>
+#include <new>
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    const size_t kGranularity = 16;
+    const int kNumberOfSizeClasses = 32; // blocks up to 512 bytes
+    const int kBatchSize = 32;
+    const int kMaximumNumberOfCachedBlocks = 4 * kBatchSize;
+    const size_t kSlabSizeInBytes = 64 * 1024;
+
+    struct FreeBlock
+    {
+        FreeBlock *mpNext;
+    };
+
+    // Counters are only written by the thread owning them, they are atomic
+    // so getStatistics() can read them from any thread.
+    //
+    struct Counters
+    {
+        Counters() : mNumberOfAllocations(0), mNumberOfDeallocations(0),
+            mNumberOfPoolHits(0), mNumberOfBatchTransfers(0) {}
+
+        std::atomic<uint64_t> mNumberOfAllocations;
+        std::atomic<uint64_t> mNumberOfDeallocations;
+        std::atomic<uint64_t> mNumberOfPoolHits;
+        std::atomic<uint64_t> mNumberOfBatchTransfers;
+    };
+
+    void increment(std::atomic<uint64_t>& iCounter)
+    {
+        iCounter.store(iCounter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    //-------------------------------------------------------------------------
+    struct CentralPool
+    {
+        CentralPool() : mpFreeList(nullptr), mSlabs() {}
+
+        std::mutex mMutex;
+        FreeBlock *mpFreeList;
+        std::vector<void*> mSlabs;
+    };
+
+    struct ThreadCache;
+
+    //-------------------------------------------------------------------------
+    // Never deleted, so that messages deleted during static destruction can
+    // still be returned to the pool.
+    //
+    struct Globals
+    {
+        Globals() : mNumberOfHeapAllocations(0) {}
+
+        CentralPool mCentralPools[kNumberOfSizeClasses];
+
+        std::mutex mRegistryMutex;
+        std::vector<ThreadCache*> mThreadCaches;
+        Counters mExitedThreadsCounters[kNumberOfSizeClasses];
+        std::atomic<uint64_t> mNumberOfHeapAllocations;
+    };
+
+    Globals& getGlobals()
+    {
+        static Globals *spGlobals = new Globals();
+        return *spGlobals;
+    }
+
+    //-------------------------------------------------------------------------
+    size_t getBlockSize(int iSizeClass)
+    {
+        return (iSizeClass + 1) * kGranularity;
+    }
+
+    //-------------------------------------------------------------------------
+    // Takes up to iMaxNumberOfBlocks from the central pool. New slabs are
+    // carved when the central pool is empty. Returns the number of blocks
+    // taken, which are chained from *opHead.
+    //
+    int takeFromCentral(int iSizeClass, int iMaxNumberOfBlocks, FreeBlock **opHead)
+    {
+        CentralPool &cp = getGlobals().mCentralPools[iSizeClass];
+        std::lock_guard<std::mutex> lk(cp.mMutex);
+
+        if (cp.mpFreeList == nullptr)
+        {
+            const size_t blockSize = getBlockSize(iSizeClass);
+            const size_t numBlocks = kSlabSizeInBytes / blockSize;
+            char *slab = static_cast<char*>(::operator new(numBlocks * blockSize));
+            cp.mSlabs.push_back(slab);
+
+            for (size_t i = 0; i < numBlocks; ++i)
+            {
+                FreeBlock *b = reinterpret_cast<FreeBlock*>(slab + i * blockSize);
+                b->mpNext = cp.mpFreeList;
+                cp.mpFreeList = b;
+            }
+        }
+
+        int n = 0;
+        FreeBlock *head = cp.mpFreeList;
+        FreeBlock *tail = nullptr;
+        FreeBlock *b = head;
+        while (b != nullptr && n < iMaxNumberOfBlocks)
+        {
+            tail = b;
+            b = b->mpNext;
+            ++n;
+        }
+        tail->mpNext = nullptr;
+        cp.mpFreeList = b;
+
+        *opHead = head;
+        return n;
+    }
+
+    //-------------------------------------------------------------------------
+    // Gives the chain ipHead..ipTail back to the central pool.
+    //
+    void giveToCentral(int iSizeClass, FreeBlock *ipHead, FreeBlock *ipTail)
+    {
+        CentralPool &cp = getGlobals().mCentralPools[iSizeClass];
+        std::lock_guard<std::mutex> lk(cp.mMutex);
+        ipTail->mpNext = cp.mpFreeList;
+        cp.mpFreeList = ipHead;
+    }
+
+    //-------------------------------------------------------------------------
+    struct ThreadCache
+    {
+        ThreadCache();
+        ~ThreadCache();
+
+        FreeBlock *mpFreeLists[kNumberOfSizeClasses];
+        int mNumberOfBlocks[kNumberOfSizeClasses];
+        Counters mCounters[kNumberOfSizeClasses];
+    };
+
+    // tpThreadCache is trivially destructible, so it can safely be checked
+    // while the thread is exiting. Once the cache is destroyed, the thread
+    // uses the central pools directly.
+    thread_local ThreadCache *tpThreadCache = nullptr;
+    thread_local bool tThreadCacheDestroyed = false;
+
+    //-------------------------------------------------------------------------
+    ThreadCache::ThreadCache()
+    {
+        for (int i = 0; i < kNumberOfSizeClasses; ++i)
+        {
+            mpFreeLists[i] = nullptr;
+            mNumberOfBlocks[i] = 0;
+        }
+
+        Globals &g = getGlobals();
+        std::lock_guard<std::mutex> lk(g.mRegistryMutex);
+        g.mThreadCaches.push_back(this);
+    }
+
+    //-------------------------------------------------------------------------
+    // returns all blocks to the central pools and keeps the counters of the
+    // thread for the statistics.
+    //
+    ThreadCache::~ThreadCache()
+    {
+        Globals &g = getGlobals();
+        for (int i = 0; i < kNumberOfSizeClasses; ++i)
+        {
+            if (mpFreeLists[i] != nullptr)
+            {
+                FreeBlock *tail = mpFreeLists[i];
+                while (tail->mpNext != nullptr)
+                { tail = tail->mpNext; }
+                giveToCentral(i, mpFreeLists[i], tail);
+            }
+        }
+
+        std::lock_guard<std::mutex> lk(g.mRegistryMutex);
+        for (int i = 0; i < kNumberOfSizeClasses; ++i)
+        {
+            Counters &dst = g.mExitedThreadsCounters[i];
+            const Counters &src = mCounters[i];
+            dst.mNumberOfAllocations += src.mNumberOfAllocations.load();
+            dst.mNumberOfDeallocations += src.mNumberOfDeallocations.load();
+            dst.mNumberOfPoolHits += src.mNumberOfPoolHits.load();
+            dst.mNumberOfBatchTransfers += src.mNumberOfBatchTransfers.load();
+        }
+
+        for (size_t i = 0; i < g.mThreadCaches.size(); ++i)
+        {
+            if (g.mThreadCaches[i] == this)
+            {
+                g.mThreadCaches.erase(g.mThreadCaches.begin() + i);
+                break;
+            }
+        }
+
+        tpThreadCache = nullptr;
+        tThreadCacheDestroyed = true;
+    }
+
+    //-------------------------------------------------------------------------
+    ThreadCache* getThreadCache()
+    {
+        if (tpThreadCache == nullptr && !tThreadCacheDestroyed)
+        {
+            thread_local ThreadCache sThreadCache;
+            tpThreadCache = &sThreadCache;
+        }
+        return tpThreadCache;
+    }
+}
+
+//------------------------------------------------------------------------------
+void* MemoryPool::allocate(size_t iSizeInBytes)
+{
+    const int sizeClass = toSizeClass(iSizeInBytes);
+    if (sizeClass < 0)
+    {
+        increment(getGlobals().mNumberOfHeapAllocations);
+        return ::operator new(iSizeInBytes);
+    }
+
+    ThreadCache *tc = getThreadCache();
+    if (tc == nullptr)
+    {
+        // the thread is exiting, its cache is gone.
+        FreeBlock *b = nullptr;
+        takeFromCentral(sizeClass, 1, &b);
+        return b;
+    }
+
+    increment(tc->mCounters[sizeClass].mNumberOfAllocations);
+    if (tc->mpFreeLists[sizeClass] != nullptr)
+    {
+        increment(tc->mCounters[sizeClass].mNumberOfPoolHits);
+    }
+    else
+    {
+        increment(tc->mCounters[sizeClass].mNumberOfBatchTransfers);
+        tc->mNumberOfBlocks[sizeClass] = takeFromCentral(sizeClass, kBatchSize, &tc->mpFreeLists[sizeClass]);
+    }
+
+    FreeBlock *b = tc->mpFreeLists[sizeClass];
+    tc->mpFreeLists[sizeClass] = b->mpNext;
+    tc->mNumberOfBlocks[sizeClass]--;
+    return b;
+}
+
+//------------------------------------------------------------------------------
+void MemoryPool::deallocate(void* ipBlock, size_t iSizeInBytes)
+{
+    if (ipBlock == nullptr) return;
+
+    const int sizeClass = toSizeClass(iSizeInBytes);
+    if (sizeClass < 0)
+    {
+        ::operator delete(ipBlock);
+        return;
+    }
+
+    FreeBlock *b = static_cast<FreeBlock*>(ipBlock);
+    ThreadCache *tc = getThreadCache();
+    if (tc == nullptr)
+    {
+        // the thread is exiting, its cache is gone.
+        giveToCentral(sizeClass, b, b);
+        return;
+    }
+
+    increment(tc->mCounters[sizeClass].mNumberOfDeallocations);
+    b->mpNext = tc->mpFreeLists[sizeClass];
+    tc->mpFreeLists[sizeClass] = b;
+    tc->mNumberOfBlocks[sizeClass]++;
+
+    // too many blocks in the cache, typically because this thread frees what
+    // other threads allocate. Give a batch back to the central pool.
+    //
+    if (tc->mNumberOfBlocks[sizeClass] > kMaximumNumberOfCachedBlocks)
+    {
+        FreeBlock *head = tc->mpFreeLists[sizeClass];
+        FreeBlock *tail = head;
+        for (int i = 1; i < kBatchSize; ++i)
+        { tail = tail->mpNext; }
+
+        tc->mpFreeLists[sizeClass] = tail->mpNext;
+        tc->mNumberOfBlocks[sizeClass] -= kBatchSize;
+        increment(tc->mCounters[sizeClass].mNumberOfBatchTransfers);
+        giveToCentral(sizeClass, head, tail);
+    }
+}
+
+//------------------------------------------------------------------------------
+size_t MemoryPool::getMaximumBlockSize()
+{
+    return getBlockSize(kNumberOfSizeClasses - 1);
+}
+
+//------------------------------------------------------------------------------
+int MemoryPool::getNumberOfSizeClasses()
+{
+    return kNumberOfSizeClasses;
+}
+
+//------------------------------------------------------------------------------
+// Returns the statistics of all size classes added together. mBlockSize is
+// meaningless in that case and is set to 0.
+//
+MemoryPool::Statistics MemoryPool::getStatistics()
+{
+    Statistics r;
+    for (int i = 0; i < kNumberOfSizeClasses; ++i)
+    {
+        const Statistics s = getStatistics(i);
+        r.mNumberOfAllocations += s.mNumberOfAllocations;
+        r.mNumberOfDeallocations += s.mNumberOfDeallocations;
+        r.mNumberOfPoolHits += s.mNumberOfPoolHits;
+        r.mNumberOfBatchTransfers += s.mNumberOfBatchTransfers;
+        r.mNumberOfSlabs += s.mNumberOfSlabs;
+    }
+    r.mNumberOfHeapAllocations = getGlobals().mNumberOfHeapAllocations.load();
+    return r;
+}
+
+//------------------------------------------------------------------------------
+MemoryPool::Statistics MemoryPool::getStatistics(int iSizeClass)
+{
+    Statistics r;
+    if (iSizeClass < 0 || iSizeClass >= kNumberOfSizeClasses)
+    { return r; }
+
+    Globals &g = getGlobals();
+    r.mBlockSize = getBlockSize(iSizeClass);
+    {
+        std::lock_guard<std::mutex> lk(g.mRegistryMutex);
+
+        vector<const Counters*> allCounters;
+        allCounters.push_back(&g.mExitedThreadsCounters[iSizeClass]);
+        for (auto tc : g.mThreadCaches)
+        {
+            allCounters.push_back(&tc->mCounters[iSizeClass]);
+        }
+
+        for (auto c : allCounters)
+        {
+            r.mNumberOfAllocations += c->mNumberOfAllocations.load(std::memory_order_relaxed);
+            r.mNumberOfDeallocations += c->mNumberOfDeallocations.load(std::memory_order_relaxed);
+            r.mNumberOfPoolHits += c->mNumberOfPoolHits.load(std::memory_order_relaxed);
+            r.mNumberOfBatchTransfers += c->mNumberOfBatchTransfers.load(std::memory_order_relaxed);
+        }
+    }
+
+    CentralPool &cp = g.mCentralPools[iSizeClass];
+    std::lock_guard<std::mutex> lk(cp.mMutex);
+    r.mNumberOfSlabs = cp.mSlabs.size();
+    return r;
+}
+
+//------------------------------------------------------------------------------
+// Returns the size class for iSizeInBytes or -1 if it is too large for
+// the pool.
+//
+int MemoryPool::toSizeClass(size_t iSizeInBytes)
+{
+    const size_t sizeClass = iSizeInBytes == 0 ? 0 : (iSizeInBytes - 1) / kGranularity;
+    return sizeClass < (size_t)kNumberOfSizeClasses ? (int)sizeClass : -1;
+}
+
+//------------------------------------------------------------------------------
+//--- MemoryPool::Statistics
+//------------------------------------------------------------------------------
+MemoryPool::Statistics::Statistics() :
+    mBlockSize(0),
+    mNumberOfAllocations(0),
+    mNumberOfDeallocations(0),
+    mNumberOfPoolHits(0),
+    mNumberOfBatchTransfers(0),
+    mNumberOfSlabs(0),
+    mNumberOfHeapAllocations(0)
+{}
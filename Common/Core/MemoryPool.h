@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // This class is a fixed size memory pool meant for small objects that are
+    // allocated by one thread and freed by another, at a high rate. The typical
+    // use case is MessageQueue::Message, which uses it via its operator new
+    // and delete.
+    //
+    // Blocks are grouped by size class (multiple of 16 bytes, up to
+    // getMaximumBlockSize()). All objects of the same size, thus all instances
+    // of a given Message subclass, share the same pool. Larger requests go
+    // straight to the global heap.
+    //
+    // Each size class has:
+    //      - A central free list protected by a mutex. It gets new blocks by
+    //        carving slabs allocated on the heap. Slabs are never returned to
+    //        the heap.
+    //      - A free list per thread (thread cache). Allocations and
+    //        deallocations only touch the cache of the calling thread, without
+    //        any lock. Blocks move between the thread caches and the central
+    //        list in batches: when a cache is empty it takes a batch from the
+    //        central list, when it holds too many blocks it gives a batch back.
+    //
+    // A message allocated by the main thread and deleted by a worker thus ends
+    // up in the cache of the worker, and flows back to the main thread through
+    // the central list, one batch at a time.
+    //
+    // Statistics are kept per size class, see getStatistics().
+    //
+    class MemoryPool
+    {
+    public:
+        MemoryPool() = delete;
+
+        struct Statistics
+        {
+            Statistics();
+
+            size_t mBlockSize;
+            uint64_t mNumberOfAllocations;
+            uint64_t mNumberOfDeallocations;
+            uint64_t mNumberOfPoolHits; // served by the thread cache, without lock
+            uint64_t mNumberOfBatchTransfers; // between thread caches and central list
+            uint64_t mNumberOfSlabs;
+            uint64_t mNumberOfHeapAllocations; // too large for the pool
+        };
+
+        static void* allocate(size_t iSizeInBytes);
+        static void deallocate(void* ipBlock, size_t iSizeInBytes);
+        static size_t getMaximumBlockSize();
+        static int getNumberOfSizeClasses();
+        static Statistics getStatistics();
+        static Statistics getStatistics(int iSizeClass);
+        static int toSizeClass(size_t iSizeInBytes);
+    };
+}
+}
@@ -1,7 +1,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include "MemoryPool.h"
 #include "MessageQueue.h"
+#include "ThreadPool.h"
 
 using namespace Realisim;
     using namespace Core;
@@ -9,11 +11,26 @@ using namespace std;
 
 //------------------------------------------------------------------------------
 MessageQueue::MessageQueue() :
+MessageQueue(stDeque)
+{}
+
+//------------------------------------------------------------------------------
+MessageQueue::MessageQueue(StorageType iStorageType, int iRingBufferCapacity) :
 mThreads(),
 mQueue(),
+mStorageType(iStorageType),
+mpRingBuffer(),
+mNumberOfWaitingThreads(0),
+mpThreadPool(nullptr),
+mNumberOfThreadPoolTasks(0),
+mThreadPoolTasksDoneCondition(),
 mMutex(),
 mState(sIdle),
 mMaximumSize(-1),
+mMaximumBatchSize(1),
+mEpoch(0),
+mNextPostIndex(0),
+mNumberOfDroppedMessages(0),
 mBehavior(bFifo),
 mIsIdenticalContiguousMessageAllowed(true)
 
@@ -21,6 +38,11 @@ mIsIdenticalContiguousMessageAllowed(true)
     using std::placeholders::_1;
     mOneByOneProcessingFunction = std::bind(&MessageQueue::dummyOneByOneProcessingFunction, this, _1);
 
+    if (mStorageType == stLockFreeRingBuffer)
+    {
+        mpRingBuffer.reset(new LockFreeRingBuffer<Message*>(iRingBufferCapacity));
+    }
+
     // by default, on thread available, thread is not started...
     mThreads.resize(1);
 }
@@ -35,13 +57,19 @@ MessageQueue::~MessageQueue()
     //
     clear();
     stopThread();
-    assert(mQueue.empty());
+    assert(isEmpty());
 }
 
 
 //------------------------------------------------------------------------------
 void MessageQueue::allowIdenticalContiguousMessage(bool iA)
 {
+    // the lock free ring cannot peek at the last message posted.
+    assert((iA || getStorageType() != stLockFreeRingBuffer) &&
+        "Identical contiguous messages are always allowed with stLockFreeRingBuffer");
+    if (getStorageType() == stLockFreeRingBuffer)
+    { return; }
+
     mIsIdenticalContiguousMessageAllowed = iA;
 }
 
@@ -50,6 +78,16 @@ void MessageQueue::allowIdenticalContiguousMessage(bool iA)
 // 
 void MessageQueue::clear()
 {
+    if (getStorageType() == stLockFreeRingBuffer)
+    {
+        Message *m = nullptr;
+        while (mpRingBuffer->tryPop(&m))
+        {
+            delete m;
+        }
+        return;
+    }
+
     mMutex.lock();
 
     //delete all message in queue
@@ -72,17 +110,47 @@ void MessageQueue::dummyOneByOneProcessingFunction(Message* iM)
     printf("dummy processing function\n");
 }
 
+//------------------------------------------------------------------------------
+// Returns the number of messages a consumer thread takes from the queue at
+// once. The messages are shared evenly among the consumer threads, up to the
+// maximum batch size, so that a single thread does not take all the work.
+//
+int MessageQueue::getBatchSize() const
+{
+    const int n = getNumberOfThreads();
+    const int evenShare = (getNumberOfMessages() + n - 1) / n;
+    return std::max(std::min(evenShare, getMaximumBatchSize()), 1);
+}
+
 //------------------------------------------------------------------------------
 MessageQueue::Behavior MessageQueue::getBehavior() const
 { return mBehavior; }
 
+//------------------------------------------------------------------------------
+int MessageQueue::getEpoch() const
+{ return mEpoch.load(); }
+
+//------------------------------------------------------------------------------
+int MessageQueue::getMaximumBatchSize() const
+{ return mMaximumBatchSize; }
+
 //------------------------------------------------------------------------------
 int MessageQueue::getMaximumSize() const
 { return mMaximumSize; }
 
+//------------------------------------------------------------------------------
+// Returns the number of messages dropped because the queue was full, see
+// setMaximumSize().
+//
+uint64_t MessageQueue::getNumberOfDroppedMessages() const
+{ return mNumberOfDroppedMessages.load(); }
+
 //------------------------------------------------------------------------------
 int MessageQueue::getNumberOfMessages() const
 {
+    if (getStorageType() == stLockFreeRingBuffer)
+    { return mpRingBuffer->getApproximateSize(); }
+
     int r = 0;
     mMutex.lock();
     r = (int)mQueue.size();
@@ -102,13 +170,49 @@ MessageQueue::state MessageQueue::getState() const
     return mState;
 }
 
+//------------------------------------------------------------------------------
+MessageQueue::StorageType MessageQueue::getStorageType() const
+{
+    return mStorageType;
+}
+
+//------------------------------------------------------------------------------
+ThreadPool* MessageQueue::getThreadPool() const
+{
+    return mpThreadPool;
+}
+
 //------------------------------------------------------------------------------
 bool MessageQueue::hasLimitedSize() const
 { return getMaximumSize() != -1; }
 
+//------------------------------------------------------------------------------
+// Comparison used to order the heap of the bPriority behavior. The message on
+// top of the heap is the one with the highest priority that was posted first.
+//
+bool MessageQueue::hasLowerPriority(const Message* iA, const Message* iB)
+{
+    if (iA->mPriority != iB->mPriority)
+    { return iA->mPriority < iB->mPriority; }
+    return iA->mPostIndex > iB->mPostIndex;
+}
+
+//------------------------------------------------------------------------------
+// Makes all messages posted with an older epoch stale, they will be discarded
+// instead of processed. Returns the new epoch, which must be assigned to the
+// messages posted from now on.
+//
+int MessageQueue::incrementEpoch()
+{
+    return mEpoch.fetch_add(1) + 1;
+}
+
 //------------------------------------------------------------------------------
 bool MessageQueue::isEmpty() const
 {
+    if (getStorageType() == stLockFreeRingBuffer)
+    { return mpRingBuffer->isEmpty(); }
+
     bool r = true;
     mMutex.lock();
     r = mQueue.empty();
@@ -116,6 +220,12 @@ bool MessageQueue::isEmpty() const
     return r;
 }
 
+//------------------------------------------------------------------------------
+bool MessageQueue::isStale(const Message* iM) const
+{
+    return iM->mEpoch < getEpoch();
+}
+
 //------------------------------------------------------------------------------
 bool MessageQueue::isIdenticalContiguousMessageAllowed() const
 {
@@ -128,33 +238,19 @@ void MessageQueue::post( Message* iM )
     // the queue will not accept messages when a request to stop
     // has been issued. Else it would never terminate when stopThread() is called...
     //
-    if(getState() != sStopping)
+    if(getState() != sStopping && getStorageType() == stLockFreeRingBuffer)
+    {
+        pushToRingBuffer(iM);
+        wakeWaitingThreads(1);
+        scheduleOnThreadPool(1);
+    }
+    else if(getState() != sStopping)
     {
         mMutex.lock();
-
-        // When the queue has a limited size and that size has been reached, it
-        // drops the oldest message.
-        // the oldest message in both behavior is at the front of the queue,
-        // since we always push backed...
-        //
-        if (hasLimitedSize() && mQueue.size() == getMaximumSize())
-        {
-            Message *m = nullptr;
-            m = mQueue.front();
-            mQueue.pop_front();
-            delete m;
-        }
-
-        //before inserting the message, let's verify if we enabled contiguous identical message
-        if (isIdenticalContiguousMessageAllowed() || 
-            mQueue.size() == 0 ||
-            *(mQueue.front()) != *iM)
-        {
-            mQueue.push_back(iM);
-        }
-
+        pushToDeque(iM);
         mMutex.unlock();
         mQueueWaitCondition.notify_one();
+        scheduleOnThreadPool(1);
     }
     else
     {
@@ -167,103 +263,297 @@ void MessageQueue::post( Message* iM )
 }
 
 //------------------------------------------------------------------------------
-// This method will invoke the OneByOne callback on all messages contained in the
-// queue.
-// See method processMessagesAllAtOnce for a more performant version, which requires
-// a different callback
+// Posts all messages of iMessages, in order, with a single lock of the queue
+// and a single notification of the consumer threads. This is the same as
+// calling post() for each message, minus the locking overhead.
 //
-void MessageQueue::processMessages()
+void MessageQueue::postBatch(const std::vector<Message*>& iMessages)
 {
-    while( getNumberOfMessages() > 0 )
+    const int n = (int)iMessages.size();
+    if (n == 0) return;
+
+    if (getState() != sStopping && getStorageType() == stLockFreeRingBuffer)
     {
-        processNextMessage();
+        for (int i = 0; i < n; ++i)
+        { pushToRingBuffer(iMessages[i]); }
+        wakeWaitingThreads(n);
+        scheduleOnThreadPool(n);
+    }
+    else if (getState() != sStopping)
+    {
+        mMutex.lock();
+        for (int i = 0; i < n; ++i)
+        { pushToDeque(iMessages[i]); }
+        mMutex.unlock();
+
+        if (n > 1)
+        { mQueueWaitCondition.notify_all(); }
+        else
+        { mQueueWaitCondition.notify_one(); }
+        scheduleOnThreadPool(n);
+    }
+    else
+    {
+        // while stopping message are not accepted
+        // delete right away
+        //
+        for (int i = 0; i < n; ++i)
+        { delete iMessages[i]; }
     }
 }
 
 //------------------------------------------------------------------------------
-void MessageQueue::processMessagesAllAtOnce()
+// Pops the next message according to the behavior. Stale messages are deleted
+// along the way. Returns nullptr when there is no message left.
+//
+// With stDeque, the mutex must be held by the caller.
+//
+MessageQueue::Message* MessageQueue::popMessage()
 {
-    static std::vector<Message*> allMessages;
-    
-    // pop first message and process it!
-    mMutex.lock();
-    const int numMessages = getNumberOfMessages();
-    allMessages.resize(numMessages);
-    if (mQueue.size() > 0)
+    Message *m = nullptr;
+    for (;;)
     {
-        int index = 0;
-        Message *m = nullptr;
-        switch (getBehavior())
+        if (getStorageType() == stLockFreeRingBuffer)
         {
-        case bFifo:
-            m = mQueue.front();
-            while (m) // beware of calling front on an empty container... it is undefined
+            if (!mpRingBuffer->tryPop(&m))
+            { return nullptr; }
+        }
+        else
+        {
+            if (mQueue.empty())
+            { return nullptr; }
+
+            switch (getBehavior())
             {
-                allMessages[index] = m;
+            case bFifo:
+                m = mQueue.front();
                 mQueue.pop_front();
-                index++;
-                m = (index < numMessages) ? mQueue.front() : nullptr;
-            }
-            break;
-        case bLifo:
-            m = mQueue.back();
-            index++;
-            while (m) // beware of calling front on an empty container... it is undefined
-            {
-                allMessages[index] = m;
+                break;
+            case bLifo:
+                m = mQueue.back();
+                mQueue.pop_back();
+                break;
+            case bPriority:
+                std::pop_heap(mQueue.begin(), mQueue.end(), &MessageQueue::hasLowerPriority);
+                m = mQueue.back();
                 mQueue.pop_back();
-                index++;
-                m = (index < numMessages) ? mQueue.back() : nullptr;
+                break;
+            default: assert(0); break;
             }
-            break;
-        default: assert(0); break;
         }
-        mMutex.unlock();
 
-        mAllAtOnceProcessingFunction(allMessages);
+        if (!isStale(m))
+        { return m; }
+        delete m;
+    }
+}
 
-        //delete all
-        
-        for (int i = 0; i < numMessages; ++i)
+//------------------------------------------------------------------------------
+// Pops up to iMaxNumberOfMessages messages, in the order defined by the
+// behavior, and appends them to opMessages. The queue is locked only once.
+// Returns the number of messages popped.
+//
+int MessageQueue::popMessages(int iMaxNumberOfMessages, std::vector<Message*>* opMessages)
+{
+    int n = 0;
+    Message *m = nullptr;
+    const bool needsLock = getStorageType() == stDeque;
+    if (needsLock)
+    { mMutex.lock(); }
+
+    while (n < iMaxNumberOfMessages && (m = popMessage()) != nullptr)
+    {
+        opMessages->push_back(m);
+        ++n;
+    }
+
+    if (needsLock)
+    { mMutex.unlock(); }
+    return n;
+}
+
+//------------------------------------------------------------------------------
+// Inserts the message in the deque. The mutex must be held by the caller.
+//
+void MessageQueue::pushToDeque(Message* iM)
+{
+    iM->mPostIndex = mNextPostIndex++;
+
+    // When the queue has a limited size and that size has been reached, it
+    // drops the oldest message.
+    // the oldest message in both fifo and lifo behavior is at the front of
+    // the queue, since we always push backed...
+    // With bPriority, the message that would be processed last is dropped,
+    // which is the posted one when its priority is lower than or equal to
+    // all others, since it was posted last.
+    //
+    if (hasLimitedSize() && mQueue.size() == getMaximumSize())
+    {
+        Message *m = nullptr;
+        if (getBehavior() == bPriority)
+        {
+            auto it = std::min_element(mQueue.begin(), mQueue.end(), &MessageQueue::hasLowerPriority);
+            if (iM->mPriority <= (*it)->mPriority)
+            {
+                mNumberOfDroppedMessages.fetch_add(1);
+                delete iM;
+                return;
+            }
+            m = *it;
+            mQueue.erase(it);
+            std::make_heap(mQueue.begin(), mQueue.end(), &MessageQueue::hasLowerPriority);
+        }
+        else
         {
-            delete allMessages[i];
+            m = mQueue.front();
+            mQueue.pop_front();
         }
+        mNumberOfDroppedMessages.fetch_add(1);
+        delete m;
+    }
+
+    //before inserting the message, let's verify if we enabled contiguous identical message
+    if (isIdenticalContiguousMessageAllowed() || 
+        mQueue.size() == 0 ||
+        *(mQueue.front()) != *iM)
+    {
+        mQueue.push_back(iM);
+        if (getBehavior() == bPriority)
+        { std::push_heap(mQueue.begin(), mQueue.end(), &MessageQueue::hasLowerPriority); }
     }
     else
     {
-        mMutex.unlock();
+        delete iM;
     }
 }
 
 //------------------------------------------------------------------------------
-void MessageQueue::processNextMessage()
+// Lock free version of pushToDeque(). The caller is responsible to wake the
+// consumer threads.
+//
+void MessageQueue::pushToRingBuffer(Message* iM)
 {
-    // pop first message and process it!
-    mMutex.lock();
-    if( mQueue.size() > 0 )
+    // When the queue has a limited size and that size has been reached, it
+    // drops the oldest message. The size is only approximate when many
+    // threads are posting at the same time.
+    //
+    if (hasLimitedSize() && mpRingBuffer->getApproximateSize() >= getMaximumSize())
     {
         Message *m = nullptr;
-        switch (getBehavior())
+        if (mpRingBuffer->tryPop(&m))
         {
-        case bFifo:
-            m = mQueue.front();
-            mQueue.pop_front();
-            break;
-        case bLifo:
-            m = mQueue.back();
-            mQueue.pop_back();
-            break;
-        default: assert(0); break;
+            mNumberOfDroppedMessages.fetch_add(1);
+            delete m;
         }
-        mMutex.unlock();
+    }
 
-        mOneByOneProcessingFunction(m);
+    while (!mpRingBuffer->tryPush(iM))
+    {
+        // The ring is full. Drop the oldest when allowed, else give
+        // the consumers a chance to free a slot.
+        //
+        Message *m = nullptr;
+        if (hasLimitedSize() && mpRingBuffer->tryPop(&m))
+        {
+            mNumberOfDroppedMessages.fetch_add(1);
+            delete m;
+        }
+        else
+        { std::this_thread::yield(); }
+    }
+}
+
+//------------------------------------------------------------------------------
+// This method will invoke the OneByOne callback on all messages contained in the
+// queue.
+// See method processMessagesAllAtOnce for a more performant version, which requires
+// a different callback
+//
+void MessageQueue::processMessages()
+{
+    while( getNumberOfMessages() > 0 )
+    {
+        processNextMessage();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Pops all messages currently in the queue, with a single lock, and hands them
+// to the AllAtOnce callback. Messages posted while the callback is running
+// will be handled by the next call.
+//
+void MessageQueue::processMessagesAllAtOnce()
+{
+    mAllAtOnceMessages.clear();
+    popMessages(getNumberOfMessages(), &mAllAtOnceMessages);
+
+    if (!mAllAtOnceMessages.empty())
+    {
+        mAllAtOnceProcessingFunction(mAllAtOnceMessages);
+
+        //delete all
+        for (size_t i = 0; i < mAllAtOnceMessages.size(); ++i)
+        {
+            delete mAllAtOnceMessages[i];
+        }
+        mAllAtOnceMessages.clear();
+    }
+}
 
+//------------------------------------------------------------------------------
+void MessageQueue::processNextMessage()
+{
+    // pop first message and process it!
+    const bool needsLock = getStorageType() == stDeque;
+    if (needsLock)
+    { mMutex.lock(); }
+    Message *m = popMessage();
+    if (needsLock)
+    { mMutex.unlock(); }
+
+    if (m != nullptr)
+    {
+        mOneByOneProcessingFunction(m);
         delete m;
     }
-    else
+}
+
+//------------------------------------------------------------------------------
+// Pops up to iMaxNumberOfMessages messages with a single lock of the queue into
+// opStorage, invokes the OneByOne callback on each of them and deletes them.
+// opStorage is owned by the caller, it is typically kept alive by a consumer
+// thread to avoid reallocating it at each call. It is cleared on return.
+//
+// Returns the number of messages processed.
+//
+int MessageQueue::processUpTo(int iMaxNumberOfMessages, std::vector<Message*>* opStorage)
+{
+    assert(opStorage != nullptr);
+    opStorage->clear();
+    const int n = popMessages(iMaxNumberOfMessages, opStorage);
+    for (int i = 0; i < n; ++i)
     {
-        mMutex.unlock();
+        mOneByOneProcessingFunction((*opStorage)[i]);
+        delete (*opStorage)[i];
+    }
+    opStorage->clear();
+    return n;
+}
+
+//------------------------------------------------------------------------------
+// Submits tasks processing the messages of the queue to the thread pool, one
+// per posted message, up to the maximum number of tasks for this queue.
+// Running tasks process messages until the queue is empty, so there is no need
+// to submit one task per message once that maximum is reached.
+//
+void MessageQueue::scheduleOnThreadPool(int iNumberOfMessages)
+{
+    if (mpThreadPool == nullptr || getState() == sIdle)
+    { return; }
+
+    for (int i = 0; i < iNumberOfMessages && tryAcquireThreadPoolSlot(); ++i)
+    {
+        mpThreadPool->submit([this]() { threadPoolLoop(); });
     }
 }
 
@@ -280,12 +570,32 @@ void MessageQueue::setAllAtOnceProcessingFunction(std::function<void(const std::
 // NOTE: Calling this function will delete the content of the queue, it is meant
 //      to be called as an initialized not at runtime...
 //
+// NOTE: stLockFreeRingBuffer only supports bFifo.
+//
 void MessageQueue::setBehavior(Behavior iB)
 {
+    assert((iB == bFifo || getStorageType() != stLockFreeRingBuffer) &&
+        "Only bFifo is supported with stLockFreeRingBuffer");
+    if (getStorageType() == stLockFreeRingBuffer)
+    { iB = bFifo; }
+
     clear();
     mBehavior = iB;
 }
 
+//------------------------------------------------------------------------------
+// Sets the maximum number of messages a consumer thread takes from the queue,
+// with a single lock, before processing them. The default is 1.
+//
+// Larger batches reduce the contention on the queue when messages are small
+// and numerous. Note that messages already taken by a consumer are processed
+// even if stopThread() or clear() is called in the meantime.
+//
+void MessageQueue::setMaximumBatchSize(int iSize)
+{
+    mMaximumBatchSize = std::max(iSize, 1);
+}
+
 //------------------------------------------------------------------------------
 // Sets the maximal size of the queue. 
 // One the queue as reach the size limit, any new message comming in will cause
@@ -334,6 +644,21 @@ void MessageQueue::setOneByOneProcessingFunction(std::function<void(Message*)> i
     }
 }
 
+//------------------------------------------------------------------------------
+// Sets the thread pool used by startInThread(). A null pool reverts to
+// threads owned by the queue.
+//
+// NOTE: This must be called while the queue is not started.
+//
+void MessageQueue::setThreadPool(ThreadPool* ipPool)
+{
+    assert(getState() == sIdle && "setThreadPool must be called before startInThread");
+    if (getState() == sIdle)
+    {
+        mpThreadPool = ipPool;
+    }
+}
+
 //------------------------------------------------------------------------------
 void MessageQueue::setState(MessageQueue::state iState)
 {
@@ -351,6 +676,15 @@ void MessageQueue::startInThread()
 #ifndef MESSAGE_QUEUE_NO_THREADING
     //early out
     if(getState() != sIdle) return;
+
+    if (mpThreadPool != nullptr)
+    {
+        // messages posted prior to starting are processed right away.
+        setState(sRunning);
+        if (!isEmpty())
+        { scheduleOnThreadPool(getNumberOfMessages()); }
+        return;
+    }
     
     mMutex.lock();
     setState(sRunning);
@@ -371,6 +705,17 @@ void MessageQueue::startInThread()
 //
 void MessageQueue::stopThread()
 {
+    if (mpThreadPool != nullptr)
+    {
+        if (getState() == sRunning)
+        {
+            setState(sStopping);
+            clear();
+            waitForThreadPoolToFinish();
+        }
+        return;
+    }
+
     // there is always at least one thread.
     if (mThreads[0].joinable())
     {
@@ -396,6 +741,11 @@ void MessageQueue::stopThread()
 // This is the function executed in a thread when method start() is called
 void MessageQueue::threadLoop()
 {
+    // messages taken in a batch, kept alive for the whole life of the thread
+    // so it is not reallocated at each batch.
+    std::vector<Message*> batch;
+    batch.reserve(getMaximumBatchSize());
+
     while( getState() != sIdle  )
     {
         // The queue is empty...
@@ -405,27 +755,87 @@ void MessageQueue::threadLoop()
         // and waitForThreadTofinish to be able to join() this thread
         // event if the queue is empty.
         //
+        // The number of waiting threads is incremented before checking
+        // the queue so that a lock free post() either sees this thread
+        // waiting or this thread sees the posted message.
+        //
         std::unique_lock<std::recursive_mutex> lk(mMutex);
+        mNumberOfWaitingThreads.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
         mQueueWaitCondition.wait(lk, [this]()
-            {return mQueue.size() > 0 || getState() != sRunning;}) ;
+            {return !isEmpty() || getState() != sRunning;}) ;
+        mNumberOfWaitingThreads.fetch_sub(1);
         lk.unlock();
         
-        processNextMessage();
+        processUpTo(getBatchSize(), &batch);
         
         // if we are stopping and the queue is empty, then we are
         // done, set state to idle, this will exit the while loop
         // of ::threadLoop and the thread will end.
-        if(getState() == sStopping && mQueue.empty())
+        if(getState() == sStopping && isEmpty())
         { setState(sIdle); }
     }
 }
 
+//------------------------------------------------------------------------------
+// This is the task submitted to the thread pool. It processes messages until
+// the queue is empty.
+//
+void MessageQueue::threadPoolLoop()
+{
+    std::vector<Message*> batch;
+    bool done = false;
+    while (!done)
+    {
+        while (!isEmpty())
+        {
+            processUpTo(getBatchSize(), &batch);
+        }
+
+        // A message might have been posted after the queue was found empty
+        // but before the slot was released, in which case post() could not
+        // schedule a new task. Check again after releasing the slot.
+        //
+        // The mutex is held when releasing the slot so that
+        // waitForThreadPoolToFinish() cannot return, and the queue be
+        // destroyed, before this task stops touching it.
+        //
+        std::unique_lock<std::recursive_mutex> lk(mMutex);
+        mNumberOfThreadPoolTasks.fetch_sub(1);
+        done = isEmpty() || !tryAcquireThreadPoolSlot();
+        if (done)
+        { mThreadPoolTasksDoneCondition.notify_all(); }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool MessageQueue::tryAcquireThreadPoolSlot()
+{
+    int n = mNumberOfThreadPoolTasks.load();
+    while (n < getNumberOfThreads())
+    {
+        if (mNumberOfThreadPoolTasks.compare_exchange_weak(n, n + 1))
+        { return true; }
+    }
+    return false;
+}
+
 //------------------------------------------------------------------------------
 // This will stop the thread but will treat all message still in the queue
 // before stopping the thread
 //
 void MessageQueue::waitForThreadToFinish()
 {
+    if (mpThreadPool != nullptr)
+    {
+        if (getState() == sRunning)
+        {
+            setState(sStopping);
+            waitForThreadPoolToFinish();
+        }
+        return;
+    }
+
     // there is always at least one thread.
     if (mThreads[0].joinable())
     {
@@ -447,13 +857,66 @@ void MessageQueue::waitForThreadToFinish()
     }
 }
 
+//------------------------------------------------------------------------------
+// Waits for all tasks of this queue on the thread pool to finish and goes back
+// to idle.
+//
+void MessageQueue::waitForThreadPoolToFinish()
+{
+    std::unique_lock<std::recursive_mutex> lk(mMutex);
+    mThreadPoolTasksDoneCondition.wait(lk, [this]()
+        {return mNumberOfThreadPoolTasks.load() == 0; });
+    setState(sIdle);
+}
+
+//------------------------------------------------------------------------------
+// Wakes consumer threads, one per posted message, if some are waiting on the
+// condition. The mutex is taken, and released right away, to make sure the
+// waiting threads are really waiting on the condition and not in between their
+// check of the queue and the wait.
+//
+void MessageQueue::wakeWaitingThreads(int iNumberOfMessages)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mNumberOfWaitingThreads.load() > 0)
+    {
+        mMutex.lock();
+        mMutex.unlock();
+        if (iNumberOfMessages > 1)
+        { mQueueWaitCondition.notify_all(); }
+        else
+        { mQueueWaitCondition.notify_one(); }
+    }
+}
+
 //------------------------------------------------------------------------------
 //--- MessageQueue::Message
 //------------------------------------------------------------------------------
 MessageQueue::Message::Message():
-mpSender(nullptr)
+mpSender(nullptr),
+mPriority(0),
+mEpoch(0),
+mPostIndex(0)
 {}
 
 MessageQueue::Message::Message(void *ipSender):
-mpSender(ipSender)
+mpSender(ipSender),
+mPriority(0),
+mEpoch(0),
+mPostIndex(0)
 {}
+
+//------------------------------------------------------------------------------
+// Since the destructor is virtual, iSize is the size of the most derived type,
+// thus each subclass of Message ends up in the pool matching its size.
+//
+void* MessageQueue::Message::operator new(std::size_t iSize)
+{
+    return MemoryPool::allocate(iSize);
+}
+
+//------------------------------------------------------------------------------
+void MessageQueue::Message::operator delete(void* ipBlock, std::size_t iSize)
+{
+    MemoryPool::deallocate(ipBlock, iSize);
+}
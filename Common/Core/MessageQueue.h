@@ -1,7 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include "Core/LockFreeRingBuffer.h"
 #include <deque>
+#include <memory>
 #include <functional>
 #include <mutex>
 #include <string>
@@ -12,6 +17,8 @@ namespace Realisim
 {
 namespace Core
 {
+    class ThreadPool;
+
     //-------------------------------------------------------------------------
     // This class represent a thread safe message queue (FIFO). It also
     // comes with a convenient built in threaded function to
@@ -30,6 +37,12 @@ namespace Core
     //      to specify how to determine when messages are identical.
     //
     //
+    //      Messages are allocated from a MemoryPool (see
+    //      Message::operator new). This is transparent for the subclasses,
+    //      they are created with new and deleted with delete as usual. It
+    //      avoids hitting the global heap when messages are created by a
+    //      thread and deleted by another.
+    //
     //      Messages posted to the message queue will be
     //      owned and deleted by the queue once they have been
     //      processed/handled. They can be handled in 3 different ways:
@@ -53,12 +66,22 @@ namespace Core
     //      processNextMessage() will invoke the processing function
     //      on the oldest message (FIFO) in the queue. Once the
     //      processing function returns, the message is deleted.
+    //      Which message is next depends on the behavior, see below.
     //
     //      processMessages() will invoke processNextMessage() until
     //      the queue is empty.
     //
+    //      processUpTo() pops up to N messages with a single lock and
+    //      invokes the processing function on each of them. The caller
+    //      provides the storage, so it can be reused between calls.
+    //
+    //      processMessagesAllAtOnce() pops all messages with a single lock
+    //      and hands them to the AllAtOnce processing function.
+    //
     // Usage as a thread safe message queue.
     //      Messages can be posted to the queue via post() method.
+    //      postBatch() posts many messages with a single lock of the queue
+    //      and a single wake up of the consumer threads.
     //
     //      The number of messages in the queue can be queried via
     //      getNumberOfMessages().
@@ -103,6 +126,9 @@ namespace Core
     //          empty, the thread will wait (no cpu usage).
     //          The thread will wake up when a message is posted.
     //
+    //      setMaximumBatchSize(): define how many messages a consumer
+    //          thread takes from the queue at once. Default is 1.
+    //
     //      waitForThreadToFinish(); will stop receiving new messages
     //          and will invoke the processing function for all
     //          remaining messages in the queue. Then the thread
@@ -115,15 +141,90 @@ namespace Core
     //      Ex:
     //
     //
+    // Processing the messages on a thread pool:
+    //      setThreadPool() can be called, prior to startInThread(), to have
+    //      the messages processed by the workers of a shared ThreadPool
+    //      instead of threads owned by the queue. This way, a process runs a
+    //      fixed number of threads no matter how many queues exist.
+    //
+    //      startInThread(), stopThread() and waitForThreadToFinish() behave
+    //      the same. setNumberOfThreads() becomes the maximum number of pool
+    //      workers processing messages of this queue at the same time. With
+    //      1, messages are processed one after the other, like a single
+    //      consumer thread.
+    //
+    //      Ex:
+    //          MessageQueue q;
+    //          q.setThreadPool(&ThreadPool::getGlobalInstance());
+    //          q.setNumberOfThreads(4);
+    //          q.startInThread();
+    //
+    // Behavior:
+    //      bFifo (default): messages are processed in the order they were
+    //          posted.
+    //
+    //      bLifo: the last message posted is processed first.
+    //
+    //      bPriority: the message with the highest Message::mPriority is
+    //          processed first. Messages of equal priority are processed
+    //          in the order they were posted. The queue is a binary heap,
+    //          post and pop are O(log n). When the queue has a limited
+    //          size and is full, the message that would be processed last
+    //          is dropped, which can be the posted one.
+    //
+    // Epoch:
+    //      Each message carries an epoch (Message::mEpoch, 0 by default)
+    //      and so does the queue (getEpoch(), 0 at construction). A message
+    //      whose epoch is older than the queue epoch is stale: it is deleted
+    //      when popped, without invoking the processing function. This is
+    //      the way to cancel outdated work without clearing the queue, for
+    //      all behaviors and storage types.
+    //
+    //      Ex:
+    //          // the camera moved, cancel the tiles of the previous frame.
+    //          const int epoch = q.incrementEpoch();
+    //          m->mEpoch = epoch;
+    //          m->mPriority = -distanceToScreenCenter;
+    //          q.post(m);
+    //
+    //      Note that stale messages still count in getNumberOfMessages()
+    //      until they are popped.
+    //
+    // Storage type:
+    //      The storage is selected at construction and cannot be changed
+    //      afterward.
+    //
+    //      stDeque (default): messages are stored in a std::deque protected
+    //          by a mutex. All behaviors and options are supported.
+    //
+    //      stLockFreeRingBuffer: messages are stored in a bounded lock-free
+    //          ring (see LockFreeRingBuffer). post() and the consumer threads
+    //          do not take the mutex, it is only used to put idle consumer
+    //          threads to sleep. This is meant for many producers/consumers
+    //          posting lots of small messages. Some restrictions apply:
+    //          - Only bFifo behavior is supported.
+    //          - Identical contiguous messages are always allowed.
+    //          - The queue never holds more messages than the ring capacity.
+    //            When the ring is full, post() drops the oldest message if a
+    //            maximum size was set, else it yields until a consumer frees
+    //            a slot. The capacity must thus be chosen accordingly when
+    //            the queue is not consumed by threads.
+    //
+    //      Ex:
+    //          MessageQueue q(MessageQueue::stLockFreeRingBuffer, 16384);
+    //
     class MessageQueue
     {
     public:
+        enum StorageType{stDeque, stLockFreeRingBuffer};
+
         MessageQueue();
+        explicit MessageQueue(StorageType iStorageType, int iRingBufferCapacity = 4096);
         MessageQueue(const MessageQueue&) = delete;
         MessageQueue& operator=(const MessageQueue&) = delete;
         ~MessageQueue();
         
-        enum Behavior{bFifo, bLifo};
+        enum Behavior{bFifo, bLifo, bPriority};
         enum state{sIdle, sRunning, sStopping};
         
         class Message
@@ -135,49 +236,91 @@ namespace Core
             Message& operator=(const Message&) = default;
             virtual ~Message() = default;
 
+            static void* operator new(std::size_t iSize);
+            static void operator delete(void* ipBlock, std::size_t iSize);
+
             virtual bool isEqual(const Message&) const {return false;} 
             bool operator==(const Message& iM) const {return isEqual(iM);}
             bool operator!=(const Message& iM) const {return !(this->operator==(iM));}
             
             void* mpSender;
+            int mPriority; // higher is processed first, with bPriority
+            int mEpoch; // discarded when older than the queue epoch
+
+        private:
+            friend class MessageQueue;
+            uint64_t mPostIndex; // keeps bPriority fifo among equal priorities
         };
         
         void allowIdenticalContiguousMessage(bool iA);
         void clear();
         Behavior getBehavior() const;
+        int getEpoch() const;
+        int getMaximumBatchSize() const;
         int getMaximumSize() const;
+        uint64_t getNumberOfDroppedMessages() const;
         int getNumberOfMessages() const;
         int getNumberOfThreads() const;
         state getState() const;
+        StorageType getStorageType() const;
+        ThreadPool* getThreadPool() const;
         bool hasLimitedSize() const;
+        int incrementEpoch();
         bool isEmpty() const;
         bool isIdenticalContiguousMessageAllowed() const;
         void post( Message* );
+        void postBatch(const std::vector<Message*>& iMessages);
         void processNextMessage();
         void processMessages();
         void processMessagesAllAtOnce();
+        int processUpTo(int iMaxNumberOfMessages, std::vector<Message*>* opStorage);
         void setAllAtOnceProcessingFunction(std::function<void(const std::vector<Message*>&)>);
         void setBehavior(Behavior);
+        void setMaximumBatchSize(int);
         void setMaximumSize(int);
         void setNumberOfThreads(int iN);
         void setOneByOneProcessingFunction(std::function<void(Message*)>);
+        void setThreadPool(ThreadPool*);
         void startInThread();
         void stopThread();
         void waitForThreadToFinish();
 
     protected:
         void dummyOneByOneProcessingFunction(Message*);
+        int getBatchSize() const;
+        static bool hasLowerPriority(const Message* iA, const Message* iB);
+        bool isStale(const Message*) const;
+        Message* popMessage();
+        int popMessages(int iMaxNumberOfMessages, std::vector<Message*>* opMessages);
+        void pushToDeque(Message*);
+        void pushToRingBuffer(Message*);
+        void scheduleOnThreadPool(int iNumberOfMessages);
         void threadLoop();
+        void threadPoolLoop();
+        bool tryAcquireThreadPoolSlot();
+        void waitForThreadPoolToFinish();
         void setState(state);
+        void wakeWaitingThreads(int iNumberOfMessages);
         
         std::vector<std::thread> mThreads;
         std::deque<Message*> mQueue;
+        const StorageType mStorageType;
+        std::unique_ptr<LockFreeRingBuffer<Message*>> mpRingBuffer;
+        std::atomic<int> mNumberOfWaitingThreads;
+        ThreadPool *mpThreadPool;
+        std::atomic<int> mNumberOfThreadPoolTasks;
+        std::condition_variable_any mThreadPoolTasksDoneCondition;
         mutable std::recursive_mutex mMutex;
         std::condition_variable_any mQueueWaitCondition;
         state mState;
         std::function<void(Message*)> mOneByOneProcessingFunction;
         std::function<void( std::vector<Message*>& )> mAllAtOnceProcessingFunction;
+        std::vector<Message*> mAllAtOnceMessages;
         int mMaximumSize;
+        int mMaximumBatchSize;
+        std::atomic<int> mEpoch;
+        uint64_t mNextPostIndex;
+        std::atomic<uint64_t> mNumberOfDroppedMessages;
         Behavior mBehavior;
         bool mIsIdenticalContiguousMessageAllowed;
     };
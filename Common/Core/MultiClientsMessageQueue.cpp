@@ -1,6 +1,7 @@
 
 #include <cassert>
 #include "MultiClientsMessageQueue.h"
+#include "Unused.h"
 
 using namespace Realisim;
     using namespace Core;
@@ -27,19 +28,19 @@ MultiClientsMessageQueue::~MultiClientsMessageQueue()
 //-----------------------------------------------------------------------------
 void MultiClientsMessageQueue::callRegisteredSenderFunction(MessageQueue::Message* ipM)
 {
-    auto it = mRegisteredSenders.find(ipM->mpSender);
-    assert(it != mRegisteredSenders.end());
-
-    if (it != mRegisteredSenders.end())
-    {
-        it->second(ipM);
-    }
+    const bool isRegistered = mRegisteredSenders.call(ipM);
+    assert(isRegistered && "The sender of the message is not registered");
+    UNUSED(isRegistered);
 }
 
 //-----------------------------------------------------------------------------
 int MultiClientsMessageQueue::getMaximumNumberOfMessages() const
 { return mRequestQueue.getMaximumSize(); }
 
+//-----------------------------------------------------------------------------
+ThreadPool* MultiClientsMessageQueue::getThreadPool() const
+{ return mRequestQueue.getThreadPool(); }
+
 //-----------------------------------------------------------------------------
 bool MultiClientsMessageQueue::isStarted() const
 { return mRequestQueue.getState() == MessageQueue::sRunning; }
@@ -60,13 +61,19 @@ void MultiClientsMessageQueue::processRequestMessage(MessageQueue::Message* ipM)
 void MultiClientsMessageQueue::registerAsSender(void* ipSender,
     std::function<void(MessageQueue::Message*)>& iFunction)
 {
-    mRegisteredSenders[ipSender] = iFunction;
+    mRegisteredSenders.registerSender(ipSender, iFunction);
 }
 
 //-----------------------------------------------------------------------------
 void MultiClientsMessageQueue::setMaximumNumberOfMessages(int iN)
 { mRequestQueue.setMaximumSize(iN); }
 
+//-----------------------------------------------------------------------------
+// NOTE: This must be called before start().
+//
+void MultiClientsMessageQueue::setThreadPool(ThreadPool* ipPool)
+{ mRequestQueue.setThreadPool(ipPool); }
+
 //-----------------------------------------------------------------------------
 void MultiClientsMessageQueue::start()
 {
@@ -85,11 +92,7 @@ void MultiClientsMessageQueue::stop()
 //-----------------------------------------------------------------------------
 void MultiClientsMessageQueue::unregisterAsSender(void* ipSender)
 {
-    auto it = mRegisteredSenders.find(ipSender);
-    if (it != mRegisteredSenders.end())
-    {
-        mRegisteredSenders.erase(it);
-    }
+    mRegisteredSenders.unregisterSender(ipSender);
 }
 
 //-----------------------------------------------------------------------------
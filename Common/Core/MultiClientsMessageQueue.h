@@ -1,7 +1,7 @@
 #pragma once
 
 #include "Core/MessageQueue.h"
-#include <map>
+#include "Core/SenderRegistry.h"
 
 namespace Realisim
 {
@@ -22,6 +22,10 @@ namespace Core
     // It is possible to set a maximum number of message to the queues, refer to
     // messageQueue class for more info on that behavior.
     //
+    // setThreadPool() can be called prior to start() to have the messages
+    // processed by a worker of a shared ThreadPool instead of a thread owned
+    // by the queue. Messages are still processed one after the other.
+    //
     // It wraps a messageQueue and present the post() function to send requests/tasks.
     // 
     // Typically, to use MultiClientsMessageQueue:
@@ -34,6 +38,11 @@ namespace Core
     //      with the sender. See MessageQueue::Message(void* ipSender) constructor.
     //  3- treat your message in your registered function.
     //
+    // Senders can register and unregister at any time, even while messages
+    // are being processed, see SenderRegistry. Once unregisterAsSender()
+    // returns, the function of that sender will not be invoked anymore. A
+    // registered function must not register or unregister senders.
+    //
     class MultiClientsMessageQueue
     {
     public:
@@ -43,10 +52,12 @@ namespace Core
         ~MultiClientsMessageQueue();
 
         int getMaximumNumberOfMessages() const;
+        ThreadPool* getThreadPool() const;
         bool isStarted() const;
         void post(Core::MessageQueue::Message*);
         void registerAsSender(void* ipSender, std::function<void(Core::MessageQueue::Message*)>& iFunction );
         void setMaximumNumberOfMessages(int);
+        void setThreadPool(ThreadPool*);
         void start();
         void stop();
         void unregisterAsSender(void* ipSender);
@@ -57,7 +68,7 @@ namespace Core
         void processRequestMessage(Core::MessageQueue::Message*);
 
         Core::MessageQueue mRequestQueue;
-        std::map<void*, std::function<void(Core::MessageQueue::Message*)>> mRegisteredSenders;
+        SenderRegistry mRegisteredSenders;
     };
 }
 }
\ No newline at end of file
@@ -1,14 +1,41 @@
 
 #include <cassert>
+#include <cstdint>
+#include <limits>
 #include "MultiClientsMultiMessageQueues.h"
+#include "Unused.h"
 
 using namespace Realisim;
     using namespace Core;
 using namespace std;
 
+namespace
+{
+    // Jump consistent hash (Lamping and Veach). Maps iKey to one of
+    // iNumberOfBuckets buckets so that going from n to n+1 buckets only moves
+    // 1/(n+1) of the keys, without any table.
+    //
+    int jumpConsistentHash(uint64_t iKey, int iNumberOfBuckets)
+    {
+        int64_t b = -1;
+        int64_t j = 0;
+        while (j < iNumberOfBuckets)
+        {
+            b = j;
+            iKey = iKey * 2862933555777941757ULL + 1;
+            j = (int64_t)((b + 1) * ((double)(1LL << 31) / (double)((iKey >> 33) + 1)));
+        }
+        return (int)b;
+    }
+}
+
 //-----------------------------------------------------------------------------
 MultiClientsMultiMessageQueues::MultiClientsMultiMessageQueues() :
-    mRequestQueues()
+    mRequestQueues(),
+    mpThreadPool(nullptr),
+    mQueueSelection(qsSenderAffinity),
+    mHighWaterMark(-1),
+    mNumberOfBlockedProducers(0)
 {
 }
 
@@ -32,15 +59,15 @@ void MultiClientsMultiMessageQueues::clear()
 //-----------------------------------------------------------------------------
 void MultiClientsMultiMessageQueues::callRegisteredSenderFunction(MessageQueue::Message* ipM)
 {
-    auto it = mRegisteredSenders.find(ipM->mpSender);
-    assert(it != mRegisteredSenders.end());
-
-    if (it != mRegisteredSenders.end())
-    {
-        it->second(ipM);
-    }
+    const bool isRegistered = mRegisteredSenders.call(ipM);
+    assert(isRegistered && "The sender of the message is not registered");
+    UNUSED(isRegistered);
 }
 
+//-----------------------------------------------------------------------------
+int MultiClientsMultiMessageQueues::getHighWaterMark() const
+{ return mHighWaterMark; }
+
 //-----------------------------------------------------------------------------
 int MultiClientsMultiMessageQueues::getMaximumNumberOfMessages() const
 { 
@@ -53,12 +80,40 @@ int MultiClientsMultiMessageQueues::getMaximumNumberOfMessages() const
     return r;
 }
 
+//-----------------------------------------------------------------------------
+// Returns the number of messages dropped by queue iQueueIndex because it was
+// full, see setMaximumNumberOfMessages().
+//
+uint64_t MultiClientsMultiMessageQueues::getNumberOfDroppedMessages(int iQueueIndex) const
+{ return mRequestQueues[iQueueIndex]->getNumberOfDroppedMessages(); }
+
+//-----------------------------------------------------------------------------
+int MultiClientsMultiMessageQueues::getNumberOfMessages(int iQueueIndex) const
+{ return mRequestQueues[iQueueIndex]->getNumberOfMessages(); }
+
 //-----------------------------------------------------------------------------
 int MultiClientsMultiMessageQueues::getNumberOfQueues() const
 {
     return (int)mRequestQueues.size();
 }
 
+//-----------------------------------------------------------------------------
+ThreadPool* MultiClientsMultiMessageQueues::getThreadPool() const
+{
+    return mpThreadPool;
+}
+
+//-----------------------------------------------------------------------------
+MultiClientsMultiMessageQueues::QueueSelection MultiClientsMultiMessageQueues::getQueueSelection() const
+{ return mQueueSelection; }
+
+//-----------------------------------------------------------------------------
+bool MultiClientsMultiMessageQueues::isAboveHighWaterMark(int iQueueIndex) const
+{
+    return getHighWaterMark() >= 0 &&
+        getNumberOfMessages(iQueueIndex) >= getHighWaterMark();
+}
+
 //-----------------------------------------------------------------------------
 bool MultiClientsMultiMessageQueues::isStarted() const
 { 
@@ -73,43 +128,85 @@ bool MultiClientsMultiMessageQueues::isStarted() const
 }
 
 //-----------------------------------------------------------------------------
+// Posts to the queue chosen by the queue selection. When a high water mark is
+// set, this blocks until that queue is below the mark, see tryPost() for the
+// non blocking version.
+//
 void MultiClientsMultiMessageQueues::post(Core::MessageQueue::Message* ipM)
 {
-    //post in the queue with the least amount of messages
-    int r = -1;
-    int minMessage = std::numeric_limits<int>::max();
-    bool stop = false;
-    for(int i = 0; i < (int)mRequestQueues.size() && !stop; ++i)
+    if (getNumberOfQueues() == 0)
     {
-        const int n = mRequestQueues[i]->getNumberOfMessages();
-        if(n == 0)
-        {
-            r = i;
-            stop = true;
-        }
-        else if(n < minMessage)
-        {
-            minMessage = n;
-            r = i;
-        }
-        else{}
+        delete ipM;
+        return;
+    }
+
+    int r = selectQueue(ipM);
+    if (isStarted() && isAboveHighWaterMark(r))
+    {
+        // The number of blocked producers is incremented before checking the
+        // queue so that a consumer either sees this producer blocked or this
+        // producer sees the consumed message.
+        //
+        std::unique_lock<std::mutex> lk(mBlockedProducersMutex);
+        mNumberOfBlockedProducers.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        mBlockedProducersCondition.wait(lk, [this, ipM, &r]()
+            {
+                r = selectQueue(ipM);
+                return !isAboveHighWaterMark(r) || !isStarted();
+            });
+        mNumberOfBlockedProducers.fetch_sub(1);
     }
 
-    if(r != -1)
-    { mRequestQueues[r]->post(ipM); }
+    mRequestQueues[r]->post(ipM);
 }
 
 //-----------------------------------------------------------------------------
 void MultiClientsMultiMessageQueues::processRequestMessage(MessageQueue::Message* ipM)
 {
     callRegisteredSenderFunction(ipM);
+    wakeBlockedProducers();
+}
+
+//-----------------------------------------------------------------------------
+int MultiClientsMultiMessageQueues::selectQueue(const MessageQueue::Message* ipM) const
+{
+    int r = 0;
+    switch (getQueueSelection())
+    {
+    case qsSenderAffinity:
+    {
+        // Senders are typically heap allocated, the address is mixed so the
+        // low bits, always 0, do not bias the hash.
+        const uint64_t key = (uint64_t)(uintptr_t)ipM->mpSender * 0x9E3779B97F4A7C15ull;
+        r = jumpConsistentHash(key, getNumberOfQueues());
+    } break;
+    case qsLeastBusy:
+    {
+        //post in the queue with the least amount of messages
+        int minMessage = std::numeric_limits<int>::max();
+        for (int i = 0; i < getNumberOfQueues(); ++i)
+        {
+            const int n = getNumberOfMessages(i);
+            if (n < minMessage)
+            {
+                minMessage = n;
+                r = i;
+            }
+            if (n == 0)
+            { break; }
+        }
+    } break;
+    default: assert(0); break;
+    }
+    return r;
 }
 
 //-----------------------------------------------------------------------------
 void MultiClientsMultiMessageQueues::registerAsSender(void* ipSender,
     std::function<void(MessageQueue::Message*)>& iFunction)
 {
-    mRegisteredSenders[ipSender] = iFunction;
+    mRegisteredSenders.registerSender(ipSender, iFunction);
 }
 
 //-----------------------------------------------------------------------------
@@ -123,12 +220,34 @@ void MultiClientsMultiMessageQueues::setNumberOfQueues(int iN)
     mRequestQueues.resize(iN);
     mRequestQueues.shrink_to_fit();
     
+    // configure threaded message queue. This is done here rather than in
+    // start(), since setBehavior() clears the queue and would delete the
+    // messages posted before start().
+    using placeholders::_1;
+    function<void(Realisim::Core::MessageQueue::Message*)> f =
+        bind(&MultiClientsMultiMessageQueues::processRequestMessage, this, _1);
     for(int i = 0; i < iN; ++i)
     {
         mRequestQueues[i] = new MessageQueue();
+        mRequestQueues[i]->setOneByOneProcessingFunction(f);
+        mRequestQueues[i]->setBehavior(MessageQueue::bFifo);
     }
 }
 
+//-----------------------------------------------------------------------------
+// Sets the number of messages per queue above which post() blocks and
+// tryPost() fails. -1 (default) means no limit.
+//
+// Unlike setMaximumNumberOfMessages(), no message is ever lost, the producers
+// are slowed down instead. When both are set, the high water mark should be
+// lower than the maximum number of messages.
+//
+void MultiClientsMultiMessageQueues::setHighWaterMark(int iN)
+{
+    mHighWaterMark = iN < 0 ? -1 : std::max(iN, 1);
+    wakeBlockedProducers();
+}
+
 //-----------------------------------------------------------------------------
 void MultiClientsMultiMessageQueues::setMaximumNumberOfMessages(int iN)
 { 
@@ -139,6 +258,22 @@ void MultiClientsMultiMessageQueues::setMaximumNumberOfMessages(int iN)
 
 }
 
+//-----------------------------------------------------------------------------
+void MultiClientsMultiMessageQueues::setQueueSelection(QueueSelection iQs)
+{ mQueueSelection = iQs; }
+
+//-----------------------------------------------------------------------------
+// Sets the thread pool used by all queues. A null pool reverts to one thread
+// per queue.
+//
+// NOTE: This must be called before start().
+//
+void MultiClientsMultiMessageQueues::setThreadPool(ThreadPool* ipPool)
+{
+    assert(!isStarted() && "setThreadPool must be called before start");
+    mpThreadPool = ipPool;
+}
+
 //-----------------------------------------------------------------------------
 void MultiClientsMultiMessageQueues::start()
 {
@@ -146,12 +281,7 @@ void MultiClientsMultiMessageQueues::start()
     {
         if(mRequestQueues[i]->getState() == MessageQueue::sIdle)
         {
-            // configure threaded message queue
-            using placeholders::_1;
-            function<void(Realisim::Core::MessageQueue::Message*)> f =
-               bind(&MultiClientsMultiMessageQueues::processRequestMessage, this, _1);
-            mRequestQueues[i]->setOneByOneProcessingFunction(f);
-            mRequestQueues[i]->setBehavior(MessageQueue::bFifo);
+            mRequestQueues[i]->setThreadPool(mpThreadPool);
 
             mRequestQueues[i]->startInThread();
         }
@@ -167,16 +297,31 @@ void MultiClientsMultiMessageQueues::stop()
     {
         mRequestQueues[i]->stopThread();
     }
+    wakeBlockedProducers();
+}
+
+//-----------------------------------------------------------------------------
+// Posts to the queue chosen by the queue selection, unless that queue has
+// reached the high water mark. Returns false in that case, the message is not
+// taken and still belongs to the caller.
+//
+bool MultiClientsMultiMessageQueues::tryPost(Core::MessageQueue::Message* ipM)
+{
+    if (getNumberOfQueues() == 0)
+    { return false; }
+
+    const int r = selectQueue(ipM);
+    if (isAboveHighWaterMark(r))
+    { return false; }
+
+    mRequestQueues[r]->post(ipM);
+    return true;
 }
 
 //-----------------------------------------------------------------------------
 void MultiClientsMultiMessageQueues::unregisterAsSender(void* ipSender)
 {
-    auto it = mRegisteredSenders.find(ipSender);
-    if (it != mRegisteredSenders.end())
-    {
-        mRegisteredSenders.erase(it);
-    }
+    mRegisteredSenders.unregisterSender(ipSender);
 }
 
 //-----------------------------------------------------------------------------
@@ -186,4 +331,20 @@ void MultiClientsMultiMessageQueues::waitForThreadsToFinish()
     {
         mRequestQueues[i]->waitForThreadToFinish();
     }
+    wakeBlockedProducers();
+}
+
+//-----------------------------------------------------------------------------
+// Wakes the producers blocked in post(), if any. The mutex is taken, and
+// released right away, to make sure they are really waiting on the condition
+// and not in between their check of the queue and the wait.
+//
+void MultiClientsMultiMessageQueues::wakeBlockedProducers()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mNumberOfBlockedProducers.load() > 0)
+    {
+        { std::lock_guard<std::mutex> lk(mBlockedProducersMutex); }
+        mBlockedProducersCondition.notify_all();
+    }
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include "Core/MessageQueue.h"
-#include <map>
+#include "Core/SenderRegistry.h"
+#include <mutex>
 #include <vector>
 
 namespace Realisim
@@ -26,7 +29,34 @@ namespace Core
     //
     //
     // It is possible to set a maximum number of message to the queues, refer to
-    // messageQueue class for more info on that behavior.
+    // messageQueue class for more info on that behavior. Messages dropped that
+    // way are counted, see getNumberOfDroppedMessages().
+    //
+    // Queue selection:
+    //      qsSenderAffinity (default): all messages of a sender go to the
+    //          same queue, chosen by a consistent hash of mpSender. Messages
+    //          of a sender are thus processed in the order they were posted,
+    //          and always by the same thread. Changing the number of queues
+    //          only moves a fraction of the senders to other queues.
+    //
+    //      qsLeastBusy: messages go to the queue with the least messages.
+    //          There is no ordering guarantee.
+    //
+    // Backpressure:
+    //      setHighWaterMark() bounds the number of messages per queue without
+    //      losing any. When the selected queue has reached the high water
+    //      mark:
+    //          - post() blocks until the queue is below the mark.
+    //          - tryPost() returns false right away. The message is not taken,
+    //            it still belongs to the caller.
+    //      The mark is approximate, concurrent producers can overshoot it by
+    //      at most one message each. post() never blocks when the queues are
+    //      not started, since nothing would drain them.
+    //
+    // By default, each queue owns a thread. setThreadPool() can be called prior
+    // to start() to have all queues processed by the workers of a shared
+    // ThreadPool instead. Each queue is then processed by at most one worker
+    // at a time.
     //
     // It wraps a messageQueue and present the post() function to send requests/tasks.
     // 
@@ -40,6 +70,11 @@ namespace Core
     //      with the sender. See MessageQueue::Message(void* ipSender) constructor.
     //  3- treat your message in your registered function.
     //
+    // Senders can register and unregister at any time, even while messages
+    // are being processed, see SenderRegistry. Once unregisterAsSender()
+    // returns, the function of that sender will not be invoked anymore. A
+    // registered function must not register or unregister senders.
+    //
     class MultiClientsMultiMessageQueues
     {
     public:
@@ -50,23 +85,43 @@ namespace Core
 
         void clear();
         int getNumberOfQueues() const;
+        enum QueueSelection{qsSenderAffinity, qsLeastBusy};
+
+        int getHighWaterMark() const;
         int getMaximumNumberOfMessages() const;
+        uint64_t getNumberOfDroppedMessages(int iQueueIndex) const;
+        int getNumberOfMessages(int iQueueIndex) const;
+        QueueSelection getQueueSelection() const;
+        ThreadPool* getThreadPool() const;
         bool isStarted() const;
         void post(Core::MessageQueue::Message*);
         void registerAsSender(void* ipSender, std::function<void(Core::MessageQueue::Message*)>& iFunction );
+        void setHighWaterMark(int);
         void setMaximumNumberOfMessages(int);
         void setNumberOfQueues(int iN);
+        void setQueueSelection(QueueSelection);
+        void setThreadPool(ThreadPool*);
         void start();
         void stop();
+        bool tryPost(Core::MessageQueue::Message*);
         void unregisterAsSender(void* ipSender);
         void waitForThreadsToFinish();
 
     protected:
         void callRegisteredSenderFunction(Core::MessageQueue::Message*);
+        bool isAboveHighWaterMark(int iQueueIndex) const;
         void processRequestMessage(Core::MessageQueue::Message*);
+        int selectQueue(const Core::MessageQueue::Message*) const;
+        void wakeBlockedProducers();
 
         std::vector<Core::MessageQueue*> mRequestQueues;
-        std::map<void*, std::function<void(Core::MessageQueue::Message*)>> mRegisteredSenders;
+        SenderRegistry mRegisteredSenders;
+        ThreadPool *mpThreadPool;
+        QueueSelection mQueueSelection;
+        int mHighWaterMark;
+        std::atomic<int> mNumberOfBlockedProducers;
+        std::mutex mBlockedProducersMutex;
+        std::condition_variable mBlockedProducersCondition;
     };
 }
 }
\ No newline at end of file
@@ -15,6 +15,7 @@ namespace Core
 	public:
         static std::string getApplicationFilePath();
 		static std::string getCurrentWorkingDirectory();
+        static std::string getTemporaryFolderPath();
 		static std::string join(const std::string& iPath0, const std::string& iPath1);
 		static std::string resolve(const std::string & path);
 		static std::string sanitize(const std::string & path);
@@ -0,0 +1,367 @@
+
+#include <cassert>
+#include "Core/CycleCounter.h"
+#include <map>
+#include "Core/Profiler.h"
+#include "Core/StringUtilities.h"
+#include <sstream>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    const size_t kMaximumNumberOfEventsPerThread = 1 << 20;
+}
+
+//-----------------------------------------------------------------------------
+Profiler::Profiler() :
+    mIsEnabled(true),
+    mIsCapturing(false),
+    mEpochInNs(0),
+    mMutex(),
+    mIds(),
+    mNames(),
+    mThreads()
+{
+    mEpochInNs = nowInNs();
+}
+
+//-----------------------------------------------------------------------------
+Profiler::~Profiler()
+{}
+
+//-----------------------------------------------------------------------------
+// Adds a child with id iId to the current node and returns its index. The
+// mutex of ipData must be held.
+//
+int Profiler::addChild(ThreadData* ipData, Id iId, const std::string& iName)
+{
+    const int parentIndex = ipData->mCurrentNodeIndex;
+
+    Node child;
+    child.mId = iId;
+    child.mParentIndex = parentIndex;
+    child.mKey = parentIndex == 0 ? iName : ipData->mNodes[parentIndex].mKey + "/" + iName;
+    child.mFrameDurationInNs = 0;
+    child.mFrameCount = 0;
+
+    const int childIndex = (int)ipData->mNodes.size();
+    ipData->mNodes.push_back(child);
+    ipData->mNodes[parentIndex].mChildIndices.push_back(childIndex);
+    return childIndex;
+}
+
+//-----------------------------------------------------------------------------
+// Drops the captured events and the time recorded during the current frame.
+// The interned names are kept.
+//
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lk(mMutex);
+    for (auto &t : mThreads)
+    {
+        std::lock_guard<std::mutex> threadLock(t->mMutex);
+        t->mEvents.clear();
+        t->mNumberOfDroppedEvents = 0;
+        for (auto &n : t->mNodes)
+        {
+            n.mFrameDurationInNs = 0;
+            n.mFrameCount = 0;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Adds the time spent during the frame in each scope path to opTree, in
+// seconds, and starts a new frame. The times of the same path on different
+// threads are summed.
+//
+// Scopes that are still open are accounted in the frame they end.
+//
+void Profiler::endFrame(StatisticsTree* opTree)
+{
+    map<string, int64_t> durations;
+
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        for (auto &t : mThreads)
+        {
+            std::lock_guard<std::mutex> threadLock(t->mMutex);
+            for (auto &n : t->mNodes)
+            {
+                if (n.mFrameCount == 0) continue;
+                durations[n.mKey] += n.mFrameDurationInNs;
+                n.mFrameDurationInNs = 0;
+                n.mFrameCount = 0;
+            }
+        }
+    }
+
+    if (opTree == nullptr) return;
+    for (auto &d : durations)
+    {
+        opTree->add(d.first, d.second * 1e-9);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void Profiler::enterScope(ThreadData* ipData, Id iId)
+{
+    const int64_t now = nowInNs();
+
+    std::unique_lock<std::mutex> lk(ipData->mMutex);
+    int childIndex = findChild(ipData, iId);
+    if (childIndex < 0)
+    {
+        // first time this scope is entered from the current node. The name
+        // is fetched without the lock of the thread, since endFrame() takes
+        // the locks in the other order. Only this thread modifies its tree.
+        lk.unlock();
+        const string name = getName(iId);
+        lk.lock();
+        childIndex = addChild(ipData, iId, name);
+    }
+    ipData->mCurrentNodeIndex = childIndex;
+    ipData->mStartTimesInNs.push_back(now);
+}
+
+//-----------------------------------------------------------------------------
+void Profiler::exitScope(ThreadData* ipData)
+{
+    const int64_t now = nowInNs();
+
+    std::lock_guard<std::mutex> lk(ipData->mMutex);
+    assert(!ipData->mStartTimesInNs.empty());
+    const int64_t start = ipData->mStartTimesInNs.back();
+    ipData->mStartTimesInNs.pop_back();
+
+    Node &n = ipData->mNodes[ipData->mCurrentNodeIndex];
+    n.mFrameDurationInNs += now - start;
+    ++n.mFrameCount;
+
+    if (isCapturing())
+    {
+        if (ipData->mEvents.size() < kMaximumNumberOfEventsPerThread)
+        { ipData->mEvents.push_back({ n.mId, start - mEpochInNs, now - start }); }
+        else
+        { ++ipData->mNumberOfDroppedEvents; }
+    }
+
+    ipData->mCurrentNodeIndex = n.mParentIndex;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the index of the child of the current node with id iId, -1 if
+// there is none. The mutex of ipData must be held.
+//
+int Profiler::findChild(const ThreadData* ipData, Id iId) const
+{
+    for (int childIndex : ipData->mNodes[ipData->mCurrentNodeIndex].mChildIndices)
+    {
+        if (ipData->mNodes[childIndex].mId == iId)
+        { return childIndex; }
+    }
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+Profiler& Profiler::getInstance()
+{
+    static Profiler sInstance;
+    return sInstance;
+}
+
+//-----------------------------------------------------------------------------
+std::string Profiler::getName(Id iId) const
+{
+    std::lock_guard<std::mutex> lk(mMutex);
+    return iId >= 0 && iId < (Id)mNames.size() ? mNames[iId] : string();
+}
+
+//-----------------------------------------------------------------------------
+uint64_t Profiler::getNumberOfDroppedEvents() const
+{
+    uint64_t r = 0;
+    std::lock_guard<std::mutex> lk(mMutex);
+    for (auto &t : mThreads)
+    {
+        std::lock_guard<std::mutex> threadLock(t->mMutex);
+        r += t->mNumberOfDroppedEvents;
+    }
+    return r;
+}
+
+//-----------------------------------------------------------------------------
+int Profiler::getNumberOfEvents() const
+{
+    int r = 0;
+    std::lock_guard<std::mutex> lk(mMutex);
+    for (auto &t : mThreads)
+    {
+        std::lock_guard<std::mutex> threadLock(t->mMutex);
+        r += (int)t->mEvents.size();
+    }
+    return r;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the data of the calling thread, it is created on first use.
+//
+Profiler::ThreadData* Profiler::getThreadData()
+{
+    thread_local ThreadData* tpData = nullptr;
+    if (tpData == nullptr)
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        unique_ptr<ThreadData> data(new ThreadData());
+        data->mThreadIndex = (int)mThreads.size();
+        data->mThreadName = "thread " + to_string(data->mThreadIndex);
+        tpData = data.get();
+        mThreads.push_back(std::move(data));
+    }
+    return tpData;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the id of iName, it is added if needed. This is meant to be called
+// once per call site, see PROFILE_SCOPE.
+//
+Profiler::Id Profiler::intern(const std::string& iName)
+{
+    assert(iName.find('/') == string::npos);
+
+    std::lock_guard<std::mutex> lk(mMutex);
+    auto it = mIds.find(iName);
+    if (it != mIds.end())
+    { return it->second; }
+
+    const Id id = (Id)mNames.size();
+    mNames.push_back(iName);
+    mIds[iName] = id;
+    return id;
+}
+
+//-----------------------------------------------------------------------------
+int64_t Profiler::nowInNs() const
+{
+    return CycleCounter::toNanoseconds(CycleCounter::now());
+}
+
+//-----------------------------------------------------------------------------
+// Starting a capture drops the events of the previous one.
+//
+void Profiler::setCapturing(bool iCapturing)
+{
+    if (iCapturing && !isCapturing())
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        for (auto &t : mThreads)
+        {
+            std::lock_guard<std::mutex> threadLock(t->mMutex);
+            t->mEvents.clear();
+            t->mNumberOfDroppedEvents = 0;
+        }
+    }
+    mIsCapturing.store(iCapturing);
+}
+
+//-----------------------------------------------------------------------------
+// Scopes entered while the profiler is disabled are not recorded.
+//
+void Profiler::setEnabled(bool iEnabled)
+{
+    mIsEnabled.store(iEnabled);
+}
+
+//-----------------------------------------------------------------------------
+// Names the calling thread in the Chrome trace.
+//
+void Profiler::setThreadName(const std::string& iName)
+{
+    ThreadData *data = getThreadData();
+    std::lock_guard<std::mutex> lk(data->mMutex);
+    data->mThreadName = iName;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the captured events in the Trace Event Format (json), as complete
+// events ("ph":"X") with timestamps in microseconds.
+//
+std::string Profiler::toChromeTraceJson() const
+{
+    ostringstream oss;
+    oss.precision(3);
+    oss << fixed;
+    oss << "{\"traceEvents\":[";
+
+    bool isFirst = true;
+    auto separator = [&]() -> const char* {
+        const char *r = isFirst ? "\n" : ",\n";
+        isFirst = false;
+        return r;
+    };
+
+    std::lock_guard<std::mutex> lk(mMutex);
+    for (auto &t : mThreads)
+    {
+        std::lock_guard<std::mutex> threadLock(t->mMutex);
+        oss << separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" <<
+            t->mThreadIndex << ",\"args\":{\"name\":" << toJsonString(t->mThreadName) << "}}";
+
+        for (auto &e : t->mEvents)
+        {
+            oss << separator() << "{\"name\":" << toJsonString(mNames[e.mId]) <<
+                ",\"ph\":\"X\",\"pid\":1,\"tid\":" << t->mThreadIndex <<
+                ",\"ts\":" << e.mStartInNs * 1e-3 <<
+                ",\"dur\":" << e.mDurationInNs * 1e-3 << "}";
+        }
+    }
+    oss << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return oss.str();
+}
+
+//-----------------------------------------------------------------------------
+//--- Profiler::ThreadData
+//-----------------------------------------------------------------------------
+Profiler::ThreadData::ThreadData() :
+    mMutex(),
+    mThreadIndex(0),
+    mThreadName(),
+    mNodes(),
+    mCurrentNodeIndex(0),
+    mStartTimesInNs(),
+    mEvents(),
+    mNumberOfDroppedEvents(0)
+{
+    Node root;
+    root.mId = -1;
+    root.mParentIndex = -1;
+    root.mFrameDurationInNs = 0;
+    root.mFrameCount = 0;
+    mNodes.push_back(root);
+}
+
+//-----------------------------------------------------------------------------
+//--- ProfileScope
+//-----------------------------------------------------------------------------
+ProfileScope::ProfileScope(Profiler::Id iId) :
+    mpThreadData(nullptr)
+{
+    Profiler &p = Profiler::getInstance();
+    if (p.isEnabled())
+    {
+        mpThreadData = p.getThreadData();
+        p.enterScope(mpThreadData, iId);
+    }
+}
+
+//-----------------------------------------------------------------------------
+ProfileScope::~ProfileScope()
+{
+    if (mpThreadData != nullptr)
+    {
+        Profiler::getInstance().exitScope(mpThreadData);
+    }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "Core/StatisticsTree.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define REALISIM_PROFILE_CONCAT_IMPL(a, b) a##b
+#define REALISIM_PROFILE_CONCAT(a, b) REALISIM_PROFILE_CONCAT_IMPL(a, b)
+
+// Profiles the enclosing scope under iName, which must not contain '/'. The
+// name is interned once per call site, the scope then only records two
+// timestamps. Define REALISIM_DISABLE_PROFILING to compile the scopes out.
+//
+#ifndef REALISIM_DISABLE_PROFILING
+#define PROFILE_SCOPE(iName) \
+    static const Realisim::Core::Profiler::Id REALISIM_PROFILE_CONCAT(_profileId, __LINE__) = \
+        Realisim::Core::Profiler::getInstance().intern(iName); \
+    Realisim::Core::ProfileScope REALISIM_PROFILE_CONCAT(_profileScope, __LINE__)(REALISIM_PROFILE_CONCAT(_profileId, __LINE__));
+#else
+#define PROFILE_SCOPE(iName)
+#endif
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // This is a hierarchical frame profiler implemented as a singleton.
+    //
+    // Usage:
+    //      void Engine::update()
+    //      {
+    //          PROFILE_SCOPE("update");
+    //          {
+    //              PROFILE_SCOPE("physics");
+    //              ...
+    //          }
+    //      }
+    //
+    //      // once per frame, from the main thread
+    //      Profiler::getInstance().endFrame(&mStatisticsTree);
+    //      // mStatisticsTree.getAverage("update/physics") is the average
+    //      // time per frame, in seconds.
+    //
+    // Scopes can be used from any thread. Each thread records into its own
+    // tree of nodes, keyed by the interned id of the scope names, so a scope
+    // does no string operation and never contends with other threads. The
+    // only lock taken is the one of the thread's own tree, which is contended
+    // only while endFrame() reads it.
+    //
+    // endFrame() adds, for each scope path entered during the frame, the time
+    // spent in it to the StatisticsTree. The times of all threads are summed:
+    // a scope run by 4 workers for 1 ms each counts for 4 ms.
+    //
+    // Chrome trace:
+    //      While capturing (setCapturing(true)), every scope is also recorded
+    //      as an event with its thread, start and duration. toChromeTraceJson()
+    //      returns them in the Trace Event Format, which can be loaded in
+    //      chrome://tracing or https://ui.perfetto.dev. A thread keeps at
+    //      most 1M events, the following ones are dropped.
+    //
+    // The per thread data is kept until the profiler is destroyed, it is
+    // meant for long lived threads (thread pools, workers...).
+    //
+    class Profiler
+    {
+    public:
+        typedef int Id;
+
+        static Profiler& getInstance();
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+        ~Profiler();
+
+        void clear();
+        void endFrame(StatisticsTree* opTree);
+        std::string getName(Id iId) const;
+        uint64_t getNumberOfDroppedEvents() const;
+        int getNumberOfEvents() const;
+        Id intern(const std::string& iName);
+        bool isCapturing() const { return mIsCapturing.load(std::memory_order_relaxed); }
+        bool isEnabled() const { return mIsEnabled.load(std::memory_order_relaxed); }
+        void setCapturing(bool iCapturing);
+        void setEnabled(bool iEnabled);
+        void setThreadName(const std::string& iName);
+        std::string toChromeTraceJson() const;
+
+    protected:
+        friend class ProfileScope;
+
+        Profiler();
+
+        struct Node
+        {
+            Id mId;
+            int mParentIndex;
+            std::string mKey; // path in the StatisticsTree
+            std::vector<int> mChildIndices;
+            int64_t mFrameDurationInNs;
+            int mFrameCount;
+        };
+
+        struct Event
+        {
+            Id mId;
+            int64_t mStartInNs;
+            int64_t mDurationInNs;
+        };
+
+        struct ThreadData
+        {
+            ThreadData();
+            ThreadData(const ThreadData&) = delete;
+            ThreadData& operator=(const ThreadData&) = delete;
+
+            std::mutex mMutex;
+            int mThreadIndex;
+            std::string mThreadName;
+            std::vector<Node> mNodes; // [0] is the root
+            int mCurrentNodeIndex;
+            std::vector<int64_t> mStartTimesInNs; // stack of the open scopes
+            std::vector<Event> mEvents;
+            uint64_t mNumberOfDroppedEvents;
+        };
+
+        int addChild(ThreadData* ipData, Id iId, const std::string& iName);
+        void enterScope(ThreadData* ipData, Id iId);
+        void exitScope(ThreadData* ipData);
+        int findChild(const ThreadData* ipData, Id iId) const;
+        ThreadData* getThreadData();
+        int64_t nowInNs() const;
+
+        std::atomic<bool> mIsEnabled;
+        std::atomic<bool> mIsCapturing;
+        int64_t mEpochInNs;
+
+        // protects the names and the list of threads.
+        mutable std::mutex mMutex;
+        std::unordered_map<std::string, Id> mIds;
+        std::vector<std::string> mNames;
+        std::vector<std::unique_ptr<ThreadData>> mThreads;
+    };
+
+    //-------------------------------------------------------------------------
+    // Records the time spent between its construction and destruction. See
+    // PROFILE_SCOPE.
+    //
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(Profiler::Id iId);
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+        ~ProfileScope();
+
+    private:
+        Profiler::ThreadData* mpThreadData; // null when the profiler is disabled
+    };
+}
+}
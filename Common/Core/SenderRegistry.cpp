@@ -0,0 +1,205 @@
+
+#include <cassert>
+#include <cstdint>
+#include "Core/SenderRegistry.h"
+#include <thread>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    const int kDefaultNumberOfShards = 16;
+
+    // The reader side of a shard: the reader counter of the current version
+    // is held for the whole lookup, so writers know the table in use.
+    //
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(std::atomic<int>& iVersionIndex, std::atomic<int>* ipNumberOfReaders) :
+            mNumberOfReadersRef(ipNumberOfReaders[iVersionIndex.load()])
+        { mNumberOfReadersRef.fetch_add(1); }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ~ReadGuard()
+        { mNumberOfReadersRef.fetch_sub(1); }
+
+    private:
+        std::atomic<int>& mNumberOfReadersRef;
+    };
+
+    void waitForReaders(const std::atomic<int>& iNumberOfReaders)
+    {
+        while (iNumberOfReaders.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+SenderRegistry::SenderRegistry() :
+    SenderRegistry(kDefaultNumberOfShards)
+{}
+
+//------------------------------------------------------------------------------
+SenderRegistry::SenderRegistry(int iNumberOfShards) :
+    mShards(),
+    mShardMask(0)
+{
+    size_t n = 1;
+    while (n < (size_t)iNumberOfShards)
+    {
+        n <<= 1;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        mShards.push_back(unique_ptr<Shard>(new Shard()));
+    }
+    mShardMask = n - 1;
+}
+
+//------------------------------------------------------------------------------
+SenderRegistry::~SenderRegistry()
+{
+    for (auto &s : mShards)
+    {
+        delete s->mpTable.load();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Invokes the function registered for the sender of ipM. Returns false if the
+// sender is not registered.
+//
+bool SenderRegistry::call(MessageQueue::Message* ipM) const
+{
+    Shard &s = getShard(ipM->mpSender);
+    ReadGuard guard(s.mVersionIndex, s.mNumberOfReaders);
+
+    const Table *t = s.mpTable.load();
+    auto it = t->find(ipM->mpSender);
+    if (it == t->end())
+    { return false; }
+
+    it->second(ipM);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void SenderRegistry::clear()
+{
+    for (auto &s : mShards)
+    {
+        std::lock_guard<std::mutex> lk(s->mWriteMutex);
+        publish(*s, new Table());
+    }
+}
+
+//------------------------------------------------------------------------------
+// Returns a snapshot of the number of registered senders.
+//
+int SenderRegistry::getNumberOfSenders() const
+{
+    int r = 0;
+    for (auto &s : mShards)
+    {
+        ReadGuard guard(s->mVersionIndex, s->mNumberOfReaders);
+        r += (int)s->mpTable.load()->size();
+    }
+    return r;
+}
+
+//------------------------------------------------------------------------------
+int SenderRegistry::getNumberOfShards() const
+{
+    return (int)mShards.size();
+}
+
+//------------------------------------------------------------------------------
+// Senders are typically objects allocated on the heap, the low bits of their
+// address are always 0. The address is mixed (Fibonacci hashing) so that
+// they spread evenly among the shards.
+//
+SenderRegistry::Shard& SenderRegistry::getShard(void* ipSender) const
+{
+    const uint64_t h = (uint64_t)(uintptr_t)ipSender * 0x9E3779B97F4A7C15ull;
+    return *mShards[(size_t)(h >> 32) & mShardMask];
+}
+
+//------------------------------------------------------------------------------
+bool SenderRegistry::isRegistered(void* ipSender) const
+{
+    Shard &s = getShard(ipSender);
+    ReadGuard guard(s.mVersionIndex, s.mNumberOfReaders);
+    const Table *t = s.mpTable.load();
+    return t->find(ipSender) != t->end();
+}
+
+//------------------------------------------------------------------------------
+// Replaces the table of the shard by ipTable and deletes the previous one once
+// no reader can be using it. The write mutex of the shard must be held.
+//
+// Readers pick a reader counter (the version) and then load the table. The
+// version is toggled and both counters are drained in turn, the same way the
+// left-right algorithm does: a reader that loaded the previous table is
+// accounted in one of the two counters and is thus waited for.
+//
+void SenderRegistry::publish(Shard& iShard, const Table* ipTable)
+{
+    const Table *previous = iShard.mpTable.exchange(ipTable);
+
+    const int previousVersion = iShard.mVersionIndex.load();
+    const int nextVersion = 1 - previousVersion;
+    waitForReaders(iShard.mNumberOfReaders[nextVersion]);
+    iShard.mVersionIndex.store(nextVersion);
+    waitForReaders(iShard.mNumberOfReaders[previousVersion]);
+
+    delete previous;
+}
+
+//------------------------------------------------------------------------------
+// Registers (or replaces) the function processing the messages of ipSender.
+//
+void SenderRegistry::registerSender(void* ipSender, const Function& iFunction)
+{
+    Shard &s = getShard(ipSender);
+    std::lock_guard<std::mutex> lk(s.mWriteMutex);
+
+    Table *t = new Table(*s.mpTable.load());
+    (*t)[ipSender] = iFunction;
+    publish(s, t);
+}
+
+//------------------------------------------------------------------------------
+// Once this returns, the function of ipSender is not running and will not be
+// invoked anymore.
+//
+void SenderRegistry::unregisterSender(void* ipSender)
+{
+    Shard &s = getShard(ipSender);
+    std::lock_guard<std::mutex> lk(s.mWriteMutex);
+
+    const Table *current = s.mpTable.load();
+    if (current->find(ipSender) == current->end())
+    { return; }
+
+    Table *t = new Table(*current);
+    t->erase(ipSender);
+    publish(s, t);
+}
+
+//------------------------------------------------------------------------------
+//--- SenderRegistry::Shard
+//------------------------------------------------------------------------------
+SenderRegistry::Shard::Shard() :
+    mpTable(new Table()),
+    mVersionIndex(0),
+    mWriteMutex()
+{
+    mNumberOfReaders[0].store(0);
+    mNumberOfReaders[1].store(0);
+}
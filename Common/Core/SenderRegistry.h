@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include "Core/MessageQueue.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // This class maps a sender (see MessageQueue::Message::mpSender) to the
+    // function that must process its messages. It is the dispatch table of
+    // MultiClientsMessageQueue and MultiClientsMultiMessageQueues.
+    //
+    // It is optimized for lookups, which happen for every processed message,
+    // while senders can register and unregister at any time from any thread.
+    //
+    // The senders are spread among shards by hashing their address. Each
+    // shard holds an immutable hash table:
+    //      - call() looks up the current table of the shard without any lock.
+    //        It only increments and decrements a reader counter, thus never
+    //        waits on a writer (wait-free).
+    //      - registerSender() and unregisterSender() copy the table of the
+    //        shard, modify the copy and publish it. The old table is deleted
+    //        once all readers that could still be using it are done
+    //        (left-right grace period). Writers of different shards do not
+    //        block each other.
+    //
+    // The function is invoked while the shard is being read. This means that
+    // once unregisterSender() returns, the function of that sender is not
+    // running and will never be invoked again. It also means that a
+    // registered function must not register or unregister senders itself,
+    // since the writer would wait for its own read to end.
+    //
+    class SenderRegistry
+    {
+    public:
+        typedef std::function<void(MessageQueue::Message*)> Function;
+
+        SenderRegistry();
+        explicit SenderRegistry(int iNumberOfShards);
+        SenderRegistry(const SenderRegistry&) = delete;
+        SenderRegistry& operator=(const SenderRegistry&) = delete;
+        ~SenderRegistry();
+
+        bool call(MessageQueue::Message* ipM) const;
+        void clear();
+        int getNumberOfSenders() const;
+        int getNumberOfShards() const;
+        bool isRegistered(void* ipSender) const;
+        void registerSender(void* ipSender, const Function& iFunction);
+        void unregisterSender(void* ipSender);
+
+    protected:
+        typedef std::unordered_map<void*, Function> Table;
+
+        struct Shard
+        {
+            Shard();
+
+            std::atomic<const Table*> mpTable;
+            std::atomic<int> mVersionIndex;
+            std::atomic<int> mNumberOfReaders[2];
+            std::mutex mWriteMutex;
+        };
+
+        Shard& getShard(void* ipSender) const;
+        void publish(Shard& iShard, const Table* ipTable);
+
+        std::vector<std::unique_ptr<Shard>> mShards;
+        size_t mShardMask;
+    };
+}
+}
@@ -8,6 +8,19 @@ using namespace Realisim;
 using namespace Core;
 using namespace std;
 
+namespace
+{
+  //précision relative des quantiles estimés par l'histogramme.
+  const double kRelativeAccuracy = 0.01;
+  const double kGamma = (1.0 + kRelativeAccuracy) / (1.0 - kRelativeAccuracy);
+  const double kLogGamma = log(kGamma);
+  const int kMaximumNumberOfBins = 2048;
+
+  //quantiles rapportés par toCsv().
+  const double kCsvQuantiles[] = {0.5, 0.9, 0.95, 0.99, 0.999};
+  const char* kCsvQuantileNames[] = {"p50", "p90", "p95", "p99", "p99.9"};
+}
+
 Statistics::Statistics() :
   mKeepSamples(false),
   mSamples(),
@@ -15,7 +28,10 @@ Statistics::Statistics() :
   mSum(0.0),
   mSumSquared(0.0),
   mMin(std::numeric_limits<double>::max()),
-  mMax(-std::numeric_limits<double>::max())
+  mMax(-std::numeric_limits<double>::max()),
+  mPositiveBins(),
+  mNegativeBins(),
+  mNumberOfZeros(0)
 {}
 
 //-------------------------------------------------------------------------
@@ -33,6 +49,16 @@ void Statistics::add(double iSample)
   mSumSquared += iSample * iSample;
   mMin = std::min(mMin, iSample);
   mMax = std::max(mMax, iSample);
+
+  //les valeurs trop petites pour être indexées (et NaN) comptent pour 0.
+  const double absoluteValue = std::min(std::abs(iSample), std::numeric_limits<double>::max());
+  if(absoluteValue >= std::numeric_limits<double>::min())
+  {
+    Bins &bins = iSample > 0.0 ? mPositiveBins : mNegativeBins;
+    bins.add(binIndex(absoluteValue), 1);
+  }
+  else
+  { ++mNumberOfZeros; }
 }
 
 //-------------------------------------------------------------------------
@@ -55,6 +81,33 @@ double Statistics::average() const
     return mSum / max((double)numberOfSamples(), 1.0);
 }
 
+//-------------------------------------------------------------------------
+//La classe iIndex contient les valeurs absolues dans
+//]kGamma^(iIndex-1), kGamma^iIndex].
+int Statistics::binIndex(double iAbsoluteValue)
+{
+  return (int)ceil(log(iAbsoluteValue) / kLogGamma);
+}
+
+//-------------------------------------------------------------------------
+double Statistics::binLowerBound(int iIndex)
+{
+  return exp((iIndex - 1) * kLogGamma);
+}
+
+//-------------------------------------------------------------------------
+double Statistics::binUpperBound(int iIndex)
+{
+  return exp(iIndex * kLogGamma);
+}
+
+//-------------------------------------------------------------------------
+//Valeur à moins de kRelativeAccuracy de toute valeur de la classe.
+double Statistics::binValue(int iIndex)
+{
+  return 2.0 * binUpperBound(iIndex) / (kGamma + 1.0);
+}
+
 //-------------------------------------------------------------------------
 void Statistics::clear()
 {
@@ -64,6 +117,109 @@ void Statistics::clear()
   mSumSquared = 0.0;
   mMin = std::numeric_limits<double>::max();
   mMax = -std::numeric_limits<double>::max();
+  mPositiveBins = Bins();
+  mNegativeBins = Bins();
+  mNumberOfZeros = 0;
+}
+
+//-------------------------------------------------------------------------
+double Statistics::exactQuantile(double iQ) const
+{
+  vector<double> samples(mSamples);
+  const size_t rank = (size_t)(iQ * (samples.size() - 1));
+  nth_element(samples.begin(), samples.begin() + rank, samples.end());
+  return samples[rank];
+}
+
+//-------------------------------------------------------------------------
+//Retourne les classes non vides de l'histogramme, en ordre croissant de
+//valeurs. Les échantillons nuls sont dans une classe [0, 0].
+std::vector<Statistics::HistogramBin> Statistics::histogram() const
+{
+  vector<HistogramBin> r;
+  for(int i = (int)mNegativeBins.mCounts.size() - 1; i >= 0; --i)
+  {
+    if(mNegativeBins.mCounts[i] == 0) continue;
+    const int index = mNegativeBins.mFirstIndex + i;
+    r.push_back({-binUpperBound(index), -binLowerBound(index), mNegativeBins.mCounts[i]});
+  }
+
+  if(mNumberOfZeros > 0)
+  { r.push_back({0.0, 0.0, mNumberOfZeros}); }
+
+  for(size_t i = 0; i < mPositiveBins.mCounts.size(); ++i)
+  {
+    if(mPositiveBins.mCounts[i] == 0) continue;
+    const int index = mPositiveBins.mFirstIndex + (int)i;
+    r.push_back({binLowerBound(index), binUpperBound(index), mPositiveBins.mCounts[i]});
+  }
+  return r;
+}
+
+//-------------------------------------------------------------------------
+//Ajoute les échantillons de iStats. Les échantillons conservés par iStats
+//sont ajoutés si this conserve ses échantillons.
+void Statistics::merge(const Statistics& iStats)
+{
+  if(isKeepingSamples())
+  { mSamples.insert(mSamples.end(), iStats.mSamples.begin(), iStats.mSamples.end()); }
+
+  mNumberOfSamples += iStats.mNumberOfSamples;
+  mSum += iStats.mSum;
+  mSumSquared += iStats.mSumSquared;
+  mMin = std::min(mMin, iStats.mMin);
+  mMax = std::max(mMax, iStats.mMax);
+  mPositiveBins.merge(iStats.mPositiveBins);
+  mNegativeBins.merge(iStats.mNegativeBins);
+  mNumberOfZeros += iStats.mNumberOfZeros;
+}
+
+//-------------------------------------------------------------------------
+//Retourne la valeur sous laquelle se trouve la fraction iQ (entre 0 et 1)
+//des échantillons, ex: quantile(0.99) est le 99e centile. Le résultat est
+//exact si tous les échantillons sont conservés, sinon il est estimé par
+//l'histogramme.
+double Statistics::quantile(double iQ) const
+{
+  if(numberOfSamples() == 0)
+  { return 0.0; }
+
+  iQ = std::max(0.0, std::min(iQ, 1.0));
+  if(isKeepingSamples() && mSamples.size() == numberOfSamples())
+  { return exactQuantile(iQ); }
+
+  uint64_t total = mNumberOfZeros;
+  for(auto c : mNegativeBins.mCounts) { total += c; }
+  for(auto c : mPositiveBins.mCounts) { total += c; }
+  const uint64_t rank = (uint64_t)(iQ * (total - 1));
+  if(rank == 0)
+  { return minimum(); }
+  if(rank == total - 1)
+  { return maximum(); }
+
+  //les classes sont parcourues en ordre croissant de valeurs.
+  double r = 0.0;
+  uint64_t cumulative = 0;
+  bool found = false;
+  for(int i = (int)mNegativeBins.mCounts.size() - 1; i >= 0 && !found; --i)
+  {
+    cumulative += mNegativeBins.mCounts[i];
+    if(cumulative > rank)
+    { r = -binValue(mNegativeBins.mFirstIndex + i); found = true; }
+  }
+
+  cumulative += mNumberOfZeros;
+  if(!found && cumulative > rank)
+  { r = 0.0; found = true; }
+
+  for(size_t i = 0; i < mPositiveBins.mCounts.size() && !found; ++i)
+  {
+    cumulative += mPositiveBins.mCounts[i];
+    if(cumulative > rank)
+    { r = binValue(mPositiveBins.mFirstIndex + (int)i); found = true; }
+  }
+
+  return std::max(mMin, std::min(r, mMax));
 }
 
 //-------------------------------------------------------------------------
@@ -96,10 +252,86 @@ std::string Statistics::toCsv() const
 
 	//summary
 	oss << "\n\n";
-	oss << ",Number of samples,average,minimum,maximum,standard deviation\n";
+	oss << ",Number of samples,average,minimum,maximum,standard deviation";
+	for (auto name : kCsvQuantileNames)
+	{
+		oss << "," << name;
+	}
+	oss << "\n";
 	oss << "," << numberOfSamples() << "," << average() << "," << minimum() << "," << maximum() << "," << standardDeviation();
+	for (auto q : kCsvQuantiles)
+	{
+		oss << "," << quantile(q);
+	}
 
+	//histogram
+	oss << "\n\n";
+	oss << "Histogram\n";
+	oss << ",lower bound,upper bound,count";
+	for (auto &bin : histogram())
+	{
+		oss << "\n," << bin.mLowerBound << "," << bin.mUpperBound << "," << bin.mCount;
+	}
 
 	return oss.str();
 }
 
+//-------------------------------------------------------------------------
+//--- Statistics::Bins
+//-------------------------------------------------------------------------
+Statistics::Bins::Bins() :
+  mFirstIndex(0),
+  mCounts()
+{}
+
+//-------------------------------------------------------------------------
+//Au plus kMaximumNumberOfBins classes sont conservées, les classes des plus
+//petites valeurs sont fusionnées au besoin.
+void Statistics::Bins::add(int iIndex, uint64_t iCount)
+{
+  if(mCounts.empty())
+  {
+    mFirstIndex = iIndex;
+    mCounts.assign(1, iCount);
+    return;
+  }
+
+  const int lastIndex = mFirstIndex + (int)mCounts.size() - 1;
+  if(iIndex > lastIndex)
+  {
+    mCounts.resize(mCounts.size() + (iIndex - lastIndex), 0);
+    const int excess = (int)mCounts.size() - kMaximumNumberOfBins;
+    if(excess > 0)
+    {
+      uint64_t collapsed = 0;
+      for(int i = 0; i <= excess; ++i)
+      { collapsed += mCounts[i]; }
+      mCounts.erase(mCounts.begin(), mCounts.begin() + excess);
+      mCounts[0] = collapsed;
+      mFirstIndex += excess;
+    }
+  }
+  else if(iIndex < mFirstIndex)
+  {
+    const int lowestIndex = std::max(iIndex, lastIndex - kMaximumNumberOfBins + 1);
+    if(lowestIndex < mFirstIndex)
+    {
+      mCounts.insert(mCounts.begin(), mFirstIndex - lowestIndex, 0);
+      mFirstIndex = lowestIndex;
+    }
+    iIndex = std::max(iIndex, mFirstIndex);
+  }
+
+  mCounts[iIndex - mFirstIndex] += iCount;
+}
+
+//-------------------------------------------------------------------------
+void Statistics::Bins::merge(const Bins& iBins)
+{
+  for(size_t i = 0; i < iBins.mCounts.size(); ++i)
+  {
+    if(iBins.mCounts[i] > 0)
+    { add(iBins.mFirstIndex + (int)i, iBins.mCounts[i]); }
+  }
+}
+
@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -22,10 +23,31 @@ namespace Core
   // mean
   // nombre d'échantillons
   // écart type
-  // 
+  // quantiles (médiane, p95, p99...)
+  //
+  //Les quantiles sont estimés en mémoire bornée, sans conserver les
+  //échantillons. Chaque échantillon est compté dans un histogramme dont
+  //les bornes des classes croissent géométriquement (voir DDSketch). La
+  //valeur retournée par quantile() est à moins de 1% (relatif) de la
+  //valeur réelle. L'histogramme a au plus 2048 classes par signe, ce qui
+  //couvre des valeurs de 1e-9 à 1e9 sans perte de précision; au-delà, les
+  //classes des plus petites valeurs sont fusionnées. Lorsque les
+  //échantillons sont conservés, quantile() est exact.
+  //
+  //Deux Statistics peuvent être fusionnées (merge()), par exemple pour
+  //combiner les statistiques de plusieurs threads, ou des copies
+  //(instantanés) prises à intervalle régulier lors d'un long rendu.
+  //
   class Statistics
   {
   public:
+    struct HistogramBin
+    {
+      double mLowerBound;
+      double mUpperBound;
+      uint64_t mCount;
+    };
+
     Statistics();
     Statistics(const Statistics&) = default;
     Statistics& operator=(const Statistics&) = default;
@@ -36,16 +58,37 @@ namespace Core
     void add(const double*, unsigned int);
     double average() const;
     void clear();
+    std::vector<HistogramBin> histogram() const;
     bool isKeepingSamples() const {return mKeepSamples;}
     void keepSamples(bool iK) {mKeepSamples = iK;}
     double maximum() const {return mMax;}
+    void merge(const Statistics&);
     double minimum() const {return mMin;}
     unsigned int numberOfSamples() const {return mNumberOfSamples;}
+    double quantile(double) const;
     double sample(unsigned int) const;
     double standardDeviation() const;
 	std::string toCsv() const;
     
   protected:
+    //Classes de l'histogramme pour un signe, indexées par binIndex().
+    struct Bins
+    {
+      Bins();
+
+      void add(int iIndex, uint64_t iCount);
+      void merge(const Bins&);
+
+      int mFirstIndex;
+      std::vector<uint64_t> mCounts;
+    };
+
+    static int binIndex(double iAbsoluteValue);
+    static double binLowerBound(int iIndex);
+    static double binUpperBound(int iIndex);
+    static double binValue(int iIndex);
+    double exactQuantile(double) const;
+
     bool mKeepSamples;
     std::vector<double> mSamples;
     unsigned int mNumberOfSamples;
@@ -53,6 +96,9 @@ namespace Core
     double mSumSquared;
     double mMin;
     double mMax;
+    Bins mPositiveBins;
+    Bins mNegativeBins; //indexées par la valeur absolue.
+    uint64_t mNumberOfZeros;
   };
 
 } // end of namespace utils
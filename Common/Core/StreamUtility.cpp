@@ -1,7 +1,18 @@
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include "StreamUtility.h"
 #include <fstream>
 
+#if defined(__SSSE3__) || defined(__AVX__)
+    #define REALISIM_STREAM_UTILITY_USES_SSSE3
+    #include <tmmintrin.h>
+#elif defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define REALISIM_STREAM_UTILITY_USES_SSE2
+    #include <emmintrin.h>
+#endif
+
 using namespace std;
 using namespace Realisim;
 using namespace Core;
@@ -9,6 +20,80 @@ using namespace Core;
 namespace
 {
     const StreamUtility::endianness __localByteOrder = StreamUtility::eLittleEndian; //Windows machine are little endian...
+
+    // size of the buffer used to swap arrays before writing them, a multiple
+    // of 8.
+    const size_t kSwapBufferSize = 16384;
+
+    //-------------------------------------------------------------------------
+    // Swaps the bytes of the values contained in the largest multiple of 16
+    // bytes of iopData and returns the number of bytes processed. The
+    // remaining values are left to the scalar path.
+    //
+    template<int kSizeOfValue>
+    size_t swapBytesSimd(char *iopData, size_t iNumberOfBytes)
+    {
+        size_t i = 0;
+#if defined(REALISIM_STREAM_UTILITY_USES_SSSE3)
+        // a single pshufb reverses the bytes of every value of the register.
+        const __m128i mask = kSizeOfValue == 2 ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14) :
+            kSizeOfValue == 4 ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12) :
+            _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        for (; i + 16 <= iNumberOfBytes; i += 16)
+        {
+            __m128i *p = (__m128i*)(iopData + i);
+            _mm_storeu_si128(p, _mm_shuffle_epi8(_mm_loadu_si128(p), mask));
+        }
+#elif defined(REALISIM_STREAM_UTILITY_USES_SSE2)
+        for (; i + 16 <= iNumberOfBytes; i += 16)
+        {
+            __m128i *p = (__m128i*)(iopData + i);
+            __m128i v = _mm_loadu_si128(p);
+
+            // swap the bytes of each 16 bits word, then the words of each value.
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            if (kSizeOfValue == 4)
+            { v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1)); }
+            if (kSizeOfValue == 8)
+            { v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3)); }
+            _mm_storeu_si128(p, v);
+        }
+#else
+        (void)iopData;
+        (void)iNumberOfBytes;
+#endif
+        return i;
+    }
+
+    //-------------------------------------------------------------------------
+    // Compilers turn these into a single bswap (or rev) instruction.
+    //
+    inline uint16_t byteSwap(uint16_t iV)
+    { return (uint16_t)((iV << 8) | (iV >> 8)); }
+
+    inline uint32_t byteSwap(uint32_t iV)
+    {
+        return (iV >> 24) | ((iV >> 8) & 0x0000FF00u) |
+            ((iV << 8) & 0x00FF0000u) | (iV << 24);
+    }
+
+    inline uint64_t byteSwap(uint64_t iV)
+    { return ((uint64_t)byteSwap((uint32_t)iV) << 32) | byteSwap((uint32_t)(iV >> 32)); }
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    void swapBytesArray(void *iopV, size_t iNumberOfValues)
+    {
+        char *pData = (char*)iopV;
+        const size_t numberOfBytes = iNumberOfValues * sizeof(T);
+        for (size_t i = swapBytesSimd<sizeof(T)>(pData, numberOfBytes); i < numberOfBytes; i += sizeof(T))
+        {
+            T v;
+            memcpy(&v, pData + i, sizeof(T));
+            v = byteSwap(v);
+            memcpy(pData + i, &v, sizeof(T));
+        }
+    }
 }
 
 //-------------------------------------------------------------------------
@@ -23,6 +108,19 @@ bool StreamUtility::needsSwapping() const
     return __localByteOrder != getStreamFormat();
 }
 
+//-------------------------------------------------------------------------
+// Reads all the values with a single read, then swaps their bytes in place
+// if needed.
+//
+bool StreamUtility::readArray(std::istream& iStream, size_t iNumberOfValues, size_t iSizeOfValue, void *oV)
+{
+    iStream.read((char*)oV, iNumberOfValues * iSizeOfValue);
+
+    if (needsSwapping()) { swapBytesArray(oV, iNumberOfValues, iSizeOfValue); }
+
+    return iStream.good();
+}
+
 //-------------------------------------------------------------------------
 // read iNumberOfBytesToRead into oV.
 // oV must be preallocated at the correct size.
@@ -66,6 +164,12 @@ bool StreamUtility::readDouble(std::istream& iStream, double *oV)
     return iStream.good();
 }
 
+//-------------------------------------------------------------------------
+bool StreamUtility::readDoubleArray(std::istream& iStream, size_t iNumberOfValues, double *oV)
+{
+    return readArray(iStream, iNumberOfValues, sizeof(double), oV);
+}
+
 //-------------------------------------------------------------------------
 bool StreamUtility::readFloat32(std::istream& iStream, float *oV)
 {
@@ -76,6 +180,12 @@ bool StreamUtility::readFloat32(std::istream& iStream, float *oV)
     return iStream.good();
 }
 
+//-------------------------------------------------------------------------
+bool StreamUtility::readFloat32Array(std::istream& iStream, size_t iNumberOfValues, float *oV)
+{
+    return readArray(iStream, iNumberOfValues, sizeof(float), oV);
+}
+
 //-------------------------------------------------------------------------
 bool StreamUtility::readInt8(istream& iStream, int8_t *oV)
 {
@@ -93,6 +203,12 @@ bool StreamUtility::readInt16(istream& iStream, int16_t *oV)
     return iStream.good();
 }
 
+//-------------------------------------------------------------------------
+bool StreamUtility::readInt16Array(std::istream& iStream, size_t iNumberOfValues, int16_t *oV)
+{
+    return readArray(iStream, iNumberOfValues, sizeof(int16_t), oV);
+}
+
 //-------------------------------------------------------------------------
 bool StreamUtility::readInt32(std::istream& iStream, int32_t *oV)
 {
@@ -103,6 +219,12 @@ bool StreamUtility::readInt32(std::istream& iStream, int32_t *oV)
     return iStream.good();
 }
 
+//-------------------------------------------------------------------------
+bool StreamUtility::readInt32Array(std::istream& iStream, size_t iNumberOfValues, int32_t *oV)
+{
+    return readArray(iStream, iNumberOfValues, sizeof(int32_t), oV);
+}
+
 //-------------------------------------------------------------------------
 bool StreamUtility::readInt64(std::istream& iStream, int64_t *oV)
 {
@@ -113,6 +235,12 @@ bool StreamUtility::readInt64(std::istream& iStream, int64_t *oV)
     return iStream.good();
 }
 
+//-------------------------------------------------------------------------
+bool StreamUtility::readInt64Array(std::istream& iStream, size_t iNumberOfValues, int64_t *oV)
+{
+    return readArray(iStream, iNumberOfValues, sizeof(int64_t), oV);
+}
+
 //-------------------------------------------------------------------------
 bool StreamUtility::readUint8(std::istream& iStream, uint8_t *oV)
 {
@@ -130,6 +258,12 @@ bool StreamUtility::readUint16(istream& iStream, uint16_t *oV)
     return iStream.good();
 }
 
+//-------------------------------------------------------------------------
+bool StreamUtility::readUint16Array(std::istream& iStream, size_t iNumberOfValues, uint16_t *oV)
+{
+    return readArray(iStream, iNumberOfValues, sizeof(uint16_t), oV);
+}
+
 //-------------------------------------------------------------------------
 bool StreamUtility::readUint32(istream& iStream, uint32_t *oV)
 {
@@ -140,6 +274,12 @@ bool StreamUtility::readUint32(istream& iStream, uint32_t *oV)
     return iStream.good();
 }
 
+//-------------------------------------------------------------------------
+bool StreamUtility::readUint32Array(std::istream& iStream, size_t iNumberOfValues, uint32_t *oV)
+{
+    return readArray(iStream, iNumberOfValues, sizeof(uint32_t), oV);
+}
+
 //-------------------------------------------------------------------------
 bool StreamUtility::readUint64(istream& iStream, uint64_t *oV)
 {
@@ -150,6 +290,12 @@ bool StreamUtility::readUint64(istream& iStream, uint64_t *oV)
     return iStream.good();
 }
 
+//-------------------------------------------------------------------------
+bool StreamUtility::readUint64Array(std::istream& iStream, size_t iNumberOfValues, uint64_t *oV)
+{
+    return readArray(iStream, iNumberOfValues, sizeof(uint64_t), oV);
+}
+
 //-------------------------------------------------------------------------
 void StreamUtility::setStreamFormat(endianness iV)
 { mStreamFormat = iV; }
@@ -164,6 +310,15 @@ void StreamUtility::swapBytes2(void* iV)
     memcpy(iV, out, 2);
 }
 
+//-------------------------------------------------------------------------
+// Swaps the bytes of each of the iNumberOfValues values of 2 bytes pointed
+// by iopV, 16 bytes at a time with SIMD instructions.
+//
+void StreamUtility::swapBytes2Array(void* iopV, size_t iNumberOfValues)
+{
+    ::swapBytesArray<uint16_t>(iopV, iNumberOfValues);
+}
+
 //-------------------------------------------------------------------------
 void StreamUtility::swapBytes4(void* iV)
 { 
@@ -176,6 +331,14 @@ void StreamUtility::swapBytes4(void* iV)
     memcpy(iV, out, 4);
 }
 
+//-------------------------------------------------------------------------
+// see swapBytes2Array()
+//
+void StreamUtility::swapBytes4Array(void* iopV, size_t iNumberOfValues)
+{
+    ::swapBytesArray<uint32_t>(iopV, iNumberOfValues);
+}
+
 //-------------------------------------------------------------------------
 void StreamUtility::swapBytes8(void* iV)
 {
@@ -192,6 +355,29 @@ void StreamUtility::swapBytes8(void* iV)
     memcpy(iV, out, 8);
 }
 
+//-------------------------------------------------------------------------
+// see swapBytes2Array()
+//
+void StreamUtility::swapBytes8Array(void* iopV, size_t iNumberOfValues)
+{
+    ::swapBytesArray<uint64_t>(iopV, iNumberOfValues);
+}
+
+//-------------------------------------------------------------------------
+// Swaps values of iSizeOfValue bytes (1, 2, 4 or 8), see swapBytes2Array().
+//
+void StreamUtility::swapBytesArray(void* iopV, size_t iNumberOfValues, size_t iSizeOfValue)
+{
+    switch (iSizeOfValue)
+    {
+    case 1: break;
+    case 2: swapBytes2Array(iopV, iNumberOfValues); break;
+    case 4: swapBytes4Array(iopV, iNumberOfValues); break;
+    case 8: swapBytes8Array(iopV, iNumberOfValues); break;
+    default: assert(0); break;
+    }
+}
+
 //-------------------------------------------------------------------------
 void StreamUtility::write(std::ostream& iStream, ByteArray iV)
 {
@@ -281,6 +467,31 @@ void StreamUtility::writeBytes(std::ostream& iStream, const std::string& iData)
     iStream.write(iData.c_str(), iData.size());
 }
 
+//-------------------------------------------------------------------------
+// Writes the values with as few stream operations as possible. When the bytes
+// must be swapped, the values are swapped in a buffer, one chunk at a time,
+// ipV is left untouched.
+//
+void StreamUtility::writeArray(std::ostream& iStream, size_t iNumberOfValues, size_t iSizeOfValue, const void *ipV)
+{
+    const char *pData = (const char*)ipV;
+    const size_t numberOfBytes = iNumberOfValues * iSizeOfValue;
+    if (!needsSwapping())
+    {
+        iStream.write(pData, numberOfBytes);
+        return;
+    }
+
+    char buffer[kSwapBufferSize];
+    for (size_t offset = 0; offset < numberOfBytes; offset += kSwapBufferSize)
+    {
+        const size_t chunkSize = min(kSwapBufferSize, numberOfBytes - offset);
+        memcpy(buffer, pData + offset, chunkSize);
+        swapBytesArray(buffer, chunkSize / iSizeOfValue, iSizeOfValue);
+        iStream.write(buffer, chunkSize);
+    }
+}
+
 //-------------------------------------------------------------------------
 // This method will write iData as if it was a null terminated string.
 //
@@ -290,6 +501,118 @@ void StreamUtility::writeChar(std::ostream& iStream, const std::string& iData)
     iStream.write(iData.c_str(), iData.size()+1);
 }
 
+//-------------------------------------------------------------------------
+void StreamUtility::writeDoubleArray(std::ostream& iStream, size_t iNumberOfValues, const double *ipV)
+{
+    writeArray(iStream, iNumberOfValues, sizeof(double), ipV);
+}
+
+//-------------------------------------------------------------------------
+void StreamUtility::writeFloat32Array(std::ostream& iStream, size_t iNumberOfValues, const float *ipV)
+{
+    writeArray(iStream, iNumberOfValues, sizeof(float), ipV);
+}
+
+//-------------------------------------------------------------------------
+void StreamUtility::writeInt16Array(std::ostream& iStream, size_t iNumberOfValues, const int16_t *ipV)
+{
+    writeArray(iStream, iNumberOfValues, sizeof(int16_t), ipV);
+}
+
+//-------------------------------------------------------------------------
+void StreamUtility::writeInt32Array(std::ostream& iStream, size_t iNumberOfValues, const int32_t *ipV)
+{
+    writeArray(iStream, iNumberOfValues, sizeof(int32_t), ipV);
+}
+
+//-------------------------------------------------------------------------
+void StreamUtility::writeInt64Array(std::ostream& iStream, size_t iNumberOfValues, const int64_t *ipV)
+{
+    writeArray(iStream, iNumberOfValues, sizeof(int64_t), ipV);
+}
+
+//-------------------------------------------------------------------------
+void StreamUtility::writeUint16Array(std::ostream& iStream, size_t iNumberOfValues, const uint16_t *ipV)
+{
+    writeArray(iStream, iNumberOfValues, sizeof(uint16_t), ipV);
+}
+
+//-------------------------------------------------------------------------
+void StreamUtility::writeUint32Array(std::ostream& iStream, size_t iNumberOfValues, const uint32_t *ipV)
+{
+    writeArray(iStream, iNumberOfValues, sizeof(uint32_t), ipV);
+}
+
+//-------------------------------------------------------------------------
+void StreamUtility::writeUint64Array(std::ostream& iStream, size_t iNumberOfValues, const uint64_t *ipV)
+{
+    writeArray(iStream, iNumberOfValues, sizeof(uint64_t), ipV);
+}
+
+//-------------------------------------------------------------------------
+//--- ByteArrayCursor
+//-------------------------------------------------------------------------
+ByteArrayCursor::ByteArrayCursor(const ByteArray& iData, StreamUtility::endianness iStreamFormat /*= StreamUtility::eLittleEndian*/) :
+    mData(iData),
+    mPosition(0),
+    mStreamFormat(iStreamFormat)
+{}
+
+//-------------------------------------------------------------------------
+// Returns in oV a view on the next iNumberOfBytes bytes, no copy is made
+// (see ByteArray::mid()).
+//
+bool ByteArrayCursor::readByteArray(size_t iNumberOfBytes, ByteArray *oV)
+{
+    if (iNumberOfBytes > getNumberOfRemainingBytes()) { return false; }
+
+    *oV = mData.mid(mPosition, (int64_t)iNumberOfBytes);
+    mPosition += iNumberOfBytes;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool ByteArrayCursor::readBytes(size_t iNumberOfBytes, char *oV)
+{
+    if (iNumberOfBytes > getNumberOfRemainingBytes()) { return false; }
+
+    memcpy(oV, mData.constData() + mPosition, iNumberOfBytes);
+    mPosition += iNumberOfBytes;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool ByteArrayCursor::readValues(size_t iNumberOfValues, size_t iSizeOfValue, void *oV)
+{
+    if (iNumberOfValues > getNumberOfRemainingBytes() / iSizeOfValue) { return false; }
+
+    readBytes(iNumberOfValues * iSizeOfValue, (char*)oV);
+    if (mStreamFormat != StreamUtility::getLocalMachineByteOrder())
+    { StreamUtility::swapBytesArray(oV, iNumberOfValues, iSizeOfValue); }
+    return true;
+}
+
+//-------------------------------------------------------------------------
+// Moves the cursor at iPosition bytes from the beginning, the end of the data
+// is a valid position.
+//
+bool ByteArrayCursor::seek(size_t iPosition)
+{
+    if (iPosition > mData.size()) { return false; }
+
+    mPosition = iPosition;
+    return true;
+}
+
+//-------------------------------------------------------------------------
+bool ByteArrayCursor::skip(size_t iNumberOfBytes)
+{
+    if (iNumberOfBytes > getNumberOfRemainingBytes()) { return false; }
+
+    mPosition += iNumberOfBytes;
+    return true;
+}
+
 //-------------------------------------------------------------------------
 // utility function
 //-------------------------------------------------------------------------
@@ -303,8 +626,17 @@ namespace Realisim
             return istringstream(iBa.constString(), stringstream::binary);
         }
 
-        ByteArray readFromFile(const std::string& iFilenamePath)
+        // When iMapInMemory is true, the file is memory mapped instead of
+        // being read, see ByteArray::fromMappedFile(). Pages of the file are
+        // then only read when accessed.
+        //
+        ByteArray readFromFile(const std::string& iFilenamePath, bool iMapInMemory /*= false*/)
         {
+            if (iMapInMemory)
+            {
+                return ByteArray::fromMappedFile(iFilenamePath);
+            }
+
             ByteArray r;
             ifstream ifs;
             ifs.open(iFilenamePath, ios::in | ios::binary);
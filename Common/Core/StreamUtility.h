@@ -7,11 +7,21 @@
 #include <sstream>
 #include <stdint.h>
 #include <string>
+#include <type_traits>
 
 namespace Realisim
 {
 namespace Core
 {
+    //-------------------------------------------------------------------------
+    // Reads and writes values in little or big endian, see setStreamFormat().
+    //
+    // The array methods (readUint16Array(), writeFloat32Array(), ...) read or
+    // write all values with a single stream operation and swap the bytes of
+    // the whole array at once with SIMD instructions. They are much faster
+    // than reading the values one by one. See ByteArrayCursor to read
+    // directly from a ByteArray, without a stream.
+    //
     class StreamUtility
     {
     public:
@@ -28,17 +38,29 @@ namespace Core
         bool readBytes(std::istream& iStream, size_t iNumberOfBytesToRead, std::string *oV);
         bool readChar(std::istream& iStream, size_t iNumberOfCharToRead, std::string *oV);
         bool readDouble(std::istream& iStream, double *oV);
+        bool readDoubleArray(std::istream& iStream, size_t iNumberOfValues, double *oV);
         bool readFloat32(std::istream& iStream, float *oV);
+        bool readFloat32Array(std::istream& iStream, size_t iNumberOfValues, float *oV);
         bool readInt8(std::istream& iStream, int8_t *oV);
         bool readInt16(std::istream& iStream, int16_t *oV);
+        bool readInt16Array(std::istream& iStream, size_t iNumberOfValues, int16_t *oV);
         bool readInt32(std::istream& iStream, int32_t *oV);
+        bool readInt32Array(std::istream& iStream, size_t iNumberOfValues, int32_t *oV);
         bool readInt64(std::istream& iStream, int64_t *oV);
+        bool readInt64Array(std::istream& iStream, size_t iNumberOfValues, int64_t *oV);
         bool readUint8(std::istream& iStream, uint8_t *oV);
         bool readUint16(std::istream& iStream, uint16_t *oV);
+        bool readUint16Array(std::istream& iStream, size_t iNumberOfValues, uint16_t *oV);
         bool readUint32(std::istream& iStream, uint32_t *oV);
+        bool readUint32Array(std::istream& iStream, size_t iNumberOfValues, uint32_t *oV);
         bool readUint64(std::istream& iStream, uint64_t *oV);
+        bool readUint64Array(std::istream& iStream, size_t iNumberOfValues, uint64_t *oV);
 
         void setStreamFormat(endianness);
+        static void swapBytes2Array(void* iopV, size_t iNumberOfValues);
+        static void swapBytes4Array(void* iopV, size_t iNumberOfValues);
+        static void swapBytes8Array(void* iopV, size_t iNumberOfValues);
+        static void swapBytesArray(void* iopV, size_t iNumberOfValues, size_t iSizeOfValue);
 
         void write(std::ostream& iStream, ByteArray);
         void write(std::ostream& iStream, int8_t);
@@ -54,21 +76,83 @@ namespace Core
         void write(std::ostream& iStream, size_t iNumberOfBytesToWrite, const char *ipData);
         void writeBytes(std::ostream& iStream, const std::string& iData);
         void writeChar(std::ostream& iStream, const std::string& iData);
+        void writeDoubleArray(std::ostream& iStream, size_t iNumberOfValues, const double *ipV);
+        void writeFloat32Array(std::ostream& iStream, size_t iNumberOfValues, const float *ipV);
+        void writeInt16Array(std::ostream& iStream, size_t iNumberOfValues, const int16_t *ipV);
+        void writeInt32Array(std::ostream& iStream, size_t iNumberOfValues, const int32_t *ipV);
+        void writeInt64Array(std::ostream& iStream, size_t iNumberOfValues, const int64_t *ipV);
+        void writeUint16Array(std::ostream& iStream, size_t iNumberOfValues, const uint16_t *ipV);
+        void writeUint32Array(std::ostream& iStream, size_t iNumberOfValues, const uint32_t *ipV);
+        void writeUint64Array(std::ostream& iStream, size_t iNumberOfValues, const uint64_t *ipV);
         
     protected:
         bool needsSwapping() const;
+        bool readArray(std::istream& iStream, size_t iNumberOfValues, size_t iSizeOfValue, void *oV);
         void swapBytes2(void* iV);
         void swapBytes4(void* iV);
         void swapBytes8(void* iV);
+        void writeArray(std::ostream& iStream, size_t iNumberOfValues, size_t iSizeOfValue, const void *ipV);
         
         endianness mStreamFormat;
     };
 
+    //-------------------------------------------------------------------------
+    // Reads values from a ByteArray in little or big endian, like
+    // StreamUtility but without a stream: values are copied straight out of
+    // the ByteArray, which is shared and not copied.
+    //
+    // Usage:
+    //      ByteArrayCursor cursor(readFromFile(path, true), StreamUtility::eBigEndian);
+    //      uint32_t magic;
+    //      cursor.read(&magic);
+    //      vector<int16_t> samples(n);
+    //      cursor.readArray(n, samples.data());
+    //
+    // Reads fail, and do not move the cursor, when there are not enough
+    // bytes left.
+    //
+    class ByteArrayCursor
+    {
+    public:
+        explicit ByteArrayCursor(const ByteArray& iData, StreamUtility::endianness iStreamFormat = StreamUtility::eLittleEndian);
+        ByteArrayCursor(const ByteArrayCursor&) = default;
+        ByteArrayCursor& operator=(const ByteArrayCursor&) = default;
+        ~ByteArrayCursor() = default;
+
+        bool atEnd() const { return mPosition >= mData.size(); }
+        const ByteArray& getData() const { return mData; }
+        size_t getNumberOfRemainingBytes() const { return atEnd() ? 0 : mData.size() - mPosition; }
+        size_t getPosition() const { return mPosition; }
+        StreamUtility::endianness getStreamFormat() const { return mStreamFormat; }
+        template<typename T> bool read(T *oV) { return readArray(1, oV); }
+        template<typename T> bool readArray(size_t iNumberOfValues, T *oV);
+        bool readByteArray(size_t iNumberOfBytes, ByteArray *oV);
+        bool readBytes(size_t iNumberOfBytes, char *oV);
+        bool seek(size_t iPosition);
+        void setStreamFormat(StreamUtility::endianness iV) { mStreamFormat = iV; }
+        bool skip(size_t iNumberOfBytes);
+
+    protected:
+        bool readValues(size_t iNumberOfValues, size_t iSizeOfValue, void *oV);
+
+        ByteArray mData;
+        size_t mPosition;
+        StreamUtility::endianness mStreamFormat;
+    };
+
+    //-------------------------------------------------------------------------
+    template<typename T>
+    bool ByteArrayCursor::readArray(size_t iNumberOfValues, T *oV)
+    {
+        static_assert(std::is_arithmetic<T>::value, "ByteArrayCursor reads arithmetic values only");
+        return readValues(iNumberOfValues, sizeof(T), oV);
+    }
+
     //-------------------------------------------------------------------------
     // utility function
     //-------------------------------------------------------------------------
 	std::istringstream makeIStringStream(ByteArray);
-    ByteArray readFromFile(const std::string& iFilenamePath);
+    ByteArray readFromFile(const std::string& iFilenamePath, bool iMapInMemory = false);
     bool writeToFile(ByteArray iBa, const std::string& iFilenamePath);
 }
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 
+#include <cstdio>
 #include <sstream>
 #include "StringUtilities.h"
 
@@ -35,6 +36,36 @@ namespace Core
 		return r;
 	}
 
+    //-------------------------------------------------------------------------
+    // returns iInput as a json string, quoted and escaped.
+    //
+    string toJsonString(const string& iInput)
+    {
+        string r("\"");
+        for (char c : iInput)
+        {
+            switch (c)
+            {
+            case '"': r += "\\\""; break;
+            case '\\': r += "\\\\"; break;
+            case '\n': r += "\\n"; break;
+            case '\t': r += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20)
+                {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned)c);
+                    r += buffer;
+                }
+                else
+                { r += c; }
+                break;
+            }
+        }
+        r += '"';
+        return r;
+    }
+
     //-------------------------------------------------------------------------
     vector<string> toVector(const string& iInput, char iSeparator)
     {
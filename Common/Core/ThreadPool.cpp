@@ -0,0 +1,306 @@
+
+#include <algorithm>
+#include <cassert>
+#include "Core/ThreadPool.h"
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    // identifies the pool and the worker running on the current thread.
+    // Used by submit() to push in the deque of the calling worker.
+    thread_local const ThreadPool* tpCurrentPool = nullptr;
+    thread_local int tCurrentWorkerIndex = -1;
+}
+
+//------------------------------------------------------------------------------
+ThreadPool::ThreadPool() :
+    mWorkers(),
+    mIsStopping(false),
+    mNumberOfPendingTasks(0),
+    mNumberOfUnfinishedTasks(0),
+    mNumberOfSleepingThreads(0),
+    mNextWorkerIndex(0)
+{}
+
+//------------------------------------------------------------------------------
+ThreadPool::ThreadPool(int iNumberOfThreads) :
+    ThreadPool()
+{
+    start(iNumberOfThreads);
+}
+
+//------------------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+//------------------------------------------------------------------------------
+ThreadPool& ThreadPool::getGlobalInstance()
+{
+    static ThreadPool sGlobalPool(std::max((int)std::thread::hardware_concurrency(), 1));
+    return sGlobalPool;
+}
+
+//------------------------------------------------------------------------------
+int ThreadPool::getNumberOfPendingTasks() const
+{
+    return mNumberOfPendingTasks.load();
+}
+
+//------------------------------------------------------------------------------
+int ThreadPool::getNumberOfThreads() const
+{
+    return (int)mWorkers.size();
+}
+
+//------------------------------------------------------------------------------
+bool ThreadPool::isStarted() const
+{
+    return !mWorkers.empty();
+}
+
+//------------------------------------------------------------------------------
+// Calls iTask(i) for each i in [0, iNumberOfTasks[ and returns when all calls
+// are done. Indices are handed out one at a time to the calling thread and to
+// at most getNumberOfThreads() helper tasks, so the work balances itself.
+//
+// Since the calling thread also executes iTask, this does not deadlock when
+// called from a task or on a pool that is not started. Helper tasks that
+// start after the loop is done return immediately.
+//
+void ThreadPool::parallelFor(int iNumberOfTasks, const std::function<void(int)>& iTask)
+{
+    if (iNumberOfTasks <= 0) return;
+
+    struct Loop
+    {
+        Loop(int iNumberOfTasks, const std::function<void(int)>& iTask) :
+            mTask(iTask), mNumberOfTasks(iNumberOfTasks), mNextIndex(0), mNumberOfDoneTasks(0) {}
+
+        void run()
+        {
+            int i = 0;
+            while ((i = mNextIndex.fetch_add(1)) < mNumberOfTasks)
+            {
+                mTask(i);
+                if (mNumberOfDoneTasks.fetch_add(1) + 1 == mNumberOfTasks)
+                {
+                    std::lock_guard<std::mutex> lk(mMutex);
+                    mDoneCondition.notify_all();
+                }
+            }
+        }
+
+        std::function<void(int)> mTask;
+        const int mNumberOfTasks;
+        std::atomic<int> mNextIndex;
+        std::atomic<int> mNumberOfDoneTasks;
+        std::mutex mMutex;
+        std::condition_variable mDoneCondition;
+    };
+
+    // helpers keep the loop alive, they may start after this function
+    // returned.
+    shared_ptr<Loop> loop = make_shared<Loop>(iNumberOfTasks, iTask);
+    const int numberOfHelpers = std::min(getNumberOfThreads(), iNumberOfTasks - 1);
+    for (int i = 0; i < numberOfHelpers; ++i)
+    {
+        submit([loop]() { loop->run(); });
+    }
+
+    loop->run();
+
+    std::unique_lock<std::mutex> lk(loop->mMutex);
+    loop->mDoneCondition.wait(lk, [&loop, iNumberOfTasks]()
+        { return loop->mNumberOfDoneTasks.load() == iNumberOfTasks; });
+}
+
+//------------------------------------------------------------------------------
+// Pops the most recent task of the worker's own deque.
+//
+bool ThreadPool::popTask(int iWorkerIndex, std::function<void()> *opTask)
+{
+    Worker &w = *mWorkers[iWorkerIndex];
+    std::lock_guard<std::mutex> lk(w.mMutex);
+    if (w.mTasks.empty())
+    { return false; }
+
+    *opTask = std::move(w.mTasks.back());
+    w.mTasks.pop_back();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void ThreadPool::runTask(std::function<void()>& iTask)
+{
+    mNumberOfPendingTasks.fetch_sub(1);
+    iTask();
+    iTask = nullptr;
+
+    if (mNumberOfUnfinishedTasks.fetch_sub(1) == 1)
+    {
+        std::lock_guard<std::mutex> lk(mFinishedMutex);
+        mFinishedCondition.notify_all();
+    }
+}
+
+//------------------------------------------------------------------------------
+void ThreadPool::start(int iNumberOfThreads)
+{
+    //early out
+    if (isStarted()) return;
+
+    mIsStopping = false;
+    const int n = std::max(iNumberOfThreads, 1);
+    for (int i = 0; i < n; ++i)
+    {
+        mWorkers.push_back(unique_ptr<Worker>(new Worker()));
+    }
+
+    // threads are launched once all deques exist, since workers
+    // will try to steal from each other.
+    for (int i = 0; i < n; ++i)
+    {
+        mWorkers[i]->mThread = std::thread(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Steals the oldest task from the first non empty deque, starting with the
+// worker next to iWorkerIndex so that thieves do not all hit the same deque.
+//
+bool ThreadPool::stealTask(int iWorkerIndex, std::function<void()> *opTask)
+{
+    const int n = getNumberOfThreads();
+    for (int i = 1; i < n; ++i)
+    {
+        Worker &w = *mWorkers[(iWorkerIndex + i) % n];
+        std::lock_guard<std::mutex> lk(w.mMutex);
+        if (!w.mTasks.empty())
+        {
+            *opTask = std::move(w.mTasks.front());
+            w.mTasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+// Executes all tasks already submitted and joins the workers.
+//
+void ThreadPool::stop()
+{
+    if (!isStarted()) return;
+
+    {
+        std::lock_guard<std::mutex> lk(mSleepMutex);
+        mIsStopping = true;
+    }
+    mSleepCondition.notify_all();
+
+    for (auto &w : mWorkers)
+    {
+        if (w->mThread.joinable())
+        { w->mThread.join(); }
+    }
+
+    // tasks submitted while the workers were exiting are
+    // executed here.
+    std::function<void()> task;
+    for (int i = 0; i < getNumberOfThreads(); ++i)
+    {
+        while (popTask(i, &task))
+        { runTask(task); }
+    }
+
+    mWorkers.clear();
+}
+
+//------------------------------------------------------------------------------
+void ThreadPool::submit(std::function<void()> iTask)
+{
+    if (!isStarted())
+    {
+        iTask();
+        return;
+    }
+
+    mNumberOfUnfinishedTasks.fetch_add(1);
+
+    int workerIndex = tCurrentWorkerIndex;
+    if (tpCurrentPool != this)
+    {
+        workerIndex = (int)(mNextWorkerIndex.fetch_add(1) % (unsigned int)getNumberOfThreads());
+    }
+
+    // the pending count is incremented first so it never goes negative
+    // when a worker pops the task right after the push.
+    mNumberOfPendingTasks.fetch_add(1);
+    {
+        Worker &w = *mWorkers[workerIndex];
+        std::lock_guard<std::mutex> lk(w.mMutex);
+        w.mTasks.push_back(std::move(iTask));
+    }
+
+    // Wake a worker only if one is sleeping. The mutex is taken to make sure
+    // the sleeping worker is really waiting on the condition and not in
+    // between its check of the pending tasks and the wait.
+    //
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mNumberOfSleepingThreads.load() > 0)
+    {
+        { std::lock_guard<std::mutex> lk(mSleepMutex); }
+        mSleepCondition.notify_one();
+    }
+}
+
+//------------------------------------------------------------------------------
+void ThreadPool::waitForAllTasksToFinish()
+{
+    assert(tpCurrentPool != this && "waitForAllTasksToFinish() cannot be called from a task");
+
+    std::unique_lock<std::mutex> lk(mFinishedMutex);
+    mFinishedCondition.wait(lk, [this]() {return mNumberOfUnfinishedTasks.load() == 0; });
+}
+
+//------------------------------------------------------------------------------
+// This is the function executed by each worker thread.
+//
+void ThreadPool::workerLoop(int iWorkerIndex)
+{
+    tpCurrentPool = this;
+    tCurrentWorkerIndex = iWorkerIndex;
+
+    std::function<void()> task;
+    for (;;)
+    {
+        if (popTask(iWorkerIndex, &task) || stealTask(iWorkerIndex, &task))
+        {
+            runTask(task);
+            continue;
+        }
+
+        // nothing to do, sleep until a task is submitted. The number of
+        // sleeping threads is incremented before checking the pending tasks
+        // so that submit() either sees this thread sleeping or this thread
+        // sees the submitted task.
+        //
+        std::unique_lock<std::mutex> lk(mSleepMutex);
+        mNumberOfSleepingThreads.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        mSleepCondition.wait(lk, [this]()
+            {return mNumberOfPendingTasks.load() > 0 || mIsStopping.load(); });
+        mNumberOfSleepingThreads.fetch_sub(1);
+
+        if (mIsStopping.load() && mNumberOfPendingTasks.load() == 0)
+        { break; }
+    }
+
+    tpCurrentPool = nullptr;
+    tCurrentWorkerIndex = -1;
+}
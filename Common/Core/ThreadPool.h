@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // This class is a pool of worker threads executing tasks submitted via
+    // submit(). The intention is to have a single set of threads shared by
+    // all the subsystems of a process, instead of having each of them
+    // spawning their own threads (see MessageQueue::setThreadPool()).
+    //
+    // Each worker owns a deque of tasks:
+    //      - A task submitted from a worker thread goes in the deque of
+    //        that worker. The worker pops its own tasks from the back (last
+    //        submitted first), which keeps the data hot in its cache.
+    //      - A task submitted from any other thread is distributed in a
+    //        round robin fashion among the workers.
+    //      - When its deque is empty, a worker steals the oldest task from
+    //        the front of another worker's deque.
+    //      - When there is nothing to steal, the worker sleeps until a task
+    //        is submitted.
+    //
+    // There is no guarantee on the order of execution of the tasks.
+    //
+    // getGlobalInstance() returns a pool shared by the whole process. It is
+    // started with one worker per hardware thread the first time it is
+    // accessed.
+    //
+    // Ex:
+    //      ThreadPool &pool = ThreadPool::getGlobalInstance();
+    //      pool.submit([](){ ... do something useful ... });
+    //      pool.waitForAllTasksToFinish();
+    //
+    // parallelFor() splits a loop in tasks and returns once they are all
+    // done. The calling thread works on the loop too, it can be called from
+    // a task.
+    //
+    //      pool.parallelFor(numberOfRowBlocks, [&](int iBlock){ ... });
+    //
+    // Notes:
+    //      submit() on a pool that is not started executes the task right
+    //      away on the calling thread.
+    //
+    //      stop() executes all the tasks already submitted before joining
+    //      the workers.
+    //
+    //      waitForAllTasksToFinish() must not be called from a task, it would
+    //      wait on itself.
+    //
+    class ThreadPool
+    {
+    public:
+        ThreadPool();
+        explicit ThreadPool(int iNumberOfThreads);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool();
+
+        static ThreadPool& getGlobalInstance();
+        int getNumberOfPendingTasks() const;
+        int getNumberOfThreads() const;
+        bool isStarted() const;
+        void parallelFor(int iNumberOfTasks, const std::function<void(int)>& iTask);
+        void start(int iNumberOfThreads);
+        void stop();
+        void submit(std::function<void()> iTask);
+        void waitForAllTasksToFinish();
+
+    protected:
+        struct Worker
+        {
+            std::mutex mMutex;
+            std::deque<std::function<void()>> mTasks;
+            std::thread mThread;
+        };
+
+        bool popTask(int iWorkerIndex, std::function<void()> *opTask);
+        void runTask(std::function<void()>& iTask);
+        bool stealTask(int iWorkerIndex, std::function<void()> *opTask);
+        void workerLoop(int iWorkerIndex);
+
+        std::vector<std::unique_ptr<Worker>> mWorkers;
+        std::atomic<bool> mIsStopping;
+        std::atomic<int> mNumberOfPendingTasks; // submitted but not started
+        std::atomic<int> mNumberOfUnfinishedTasks; // submitted but not finished
+        std::atomic<int> mNumberOfSleepingThreads;
+        std::atomic<unsigned int> mNextWorkerIndex;
+        std::mutex mSleepMutex;
+        std::condition_variable mSleepCondition;
+        std::mutex mFinishedMutex;
+        std::condition_variable mFinishedCondition;
+    };
+}
+}
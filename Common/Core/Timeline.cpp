@@ -0,0 +1,168 @@
+
+#include <algorithm>
+#include "Core/StringUtilities.h"
+#include "Core/Timeline.h"
+#include <sstream>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    std::atomic<uint64_t> sNextInstanceId(1);
+}
+
+//-----------------------------------------------------------------------------
+Timeline::Timeline(int iCapacityPerThread) :
+    mCapacityPerThread(2),
+    mInstanceId(sNextInstanceId.fetch_add(1)),
+    mMutex(),
+    mThreads()
+{
+    while (mCapacityPerThread < iCapacityPerThread)
+    {
+        mCapacityPerThread <<= 1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Returns a snapshot of the events of all threads, sorted by begin tick.
+// Events overwritten while the snapshot is taken are not returned.
+//
+std::vector<Timeline::Event> Timeline::getEvents() const
+{
+    vector<Event> r;
+
+    std::lock_guard<std::mutex> lk(mMutex);
+    for (auto &ring : mThreads)
+    {
+        const uint64_t numberOfEvents = ring->mNumberOfEvents.load(std::memory_order_acquire);
+        const uint64_t capacity = ring->mMask + 1;
+        const uint64_t first = numberOfEvents > capacity ? numberOfEvents - capacity : 0;
+
+        for (uint64_t i = first; i < numberOfEvents; ++i)
+        {
+            const Slot &s = ring->mSlots[i & ring->mMask];
+            const uint64_t sequence = s.mSequence.load(std::memory_order_acquire);
+            if (sequence != 2 * i + 2) continue; // already overwritten
+
+            Event e;
+            e.mBeginTick = s.mBeginTick.load(std::memory_order_relaxed);
+            e.mEndTick = s.mEndTick.load(std::memory_order_relaxed);
+            e.mTag = s.mTag.load(std::memory_order_relaxed);
+            e.mThreadIndex = ring->mThreadIndex;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.mSequence.load(std::memory_order_relaxed) != sequence) continue;
+            r.push_back(e);
+        }
+    }
+
+    stable_sort(r.begin(), r.end(), [](const Event& a, const Event& b)
+        { return a.mBeginTick < b.mBeginTick; });
+    return r;
+}
+
+//-----------------------------------------------------------------------------
+Timeline& Timeline::getInstance()
+{
+    static Timeline sInstance;
+    return sInstance;
+}
+
+//-----------------------------------------------------------------------------
+// Returns the ring of the calling thread, it is created on first use.
+//
+Timeline::ThreadRing* Timeline::getThreadRing()
+{
+    // cache of the last timeline used by this thread.
+    thread_local uint64_t tInstanceId = 0;
+    thread_local ThreadRing* tpRing = nullptr;
+    if (tInstanceId == mInstanceId)
+    { return tpRing; }
+
+    const std::thread::id threadId = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lk(mMutex);
+    auto it = find_if(mThreads.begin(), mThreads.end(), [threadId](const unique_ptr<ThreadRing>& iRing)
+        { return iRing->mThreadId == threadId; });
+    if (it == mThreads.end())
+    {
+        unique_ptr<ThreadRing> ring(new ThreadRing(mCapacityPerThread));
+        ring->mThreadId = threadId;
+        ring->mThreadIndex = (int)mThreads.size();
+        mThreads.push_back(std::move(ring));
+        it = mThreads.end() - 1;
+    }
+
+    tInstanceId = mInstanceId;
+    tpRing = it->get();
+    return tpRing;
+}
+
+//-----------------------------------------------------------------------------
+// Records an event of the calling thread. This never blocks, the oldest
+// event of the thread is overwritten.
+//
+void Timeline::record(const char* iTag, uint64_t iBeginTick, uint64_t iEndTick)
+{
+    ThreadRing *ring = getThreadRing();
+    const uint64_t i = ring->mNumberOfEvents.load(std::memory_order_relaxed);
+    Slot &s = ring->mSlots[i & ring->mMask];
+
+    // the slot is marked as being written before its content changes.
+    s.mSequence.store(2 * i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.mBeginTick.store(iBeginTick, std::memory_order_relaxed);
+    s.mEndTick.store(iEndTick, std::memory_order_relaxed);
+    s.mTag.store(iTag, std::memory_order_relaxed);
+    s.mSequence.store(2 * i + 2, std::memory_order_release);
+
+    ring->mNumberOfEvents.store(i + 1, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+// Returns the events in the Trace Event Format (json), see
+// Profiler::toChromeTraceJson(). Timestamps are relative to the first event.
+//
+std::string Timeline::toChromeTraceJson() const
+{
+    const vector<Event> events = getEvents();
+    const uint64_t firstTick = events.empty() ? 0 : events.front().mBeginTick;
+
+    ostringstream oss;
+    oss.precision(3);
+    oss << fixed;
+    oss << "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        const Event &e = events[i];
+        oss << (i == 0 ? "\n" : ",\n") << "{\"name\":" << toJsonString(e.mTag) <<
+            ",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.mThreadIndex <<
+            ",\"ts\":" << CycleCounter::toNanoseconds(e.mBeginTick - firstTick) * 1e-3 <<
+            ",\"dur\":" << CycleCounter::toNanoseconds(e.mEndTick - e.mBeginTick) * 1e-3 << "}";
+    }
+    oss << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return oss.str();
+}
+
+//-----------------------------------------------------------------------------
+//--- Timeline::Slot
+//-----------------------------------------------------------------------------
+Timeline::Slot::Slot() :
+    mSequence(0),
+    mBeginTick(0),
+    mEndTick(0),
+    mTag(nullptr)
+{}
+
+//-----------------------------------------------------------------------------
+//--- Timeline::ThreadRing
+//-----------------------------------------------------------------------------
+Timeline::ThreadRing::ThreadRing(int iCapacity) :
+    mSlots(new Slot[iCapacity]),
+    mMask((uint64_t)iCapacity - 1),
+    mThreadId(),
+    mThreadIndex(0),
+    mNumberOfEvents(0)
+{}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "Core/CycleCounter.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Realisim
+{
+namespace Core
+{
+    //-------------------------------------------------------------------------
+    // This class keeps the most recent (begin, end, tag) events of each
+    // thread, timed with the CycleCounter. It gives a continuous timeline of
+    // what the threads did, which can be dumped at any time, ex: when a frame
+    // hitches.
+    //
+    // Usage:
+    //      {
+    //          TimelineScope scope("update");
+    //          ...
+    //      }
+    //
+    //      // any thread, at any time
+    //      string json = Timeline::getInstance().toChromeTraceJson();
+    //
+    // Each thread writes in its own ring of events, recording an event never
+    // takes a lock and never waits: only the oldest event of the ring is
+    // overwritten. Reading the events does not block the writers either,
+    // each slot of the ring is a small seqlock and events that are being
+    // overwritten while they are read are skipped.
+    //
+    // Tags must be string literals (or outlive the timeline), only their
+    // address is stored.
+    //
+    class Timeline
+    {
+    public:
+        struct Event
+        {
+            uint64_t mBeginTick;
+            uint64_t mEndTick;
+            const char* mTag;
+            int mThreadIndex;
+        };
+
+        explicit Timeline(int iCapacityPerThread = 4096);
+        Timeline(const Timeline&) = delete;
+        Timeline& operator=(const Timeline&) = delete;
+        ~Timeline() = default;
+
+        static Timeline& getInstance();
+
+        int getCapacityPerThread() const { return mCapacityPerThread; }
+        std::vector<Event> getEvents() const;
+        void record(const char* iTag, uint64_t iBeginTick, uint64_t iEndTick);
+        std::string toChromeTraceJson() const;
+
+    protected:
+        struct Slot
+        {
+            Slot();
+
+            // 2 * eventIndex + 1 while the event is written, 2 * eventIndex + 2
+            // once written.
+            std::atomic<uint64_t> mSequence;
+            std::atomic<uint64_t> mBeginTick;
+            std::atomic<uint64_t> mEndTick;
+            std::atomic<const char*> mTag;
+        };
+
+        struct ThreadRing
+        {
+            explicit ThreadRing(int iCapacity);
+            ThreadRing(const ThreadRing&) = delete;
+            ThreadRing& operator=(const ThreadRing&) = delete;
+
+            std::unique_ptr<Slot[]> mSlots;
+            uint64_t mMask;
+            std::thread::id mThreadId;
+            int mThreadIndex;
+            std::atomic<uint64_t> mNumberOfEvents; // ever written
+        };
+
+        ThreadRing* getThreadRing();
+
+        int mCapacityPerThread; // power of two
+        uint64_t mInstanceId;
+
+        // protects the list of threads.
+        mutable std::mutex mMutex;
+        std::vector<std::unique_ptr<ThreadRing>> mThreads;
+    };
+
+    //-------------------------------------------------------------------------
+    // Records an event in Timeline::getInstance() from its construction to
+    // its destruction.
+    //
+    class TimelineScope
+    {
+    public:
+        explicit TimelineScope(const char* iTag) : mTag(iTag), mBeginTick(CycleCounter::now()) {}
+        TimelineScope(const TimelineScope&) = delete;
+        TimelineScope& operator=(const TimelineScope&) = delete;
+        ~TimelineScope() { Timeline::getInstance().record(mTag, mBeginTick, CycleCounter::now()); }
+
+    private:
+        const char* mTag;
+        uint64_t mBeginTick;
+    };
+}
+}
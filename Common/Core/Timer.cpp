@@ -7,8 +7,8 @@ using namespace std;
 
 Timer::Timer() :
   mState(sIdle),
-  mT1(),
-  mT2()
+  mT1(0),
+  mT2(0)
 { start(); }
 
 //-------------------------------------------------------------------------
@@ -21,28 +21,27 @@ Timer::~Timer()
 //
 double Timer::elapsed() const
 {
-  chrono::duration<double> timeSpan;
+  return CycleCounter::toSeconds(elapsedTicks());
+}
+
+//-------------------------------------------------------------------------
+int64_t Timer::elapsedInNanoseconds() const
+{
+  return CycleCounter::toNanoseconds(elapsedTicks());
+}
+
+//-------------------------------------------------------------------------
+uint64_t Timer::elapsedTicks() const
+{
+  uint64_t r = 0;
   switch (getState())
   {
     case sIdle: break;
-    case sRunning:
-    {
-      chrono::high_resolution_clock::time_point t2 =
-        chrono::high_resolution_clock::now();
-      timeSpan =
-        chrono::duration_cast<chrono::duration<double> >(t2 - mT1);
-    }break;
-    case sStopped:
-    {
-      timeSpan =
-        chrono::duration_cast<chrono::duration<double> >(mT2 - mT1);
-    } break;
-      
-    default:
-      break;
+    case sRunning: r = CycleCounter::now() - mT1; break;
+    case sStopped: r = mT2 - mT1; break;
+    default: break;
   }
-  
-  return timeSpan.count();;
+  return r;
 }
 
 //-------------------------------------------------------------------------
@@ -54,7 +53,7 @@ void Timer::goToState(state iState)
       switch (iState)
       {
         case sRunning:
-          mT1 = chrono::high_resolution_clock::now();
+          mT1 = CycleCounter::now();
           mT2 = mT1;
           mState = sRunning;
           break;
@@ -66,11 +65,11 @@ void Timer::goToState(state iState)
       switch (iState)
       {
         case sRunning:
-          mT1 = chrono::high_resolution_clock::now();
+          mT1 = CycleCounter::now();
           mT2 = mT1;
           break;
         case sStopped:
-          mT2 = chrono::high_resolution_clock::now();
+          mT2 = CycleCounter::now();
           mState = sStopped;
           break;
         default: break;
@@ -81,7 +80,7 @@ void Timer::goToState(state iState)
       switch (iState)
       {
         case sRunning:
-          mT1 = chrono::high_resolution_clock::now();
+          mT1 = CycleCounter::now();
           mT2 = mT1;
           mState = sRunning;
           break;
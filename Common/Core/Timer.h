@@ -2,6 +2,8 @@
 #pragma once
 
 #include <chrono>
+#include "Core/CycleCounter.h"
+#include <cstdint>
 
 namespace Realisim
 {
@@ -9,6 +11,9 @@ namespace Core
 {
   //Cette classe fonctionne comme un chronomètre. Elle sert a calculer
   //des intervals de temps.
+  //
+  //Elle utilise le compteur de cycles du processeur (voir CycleCounter),
+  //start() et elapsed() ne coûtent que quelques nanosecondes.
   
   class Timer
   {
@@ -19,6 +24,7 @@ namespace Core
     ~Timer();
     
     double elapsed() const;
+    int64_t elapsedInNanoseconds() const;
 //void pause();
     void start();
     void stop();
@@ -26,12 +32,13 @@ namespace Core
   protected:
     enum state{ sIdle, sRunning, sStopped };
     
+    uint64_t elapsedTicks() const;
     state getState() const {return mState;}
     void goToState(state);
     
     state mState;
-    std::chrono::high_resolution_clock::time_point mT1;
-    std::chrono::high_resolution_clock::time_point mT2;
+    uint64_t mT1; //ticks, voir CycleCounter.
+    uint64_t mT2;
   };
 
 } // end of namespace utils
@@ -178,11 +178,12 @@ TEST(ByteArray, operator)
     
     //char operator[](int) const
     {
-        char ref[7] = {'a', 'b', 'c', 'd', 'e', 'f', '\0'};
+        // longer than the inline storage, so the data is shared.
+        char ref[27] = "abcdefghijklmnopqrstuvwxyz";
         const ByteArray ba(&ref[0]);
         ByteArray ba2(ba);
         EXPECT_TRUE(ba.refCount() == 2);
-        EXPECT_TRUE(ba.size() == 6);
+        EXPECT_TRUE(ba.size() == 26);
         for(int i = 0; i < ba.size(); ++i)
         {
             EXPECT_EQ(ba[i], ref[i]);
@@ -195,19 +196,19 @@ TEST(ByteArray, operator)
     
     //char& operator[](int)
     {
-        char ref[7] = {'a', 'b', 'c', 'd', 'e', 'f', '\0'};
+        char ref[27] = "abcdefghijklmnopqrstuvwxyz";
         ByteArray ba(&ref[0]);
         ByteArray ba2(ba);
         EXPECT_TRUE(ba.refCount() == 2);
-        EXPECT_TRUE(ba.size() == 6);
+        EXPECT_TRUE(ba.size() == 26);
         
         ba[0] = 'A';
         ba[1] = 'B';
         ba[2] = 'C';
         EXPECT_TRUE(ba.refCount() == 1);
         EXPECT_TRUE(ba2.refCount() == 1);
-        EXPECT_STREQ(ba.constData(), "ABCdef");
-        EXPECT_STREQ(ba2.constData(), "abcdef");
+        EXPECT_STREQ(ba.constData(), "ABCdefghijklmnopqrstuvwxyz");
+        EXPECT_STREQ(ba2.constData(), "abcdefghijklmnopqrstuvwxyz");
     }
 }
 
@@ -371,4 +372,100 @@ TEST(ByteArray, WriteTest_usingDataPointer)
     iss.read(ba.data(), ba.size());
     
     EXPECT_STREQ(ba.constData(), referenceString.c_str());
-}
\ No newline at end of file
+}
+
+TEST(ByteArray, SmallData)
+{
+    // small data is stored inline and copied, never shared.
+    ByteArray ba("abc");
+    ByteArray ba2(ba);
+    EXPECT_EQ(ba.refCount(), 1);
+    EXPECT_EQ(ba2.refCount(), 1);
+    EXPECT_NE(ba.constData(), ba2.constData());
+    EXPECT_TRUE(ba == ba2);
+
+    // growing past the inline storage moves the data to the heap.
+    ba.append(referenceString);
+    EXPECT_EQ(ba.size(), 3 + referenceString.size());
+    EXPECT_STREQ(ba.constData(), ("abc" + referenceString).c_str());
+    ByteArray ba3(ba);
+    EXPECT_EQ(ba3.refCount(), 2);
+
+    // appending to itself.
+    ba2.append(ba2);
+    EXPECT_STREQ(ba2.constData(), "abcabc");
+    ba3.append(ba3);
+    EXPECT_EQ(ba3.size(), 2 * ba.size());
+    EXPECT_EQ(ba.refCount(), 1);
+
+    ByteArray ba4;
+    ba4.resize(4);
+    EXPECT_EQ(ba4.size(), 4);
+    EXPECT_EQ(ba4.constString(), std::string(4, '\0'));
+}
+
+TEST(ByteArray, Slices)
+{
+    //ByteArray mid(size_t iPos, int iLength = -1) const
+    {
+        ByteArray ba(loremIpsum);
+        ByteArray slice = ba.mid(6, 100);
+
+        // the slice is a view, no copy was performed.
+        EXPECT_EQ(slice.constData(), ba.constData() + 6);
+        EXPECT_EQ(slice.size(), 100);
+        EXPECT_EQ(ba.refCount(), 2);
+        EXPECT_EQ(slice.constString(), loremIpsum.substr(6, 100));
+        // constString() returns a copy, the slice is still a view.
+        EXPECT_EQ(slice.constData(), ba.constData() + 6);
+        EXPECT_EQ(ba.refCount(), 2);
+
+        // slices of slices.
+        ByteArray slice2 = ba.mid(6);
+        ByteArray slice3 = slice2.mid(6, 50);
+        EXPECT_EQ(slice3.constData(), ba.constData() + 12);
+        EXPECT_EQ(ba.refCount(), 4);
+        EXPECT_TRUE(slice3 == ByteArray(loremIpsum.substr(12, 50)));
+
+        // writing in a slice copies it.
+        slice3[0] = '#';
+        EXPECT_EQ(slice3.refCount(), 1);
+        EXPECT_EQ(ba.refCount(), 3);
+        EXPECT_EQ(slice3.constString(), "#" + loremIpsum.substr(13, 49));
+        EXPECT_EQ(ba.constString(), loremIpsum);
+
+        // writing in the parent does not change the slice.
+        ba.append("!");
+        ba[12] = '#';
+        EXPECT_EQ(slice2.constString(), loremIpsum.substr(6));
+
+        // small slices are copied inline.
+        ByteArray small = ba.mid(0, 5);
+        EXPECT_STREQ(small.constData(), "Lorem");
+        EXPECT_EQ(small.refCount(), 1);
+
+        EXPECT_EQ(ba.mid(ba.size()).size(), 0);
+        EXPECT_THROW(ba.mid(ba.size() + 1), std::out_of_range);
+    }
+
+    //static ByteArray fromRawData(const char*, int iSize)
+    {
+        std::string buffer = loremIpsum;
+        ByteArray raw = ByteArray::fromRawData(buffer.data(), (int)buffer.size());
+        EXPECT_EQ(raw.constData(), buffer.data());
+        EXPECT_EQ(raw.size(), buffer.size());
+        EXPECT_TRUE(raw == ByteArray(loremIpsum));
+
+        ByteArray slice = raw.mid(6, 50);
+        EXPECT_EQ(slice.constData(), buffer.data() + 6);
+
+        // the external buffer is never written.
+        raw.data()[0] = '#';
+        EXPECT_NE(raw.constData(), buffer.data());
+        EXPECT_EQ(buffer, loremIpsum);
+        EXPECT_EQ(raw.constString(), "#" + loremIpsum.substr(1));
+        EXPECT_EQ(slice.constData(), buffer.data() + 6);
+
+        EXPECT_TRUE(ByteArray::fromRawData(nullptr, 0).isEmpty());
+    }
+}
@@ -0,0 +1,105 @@
+
+#include "Core/ColorRgbaF.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    void expectNear(const ColorRgbaF& iA, const Color& iB, double iEpsilon)
+    {
+        EXPECT_NEAR(iA.getRed(), iB.getRed(), iEpsilon);
+        EXPECT_NEAR(iA.getGreen(), iB.getGreen(), iEpsilon);
+        EXPECT_NEAR(iA.getBlue(), iB.getBlue(), iEpsilon);
+        EXPECT_NEAR(iA.getAlpha(), iB.getAlpha(), iEpsilon);
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(ColorRgbaF, arithmetic)
+{
+    EXPECT_EQ(sizeof(ColorRgbaF), 16u);
+    EXPECT_EQ(alignof(ColorRgbaF), 16u);
+    EXPECT_EQ(ColorRgbaF(), ColorRgbaF(0.0f, 0.0f, 0.0f, 0.0f));
+
+    const Color a(0.1, 0.2, 0.3, 0.4), b(0.5, 0.25, 0.125, 1.0);
+    const ColorRgbaF fa(a), fb(b);
+    expectNear(fa, a, 1e-7);
+    EXPECT_NEAR(fa.toColor().getBlue(), 0.3, 1e-7);
+
+    expectNear(fa + fb, a + b, 1e-6);
+    expectNear(fa - fb, a - b, 1e-6);
+    expectNear(fa * fb, a * b, 1e-6);
+    expectNear(fa / fb, a / b, 1e-6);
+    expectNear(fa * 3.0f, a * 3.0, 1e-6);
+    expectNear(fa / 4.0f, a / 4.0, 1e-6);
+
+    ColorRgbaF c = fa;
+    c += fb; c *= fb; c -= fa; c /= 2.0f; c *= 3.0f; c /= fb;
+    Color d = a;
+    d += b; d *= b; d -= a; d /= 2.0; d *= 3.0; d /= b;
+    expectNear(c, d, 1e-6);
+
+    ColorRgbaF e = fa;
+    e.addScaled(fb, 2.0f);
+    expectNear(e, a + b * 2.0, 1e-6);
+
+    EXPECT_EQ(ColorRgbaF(-1.0f, 0.5f, 2.0f, 1.0f).clamped(), ColorRgbaF(0.0f, 0.5f, 1.0f, 1.0f));
+    EXPECT_NEAR(fa.toLuma(), a.toLuma(), 1e-6);
+    EXPECT_NE(fa, fb);
+}
+
+//------------------------------------------------------------------------------
+TEST(ColorRgbaF, conversions)
+{
+    // bytes, all values go back and forth exactly.
+    vector<ColorRgbaUint8> bytes;
+    for (int i = 0; i < 256; ++i)
+    { bytes.push_back(ColorRgbaUint8((uint8_t)i, (uint8_t)(255 - i), (uint8_t)(i * 7), (uint8_t)(i / 2))); }
+    bytes.push_back(ColorRgbaUint8(1, 2, 3, 4)); // not a multiple of 4
+
+    vector<ColorRgbaF> floats(bytes.size());
+    ColorRgbaF::convert(bytes.data(), bytes.size(), floats.data());
+    vector<ColorRgbaUint8> back(bytes.size());
+    ColorRgbaF::convert(floats.data(), floats.size(), back.data());
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        ASSERT_EQ(floats[i], ColorRgbaF(bytes[i]));
+        EXPECT_EQ(back[i], bytes[i]);
+        EXPECT_EQ(floats[i].toRgbaUint8(), bytes[i]);
+        expectNear(floats[i], Color(bytes[i].getRed(), bytes[i].getGreen(), bytes[i].getBlue(), bytes[i].getAlpha()), 1e-6);
+    }
+
+    // clamped and rounded to the nearest.
+    EXPECT_EQ(ColorRgbaF(-0.5f, 1.5f, 0.5f / 255.0f + 1e-4f, 254.6f / 255.0f).toRgbaUint8(), ColorRgbaUint8(0, 255, 1, 255));
+    const ColorRgbaF outOfRange[5] = { ColorRgbaF(2.0f, -1.0f, 0.2f / 255.0f, 0.7f / 255.0f),
+        ColorRgbaF(), ColorRgbaF(1.0f, 1.0f, 1.0f, 1.0f), ColorRgbaF(), ColorRgbaF(-3.0f, 3.0f, 0.0f, 0.0f) };
+    ColorRgbaUint8 packed[5];
+    ColorRgbaF::convert(outOfRange, 5, packed);
+    EXPECT_EQ(packed[0], ColorRgbaUint8(255, 0, 0, 1));
+    EXPECT_EQ(packed[2], ColorRgbaUint8(255, 255, 255, 255));
+    EXPECT_EQ(packed[4], ColorRgbaUint8(0, 255, 0, 0));
+
+    // half floats
+    vector<ColorRgbaF> colors;
+    for (int i = 0; i < 101; ++i)
+    { colors.push_back(ColorRgbaF(i / 100.0f, -i / 7.0f, i * 13.0f, 0.5f)); }
+    vector<ColorRgbaF16> halves(colors.size());
+    ColorRgbaF::convert(colors.data(), colors.size(), halves.data());
+    vector<ColorRgbaF> fromHalves(colors.size());
+    ColorRgbaF::convert(halves.data(), halves.size(), fromHalves.data());
+    for (size_t i = 0; i < colors.size(); ++i)
+    {
+        const ColorRgbaF single(colors[i].toRgbaF16());
+        for (int c = 0; c < 4; ++c)
+        {
+            const float v = colors[i].data()[c];
+            EXPECT_NEAR(fromHalves[i].data()[c], v, fabs(v) * 1e-3f);
+            EXPECT_NEAR(single.data()[c], v, fabs(v) * 1e-3f);
+        }
+    }
+    EXPECT_EQ(ColorRgbaF(ColorRgbaF32(0.25f, 0.5f, 0.75f, 1.0f)).toRgbaF32(), ColorRgbaF32(0.25f, 0.5f, 0.75f, 1.0f));
+}
@@ -1,6 +1,7 @@
 
 #include "gtest/gtest.h"
 #include "Core/DateTime.h"
+#include "Core/Timer.h"
 #include "Core/Unused.h"
 #include <iostream>
 #include <thread>
@@ -533,4 +534,80 @@ TEST(DateTime, specialCases)
     dt.setOffsetFromUtcInHours(-8);
     dt.addSeconds(0);
     EXPECT_EQ_DATETIME_WITHOUT_TIMEZONE(dt, ref);
-}
\ No newline at end of file
+}
+
+TEST(DateTime, formatter)
+{
+    // same strings as DateTime::toString, across seconds, minutes and days.
+    const int64_t start = 1514764799000ll - 1500; // dec 31 2017, 23:59:57.500 utc
+    const char* kFormats[] = { "%Y-%m-%d %H:%M:%S.zzz", "zzz %H:%M:%S", "%S", "%H:%M:%S.zzz zzz", "", "zzz" };
+    for (const char* format : kFormats)
+    {
+        DateTimeFormatter formatter(format);
+        EXPECT_EQ(formatter.getFormat(), format);
+        for (int64_t ms = start; ms < start + 5000; ms += 7)
+        {
+            ASSERT_EQ(formatter.format(ms), DateTime::fromMillisecondsSinceEpoch(ms).toString(format)) << format << " " << ms;
+        }
+
+        // going back in time
+        const int64_t ms = start + 86400000ll * 200 + 999;
+        EXPECT_EQ(formatter.format(ms), DateTime::fromMillisecondsSinceEpoch(ms).toString(format));
+        EXPECT_EQ(formatter.format(start), DateTime::fromMillisecondsSinceEpoch(start).toString(format));
+    }
+
+    DateTimeFormatter formatter;
+    formatter.setFormat("%H:%M:%S");
+    EXPECT_EQ(formatter.format(start), DateTime::fromMillisecondsSinceEpoch(start).toString("%H:%M:%S"));
+
+    // the monotonic clock follows the system clock and never goes backward.
+    int64_t previous = DateTime::monotonicMillisecondsSinceEpoch();
+    EXPECT_NEAR((double)previous, (double)DateTime::millisecondsSinceEpoch(), 50.0);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const int64_t now = DateTime::monotonicMillisecondsSinceEpoch();
+        ASSERT_GE(now, previous);
+        previous = now;
+    }
+    EXPECT_EQ(formatter.formatNow().size(), 8u);
+}
+
+// Prints the throughput of formatting timestamps, one per log line of a busy
+// log: a million timestamps, 10 per millisecond. Disabled by default, run it
+// with --gtest_also_run_disabled_tests.
+//
+TEST(DateTime, DISABLED_formatterBenchmark)
+{
+    const char* kFormat = "%Y-%m-%d %H:%M:%S.zzz";
+    const int kNumberOfTimestamps = 1000000;
+    const int64_t start = DateTime::millisecondsSinceEpoch();
+
+    // toString is slow, it is measured on a tenth of the timestamps.
+    Timer t;
+    size_t size = 0;
+    for (int i = 0; i < kNumberOfTimestamps / 10; ++i)
+    {
+        size += DateTime::fromMillisecondsSinceEpoch(start + i / 10).toString(kFormat).size();
+    }
+    const double toStringPerSecond = (kNumberOfTimestamps / 10) / t.elapsed();
+
+    t.start();
+    DateTimeFormatter formatter(kFormat);
+    size_t formatterSize = 0;
+    for (int i = 0; i < kNumberOfTimestamps; ++i)
+    {
+        formatterSize += formatter.format(start + i / 10).size();
+    }
+    const double formatterPerSecond = kNumberOfTimestamps / t.elapsed();
+
+    t.start();
+    for (int i = 0; i < kNumberOfTimestamps; ++i)
+    {
+        formatterSize += formatter.format(DateTime::monotonicMillisecondsSinceEpoch()).size();
+    }
+    const double formatNowPerSecond = kNumberOfTimestamps / t.elapsed();
+
+    EXPECT_EQ(formatterSize, 20 * size);
+    printf("timestamps per second, toString: %.0f, DateTimeFormatter: %.0f, with monotonic clock: %.0f\n",
+        toStringPerSecond, formatterPerSecond, formatNowPerSecond);
+}
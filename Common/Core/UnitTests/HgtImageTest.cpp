@@ -1,6 +1,7 @@
 #include "Core/FileInfo.h"
 #include "Core/Path.h"
 #include "Core/ImageSupport/HgtImage.h"
+#include "Core/StreamUtility.h"
 #include "gtest/gtest.h"
 #include "Math/IsEqual.h"
 #include "Math/Vector.h"
@@ -101,6 +102,30 @@ TEST(HgtImage, testHgtImageCustomType)
     }
 }
 
+// Loading with memory mapping must give the same data.
+//
+TEST(HgtImage, memoryMapped)
+{
+    HgtImage im;
+    im.setFilenamePath(getAssetsPath() + "/N45W072.hgt");
+    im.load();
+    ASSERT_TRUE(im.isValid());
+
+    HgtImage mapped;
+    mapped.setFilenamePath(getAssetsPath() + "/N45W072.hgt");
+    mapped.setMemoryMappingEnabled(true);
+    mapped.load();
+    ASSERT_TRUE(mapped.isValid());
+    EXPECT_TRUE(mapped.isMemoryMappingEnabled());
+    EXPECT_EQ(mapped.getImageData().size(), 1201 * 1201 * 2);
+    EXPECT_TRUE(mapped.getImageData() == im.getImageData());
+
+    const ByteArray file = readFromFile(getAssetsPath() + "/N45W072.hgt");
+    const ByteArray mappedFile = readFromFile(getAssetsPath() + "/N45W072.hgt", true);
+    EXPECT_TRUE(file == mappedFile);
+    EXPECT_TRUE(readFromFile(getAssetsPath() + "/doesNotExist.hgt", true).isEmpty());
+}
+
 // This test is disabled, it is there only to test the loading of
 // a 7GB srtm image.
 //
@@ -0,0 +1,173 @@
+
+#include <cmath>
+#include <cstdio>
+#include "Core/FileInfo.h"
+#include "Core/HgtTileCache.h"
+#include "Core/ImageSupport/HgtImage.h"
+#include "Core/Path.h"
+#include <fstream>
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    const int kSrtm3Size = 1201;
+    const int kTileSizeInBytes = kSrtm3Size * kSrtm3Size * 2;
+
+    std::string getAssetsPath()
+    {
+        FileInfo fi(Path::getApplicationFilePath());
+        return fi.getCanonicalPath() + "/../CoreAssets";
+    }
+
+    // a plane, in meters.
+    double getElevation(double iLatitude, double iLongitude)
+    {
+        return 500.0 * (iLatitude - 10.0) + 200.0 * (iLongitude - 20.0);
+    }
+
+    // Writes srtm3 tiles of getElevation() for latitudes 10 to 12 and
+    // longitudes 20 to 22 in the temporary folder, they are removed on
+    // destruction. The file is big endian, northernmost line first.
+    class TemporaryTiles
+    {
+    public:
+        TemporaryTiles()
+        {
+            vector<char> file(kTileSizeInBytes);
+            for (int lat = 10; lat <= 12; ++lat)
+                for (int lon = 20; lon <= 22; ++lon)
+                {
+                    for (int line = 0; line < kSrtm3Size; ++line)
+                        for (int i = 0; i < kSrtm3Size; ++i)
+                        {
+                            const double latitude = lat + (kSrtm3Size - 1 - line) / 1200.0;
+                            const double longitude = lon + i / 1200.0;
+                            const int16_t v = (int16_t)lround(getElevation(latitude, longitude));
+                            file[2 * (line * kSrtm3Size + i)] = (char)((v >> 8) & 0xff);
+                            file[2 * (line * kSrtm3Size + i) + 1] = (char)(v & 0xff);
+                        }
+                    mFilenamePaths.push_back(Path::join(getFolderPath(), HgtTileCache::getTileFileName(lat, lon)));
+                    ofstream ofs(mFilenamePaths.back(), ios::binary);
+                    ofs.write(file.data(), file.size());
+                }
+        }
+
+        ~TemporaryTiles()
+        {
+            for (const string& filenamePath : mFilenamePaths)
+            { std::remove(filenamePath.c_str()); }
+        }
+
+        string getFolderPath() const
+        { return Path::getTemporaryFolderPath(); }
+
+    private:
+        vector<string> mFilenamePaths;
+    };
+}
+
+//------------------------------------------------------------------------------
+TEST(HgtTileCache, sampleElevation)
+{
+    const TemporaryTiles tiles;
+    EXPECT_EQ(HgtTileCache::getTileFileName(45, -72), "N45W072.hgt");
+    EXPECT_EQ(HgtTileCache::getTileFileName(-5, 7), "S05E007.hgt");
+
+    HgtTileCache cache;
+    cache.setFolderPath(tiles.getFolderPath());
+    EXPECT_EQ(cache.getNumberOfLoadedTiles(), 0);
+
+    // the first sample queues the tile and does not wait for it.
+    double elevation = 0.0;
+    cache.sampleElevation(11.3, 21.7, &elevation);
+    cache.waitForPendingTiles();
+    EXPECT_EQ(cache.getNumberOfPendingTiles(), 0);
+    EXPECT_TRUE(cache.isTileLoaded(11, 21));
+    EXPECT_EQ(cache.getMemoryUsageInBytes(), (uint64_t)kTileSizeInBytes);
+
+    for (double lat = 11.0; lat < 12.0; lat += 0.0371)
+        for (double lon = 21.0; lon < 22.0; lon += 0.0419)
+        {
+            ASSERT_TRUE(cache.sampleElevation(lat, lon, &elevation));
+            EXPECT_NEAR(elevation, getElevation(lat, lon), 1.0);
+        }
+
+    // tiles without a file are missing.
+    EXPECT_FALSE(cache.sampleElevation(50.5, 21.5, &elevation));
+    cache.waitForPendingTiles();
+    EXPECT_FALSE(cache.sampleElevation(50.5, 21.5, &elevation));
+    EXPECT_FALSE(cache.isTileLoaded(50, 21));
+    EXPECT_EQ(cache.getNumberOfLoadedTiles(), 1);
+
+    cache.clear();
+    EXPECT_EQ(cache.getNumberOfLoadedTiles(), 0);
+    EXPECT_EQ(cache.getMemoryUsageInBytes(), 0u);
+
+    // a registered file gives the samples of HgtImage.
+    HgtTileCache assetCache;
+    EXPECT_FALSE(assetCache.addTile(getAssetsPath() + "/noCorner.hgt"));
+    ASSERT_TRUE(assetCache.addTile(getAssetsPath() + "/N45W072.hgt"));
+    assetCache.prefetch(45.5, -71.5, 0);
+    assetCache.waitForPendingTiles();
+    ASSERT_TRUE(assetCache.isTileLoaded(45, -72));
+
+    HgtImage hgt;
+    hgt.setFilenamePath(getAssetsPath() + "/N45W072.hgt");
+    hgt.load();
+    const int16_t *pSamples = (const int16_t*)hgt.getImageData().constData();
+    for (int j = 0; j < kSrtm3Size; j += 97)
+        for (int i = 0; i < kSrtm3Size; i += 89)
+        {
+            ASSERT_TRUE(assetCache.sampleElevation(45.0 + j / 1200.0, -72.0 + i / 1200.0, &elevation));
+            EXPECT_NEAR(elevation, pSamples[j * kSrtm3Size + i], 1e-6);
+        }
+}
+
+//------------------------------------------------------------------------------
+TEST(HgtTileCache, prefetchAndBudget)
+{
+    const TemporaryTiles tiles;
+
+    HgtTileCache cache;
+    cache.setFolderPath(tiles.getFolderPath());
+    cache.prefetch(11.5, 21.5, 2);
+    cache.waitForPendingTiles();
+
+    // 25 tiles around the point, only 9 have a file.
+    EXPECT_EQ(cache.getNumberOfLoadedTiles(), 9);
+    EXPECT_EQ(cache.getMemoryUsageInBytes(), 9u * kTileSizeInBytes);
+    for (int lat = 10; lat <= 12; ++lat)
+        for (int lon = 20; lon <= 22; ++lon)
+        {
+            EXPECT_TRUE(cache.isTileLoaded(lat, lon));
+        }
+
+    // the least recently sampled tiles are released first.
+    double elevation = 0.0;
+    EXPECT_TRUE(cache.sampleElevation(10.5, 20.5, &elevation));
+    EXPECT_TRUE(cache.sampleElevation(12.5, 22.5, &elevation));
+    cache.setMemoryBudgetInBytes(2 * kTileSizeInBytes + kTileSizeInBytes / 2);
+    EXPECT_EQ(cache.getNumberOfLoadedTiles(), 2);
+    EXPECT_TRUE(cache.isTileLoaded(10, 20));
+    EXPECT_TRUE(cache.isTileLoaded(12, 22));
+
+    // the budget holds while tiles are loaded.
+    cache.clear();
+    cache.prefetch(11.5, 21.5, 1);
+    cache.waitForPendingTiles();
+    EXPECT_EQ(cache.getNumberOfLoadedTiles(), 2);
+    EXPECT_LE(cache.getMemoryUsageInBytes(), cache.getMemoryBudgetInBytes());
+
+    // a new point of interest replaces the queued tiles.
+    cache.setMemoryBudgetInBytes(64ull * kTileSizeInBytes);
+    cache.prefetch(10.5, 20.5, 0);
+    cache.prefetch(12.5, 22.5, 0);
+    cache.waitForPendingTiles();
+    EXPECT_TRUE(cache.isTileLoaded(12, 22));
+    EXPECT_EQ(cache.getNumberOfPendingTiles(), 0);
+}
@@ -0,0 +1,82 @@
+
+#include "Core/FileInfo.h"
+#include "Core/ImageManifest.h"
+#include "Core/Path.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    std::string getAssetsPath()
+    {
+        FileInfo fi(Path::getApplicationFilePath());
+        return fi.getCanonicalPath() + "/../CoreAssets";
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(ImageManifest, scan)
+{
+    const vector<string> paths = {
+        getAssetsPath() + "/dices.png",
+        getAssetsPath() + "/dices.tga",
+        getAssetsPath() + "/dices.rgb",
+        getAssetsPath() + "/N45W072.hgt",
+        getAssetsPath() + "/RF16_gradient.raw",
+        getAssetsPath() + "/Lenna.png",
+        getAssetsPath() + "/missing.png",
+        getAssetsPath() + "/cameraman.tif" };
+
+    const ImageManifest manifest = ImageManifest::scan(paths);
+    ASSERT_EQ(manifest.getNumberOfEntries(), (int)paths.size());
+    EXPECT_EQ(manifest.getNumberOfValidEntries(), 6);
+
+    // the headers give what a full load gives.
+    uint64_t totalSizeInBytes = 0;
+    for (int i = 0; i < 6; ++i)
+    {
+        const ImageManifest::Entry& entry = manifest.getEntry(i);
+        EXPECT_EQ(entry.mFilenamePath, paths[i]);
+        ASSERT_TRUE(entry.mIsValid) << paths[i];
+
+        Image image(paths[i]);
+        ASSERT_TRUE(image.load());
+        EXPECT_EQ(entry.mFormat, Image::getFormatFromFilename(paths[i]));
+        EXPECT_EQ(entry.mSizeInPixels, image.getSizeInPixels()) << paths[i];
+        EXPECT_EQ(entry.mInternalFormat, image.getInternalFormat()) << paths[i];
+        EXPECT_EQ(entry.mSizeInBytes, image.getSizeInBytes()) << paths[i];
+        totalSizeInBytes += entry.mSizeInBytes;
+    }
+    EXPECT_EQ(manifest.getTotalSizeInBytes(), totalSizeInBytes);
+    EXPECT_EQ(manifest.getEntry(1).mSizeInPixels, Math::Vector2i(800, 600));
+    EXPECT_EQ(manifest.getEntry(3).mInternalFormat, iifRInt16);
+
+    // missing and unsupported files are invalid.
+    EXPECT_FALSE(manifest.getEntry(6).mIsValid);
+    EXPECT_FALSE(manifest.getEntry(7).mIsValid);
+    EXPECT_EQ(manifest.getEntry(7).mFormat, Image::fUnsupported);
+
+    ASSERT_NE(manifest.find(paths[3]), nullptr);
+    EXPECT_EQ(manifest.find(paths[3])->mSizeInBytes, 1201u * 1201u * 2u);
+    EXPECT_EQ(manifest.find("notScanned.png"), nullptr);
+
+    // load order
+    const vector<string> largestFirst = manifest.getFilenamePathsBySize();
+    ASSERT_EQ(largestFirst.size(), 6u);
+    for (size_t i = 1; i < largestFirst.size(); ++i)
+    {
+        EXPECT_GE(manifest.find(largestFirst[i - 1])->mSizeInBytes, manifest.find(largestFirst[i])->mSizeInBytes);
+    }
+    const vector<string> smallestFirst = manifest.getFilenamePathsBySize(false);
+    EXPECT_EQ(smallestFirst.front(), largestFirst.back());
+
+    ImageManifest empty = manifest;
+    empty.clear();
+    EXPECT_EQ(empty.getNumberOfEntries(), 0);
+    EXPECT_EQ(empty.find(paths[0]), nullptr);
+}
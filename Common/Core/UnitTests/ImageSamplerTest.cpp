@@ -0,0 +1,149 @@
+
+#include "gtest/gtest.h"
+#include "Core/Image.h"
+#include "Core/ImageSampler.h"
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+    using namespace Math;
+using namespace std;
+
+namespace
+{
+    // a 5x4 image where each pixel has a different color.
+    Image makeImage(ImageInternalFormat iIif)
+    {
+        Image im;
+        im.set(5, 4, iIif);
+        for (int y = 0; y < im.getHeight(); ++y)
+            for (int x = 0; x < im.getWidth(); ++x)
+            {
+                Color c;
+                c.setF64(x / 5.0, y / 4.0, (x + y) / 9.0, 1.0);
+                im.setPixelColor(Vector2i(x, y), c);
+            }
+        return im;
+    }
+
+    void expectNear(const Color& iA, const Color& iB, double iTolerance)
+    {
+        EXPECT_NEAR(iA.getRed(), iB.getRed(), iTolerance);
+        EXPECT_NEAR(iA.getGreen(), iB.getGreen(), iTolerance);
+        EXPECT_NEAR(iA.getBlue(), iB.getBlue(), iTolerance);
+        EXPECT_NEAR(iA.getAlpha(), iB.getAlpha(), iTolerance);
+    }
+}
+
+//------------------------------------------------------------------------------
+// The sampler must give the same colors as Image::getPixelColor(double, double)
+// inside and outside of the image, for every wrap type and storage layout.
+//
+TEST(ImageSampler, sameAsImage)
+{
+    EXPECT_FALSE(ImageSampler().isValid());
+    EXPECT_EQ(ImageSampler().sample(1.0, 1.0), Color());
+
+    const Image::WrapType wrapTypes[] = { Image::wtClampToBorder, Image::wtClampToEdge, Image::wtRepeat };
+    const ImageInternalFormat formats[] = { iifRgbaUint8, iifRgbF32, iifRUint16 };
+    const ImageSampler::StorageLayout layouts[] = { ImageSampler::slRowMajor, ImageSampler::slTiled };
+    for (ImageSampler::StorageLayout layout : layouts)
+    for (ImageInternalFormat iif : formats)
+    {
+        Image im = makeImage(iif);
+        for (Image::WrapType wt : wrapTypes)
+        {
+            im.setWrapType(wt);
+            ImageSampler sampler(im, layout);
+            ASSERT_TRUE(sampler.isValid());
+            EXPECT_EQ(sampler.getStorageLayout(), layout);
+            EXPECT_EQ(sampler.getWrapType(), wt);
+            EXPECT_EQ(sampler.getSizeInPixels(), Vector2i(5, 4));
+
+            vector<Vector2> pixels;
+            for (double y = -1.3; y < 6.0; y += 0.37)
+                for (double x = -1.1; x < 7.0; x += 0.41)
+                {
+                    pixels.push_back(Vector2(x, y));
+                    expectNear(sampler.sample(x, y), im.getPixelColor(x, y), 1e-12);
+                }
+
+            // batch
+            vector<Color> colors(pixels.size());
+            sampler.sample(pixels.data(), (int)pixels.size(), colors.data());
+            vector<Vector2> uvs;
+            for (size_t i = 0; i < pixels.size(); ++i)
+            {
+                EXPECT_EQ(colors[i], sampler.sample(pixels[i]));
+                uvs.push_back(Vector2(pixels[i].x() / 5.0, pixels[i].y() / 4.0));
+            }
+            sampler.sampleUV(uvs.data(), (int)uvs.size(), colors.data());
+            for (size_t i = 0; i < uvs.size(); ++i)
+            {
+                expectNear(colors[i], sampler.sample(pixels[i]), 1e-12);
+            }
+        }
+    }
+
+    // pixel centers give the pixel color.
+    const Image im = makeImage(iifRgbaF32);
+    ImageSampler sampler(im);
+    expectNear(sampler.sample(2.5, 1.5), im.getPixelColor(2, 1), 1e-7);
+    expectNear(sampler.sampleUV(Vector2(0.5, 0.375)), im.getPixelColor(2, 1), 1e-7);
+}
+
+//------------------------------------------------------------------------------
+TEST(ImageSampler, mipLevels)
+{
+    Image im;
+    im.set(8, 6, iifRgbaF32);
+    ImageSampler sampler(im);
+    EXPECT_EQ(sampler.getNumberOfMipLevels(), 1);
+    sampler.generateMipLevels();
+    ASSERT_EQ(sampler.getNumberOfMipLevels(), 4);
+    EXPECT_EQ(sampler.getSizeInPixels(1), Vector2i(4, 3));
+    EXPECT_EQ(sampler.getSizeInPixels(2), Vector2i(2, 1));
+    EXPECT_EQ(sampler.getSizeInPixels(3), Vector2i(1, 1));
+    EXPECT_EQ(sampler.getSizeInPixels(4), Vector2i(0, 0));
+
+    // the filter keeps a uniform color on every level.
+    const Color uniform(0.25, 0.5, 0.75, 1.0);
+    im.fill(uniform);
+    im.setWrapType(Image::wtClampToEdge);
+    const ImageSampler uniformSampler(im, ImageSampler::slTiled, true);
+    ASSERT_EQ(uniformSampler.getNumberOfMipLevels(), 4);
+    for (int l = 0; l < 4; ++l)
+    {
+        expectNear(uniformSampler.sampleUV(Vector2(0.5, 0.5), l), uniform, 1e-6);
+        expectNear(uniformSampler.sampleUV(Vector2(0.01, 0.99), l), uniform, 1e-6);
+    }
+
+    im.set(16, 16, iifRgbaF32);
+    for (int y = 0; y < 16; ++y)
+        for (int x = 0; x < 16; ++x)
+        {
+            // a checkerboard, away from the edges texels of level 1 are grey.
+            const double v = (x + y) % 2 == 0 ? 1.0 : 0.0;
+            im.setPixelColor(Vector2i(x, y), Color(v, v, v, 1.0));
+        }
+
+    const ImageSampler rowMajor(im, ImageSampler::slRowMajor, true);
+    const ImageSampler tiled(im, ImageSampler::slTiled, true);
+    ASSERT_EQ(rowMajor.getNumberOfMipLevels(), 5);
+    const Vector2 uv(6.5 / 16.0, 5.5 / 16.0); // center of pixel (6, 5)
+    expectNear(rowMajor.sampleUV(uv, 0.0), Color(0.0, 0.0, 0.0, 1.0), 1e-7);
+    expectNear(rowMajor.sampleUV(uv, 0.5), Color(0.25, 0.25, 0.25, 1.0), 1e-6);
+    expectNear(rowMajor.sampleUV(uv, 1.0), Color(0.5, 0.5, 0.5, 1.0), 1e-6);
+
+    // both layouts hold the same levels.
+    for (double lod = 0.0; lod <= 5.0; lod += 0.25)
+        for (double v = -0.1; v < 1.1; v += 0.07)
+            for (double u = -0.1; u < 1.1; u += 0.06)
+            {
+                EXPECT_EQ(tiled.sampleUV(Vector2(u, v), lod), rowMajor.sampleUV(Vector2(u, v), lod));
+            }
+
+    EXPECT_EQ(ImageSampler::getLod(0.5), 0.0);
+    EXPECT_EQ(ImageSampler::getLod(1.0), 0.0);
+    EXPECT_DOUBLE_EQ(ImageSampler::getLod(4.0), 2.0);
+}
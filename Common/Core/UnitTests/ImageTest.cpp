@@ -1,6 +1,8 @@
+#include <cstdio>
 #include "gtest/gtest.h"
 #include "Core/Image.h"
 #include "Core/ImageInternalFormat.h"
+#include "Core/ImageSupport/ImageBufferHelpers.h"
 #include "Core/Path.h"
 #include "Core/FileInfo.h"
 #include "Core/Timer.h"
@@ -512,6 +514,39 @@ TEST(Image, Tga_image_format)
     imTga.saveAs(getCurrentFolderPath() + "/converted_dices_tga.png", Image::wfPng);
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+TEST(Image, memoryMappedRaw)
+{
+    const std::string path = getCurrentFolderPath() + "/memoryMapped.raw";
+    const int w = 64, h = 32;
+    std::string data(w * h * 4, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+    { data[i] = (char)i; }
+
+    Image im;
+    im.setData(w, h, iifRgbaUint8, data.data());
+    ASSERT_TRUE(im.saveAs(path, Image::wfRaw));
+
+    Image mapped(path);
+    mapped.setMemoryMappingEnabled(true);
+    ASSERT_TRUE(mapped.load());
+    EXPECT_EQ(mapped.getSizeInPixels(), Vector2i(w, h));
+    EXPECT_EQ(mapped.getImageData().constString(), data);
+
+    // the data is copied before the file it is mapped from is overwritten.
+    EXPECT_TRUE(mapped.saveAs(path, Image::wfRaw));
+    ASSERT_TRUE(mapped.load());
+    EXPECT_EQ(mapped.getImageData().constString(), data);
+
+    // and before being modified.
+    mapped.setPixelColor(Vector2i(0, 0), Color((uint8_t)255, (uint8_t)0, (uint8_t)0, (uint8_t)255));
+    EXPECT_TRUE(mapped.saveAs(path, Image::wfRaw));
+    ASSERT_TRUE(mapped.load());
+    EXPECT_EQ(mapped.getImageData().size(), data.size());
+    EXPECT_EQ((unsigned char)mapped.getImageData()[0], 255);
+    EXPECT_EQ(mapped.getImageData().mid(4).constString(), data.substr(4));
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 TEST(Image, Hgt_image_format)
 {
@@ -529,4 +564,259 @@ TEST(Image, Hgt_image_format)
         Color c = hgtImage.getPixelColor(Vector2i(i, 0));
         EXPECT_EQ(c.getRedInt16(), compareTo[i]);
     }
-}
\ No newline at end of file
+}
+namespace
+{
+    // convertToInternalFormat() as it was done before the vectorized
+    // kernels, pixel by pixel through Color.
+    Image convertThroughColor(const Image& iInput, ImageInternalFormat iOutput,
+        bool iNormalize, double iMinValue, double iMaxValue)
+    {
+        Image o;
+        o.setData(iInput.getWidth(), iInput.getHeight(), iOutput, nullptr);
+        const double d = 1.0 / (iMaxValue - iMinValue);
+        for (int y = 0; y < iInput.getHeight(); ++y)
+            for (int x = 0; x < iInput.getWidth(); ++x)
+            {
+                Color c = iInput.getPixelColor(Vector2i(x, y));
+                if (iNormalize)
+                {
+                    c.set((c.getRed() - iMinValue) * d, (c.getGreen() - iMinValue) * d,
+                        (c.getBlue() - iMinValue) * d, (c.getAlpha() - iMinValue) * d);
+                }
+                o.setPixelColor(Vector2i(x, y), c);
+            }
+        return o;
+    }
+
+    // an image of random bytes, floats are in [0, 1].
+    Image makeRandomImage(int iWidth, int iHeight, ImageInternalFormat iIif)
+    {
+        Image im;
+        im.set(iWidth, iHeight, iIif);
+        ByteArray data(std::string((size_t)im.getSizeInBytes(), '\0'));
+        unsigned int seed = 12345;
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            data[i] = (char)(seed >> 16);
+        }
+        if (getBytesPerChannel(iIif) == 4)
+        {
+            float *p = (float*)data.data();
+            for (size_t i = 0; i < data.size() / 4; ++i)
+            { p[i] = (float)(((const uint8_t*)data.constData())[4 * i] / 255.0); }
+        }
+        im.setData(iWidth, iHeight, iIif, data.constData());
+        return im;
+    }
+
+    // smooth gradients with a bit of noise, the png encoder picks a variety
+    // of scanline filters on them.
+    Image makeGradientImage(int iWidth, int iHeight, ImageInternalFormat iIif)
+    {
+        Image im;
+        im.set(iWidth, iHeight, iIif);
+        const size_t lineSize = (size_t)im.getSizeInBytes() / iHeight;
+        ByteArray data(std::string((size_t)im.getSizeInBytes(), '\0'));
+        unsigned int seed = 12345;
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            const size_t x = i % lineSize, y = i / lineSize;
+            data[i] = (char)(x / 3 + 2 * y + ((seed >> 16) & 7));
+        }
+        im.setData(iWidth, iHeight, iIif, data.constData());
+        return im;
+    }
+
+    bool hasSameData(const Image& iA, const Image& iB)
+    {
+        return iA.getSizeInPixels() == iB.getSizeInPixels() &&
+            iA.getInternalFormat() == iB.getInternalFormat() &&
+            iA.getImageData().size() == iB.getImageData().size() &&
+            memcmp(iA.getImageData().constData(), iB.getImageData().constData(), iA.getImageData().size()) == 0;
+    }
+
+    void expectSameImages(const Image& iA, const Image& iB, double iTolerance)
+    {
+        ASSERT_EQ(iA.getSizeInPixels(), iB.getSizeInPixels());
+        ASSERT_EQ(iA.getInternalFormat(), iB.getInternalFormat());
+        int numberOfDifferences = 0;
+        for (int y = 0; y < iA.getHeight(); ++y)
+            for (int x = 0; x < iA.getWidth(); ++x)
+            {
+                const Color a = iA.getPixelColor(Vector2i(x, y));
+                const Color b = iB.getPixelColor(Vector2i(x, y));
+                if (fabs(a.getRed() - b.getRed()) > iTolerance ||
+                    fabs(a.getGreen() - b.getGreen()) > iTolerance ||
+                    fabs(a.getBlue() - b.getBlue()) > iTolerance ||
+                    fabs(a.getAlpha() - b.getAlpha()) > iTolerance)
+                { ++numberOfDifferences; }
+            }
+        EXPECT_EQ(numberOfDifferences, 0);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// The vectorized conversions must give the same result as the conversion
+// through Color.
+//
+TEST(Image, convertToInternalFormat)
+{
+    // Color truncates some uint8 values one step down, ex: 148 / 255 * 255
+    // gives 147.99999. The kernels do not.
+    const double kOneUint8Step = 1.0 / 255.0 + 1e-9;
+    struct Case { ImageInternalFormat mInput; ImageInternalFormat mOutput; bool mNormalize; double mTolerance; };
+    const Case cases[] = {
+        { iifRgbUint8, iifRgbaF32, false, 1e-6 },
+        { iifRgbaUint8, iifRgbaF32, true, 1e-5 },
+        { iifRInt16, iifRF32, true, 1e-5 },
+        { iifRgbInt16, iifRgbaF16, false, 1e-3 },
+        { iifRgbaUint16, iifRF32, false, 1e-6 },
+        { iifRgbaF32, iifRgbaF16, false, 1e-3 },
+        { iifRgbUint8, iifRgbaUint8, false, kOneUint8Step },
+        { iifRUint8, iifRgbUint8, false, kOneUint8Step },
+        { iifRgbaF32, iifRgbaUint8, false, kOneUint8Step },
+        { iifRgbaUint8, iifRgbUint8, false, kOneUint8Step },
+        { iifRgbInt8, iifRgbaF32, false, 0.0 }, // through Color
+    };
+
+    for (const Case &c : cases)
+    {
+        // wide enough for the simd loops and their scalar tails, tall
+        // enough to be converted by many threads.
+        const Image input = makeRandomImage(301, 250, c.mInput);
+        const double minValue = c.mNormalize ? -0.25 : 0.0;
+        const double maxValue = c.mNormalize ? 0.75 : 1.0;
+
+        const Image converted = convertToInternalFormat(input, c.mOutput, c.mNormalize, minValue, maxValue);
+        const Image expected = convertThroughColor(input, c.mOutput, c.mNormalize, minValue, maxValue);
+        SCOPED_TRACE(testing::Message() << "from " << c.mInput << " to " << c.mOutput);
+        expectSameImages(converted, expected, c.mTolerance);
+    }
+
+    // uint8 channels are kept as is.
+    const Image rgb = makeRandomImage(301, 3, iifRgbUint8);
+    const Image rgba = convertToInternalFormat(rgb, iifRgbaUint8, false, 0.0, 1.0);
+    const ByteArray rgbData = rgb.getImageData(), rgbaData = rgba.getImageData();
+    int numberOfDifferences = 0;
+    for (size_t i = 0; i < rgbData.size() / 3; ++i)
+    {
+        numberOfDifferences += memcmp(rgbData.constData() + 3 * i, rgbaData.constData() + 4 * i, 3) != 0;
+        numberOfDifferences += rgbaData[4 * i + 3] != 0;
+    }
+    EXPECT_EQ(numberOfDifferences, 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Png written by saveAs() are decoded by PngImage directly in the image data.
+//
+TEST(Image, pngRoundTrip)
+{
+    const ImageInternalFormat formats[] = { iifRUint8, iifRgbUint8, iifRgbaUint8, iifRgbUint16, iifRgbaUint16 };
+    for (ImageInternalFormat iif : formats)
+        for (bool isMapped : { false, true })
+        {
+            SCOPED_TRACE(testing::Message() << "format " << iif << ", mapped " << isMapped);
+            const Image source = makeGradientImage(257, 131, iif);
+            Image copy = source;
+            const std::string path = getCurrentFolderPath() + "/pngRoundTrip.png";
+            ASSERT_TRUE(copy.saveAs(path, Image::wfPng));
+
+            Image loaded;
+            loaded.set(path);
+            loaded.setMemoryMappingEnabled(isMapped);
+            ASSERT_TRUE(loaded.load());
+            EXPECT_TRUE(hasSameData(loaded, source));
+        }
+
+    // the rows come out in the order of the file when not flipped.
+    Image source = makeGradientImage(16, 8, iifRgbaUint8);
+    source.saveAs(getCurrentFolderPath() + "/pngRoundTrip.png", Image::wfPng);
+    PngImage png;
+    png.setFilenamePath(getCurrentFolderPath() + "/pngRoundTrip.png");
+    png.load(false);
+    ASSERT_TRUE(png.isValid());
+    EXPECT_EQ(memcmp(png.getImageData().constData(), source.getImageData().constData() + 7 * 16 * 4, 16 * 4), 0);
+
+    Image missing;
+    missing.set(getCurrentFolderPath() + "/missing.png");
+    EXPECT_FALSE(missing.load());
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+TEST(Image, saveAsAsync)
+{
+    const std::string path = getCurrentFolderPath() + "/saveAsAsync.png";
+    const Image source = makeGradientImage(300, 200, iifRgbaUint8);
+    Image im = source;
+    std::future<bool> saved = im.saveAsAsync(path, Image::wfPng);
+    EXPECT_EQ(im.getFilenamePath(), path);
+
+    // the image can be modified while it is saved.
+    im.fill(Color(1.0, 0.0, 0.0, 1.0));
+    ASSERT_TRUE(saved.get());
+
+    Image loaded(path);
+    loaded.load();
+    EXPECT_TRUE(hasSameData(loaded, source));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// The image is written while several saves of it are in flight, each file
+// holds the image as it was when saveAsAsync() was called.
+//
+TEST(Image, saveAsAsync_writeWhileSaving)
+{
+    const int kNumberOfSaves = 8;
+    Image im = makeGradientImage(64, 48, iifRgbaUint8);
+    std::vector<Image> expected;
+    std::vector<std::string> paths;
+    std::vector<std::future<bool>> saved;
+    for (int i = 0; i < kNumberOfSaves; ++i)
+    {
+        paths.push_back(getCurrentFolderPath() + "/saveAsAsync" + std::to_string(i) + ".png");
+        expected.push_back(im);
+        saved.push_back(im.saveAsAsync(paths.back(), Image::wfPng));
+
+        // keeps writing while the saves run.
+        for (int j = 0; j < 16; ++j)
+        {
+            im.fill(Color(i / 8.0, j / 16.0, 0.5, 1.0));
+        }
+    }
+
+    for (int i = 0; i < kNumberOfSaves; ++i)
+    {
+        ASSERT_TRUE(saved[i].get());
+        Image loaded(paths[i]);
+        loaded.load();
+        EXPECT_TRUE(hasSameData(loaded, expected[i]));
+        std::remove(paths[i].c_str());
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+TEST(Image, loadAll)
+{
+    std::vector<std::string> paths;
+    std::vector<Image> sources;
+    for (int i = 0; i < 6; ++i)
+    {
+        sources.push_back(makeGradientImage(20 + i, 10 + 2 * i, i % 2 ? iifRgbUint8 : iifRgbaUint16));
+        paths.push_back(getCurrentFolderPath() + "/loadAll" + std::to_string(i) + ".png");
+        sources.back().saveAs(paths.back(), Image::wfPng);
+    }
+    paths.push_back(getCurrentFolderPath() + "/missing.png");
+
+    const std::vector<Image> images = Image::loadAll(paths);
+    ASSERT_EQ(images.size(), paths.size());
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        EXPECT_TRUE(images[i].isValid());
+        EXPECT_EQ(images[i].getFilenamePath(), paths[i]);
+        EXPECT_TRUE(hasSameData(images[i], sources[i]));
+    }
+    EXPECT_FALSE(images.back().isValid());
+}
@@ -0,0 +1,114 @@
+
+#include "gtest/gtest.h"
+#include "Core/Image.h"
+#include "Core/ImageView.h"
+
+using namespace Realisim;
+    using namespace Core;
+    using namespace Math;
+using namespace std;
+
+namespace
+{
+    Color makeColor(uint8_t iR, uint8_t iG, uint8_t iB, uint8_t iA)
+    {
+        Color c;
+        c.setUint8(iR, iG, iB, iA);
+        return c;
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(ImageView, access)
+{
+    Image im;
+    im.set(4, 3, iifRgbaUint8);
+
+    ImageView<iifRgbaUint8> view(im);
+    ASSERT_TRUE(view.isValid());
+    EXPECT_EQ(view.getWidth(), 4);
+    EXPECT_EQ(view.getHeight(), 3);
+    EXPECT_EQ(ImageView<iifRgbaUint8>::kBytesPerPixel, 4);
+    EXPECT_EQ(ImageView<iifRgbF32>::kBytesPerPixel, 12);
+    EXPECT_EQ(ImageView<iifRUint16>::kNumberOfChannels, 1);
+
+    const Color c = makeColor(10, 20, 30, 40);
+    view.setPixelColor(2, 1, c);
+    EXPECT_EQ(im.getPixelColor(2, 1), c);
+    EXPECT_EQ(view.getPixelColor(2, 1), c);
+
+    uint8_t *row = view.getRow(1);
+    EXPECT_EQ(row[2 * 4 + 0], 10);
+    EXPECT_EQ(row[2 * 4 + 3], 40);
+    EXPECT_EQ(view.getPixel(2, 1), row + 8);
+
+    // the format must match.
+    Image rgb;
+    rgb.set(4, 3, iifRgbUint8);
+    ConstImageView<iifRgbUint8> rgbView(rgb);
+    EXPECT_TRUE(rgbView.isValid());
+    EXPECT_FALSE(ImageView<iifRgbaUint8>().isValid());
+
+    // a mutable view detaches the data once, a const view does not.
+    Image copy = im;
+    ConstImageView<iifRgbaUint8> constView(copy);
+    EXPECT_EQ(constView.getRow(0), (const uint8_t*)im.getImageData().constData());
+    ImageView<iifRgbaUint8> copyView(copy);
+    copyView.setPixelColor(0, 0, c);
+    EXPECT_EQ(copy.getPixelColor(0, 0), c);
+    EXPECT_NE(im.getPixelColor(0, 0), c);
+}
+
+//------------------------------------------------------------------------------
+TEST(ImageView, fillAndCopy)
+{
+    const Color red = makeColor(255, 0, 0, 255);
+    const Color blue = makeColor(0, 0, 255, 255);
+
+    Image im;
+    im.set(8, 8, iifRgbaUint8);
+    im.fill(blue);
+    im.fill(Vector2i(-2, 6), Vector2i(4, 4), red); // clipped
+    for (int y = 0; y < 8; ++y)
+        for (int x = 0; x < 8; ++x)
+        {
+            EXPECT_EQ(im.getPixelColor(x, y), (x < 2 && y >= 6) ? red : blue);
+        }
+
+    // copy between images of the same format.
+    Image source;
+    source.set(3, 3, iifRgbaUint8);
+    source.fill(red);
+    Image destination = im;
+    EXPECT_TRUE(destination.copyRect(source, Vector2i(1, 1), Vector2i(2, 2), Vector2i(6, 0)));
+    EXPECT_EQ(destination.getPixelColor(6, 0), red);
+    EXPECT_EQ(destination.getPixelColor(7, 1), red);
+    EXPECT_EQ(destination.getPixelColor(5, 0), blue);
+    EXPECT_EQ(destination.getPixelColor(6, 2), blue);
+    EXPECT_EQ(im.getPixelColor(6, 0), blue); // copy-on-write
+
+    destination.blit(source, Vector2i(-1, 5));
+    EXPECT_EQ(destination.getPixelColor(0, 5), red);
+    EXPECT_EQ(destination.getPixelColor(1, 7), red);
+    EXPECT_EQ(destination.getPixelColor(2, 5), blue);
+
+    Image other;
+    other.set(3, 3, iifRgbUint8);
+    EXPECT_FALSE(destination.copyRect(other, Vector2i(0, 0), Vector2i(3, 3), Vector2i(0, 0)));
+
+    // overlapping copy in the same image, downward and upward.
+    Image gradient;
+    gradient.set(1, 8, iifRUint8);
+    ImageView<iifRUint8> g(gradient);
+    for (int y = 0; y < 8; ++y) { *g.getPixel(0, y) = (uint8_t)y; }
+    g.copyRect(g, Vector2i(0, 0), Vector2i(1, 6), Vector2i(0, 2));
+    for (int y = 2; y < 8; ++y) { EXPECT_EQ(*g.getPixel(0, y), y - 2); }
+    g.copyRect(g, Vector2i(0, 2), Vector2i(1, 6), Vector2i(0, 0));
+    for (int y = 0; y < 6; ++y) { EXPECT_EQ(*g.getPixel(0, y), y); }
+
+    // other formats go through the same kernels.
+    Image f32;
+    f32.set(4, 4, iifRgbF32);
+    f32.fill(Color(0.25, 0.5, 0.75, 1.0));
+    EXPECT_FLOAT_EQ((float)f32.getPixelColor(3, 3).getGreen(), 0.5f);
+}
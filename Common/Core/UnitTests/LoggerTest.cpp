@@ -1,9 +1,54 @@
+// Only llNormal is compiled in this file, see Logger.disabledLevels.
+#define REALISIM_COMPILED_LOG_LEVELS (Realisim::Core::Logger::llNormal)
+
+#include <cstdio>
 #include "gtest/gtest.h"
+#include "Core/FileInfo.h"
 #include "Core/Logger.h"
+#include "Core/Path.h"
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace Realisim;
 using namespace Core;
 
+namespace
+{
+    std::string getCurrentFolderPath()
+    {
+        FileInfo fi(Path::getApplicationFilePath());
+        return fi.getCanonicalPath();
+    }
+
+    std::string readFile(const std::string& iFilepath)
+    {
+        std::ifstream ifs(iFilepath, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    // Logs entries covering the conversions supported by the binary format.
+    void logAllConversions()
+    {
+        Logger& l = Logger::getInstance();
+        const std::string longString(3000, 'x');
+        int i = 42;
+
+        LOG_TRACE(Logger::llNormal, "no argument");
+        LOG_TRACE(Logger::llNormal, "%d %i %5d %-5d| %05d", 1, -2, 3, 4, -5);
+        LOG_TRACE(Logger::llNormal, "%lld %llu %u %x %X %o %#x", -1234567890123ll, 18446744073709551615ull, 4000000000u, 255, 255, 8, 16);
+        LOG_TRACE(Logger::llNormal, "%hd %ld %zu", (short)-7, 123456789L, (size_t)99);
+        LOG_TRACE(Logger::llNormal, "%f %.3f %10.2f %e %g %G", 0.5, 3.14159, -2.5f, 12345.678, 0.0001, 1e20);
+        LOG_TRACE(Logger::llNormal, "%c%c %s %10s|%-10s| %.3s", 'o', 'k', "patate", "right", "left", "truncated");
+        LOG_TRACE(Logger::llNormal, "%*d %.*f %%", 6, 7, 2, 1.23456);
+        LOG_TRACE(Logger::llNormal, "%p %p", (void*)&i, (void*)nullptr);
+        LOG_TRACE(Logger::llNormal, "long: %s", longString.c_str());
+        LOG_TRACE_ERROR(Logger::llNormal, "error %d", i);
+        l.log("plain log() %s %d", "call", i);
+    }
+}
+
 TEST(Logger, test)
 {
     Logger& l = Logger::getInstance();
@@ -43,3 +88,158 @@ TEST(Logger, test)
     //    LOG_TRACE(Logger::llNormal, "v: %d", i);
     //}
 }
+
+// Many threads log at the same time in asynchronous mode. After flush(), all
+// entries must be in the file, whole, and in order for each thread.
+//
+TEST(Logger, asynchronous)
+{
+    const std::string filepath = getCurrentFolderPath() + "/asynchronousLog.txt";
+    const int kNumThreads = 4;
+    const int kNumEntries = 2000;
+
+    Logger& l = Logger::getInstance();
+    Logger::Config previousConfig = l.getConfig();
+    Logger::Config c;
+    c.mLogToStdOut = false;
+    c.mLogToFile = true;
+    c.mFilepath = filepath;
+    c.mIsAsynchronous = true;
+    l.setConfig(c);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t)
+    {
+        threads.push_back(std::thread([t, kNumEntries]() {
+            for (int i = 0; i < kNumEntries; ++i)
+            {
+                LOG_TRACE(Logger::llNormal, "thread %d entry %d", t, i);
+            }
+        }));
+    }
+    for (auto &t : threads)
+    { t.join(); }
+    l.flush();
+
+    std::vector<int> nextEntry(kNumThreads, 0);
+    std::ifstream ifs(filepath);
+    std::string line;
+    int numLines = 0;
+    while (std::getline(ifs, line))
+    {
+        // 2018-01-01 00:00:00.000 - [function] thread t entry i
+        ASSERT_GT(line.size(), 26u);
+        EXPECT_EQ(line.substr(23, 3), " - ");
+
+        int t = -1, i = -1;
+        const size_t pos = line.find("thread ");
+        ASSERT_NE(pos, std::string::npos);
+        ASSERT_EQ(sscanf(line.c_str() + pos, "thread %d entry %d", &t, &i), 2);
+        ASSERT_TRUE(t >= 0 && t < kNumThreads);
+        EXPECT_EQ(i, nextEntry[t]);
+        nextEntry[t] = i + 1;
+        ++numLines;
+    }
+    EXPECT_EQ(numLines, kNumThreads * kNumEntries);
+    ifs.close();
+
+    l.setConfig(previousConfig);
+    std::remove(filepath.c_str());
+}
+
+// A LOG_TRACE of a level that is not compiled in, or not enabled at runtime,
+// must not evaluate its arguments.
+//
+TEST(Logger, disabledLevels)
+{
+    Logger& l = Logger::getInstance();
+    Logger::Config previousConfig = l.getConfig();
+    int numberOfEvaluations = 0;
+
+    // llVerbose is not in REALISIM_COMPILED_LOG_LEVELS for this file.
+    Logger::Config c;
+    c.mLogToStdOut = false;
+    c.mLogLevel = Logger::llNormal | Logger::llVerbose;
+    l.setConfig(c);
+    EXPECT_TRUE(l.isLogLevelEnabled(Logger::llVerbose));
+    LOG_TRACE(Logger::llVerbose, "%d", ++numberOfEvaluations);
+    LOG_TRACE_ERROR(Logger::llVerbose, "%d", ++numberOfEvaluations);
+    EXPECT_EQ(numberOfEvaluations, 0);
+
+    // llNormal is compiled in but disabled in the config.
+    c.mLogLevel = Logger::llVerbose;
+    l.setConfig(c);
+    EXPECT_FALSE(l.isLogLevelEnabled(Logger::llNormal));
+    LOG_TRACE(Logger::llNormal, "%d", ++numberOfEvaluations);
+    LOG_TRACE_ERROR(Logger::llNormal, "%d", ++numberOfEvaluations);
+    EXPECT_EQ(numberOfEvaluations, 0);
+
+    c.mLogLevel = Logger::llNormal;
+    l.setConfig(c);
+    LOG_TRACE(Logger::llNormal, "%d", ++numberOfEvaluations);
+    EXPECT_EQ(numberOfEvaluations, 1);
+
+    l.setConfig(previousConfig);
+}
+
+// The same entries are logged in text and in binary format. Once decoded, the
+// binary log must be identical to the text log.
+//
+TEST(Logger, binaryFormat)
+{
+    const std::string textFilepath = getCurrentFolderPath() + "/textLog.txt";
+    const std::string binaryFilepath = getCurrentFolderPath() + "/binaryLog.bin";
+    const std::string decodedFilepath = getCurrentFolderPath() + "/decodedLog.txt";
+
+    Logger& l = Logger::getInstance();
+    Logger::Config previousConfig = l.getConfig();
+
+    for (int async = 0; async < 2; ++async)
+    {
+        Logger::Config c;
+        c.mLogToStdOut = false;
+        c.mLogToFile = true;
+        c.mAddTimestampToLogEntry = false;
+        c.mIsAsynchronous = async == 1;
+
+        c.mFilepath = textFilepath;
+        l.setConfig(c);
+        logAllConversions();
+        l.flush();
+
+        c.mFilepath = binaryFilepath;
+        c.mLogFormat = Logger::lfBinary;
+        l.setConfig(c);
+        logAllConversions();
+        logAllConversions(); // formats are written once
+        l.setConfig(previousConfig);
+
+        EXPECT_TRUE(Logger::decodeBinaryLog(binaryFilepath, decodedFilepath));
+        const std::string text = readFile(textFilepath);
+        EXPECT_FALSE(text.empty());
+        EXPECT_EQ(readFile(decodedFilepath), text + text);
+    }
+
+    // with timestamps
+    Logger::Config c;
+    c.mLogToStdOut = false;
+    c.mLogToFile = true;
+    c.mFilepath = binaryFilepath;
+    c.mLogFormat = Logger::lfBinary;
+    l.setConfig(c);
+    LOG_TRACE(Logger::llNormal, "timestamped %d", 1);
+    l.setConfig(previousConfig);
+
+    EXPECT_TRUE(Logger::decodeBinaryLog(binaryFilepath, decodedFilepath));
+    const std::string decoded = readFile(decodedFilepath);
+    ASSERT_GT(decoded.size(), 26u);
+    EXPECT_EQ(decoded.substr(23, 3), " - ");
+    EXPECT_NE(decoded.find("timestamped 1"), std::string::npos);
+
+    // not a binary log
+    EXPECT_FALSE(Logger::decodeBinaryLog(textFilepath, decodedFilepath));
+
+    std::remove(textFilepath.c_str());
+    std::remove(binaryFilepath.c_str());
+    std::remove(decodedFilepath.c_str());
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include <cstring>
+#include "Core/MemoryPool.h"
+#include "Core/MessageQueue.h"
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    class PooledMessage : public MessageQueue::Message
+    {
+    public:
+        PooledMessage() : MessageQueue::Message() {}
+        char mPayload[100];
+    };
+}
+
+//
+TEST(MemoryPool, sizeClasses)
+{
+    EXPECT_EQ(MemoryPool::toSizeClass(0), 0);
+    EXPECT_EQ(MemoryPool::toSizeClass(1), 0);
+    EXPECT_EQ(MemoryPool::toSizeClass(16), 0);
+    EXPECT_EQ(MemoryPool::toSizeClass(17), 1);
+    EXPECT_EQ(MemoryPool::toSizeClass(MemoryPool::getMaximumBlockSize()), MemoryPool::getNumberOfSizeClasses() - 1);
+    EXPECT_EQ(MemoryPool::toSizeClass(MemoryPool::getMaximumBlockSize() + 1), -1);
+}
+
+// Blocks freed are reused by the next allocations of the same thread.
+//
+TEST(MemoryPool, allocateDeallocate)
+{
+    const size_t kSize = 40;
+    const int sizeClass = MemoryPool::toSizeClass(kSize);
+    const MemoryPool::Statistics before = MemoryPool::getStatistics(sizeClass);
+
+    vector<void*> blocks;
+    for (int i = 0; i < 1000; ++i)
+    {
+        blocks.push_back(MemoryPool::allocate(kSize));
+        memset(blocks.back(), i % 256, kSize);
+    }
+    for (auto b : blocks)
+    { MemoryPool::deallocate(b, kSize); }
+
+    void *p = MemoryPool::allocate(kSize);
+    EXPECT_EQ(p, blocks.back());
+    MemoryPool::deallocate(p, kSize);
+
+    const MemoryPool::Statistics after = MemoryPool::getStatistics(sizeClass);
+    EXPECT_EQ(after.mBlockSize, 48u);
+    EXPECT_EQ(after.mNumberOfAllocations - before.mNumberOfAllocations, 1001u);
+    EXPECT_EQ(after.mNumberOfDeallocations - before.mNumberOfDeallocations, 1001u);
+    EXPECT_GT(after.mNumberOfPoolHits - before.mNumberOfPoolHits, 900u);
+    EXPECT_GE(after.mNumberOfSlabs, 1u);
+
+    // too large, goes to the heap
+    const uint64_t heapBefore = MemoryPool::getStatistics().mNumberOfHeapAllocations;
+    p = MemoryPool::allocate(MemoryPool::getMaximumBlockSize() + 1);
+    MemoryPool::deallocate(p, MemoryPool::getMaximumBlockSize() + 1);
+    EXPECT_EQ(MemoryPool::getStatistics().mNumberOfHeapAllocations, heapBefore + 1);
+}
+
+// Messages are allocated by the main thread and deleted by the thread
+// consuming the queue, the way LightBeam does.
+//
+TEST(MemoryPool, messagesAcrossThreads)
+{
+    const int sizeClass = MemoryPool::toSizeClass(sizeof(PooledMessage));
+    const MemoryPool::Statistics before = MemoryPool::getStatistics(sizeClass);
+
+    MessageQueue q;
+    q.setOneByOneProcessingFunction([](MessageQueue::Message*) {});
+    q.startInThread();
+
+    const int kNumMessages = 20000;
+    for (int i = 0; i < kNumMessages; ++i)
+    {
+        q.post(new PooledMessage());
+    }
+    q.waitForThreadToFinish();
+
+    const MemoryPool::Statistics after = MemoryPool::getStatistics(sizeClass);
+    const uint64_t numAllocations = after.mNumberOfAllocations - before.mNumberOfAllocations;
+    const uint64_t numHits = after.mNumberOfPoolHits - before.mNumberOfPoolHits;
+    EXPECT_EQ(numAllocations, (uint64_t)kNumMessages);
+    EXPECT_EQ(after.mNumberOfDeallocations - before.mNumberOfDeallocations, (uint64_t)kNumMessages);
+    EXPECT_GT(numHits, numAllocations / 2);
+}
@@ -1,9 +1,14 @@
 
+#include <atomic>
 #include <chrono>
 #include "Core/MessageQueue.h"
+#include "Core/ThreadPool.h"
+#include "Core/Timer.h"
 #include "gtest/gtest.h"
+#include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 using namespace Realisim;
     using namespace Core;
@@ -56,6 +61,41 @@ namespace
         cout << m->mText << endl;
     }
 
+    // posts iNumMessages from iNumThreads producers to a queue consumed by
+    // iNumThreads threads. Returns the time in seconds it took to process
+    // all messages.
+    //
+    double runContention(MessageQueue::StorageType iStorageType, int iNumThreads, int iNumMessages)
+    {
+        std::atomic<int> numProcessed(0);
+        MessageQueue q(iStorageType, 1 << 16);
+        q.setOneByOneProcessingFunction([&numProcessed](MessageQueue::Message*) { numProcessed++; });
+        q.setNumberOfThreads(iNumThreads);
+        q.startInThread();
+
+        Timer t;
+        const int numMessagesPerProducer = iNumMessages / iNumThreads;
+        vector<thread> producers;
+        for (int i = 0; i < iNumThreads; ++i)
+        {
+            producers.push_back(thread([&q, numMessagesPerProducer]() {
+                for (int j = 0; j < numMessagesPerProducer; ++j)
+                {
+                    q.post(new MessageQueue::Message());
+                }
+            }));
+        }
+
+        for (auto &p : producers)
+        { p.join(); }
+        q.waitForThreadToFinish();
+        const double elapsed = t.elapsed();
+
+        EXPECT_EQ(numProcessed.load(), numMessagesPerProducer * iNumThreads);
+        EXPECT_EQ(q.getNumberOfMessages(), 0);
+        return elapsed;
+    }
+
     // this processing function is on the work thread and
     // simulates an heavy computation.
     //
@@ -242,4 +282,426 @@ TEST(MessageQueue, MultipleConsumers)
     gDoneQueue.clear();
 
     EXPECT_EQ(qThreaded.getNumberOfMessages(), 0);
-}
\ No newline at end of file
+}
+
+// Same as oneToOneFast_waitForThreadToFinish, but with the lock free storage.
+//
+TEST(MessageQueue, lockFreeRingBuffer_waitForThreadToFinish)
+{
+    MessageQueue qThreaded(MessageQueue::stLockFreeRingBuffer, 16);
+    EXPECT_EQ(qThreaded.getStorageType(), MessageQueue::stLockFreeRingBuffer);
+
+    using placeholders::_1;
+    gDoneQueue.setOneByOneProcessingFunction(bind(processDoneQueue, _1));
+
+    qThreaded.setOneByOneProcessingFunction(std::bind(processOneToOne, _1));
+    qThreaded.startInThread();
+
+    OneToOneMessage *m0 = new OneToOneMessage; m0->mText = "message0";
+    OneToOneMessage *m1 = new OneToOneMessage; m1->mText = "message1";
+    OneToOneMessage *m2 = new OneToOneMessage; m2->mText = "message2";
+
+    qThreaded.post(m0);
+    qThreaded.post(m1);
+    qThreaded.post(m2);
+
+    gLifoTest = false;
+    gIndexOfProcessedMessage = 0;
+
+    qThreaded.waitForThreadToFinish();
+    gDoneQueue.processMessages();
+
+    EXPECT_EQ(gIndexOfProcessedMessage, 3);
+    EXPECT_EQ(qThreaded.getNumberOfMessages(), 0);
+}
+
+// When the ring is full and a maximum size is set, the oldest messages
+// are dropped.
+//
+TEST(MessageQueue, lockFreeRingBuffer_sizeLimited)
+{
+    MessageQueue q(MessageQueue::stLockFreeRingBuffer, 4);
+    q.setMaximumSize(3);
+
+    vector<string> processed;
+    q.setOneByOneProcessingFunction([&processed](MessageQueue::Message* ipM) {
+        processed.push_back(dynamic_cast<OneToOneMessage*>(ipM)->mText); });
+
+    for (int i = 0; i < 10; ++i)
+    {
+        OneToOneMessage *m = new OneToOneMessage; m->mText = "message" + to_string(i);
+        q.post(m);
+    }
+    EXPECT_EQ(q.getNumberOfMessages(), 3);
+
+    q.processMessages();
+    ASSERT_EQ(processed.size(), 3u);
+    EXPECT_EQ(processed[0], "message7");
+    EXPECT_EQ(processed[1], "message8");
+    EXPECT_EQ(processed[2], "message9");
+    EXPECT_TRUE(q.isEmpty());
+}
+
+// Compares the deque+mutex storage with the lock free ring when many
+// threads post and consume at the same time. Disabled by default, run it
+// with --gtest_also_run_disabled_tests.
+//
+TEST(MessageQueue, DISABLED_contentionBenchmark)
+{
+    const int kNumMessages = 1 << 16;
+
+    printf("threads    deque (msg/s)    lock free (msg/s)\n");
+    for (int n = 1; n <= 64; n *= 2)
+    {
+        const double dequeTime = runContention(MessageQueue::stDeque, n, kNumMessages);
+        const double ringTime = runContention(MessageQueue::stLockFreeRingBuffer, n, kNumMessages);
+        printf("%7d %16.0f %20.0f\n", n,
+            kNumMessages / max(dequeTime, 1e-9),
+            kNumMessages / max(ringTime, 1e-9));
+    }
+}
+
+// Many queues processed by the same pool. Queues with a single thread
+// must still process their messages in order.
+//
+TEST(MessageQueue, threadPool)
+{
+    ThreadPool pool(4);
+
+    const int kNumQueues = 8;
+    const int kNumMessages = 500;
+    vector<unique_ptr<MessageQueue>> queues;
+    vector<vector<string>> processed(kNumQueues);
+    for (int i = 0; i < kNumQueues; ++i)
+    {
+        queues.push_back(unique_ptr<MessageQueue>(new MessageQueue()));
+        vector<string> &p = processed[i];
+        queues[i]->setOneByOneProcessingFunction([&p](MessageQueue::Message* ipM) {
+            p.push_back(dynamic_cast<OneToOneMessage*>(ipM)->mText); });
+        queues[i]->setThreadPool(&pool);
+        EXPECT_EQ(queues[i]->getThreadPool(), &pool);
+        queues[i]->startInThread();
+    }
+
+    for (int j = 0; j < kNumMessages; ++j)
+    {
+        for (int i = 0; i < kNumQueues; ++i)
+        {
+            OneToOneMessage *m = new OneToOneMessage; m->mText = "message" + to_string(j);
+            queues[i]->post(m);
+        }
+    }
+
+    for (int i = 0; i < kNumQueues; ++i)
+    {
+        queues[i]->waitForThreadToFinish();
+        EXPECT_EQ(queues[i]->getState(), MessageQueue::sIdle);
+        EXPECT_EQ(queues[i]->getNumberOfMessages(), 0);
+        ASSERT_EQ((int)processed[i].size(), kNumMessages);
+        for (int j = 0; j < kNumMessages; ++j)
+        {
+            EXPECT_EQ(processed[i][j], "message" + to_string(j));
+        }
+    }
+    EXPECT_EQ(pool.getNumberOfThreads(), 4);
+}
+
+// stopThread() on a queue processed by a pool deletes the remaining messages.
+//
+TEST(MessageQueue, threadPool_stopThread)
+{
+    ThreadPool pool(2);
+    MessageQueue q(MessageQueue::stLockFreeRingBuffer);
+    atomic<int> numProcessed(0);
+    q.setOneByOneProcessingFunction([&numProcessed](MessageQueue::Message*) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+        numProcessed++; });
+    q.setThreadPool(&pool);
+    q.setNumberOfThreads(2);
+    q.startInThread();
+
+    for (int i = 0; i < 100; ++i)
+    {
+        q.post(new MessageQueue::Message());
+    }
+    q.stopThread();
+
+    EXPECT_LT(numProcessed.load(), 100);
+    EXPECT_EQ(q.getNumberOfMessages(), 0);
+    EXPECT_EQ(q.getState(), MessageQueue::sIdle);
+}
+
+
+// postBatch() posts the messages in order, the behavior and the maximum
+// size apply as if they were posted one by one.
+//
+TEST(MessageQueue, postBatch)
+{
+    for (int storage = MessageQueue::stDeque; storage <= MessageQueue::stLockFreeRingBuffer; ++storage)
+    {
+        MessageQueue q((MessageQueue::StorageType)storage);
+        vector<string> processed;
+        q.setOneByOneProcessingFunction([&processed](MessageQueue::Message* ipM) {
+            processed.push_back(dynamic_cast<OneToOneMessage*>(ipM)->mText); });
+
+        vector<MessageQueue::Message*> batch;
+        for (int i = 0; i < 10; ++i)
+        {
+            OneToOneMessage *m = new OneToOneMessage; m->mText = "message" + to_string(i);
+            batch.push_back(m);
+        }
+        q.postBatch(batch);
+        q.postBatch(vector<MessageQueue::Message*>());
+        EXPECT_EQ(q.getNumberOfMessages(), 10);
+
+        q.processMessages();
+        ASSERT_EQ((int)processed.size(), 10);
+        for (int i = 0; i < 10; ++i)
+        {
+            EXPECT_EQ(processed[i], "message" + to_string(i));
+        }
+    }
+
+    // lifo and limited size
+    MessageQueue q;
+    q.setBehavior(MessageQueue::bLifo);
+    q.setMaximumSize(3);
+    vector<string> processed;
+    q.setOneByOneProcessingFunction([&processed](MessageQueue::Message* ipM) {
+        processed.push_back(dynamic_cast<OneToOneMessage*>(ipM)->mText); });
+
+    vector<MessageQueue::Message*> batch;
+    for (int i = 0; i < 10; ++i)
+    {
+        OneToOneMessage *m = new OneToOneMessage; m->mText = "message" + to_string(i);
+        batch.push_back(m);
+    }
+    q.postBatch(batch);
+    EXPECT_EQ(q.getNumberOfMessages(), 3);
+
+    q.processMessages();
+    ASSERT_EQ((int)processed.size(), 3);
+    EXPECT_EQ(processed[0], "message9");
+    EXPECT_EQ(processed[1], "message8");
+    EXPECT_EQ(processed[2], "message7");
+}
+
+// processUpTo() processes at most the requested number of messages, in
+// the order defined by the behavior.
+//
+TEST(MessageQueue, processUpTo)
+{
+    MessageQueue q;
+    q.setBehavior(MessageQueue::bLifo);
+    vector<string> processed;
+    q.setOneByOneProcessingFunction([&processed](MessageQueue::Message* ipM) {
+        processed.push_back(dynamic_cast<OneToOneMessage*>(ipM)->mText); });
+
+    for (int i = 0; i < 5; ++i)
+    {
+        OneToOneMessage *m = new OneToOneMessage; m->mText = "message" + to_string(i);
+        q.post(m);
+    }
+
+    vector<MessageQueue::Message*> storage;
+    EXPECT_EQ(q.processUpTo(3, &storage), 3);
+    EXPECT_TRUE(storage.empty());
+    EXPECT_EQ(q.getNumberOfMessages(), 2);
+    EXPECT_EQ(q.processUpTo(3, &storage), 2);
+    EXPECT_EQ(q.processUpTo(3, &storage), 0);
+
+    ASSERT_EQ((int)processed.size(), 5);
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(processed[i], "message" + to_string(4 - i));
+    }
+}
+
+// Consumer threads taking batches must process every message exactly once.
+//
+TEST(MessageQueue, batchedConsumers)
+{
+    for (int storage = MessageQueue::stDeque; storage <= MessageQueue::stLockFreeRingBuffer; ++storage)
+    {
+        atomic<int> numProcessed(0);
+        MessageQueue q((MessageQueue::StorageType)storage);
+        q.setOneByOneProcessingFunction([&numProcessed](MessageQueue::Message*) { numProcessed++; });
+        q.setNumberOfThreads(4);
+        q.setMaximumBatchSize(16);
+        EXPECT_EQ(q.getMaximumBatchSize(), 16);
+        q.startInThread();
+
+        for (int j = 0; j < 100; ++j)
+        {
+            vector<MessageQueue::Message*> batch;
+            for (int i = 0; i < 50; ++i)
+            {
+                batch.push_back(new MessageQueue::Message());
+            }
+            q.postBatch(batch);
+        }
+        q.waitForThreadToFinish();
+
+        EXPECT_EQ(numProcessed.load(), 5000);
+        EXPECT_EQ(q.getNumberOfMessages(), 0);
+    }
+}
+
+// processMessagesAllAtOnce() must be reentrant across queues: a callback of
+// one queue can process another queue without corrupting its own batch.
+//
+TEST(MessageQueue, processMessagesAllAtOnce_reentrant)
+{
+    MessageQueue a;
+    MessageQueue b;
+    vector<string> processedA;
+    vector<string> processedB;
+
+    b.setAllAtOnceProcessingFunction([&processedB](const vector<MessageQueue::Message*>& iMessages) {
+        for (auto m : iMessages)
+        { processedB.push_back(dynamic_cast<OneToOneMessage*>(m)->mText); } });
+
+    a.setAllAtOnceProcessingFunction([&processedA, &b](const vector<MessageQueue::Message*>& iMessages) {
+        b.processMessagesAllAtOnce();
+        for (auto m : iMessages)
+        { processedA.push_back(dynamic_cast<OneToOneMessage*>(m)->mText); } });
+
+    for (int i = 0; i < 4; ++i)
+    {
+        OneToOneMessage *m = new OneToOneMessage; m->mText = "a" + to_string(i);
+        a.post(m);
+        m = new OneToOneMessage; m->mText = "b" + to_string(i);
+        b.post(m);
+    }
+    a.processMessagesAllAtOnce();
+
+    ASSERT_EQ((int)processedA.size(), 4);
+    ASSERT_EQ((int)processedB.size(), 4);
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(processedA[i], "a" + to_string(i));
+        EXPECT_EQ(processedB[i], "b" + to_string(i));
+    }
+    EXPECT_TRUE(a.isEmpty());
+    EXPECT_TRUE(b.isEmpty());
+}
+
+// bPriority processes the highest priority first, and messages of equal
+// priority in the order they were posted. When full, the message that
+// would be processed last is dropped.
+//
+TEST(MessageQueue, priorityQueue)
+{
+    MessageQueue q;
+    q.setBehavior(MessageQueue::bPriority);
+    vector<string> processed;
+    q.setOneByOneProcessingFunction([&processed](MessageQueue::Message* ipM) {
+        processed.push_back(dynamic_cast<OneToOneMessage*>(ipM)->mText); });
+
+    const int priorities[] = { 1, 5, 3, 5, -2, 3, 1 };
+    for (int i = 0; i < 7; ++i)
+    {
+        OneToOneMessage *m = new OneToOneMessage; m->mText = "message" + to_string(i);
+        m->mPriority = priorities[i];
+        q.post(m);
+    }
+    q.processMessages();
+
+    const char* expected[] = { "message1", "message3", "message2", "message5",
+        "message0", "message6", "message4" };
+    ASSERT_EQ((int)processed.size(), 7);
+    for (int i = 0; i < 7; ++i)
+    {
+        EXPECT_EQ(processed[i], expected[i]);
+    }
+
+    // size limited
+    processed.clear();
+    q.setMaximumSize(3);
+    for (int i = 0; i < 7; ++i)
+    {
+        OneToOneMessage *m = new OneToOneMessage; m->mText = "message" + to_string(i);
+        m->mPriority = priorities[i];
+        q.post(m);
+    }
+    EXPECT_EQ(q.getNumberOfMessages(), 3);
+    q.processMessages();
+    ASSERT_EQ((int)processed.size(), 3);
+    EXPECT_EQ(processed[0], "message1");
+    EXPECT_EQ(processed[1], "message3");
+    EXPECT_EQ(processed[2], "message2");
+    EXPECT_EQ(q.getNumberOfDroppedMessages(), 4u);
+}
+
+// When a full priority queue only holds messages of equal priority, the
+// posted message is the one that would be processed last, it is dropped
+// and the oldest messages are kept.
+//
+TEST(MessageQueue, priorityQueue_sizeLimitedEqualPriorities)
+{
+    MessageQueue q;
+    q.setBehavior(MessageQueue::bPriority);
+    q.setMaximumSize(3);
+    vector<string> processed;
+    q.setOneByOneProcessingFunction([&processed](MessageQueue::Message* ipM) {
+        processed.push_back(dynamic_cast<OneToOneMessage*>(ipM)->mText); });
+
+    for (int i = 0; i < 5; ++i)
+    {
+        OneToOneMessage *m = new OneToOneMessage; m->mText = "message" + to_string(i);
+        m->mPriority = 2;
+        q.post(m);
+    }
+    EXPECT_EQ(q.getNumberOfMessages(), 3);
+    EXPECT_EQ(q.getNumberOfDroppedMessages(), 2u);
+    q.processMessages();
+    ASSERT_EQ((int)processed.size(), 3);
+    EXPECT_EQ(processed[0], "message0");
+    EXPECT_EQ(processed[1], "message1");
+    EXPECT_EQ(processed[2], "message2");
+}
+
+// Messages of an older epoch than the queue are discarded without being
+// processed, whatever the storage and behavior.
+//
+TEST(MessageQueue, epoch)
+{
+    for (int storage = MessageQueue::stDeque; storage <= MessageQueue::stLockFreeRingBuffer; ++storage)
+    {
+        MessageQueue q((MessageQueue::StorageType)storage);
+        if (storage == MessageQueue::stDeque)
+        { q.setBehavior(MessageQueue::bPriority); }
+
+        vector<string> processed;
+        q.setOneByOneProcessingFunction([&processed](MessageQueue::Message* ipM) {
+            processed.push_back(dynamic_cast<OneToOneMessage*>(ipM)->mText); });
+
+        EXPECT_EQ(q.getEpoch(), 0);
+        for (int i = 0; i < 4; ++i)
+        {
+            OneToOneMessage *m = new OneToOneMessage; m->mText = "old" + to_string(i);
+            q.post(m);
+        }
+
+        const int epoch = q.incrementEpoch();
+        EXPECT_EQ(epoch, 1);
+        EXPECT_EQ(q.getEpoch(), 1);
+        for (int i = 0; i < 2; ++i)
+        {
+            OneToOneMessage *m = new OneToOneMessage; m->mText = "new" + to_string(i);
+            m->mEpoch = epoch;
+            q.post(m);
+        }
+
+        // stale messages are still counted until they are popped
+        EXPECT_EQ(q.getNumberOfMessages(), 6);
+
+        vector<MessageQueue::Message*> batch;
+        EXPECT_EQ(q.processUpTo(1, &batch), 1);
+        q.processMessages();
+        EXPECT_TRUE(q.isEmpty());
+        ASSERT_EQ((int)processed.size(), 2);
+        EXPECT_EQ(processed[0], "new0");
+        EXPECT_EQ(processed[1], "new1");
+    }
+}
@@ -1,8 +1,12 @@
 
+#include <atomic>
 #include <chrono>
 #include "Core/MultiClientsMultiMessageQueues.h"
+#include "Core/ThreadPool.h"
+#include "Core/Timer.h"
 #include "gtest/gtest.h"
 #include <thread>
+#include <vector>
 
 using namespace Realisim;
     using namespace Core;
@@ -193,3 +197,230 @@ TEST(MultiClientsMultiMessageQueues, firstTest)
     qThreaded.waitForThreadsToFinish();
     gDoneQueue.processMessages();
 }
+
+// Same as firstTest, but all queues share the workers of a thread pool.
+//
+TEST(MultiClientsMultiMessageQueues, threadPool)
+{
+    ThreadPool pool(2);
+
+    MultiClientsMultiMessageQueues qThreaded;
+    qThreaded.setNumberOfQueues(3);
+    qThreaded.setThreadPool(&pool);
+    EXPECT_EQ(qThreaded.getThreadPool(), &pool);
+    Client0 c0;
+    Client1 c1;
+
+    using placeholders::_1;
+    gDoneQueue.setOneByOneProcessingFunction(bind(processDoneQueue, _1));
+
+    function<void(MessageQueue::Message*)> f = bind(&Client0::processRequest, &c0, _1);
+    qThreaded.registerAsSender(&c0, f);
+
+    f = bind(&Client1::processRequest, &c1, _1);
+    qThreaded.registerAsSender(&c1, f);
+
+    qThreaded.start();
+    EXPECT_TRUE(qThreaded.isStarted());
+
+    for (int i = 0; i < 5; ++i)
+    {
+        qThreaded.post(c0.makeMessage("c0 m" + to_string(i)));
+        qThreaded.post(c1.makeMessage("c1 m" + to_string(i)));
+    }
+
+    qThreaded.waitForThreadsToFinish();
+    EXPECT_EQ(gDoneQueue.getNumberOfMessages(), 10);
+    gDoneQueue.processMessages();
+}
+
+
+// Many clients, each in its own thread, post to the same queues while another
+// thread keeps registering and unregistering senders. Prints the number of
+// messages processed per second. Disabled by default, run it with
+// --gtest_also_run_disabled_tests.
+//
+TEST(MultiClientsMultiMessageQueues, DISABLED_manyClientsBenchmark)
+{
+    const int kNumMessages = 1 << 15;
+    const int kNumChurnSenders = 1000;
+
+    printf("clients    no churn (msg/s)    churn (msg/s)\n");
+    for (int numClients = 1; numClients <= 64; numClients *= 4)
+    {
+        double rates[2] = { 0.0, 0.0 };
+        for (int withChurn = 0; withChurn < 2; ++withChurn)
+        {
+            atomic<int> numProcessed(0);
+            MultiClientsMultiMessageQueues q;
+            q.setNumberOfQueues(4);
+
+            vector<int> clients(numClients);
+            function<void(MessageQueue::Message*)> f = [&numProcessed](MessageQueue::Message*) { numProcessed++; };
+            for (int i = 0; i < numClients; ++i)
+            { q.registerAsSender(&clients[i], f); }
+            q.start();
+
+            atomic<bool> isDone(false);
+            thread churn([&]() {
+                vector<int> senders(kNumChurnSenders);
+                function<void(MessageQueue::Message*)> g = [](MessageQueue::Message*) {};
+                while (withChurn && !isDone.load())
+                {
+                    for (int i = 0; i < kNumChurnSenders; ++i)
+                    { q.registerAsSender(&senders[i], g); }
+                    for (int i = 0; i < kNumChurnSenders; ++i)
+                    { q.unregisterAsSender(&senders[i]); }
+                }
+            });
+
+            Timer t;
+            const int numMessagesPerClient = kNumMessages / numClients;
+            vector<thread> producers;
+            for (int i = 0; i < numClients; ++i)
+            {
+                int *pClient = &clients[i];
+                producers.push_back(thread([&q, pClient, numMessagesPerClient]() {
+                    for (int j = 0; j < numMessagesPerClient; ++j)
+                    {
+                        q.post(new MessageQueue::Message(pClient));
+                    }
+                }));
+            }
+            for (auto &p : producers)
+            { p.join(); }
+            q.waitForThreadsToFinish();
+            rates[withChurn] = numMessagesPerClient * numClients / max(t.elapsed(), 1e-9);
+
+            isDone = true;
+            churn.join();
+            EXPECT_EQ(numProcessed.load(), numMessagesPerClient * numClients);
+        }
+        printf("%7d %19.0f %16.0f\n", numClients, rates[0], rates[1]);
+    }
+}
+
+// With qsSenderAffinity, all messages of a sender land on the same queue and
+// are thus processed in order, even with many queues.
+//
+TEST(MultiClientsMultiMessageQueues, senderAffinity)
+{
+    const int kNumSenders = 32;
+    const int kNumMessages = 200;
+
+    MultiClientsMultiMessageQueues q;
+    q.setNumberOfQueues(4);
+    EXPECT_EQ(q.getQueueSelection(), MultiClientsMultiMessageQueues::qsSenderAffinity);
+
+    vector<vector<int>> processed(kNumSenders);
+    for (int i = 0; i < kNumSenders; ++i)
+    {
+        vector<int> &p = processed[i];
+        function<void(MessageQueue::Message*)> f = [&p](MessageQueue::Message* ipM) {
+            p.push_back(dynamic_cast<RequestMessage*>(ipM)->mSleepTimeInMsec); };
+        q.registerAsSender(&processed[i], f);
+    }
+    q.start();
+
+    for (int j = 0; j < kNumMessages; ++j)
+    {
+        for (int i = 0; i < kNumSenders; ++i)
+        {
+            RequestMessage *m = new RequestMessage(&processed[i]);
+            m->mSleepTimeInMsec = j;
+            q.post(m);
+        }
+    }
+    q.waitForThreadsToFinish();
+
+    for (int i = 0; i < kNumSenders; ++i)
+    {
+        ASSERT_EQ((int)processed[i].size(), kNumMessages);
+        for (int j = 0; j < kNumMessages; ++j)
+        {
+            EXPECT_EQ(processed[i][j], j);
+        }
+    }
+}
+
+// The drop counters account for the messages lost because a queue was full.
+//
+TEST(MultiClientsMultiMessageQueues, droppedMessages)
+{
+    MultiClientsMultiMessageQueues q;
+    q.setNumberOfQueues(3);
+    q.setMaximumNumberOfMessages(2);
+
+    int sender = 0;
+    for (int i = 0; i < 5; ++i)
+    {
+        q.post(new RequestMessage(&sender));
+    }
+
+    int total = 0;
+    uint64_t totalDropped = 0;
+    for (int i = 0; i < q.getNumberOfQueues(); ++i)
+    {
+        total += q.getNumberOfMessages(i);
+        totalDropped += q.getNumberOfDroppedMessages(i);
+    }
+    EXPECT_EQ(total, 2);
+    EXPECT_EQ(totalDropped, 3u);
+}
+
+// With a high water mark, tryPost() refuses messages when the queue is busy
+// and post() blocks until there is room. No message is lost.
+//
+TEST(MultiClientsMultiMessageQueues, highWaterMark)
+{
+    MultiClientsMultiMessageQueues q;
+    q.setNumberOfQueues(2);
+    q.setHighWaterMark(4);
+    EXPECT_EQ(q.getHighWaterMark(), 4);
+
+    atomic<int> numProcessed(0);
+    atomic<int> maxDepth(0);
+    int sender = 0;
+    function<void(MessageQueue::Message*)> f = [&](MessageQueue::Message*) {
+        for (int i = 0; i < q.getNumberOfQueues(); ++i)
+        {
+            int d = q.getNumberOfMessages(i);
+            int m = maxDepth.load();
+            while (d > m && !maxDepth.compare_exchange_weak(m, d)) {}
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+        numProcessed++; };
+    q.registerAsSender(&sender, f);
+
+    // not started, nothing drains the queue.
+    int numAccepted = 0;
+    RequestMessage *m = new RequestMessage(&sender);
+    while (q.tryPost(m))
+    {
+        numAccepted++;
+        m = new RequestMessage(&sender);
+    }
+    EXPECT_EQ(numAccepted, 4);
+    delete m;
+
+    q.start();
+    const int kNumProducers = 4;
+    const int kNumMessagesPerProducer = 50;
+    vector<thread> producers;
+    for (int i = 0; i < kNumProducers; ++i)
+    {
+        producers.push_back(thread([&q, &sender, kNumMessagesPerProducer]() {
+            for (int j = 0; j < kNumMessagesPerProducer; ++j)
+            {
+                q.post(new RequestMessage(&sender));
+            }
+        }));
+    }
+    for (auto &p : producers)
+    { p.join(); }
+    q.waitForThreadsToFinish();
+
+    EXPECT_EQ(numProcessed.load(), numAccepted + kNumProducers * kNumMessagesPerProducer);
+    EXPECT_LE(maxDepth.load(), 4 + kNumProducers);
+    EXPECT_EQ(q.getNumberOfDroppedMessages(0) + q.getNumberOfDroppedMessages(1), 0u);
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+
+#include <chrono>
+#include "gtest/gtest.h"
+#include "Core/Profiler.h"
+#include "Core/StatisticsTree.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    void sleepFor(int iMilliseconds)
+    {
+        this_thread::sleep_for(chrono::milliseconds(iMilliseconds));
+    }
+
+    void runWorkerTasks(int iNumberOfTasks)
+    {
+        PROFILE_SCOPE("worker");
+        for (int i = 0; i < iNumberOfTasks; ++i)
+        {
+            PROFILE_SCOPE("task");
+            sleepFor(1);
+        }
+    }
+
+    // Starts from an empty frame, whatever the previous tests recorded.
+    void resetProfiler()
+    {
+        Profiler &p = Profiler::getInstance();
+        p.setEnabled(true);
+        p.setCapturing(false);
+        p.clear();
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(Profiler, scopes)
+{
+    resetProfiler();
+    Profiler &p = Profiler::getInstance();
+    StatisticsTree tree;
+
+    const int kNumFrames = 3;
+    const int kNumThreads = 4;
+    for (int frame = 0; frame < kNumFrames; ++frame)
+    {
+        {
+            PROFILE_SCOPE("frame");
+            {
+                PROFILE_SCOPE("update");
+                sleepFor(2);
+            }
+
+            vector<thread> workers;
+            for (int t = 0; t < kNumThreads; ++t)
+            {
+                workers.push_back(thread(runWorkerTasks, 2));
+            }
+            for (auto &w : workers)
+            { w.join(); }
+        }
+        p.endFrame(&tree);
+    }
+
+    EXPECT_TRUE(tree.hasKey("frame"));
+    EXPECT_TRUE(tree.hasKey("frame/update"));
+    EXPECT_TRUE(tree.hasKey("worker"));
+    EXPECT_TRUE(tree.hasKey("worker/task"));
+    EXPECT_FALSE(tree.hasKey("task"));
+    EXPECT_EQ(tree.getNumberOfKeys(), 4);
+
+    // one sample per frame, worker times are summed over the threads.
+    EXPECT_GE(tree.getMinimum("frame/update"), 0.002);
+    EXPECT_GE(tree.getMinimum("frame"), tree.getMaximum("frame/update"));
+    EXPECT_GE(tree.getMinimum("worker/task"), kNumThreads * 2 * 0.001);
+    EXPECT_GE(tree.getMinimum("worker"), tree.getMinimum("worker/task") * 0.99);
+
+    // an empty frame adds nothing.
+    StatisticsTree emptyTree;
+    p.endFrame(&emptyTree);
+    EXPECT_EQ(emptyTree.getNumberOfKeys(), 0);
+}
+
+//------------------------------------------------------------------------------
+TEST(Profiler, disabled)
+{
+    resetProfiler();
+    Profiler &p = Profiler::getInstance();
+    p.setEnabled(false);
+    {
+        PROFILE_SCOPE("disabled");
+    }
+    p.setEnabled(true);
+
+    StatisticsTree tree;
+    p.endFrame(&tree);
+    EXPECT_FALSE(tree.hasKey("disabled"));
+}
+
+//------------------------------------------------------------------------------
+TEST(Profiler, chromeTrace)
+{
+    resetProfiler();
+    Profiler &p = Profiler::getInstance();
+
+    {
+        PROFILE_SCOPE("outside capture");
+    }
+
+    p.setCapturing(true);
+    p.setThreadName("main \"thread\"");
+    {
+        PROFILE_SCOPE("captured");
+        thread worker([]() {
+            Profiler::getInstance().setThreadName("worker");
+            runWorkerTasks(3);
+        });
+        worker.join();
+    }
+    p.setCapturing(false);
+    {
+        PROFILE_SCOPE("outside capture");
+    }
+
+    // captured + worker + 3 tasks
+    EXPECT_EQ(p.getNumberOfEvents(), 5);
+    EXPECT_EQ(p.getNumberOfDroppedEvents(), 0u);
+
+    const string json = p.toChromeTraceJson();
+    EXPECT_EQ(json.find("{\"traceEvents\":["), 0u);
+    EXPECT_NE(json.find("\"name\":\"captured\",\"ph\":\"X\""), string::npos);
+    EXPECT_NE(json.find("\"name\":\"task\",\"ph\":\"X\""), string::npos);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"main \\\"thread\\\"\"}"), string::npos);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"worker\"}"), string::npos);
+    EXPECT_EQ(json.find("outside capture"), string::npos);
+
+    int numberOfTasks = 0;
+    for (size_t pos = json.find("\"task\""); pos != string::npos; pos = json.find("\"task\"", pos + 1))
+    { ++numberOfTasks; }
+    EXPECT_EQ(numberOfTasks, 3);
+
+    p.clear();
+    EXPECT_EQ(p.getNumberOfEvents(), 0);
+}
@@ -0,0 +1,195 @@
+
+#include "Core/FileInfo.h"
+#include "Core/ImageSupport/RgbImage.h"
+#include "Core/Path.h"
+#include <fstream>
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    std::string getCurrentFolderPath()
+    {
+        FileInfo fi(Path::getApplicationFilePath());
+        return fi.getCanonicalPath();
+    }
+
+    std::string getAssetsPath()
+    {
+        FileInfo fi(Path::getApplicationFilePath());
+        return fi.getCanonicalPath() + "/../CoreAssets";
+    }
+
+    void appendBigEndian(string& ioFile, uint32_t iV, int iNumberOfBytes)
+    {
+        for (int i = iNumberOfBytes - 1; i >= 0; --i)
+        { ioFile.push_back((char)((iV >> (8 * i)) & 0xff)); }
+    }
+
+    // Runs of 3 equal bytes or more are repeated, the rest is copied.
+    string encodeRle(const unsigned char* ipScanline, int iWidth)
+    {
+        string r;
+        int i = 0;
+        while (i < iWidth)
+        {
+            int run = 1;
+            while (i + run < iWidth && run < 127 && ipScanline[i + run] == ipScanline[i])
+            { ++run; }
+
+            if (run >= 3)
+            {
+                r.push_back((char)run);
+                r.push_back((char)ipScanline[i]);
+                i += run;
+            }
+            else
+            {
+                int count = 0;
+                while (i + count < iWidth && count < 127 &&
+                    !(i + count + 2 < iWidth && ipScanline[i + count] == ipScanline[i + count + 1] &&
+                        ipScanline[i + count] == ipScanline[i + count + 2]))
+                { ++count; }
+                r.push_back((char)(0x80 | count));
+                r.append((const char*)ipScanline + i, count);
+                i += count;
+            }
+        }
+        r.push_back(0);
+        return r;
+    }
+
+    // Writes an SGI file of the interleaved iPixels, first row is the bottom row.
+    void writeSgi(const string& iPath, int iWidth, int iHeight, int iNumberOfChannels,
+        const vector<unsigned char>& iPixels, bool iRle)
+    {
+        string file;
+        appendBigEndian(file, 474, 2);
+        appendBigEndian(file, iRle ? 1 : 0, 1);
+        appendBigEndian(file, 1, 1);
+        appendBigEndian(file, 3, 2);
+        appendBigEndian(file, iWidth, 2);
+        appendBigEndian(file, iHeight, 2);
+        appendBigEndian(file, iNumberOfChannels, 2);
+        appendBigEndian(file, 0, 4);
+        appendBigEndian(file, 255, 4);
+        file.resize(512, '\0');
+
+        vector<unsigned char> scanline(iWidth);
+        if (iRle)
+        {
+            vector<string> scanlines;
+            for (int c = 0; c < iNumberOfChannels; ++c)
+                for (int y = 0; y < iHeight; ++y)
+                {
+                    for (int x = 0; x < iWidth; ++x)
+                    { scanline[x] = iPixels[(y * iWidth + x) * iNumberOfChannels + c]; }
+                    scanlines.push_back(encodeRle(scanline.data(), iWidth));
+                }
+
+            uint32_t offset = (uint32_t)(512 + 8 * scanlines.size());
+            for (const string& s : scanlines)
+            {
+                appendBigEndian(file, offset, 4);
+                offset += (uint32_t)s.size();
+            }
+            for (const string& s : scanlines)
+            { appendBigEndian(file, (uint32_t)s.size(), 4); }
+            for (const string& s : scanlines)
+            { file += s; }
+        }
+        else
+        {
+            for (int c = 0; c < iNumberOfChannels; ++c)
+                for (int i = 0; i < iWidth * iHeight; ++i)
+                { file.push_back((char)iPixels[i * iNumberOfChannels + c]); }
+        }
+
+        ofstream ofs(iPath, ios::binary);
+        ofs.write(file.data(), file.size());
+    }
+
+    // horizontal bands with noise, rle has runs and literals to deal with.
+    vector<unsigned char> makePixels(int iWidth, int iHeight, int iNumberOfChannels)
+    {
+        vector<unsigned char> r((size_t)iWidth * iHeight * iNumberOfChannels);
+        unsigned int seed = 12345;
+        for (size_t i = 0; i < r.size(); ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            const size_t x = (i / iNumberOfChannels) % iWidth;
+            const size_t y = i / (iNumberOfChannels * iWidth);
+            r[i] = (unsigned char)((x / 16) * 8 + y + (x % 5 == 0 ? (seed >> 16) & 15 : 0));
+        }
+        return r;
+    }
+}
+
+//------------------------------------------------------------------------------
+TEST(RgbImage, rleAndVerbatim)
+{
+    for (int numberOfChannels : { 1, 3, 4 })
+        for (bool rle : { true, false })
+        {
+            const int w = 301, h = 77;
+            const vector<unsigned char> pixels = makePixels(w, h, numberOfChannels);
+            const string path = getCurrentFolderPath() + "/rleAndVerbatim.rgb";
+            writeSgi(path, w, h, numberOfChannels, pixels, rle);
+
+            RgbImage im(path);
+            ASSERT_TRUE(im.isValid());
+            EXPECT_EQ(im.isRleEncoded(), rle);
+            EXPECT_EQ(im.getWidthInPixel(), w);
+            EXPECT_EQ(im.getHeightInPixel(), h);
+            EXPECT_EQ(im.getNumberOfChannels(), numberOfChannels);
+            ASSERT_EQ(im.getImageData().size(), pixels.size());
+            EXPECT_EQ(memcmp(im.getImageData().constData(), pixels.data(), pixels.size()), 0)
+                << numberOfChannels << " channels, rle: " << rle;
+
+            RgbImage header;
+            header.setFilenamePath(path);
+            header.loadHeader();
+            EXPECT_TRUE(header.isValid());
+            EXPECT_FALSE(header.hasImageData());
+            EXPECT_EQ(header.getSizeInBytes(), (uint64_t)pixels.size());
+        }
+
+    RgbImage dices(getAssetsPath() + "/dices.rgb");
+    EXPECT_TRUE(dices.isValid());
+    EXPECT_TRUE(dices.isRleEncoded());
+    EXPECT_EQ(dices.getSizeInPixel(), Math::Vector2i(800, 600));
+}
+
+//------------------------------------------------------------------------------
+TEST(RgbImage, corruptedRle)
+{
+    const int w = 64, h = 8;
+    const string path = getCurrentFolderPath() + "/corruptedRle.rgb";
+    writeSgi(path, w, h, 3, makePixels(w, h, 3), true);
+
+    ifstream ifs(path, ios::binary);
+    string file((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    ifs.close();
+
+    // a run longer than the scanline.
+    string longRun = file;
+    const size_t firstScanline = 512 + 8 * h * 3;
+    longRun[firstScanline] = (char)0x7f;
+    ofstream(path, ios::binary).write(longRun.data(), longRun.size());
+    EXPECT_FALSE(RgbImage(path).isValid());
+
+    // an offset past the end of the file.
+    string badOffset = file;
+    badOffset[512] = (char)0x7f;
+    ofstream(path, ios::binary).write(badOffset.data(), badOffset.size());
+    EXPECT_FALSE(RgbImage(path).isValid());
+
+    // truncated file
+    ofstream(path, ios::binary).write(file.data(), file.size() / 2);
+    EXPECT_FALSE(RgbImage(path).isValid());
+}
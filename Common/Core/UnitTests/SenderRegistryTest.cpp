@@ -0,0 +1,110 @@
+
+#include <atomic>
+#include "Core/SenderRegistry.h"
+#include "gtest/gtest.h"
+#include <thread>
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+TEST(SenderRegistry, registerAndCall)
+{
+    SenderRegistry r(5);
+    EXPECT_EQ(r.getNumberOfShards(), 8);
+    EXPECT_EQ(r.getNumberOfSenders(), 0);
+
+    int a = 0, b = 0;
+    int calledA = 0, calledB = 0;
+    r.registerSender(&a, [&calledA](MessageQueue::Message*) { calledA++; });
+    r.registerSender(&b, [&calledB](MessageQueue::Message*) { calledB++; });
+    EXPECT_EQ(r.getNumberOfSenders(), 2);
+    EXPECT_TRUE(r.isRegistered(&a));
+    EXPECT_TRUE(r.isRegistered(&b));
+
+    MessageQueue::Message ma(&a), mb(&b), mc(&calledA);
+    EXPECT_TRUE(r.call(&ma));
+    EXPECT_TRUE(r.call(&mb));
+    EXPECT_TRUE(r.call(&mb));
+    EXPECT_FALSE(r.call(&mc));
+    EXPECT_EQ(calledA, 1);
+    EXPECT_EQ(calledB, 2);
+
+    // registering again replaces the function
+    r.registerSender(&a, [&calledB](MessageQueue::Message*) { calledB++; });
+    EXPECT_EQ(r.getNumberOfSenders(), 2);
+    EXPECT_TRUE(r.call(&ma));
+    EXPECT_EQ(calledA, 1);
+    EXPECT_EQ(calledB, 3);
+
+    r.unregisterSender(&a);
+    r.unregisterSender(&a);
+    EXPECT_FALSE(r.isRegistered(&a));
+    EXPECT_FALSE(r.call(&ma));
+    EXPECT_EQ(r.getNumberOfSenders(), 1);
+
+    r.clear();
+    EXPECT_EQ(r.getNumberOfSenders(), 0);
+    EXPECT_FALSE(r.call(&mb));
+}
+
+// Readers call registered senders while writers register and unregister
+// thousands of others. Once unregisterSender() returns, the function of that
+// sender must not be running.
+//
+TEST(SenderRegistry, concurrentRegistration)
+{
+    SenderRegistry r;
+    const int kNumSenders = 2000;
+    vector<int> senders(kNumSenders);
+    vector<atomic<int>> isAlive(kNumSenders);
+    atomic<int> numCalls(0);
+    atomic<int> numCallsOnDeadSender(0);
+
+    auto registerSender = [&](int i) {
+        isAlive[i] = 1;
+        r.registerSender(&senders[i], [&, i](MessageQueue::Message*) {
+            if (isAlive[i].load() == 0) { numCallsOnDeadSender++; }
+            numCalls++; });
+    };
+
+    for (int i = 0; i < kNumSenders; i += 2)
+    { registerSender(i); }
+
+    atomic<bool> isDone(false);
+    vector<thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.push_back(thread([&, t]() {
+            int i = t;
+            while (!isDone.load())
+            {
+                MessageQueue::Message m(&senders[i % kNumSenders]);
+                r.call(&m);
+                i += 7;
+            }
+        }));
+    }
+
+    thread writer([&]() {
+        for (int i = 0; i < kNumSenders; ++i)
+        {
+            if (i % 2 == 0)
+            {
+                r.unregisterSender(&senders[i]);
+                isAlive[i] = 0;
+            }
+            else
+            { registerSender(i); }
+        }
+    });
+    writer.join();
+    isDone = true;
+    for (auto &t : readers)
+    { t.join(); }
+
+    EXPECT_EQ(r.getNumberOfSenders(), kNumSenders / 2);
+    EXPECT_EQ(numCallsOnDeadSender.load(), 0);
+    EXPECT_GT(numCalls.load(), 0);
+}
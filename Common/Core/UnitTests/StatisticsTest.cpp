@@ -1,6 +1,9 @@
+#include <algorithm>
 #include "gtest/gtest.h"
 #include "Math/IsEqual.h"
 #include "Core/Statistics.h"
+#include <random>
+#include <vector>
 
 using namespace Realisim;
 using namespace Core;
@@ -51,9 +54,119 @@ TEST(Statistics, csv)
 "24.1711\n"
 "\n"
 "\n"
-",Number of samples,average,minimum,maximum,standard deviation\n"
-",8,-8.20438,-69.0117,79.5649,52.795";
+",Number of samples,average,minimum,maximum,standard deviation,p50,p90,p95,p99,p99.9\n"
+",8,-8.20438,-69.0117,79.5649,52.795,-37.7731,31.8304,31.8304,31.8304,31.8304\n"
+"\n"
+"Histogram\n"
+",lower bound,upper bound,count\n"
+",-69.4177,-68.0431,1\n"
+",-54.6054,-53.5241,1\n"
+",-53.5241,-52.4643,1\n"
+",-38.0965,-37.3421,1\n"
+",12.9369,13.1983,1\n"
+",24.0493,24.5351,1\n"
+",31.8206,32.4635,1\n"
+",78.2685,79.8497,1";
 
 	EXPECT_STREQ(r.c_str(), stats.toCsv().c_str());
 	
-}
\ No newline at end of file
+}
+
+TEST(Statistics, quantiles)
+{
+    // log-normal samples, a typical shape for frame timings.
+    std::mt19937 generator(1234);
+    std::lognormal_distribution<double> distribution(-4.0, 0.5);
+
+    const int kNumSamples = 200000;
+    std::vector<double> samples;
+    Statistics stats;
+    Statistics exactStats;
+    exactStats.keepSamples(true);
+    for (int i = 0; i < kNumSamples; ++i)
+    {
+        const double s = distribution(generator);
+        samples.push_back(s);
+        stats.add(s);
+        exactStats.add(s);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    const double kQuantiles[] = { 0.0, 0.01, 0.5, 0.9, 0.95, 0.99, 0.999, 1.0 };
+    for (auto q : kQuantiles)
+    {
+        const double exact = samples[(size_t)(q * (kNumSamples - 1))];
+        EXPECT_NEAR(stats.quantile(q), exact, exact * 0.01) << "quantile " << q;
+        EXPECT_DOUBLE_EQ(exactStats.quantile(q), exact) << "quantile " << q;
+    }
+    EXPECT_DOUBLE_EQ(stats.quantile(0.0), stats.minimum());
+    EXPECT_DOUBLE_EQ(stats.quantile(1.0), stats.maximum());
+
+    // memory is bounded whatever the range of the samples.
+    for (int i = -300; i <= 300; ++i)
+    {
+        stats.add(pow(10.0, i));
+    }
+    EXPECT_LE(stats.histogram().size(), 2048u);
+    uint64_t total = 0;
+    for (auto &bin : stats.histogram())
+    {
+        EXPECT_LE(bin.mLowerBound, bin.mUpperBound);
+        total += bin.mCount;
+    }
+    EXPECT_EQ(total, stats.numberOfSamples());
+    EXPECT_DOUBLE_EQ(stats.quantile(1.0), 1e300);
+}
+
+TEST(Statistics, negativeAndZeroQuantiles)
+{
+    Statistics stats;
+    for (int i = -1000; i <= 1000; ++i)
+    {
+        stats.add((double)i);
+    }
+
+    EXPECT_DOUBLE_EQ(stats.quantile(0.0), -1000.0);
+    EXPECT_DOUBLE_EQ(stats.quantile(0.5), 0.0);
+    EXPECT_DOUBLE_EQ(stats.quantile(1.0), 1000.0);
+    EXPECT_NEAR(stats.quantile(0.25), -500.0, 5.0);
+    EXPECT_NEAR(stats.quantile(0.75), 500.0, 5.0);
+
+    std::vector<Statistics::HistogramBin> bins = stats.histogram();
+    for (size_t i = 1; i < bins.size(); ++i)
+    {
+        EXPECT_LE(bins[i - 1].mUpperBound, bins[i].mLowerBound);
+    }
+}
+
+TEST(Statistics, merge)
+{
+    std::mt19937 generator(4321);
+    std::uniform_real_distribution<double> distribution(1.0, 100.0);
+
+    Statistics all;
+    Statistics threads[4];
+    for (int i = 0; i < 40000; ++i)
+    {
+        const double s = distribution(generator);
+        all.add(s);
+        threads[i % 4].add(s);
+    }
+
+    Statistics merged;
+    for (auto &s : threads)
+    {
+        merged.merge(s);
+    }
+
+    EXPECT_EQ(merged.numberOfSamples(), all.numberOfSamples());
+    EXPECT_DOUBLE_EQ(merged.minimum(), all.minimum());
+    EXPECT_DOUBLE_EQ(merged.maximum(), all.maximum());
+    EXPECT_NEAR(merged.average(), all.average(), 1e-9);
+    EXPECT_NEAR(merged.standardDeviation(), all.standardDeviation(), 1e-6);
+    for (double q = 0.0; q <= 1.0; q += 0.05)
+    {
+        EXPECT_DOUBLE_EQ(merged.quantile(q), all.quantile(q));
+    }
+    EXPECT_EQ(merged.histogram().size(), all.histogram().size());
+}
@@ -1,7 +1,9 @@
 ﻿#include "gtest/gtest.h"
 #include "Core/StreamUtility.h"
+#include "Core/Timer.h"
 #include <stdint.h>
 #include <sstream>
+#include <vector>
 
 using namespace Realisim;
     using namespace Core;
@@ -196,3 +198,140 @@ TEST(StreamUtiliy, writeInBigEndian)
     }
 }
 
+
+//------------------------------------------------------------------------------
+// The array methods must give the same bytes as the scalar ones. 37 values
+// exercise both the SIMD and the scalar tail.
+//
+TEST(StreamUtiliy, arrays)
+{
+    const size_t kNumValues = 37;
+    vector<int16_t> int16s(kNumValues);
+    vector<uint32_t> uint32s(kNumValues);
+    vector<double> doubles(kNumValues);
+    for (size_t i = 0; i < kNumValues; ++i)
+    {
+        int16s[i] = (int16_t)(i * 1031 - 20000);
+        uint32s[i] = (uint32_t)(i * 0x01020304u + 0x0a0b0c0du);
+        doubles[i] = i * 3.25 - 17.0;
+    }
+
+    for (auto format : { StreamUtility::eLittleEndian, StreamUtility::eBigEndian })
+    {
+        StreamUtility su;
+        su.setStreamFormat(format);
+
+        ostringstream scalar, array;
+        for (size_t i = 0; i < kNumValues; ++i) { su.write(scalar, int16s[i]); }
+        for (size_t i = 0; i < kNumValues; ++i) { su.write(scalar, uint32s[i]); }
+        for (size_t i = 0; i < kNumValues; ++i) { su.write(scalar, doubles[i]); }
+        su.writeInt16Array(array, kNumValues, int16s.data());
+        su.writeUint32Array(array, kNumValues, uint32s.data());
+        su.writeDoubleArray(array, kNumValues, doubles.data());
+        ASSERT_EQ(array.str(), scalar.str());
+
+        istringstream iss(array.str());
+        vector<int16_t> cInt16s(kNumValues);
+        vector<uint32_t> cUint32s(kNumValues);
+        vector<double> cDoubles(kNumValues);
+        EXPECT_TRUE(su.readInt16Array(iss, kNumValues, cInt16s.data()));
+        EXPECT_TRUE(su.readUint32Array(iss, kNumValues, cUint32s.data()));
+        EXPECT_TRUE(su.readDoubleArray(iss, kNumValues, cDoubles.data()));
+        EXPECT_EQ(cInt16s, int16s);
+        EXPECT_EQ(cUint32s, uint32s);
+        EXPECT_EQ(cDoubles, doubles);
+        EXPECT_FALSE(su.readInt16Array(iss, 1, cInt16s.data()));
+    }
+
+    uint64_t v = 0x0102030405060708;
+    StreamUtility::swapBytes8Array(&v, 1);
+    EXPECT_EQ(v, 0x0807060504030201u);
+}
+
+//------------------------------------------------------------------------------
+TEST(StreamUtiliy, byteArrayCursor)
+{
+    StreamUtility su;
+    su.setStreamFormat(StreamUtility::eBigEndian);
+    const vector<float> floats = { 1.5f, -2.25f, 1e10f, 0.0f, 3.0f };
+
+    ostringstream oss;
+    su.write(oss, (uint32_t)0xdeadbeef);
+    su.write(oss, (int16_t)-3);
+    su.writeFloat32Array(oss, floats.size(), floats.data());
+    su.writeBytes(oss, string(40, 'x'));
+
+    ByteArrayCursor cursor(ByteArray(oss.str()), StreamUtility::eBigEndian);
+    uint32_t magic = 0;
+    int16_t s = 0;
+    vector<float> cFloats(floats.size());
+    EXPECT_TRUE(cursor.read(&magic));
+    EXPECT_TRUE(cursor.read(&s));
+    EXPECT_TRUE(cursor.readArray(cFloats.size(), cFloats.data()));
+    EXPECT_EQ(magic, 0xdeadbeef);
+    EXPECT_EQ(s, -3);
+    EXPECT_EQ(cFloats, floats);
+    EXPECT_EQ(cursor.getPosition(), 26u);
+
+    // the remaining bytes are returned as a view on the data.
+    ByteArray rest;
+    EXPECT_FALSE(cursor.readByteArray(41, &rest));
+    EXPECT_TRUE(cursor.readByteArray(40, &rest));
+    EXPECT_EQ(rest.constData(), cursor.getData().constData() + 26);
+    EXPECT_EQ(rest.constString(), string(40, 'x'));
+    EXPECT_TRUE(cursor.atEnd());
+    EXPECT_FALSE(cursor.read(&s));
+
+    EXPECT_TRUE(cursor.seek(4));
+    EXPECT_TRUE(cursor.skip(2));
+    cursor.setStreamFormat(StreamUtility::eLittleEndian);
+    float f = 0.0f;
+    EXPECT_TRUE(cursor.read(&f));
+    EXPECT_NE(f, floats[0]);
+    EXPECT_FALSE(cursor.seek(67));
+}
+
+//------------------------------------------------------------------------------
+// Prints the cost of reading big endian uint16 one by one versus with the
+// array methods. Disabled by default, run it with
+// --gtest_also_run_disabled_tests.
+//
+TEST(StreamUtiliy, DISABLED_arrayBenchmark)
+{
+    const size_t kNumValues = 4 * 1024 * 1024;
+    StreamUtility su;
+    su.setStreamFormat(StreamUtility::eBigEndian);
+
+    vector<uint16_t> values(kNumValues);
+    for (size_t i = 0; i < kNumValues; ++i) { values[i] = (uint16_t)i; }
+    ostringstream oss;
+    su.writeUint16Array(oss, kNumValues, values.data());
+    const ByteArray data(oss.str());
+
+    vector<uint16_t> result(kNumValues);
+    istringstream scalarStream(data.constString());
+    Timer t;
+    for (size_t i = 0; i < kNumValues; ++i)
+    { su.readUint16(scalarStream, &result[i]); }
+    const double scalarTime = t.elapsed();
+    EXPECT_EQ(result, values);
+
+    result.assign(kNumValues, 0);
+    istringstream arrayStream(data.constString());
+    t.start();
+    su.readUint16Array(arrayStream, kNumValues, result.data());
+    const double arrayTime = t.elapsed();
+    EXPECT_EQ(result, values);
+
+    result.assign(kNumValues, 0);
+    t.start();
+    ByteArrayCursor cursor(data, StreamUtility::eBigEndian);
+    cursor.readArray(kNumValues, result.data());
+    const double cursorTime = t.elapsed();
+    EXPECT_EQ(result, values);
+
+    printf("%-28s %12s\n", "big endian uint16", "ns per value");
+    printf("%-28s %12.2f\n", "readUint16", scalarTime * 1e9 / kNumValues);
+    printf("%-28s %12.2f\n", "readUint16Array", arrayTime * 1e9 / kNumValues);
+    printf("%-28s %12.2f\n", "ByteArrayCursor::readArray", cursorTime * 1e9 / kNumValues);
+}
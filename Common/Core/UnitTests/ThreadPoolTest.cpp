@@ -0,0 +1,124 @@
+#include <atomic>
+#include <chrono>
+#include "Core/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+// All tasks submitted from outside the pool must be executed.
+//
+TEST(ThreadPool, submitFromOutside)
+{
+    ThreadPool pool(4);
+    EXPECT_TRUE(pool.isStarted());
+    EXPECT_EQ(pool.getNumberOfThreads(), 4);
+
+    const int kNumTasks = 10000;
+    atomic<int> counter(0);
+    for (int i = 0; i < kNumTasks; ++i)
+    {
+        pool.submit([&counter]() { counter++; });
+    }
+
+    pool.waitForAllTasksToFinish();
+    EXPECT_EQ(counter.load(), kNumTasks);
+    EXPECT_EQ(pool.getNumberOfPendingTasks(), 0);
+}
+
+// Tasks submitted from a task go in the deque of the worker running it.
+// Other workers must steal them for the work to be spread.
+//
+TEST(ThreadPool, workStealing)
+{
+    ThreadPool pool(4);
+
+    const int kNumTasks = 64;
+    atomic<int> counter(0);
+    mutex threadIdsMutex;
+    set<thread::id> threadIds;
+    pool.submit([&]() {
+        for (int i = 0; i < kNumTasks; ++i)
+        {
+            pool.submit([&]() {
+                this_thread::sleep_for(chrono::milliseconds(5));
+                {
+                    lock_guard<mutex> lk(threadIdsMutex);
+                    threadIds.insert(this_thread::get_id());
+                }
+                counter++;
+            });
+        }
+    });
+
+    pool.waitForAllTasksToFinish();
+    EXPECT_EQ(counter.load(), kNumTasks);
+    EXPECT_GE((int)threadIds.size(), 2);
+}
+
+// stop() executes all submitted tasks before joining the workers and a pool
+// that is not started executes tasks right away.
+//
+TEST(ThreadPool, stop)
+{
+    ThreadPool pool;
+    EXPECT_FALSE(pool.isStarted());
+
+    int counter = 0;
+    pool.submit([&counter]() { counter++; });
+    EXPECT_EQ(counter, 1);
+
+    atomic<int> threadedCounter(0);
+    pool.start(2);
+    for (int i = 0; i < 100; ++i)
+    {
+        pool.submit([&threadedCounter]() {
+            this_thread::sleep_for(chrono::microseconds(100));
+            threadedCounter++;
+        });
+    }
+    pool.stop();
+    EXPECT_FALSE(pool.isStarted());
+    EXPECT_EQ(threadedCounter.load(), 100);
+}
+
+//
+TEST(ThreadPool, globalInstance)
+{
+    ThreadPool &pool = ThreadPool::getGlobalInstance();
+    EXPECT_TRUE(pool.isStarted());
+    EXPECT_GE(pool.getNumberOfThreads(), 1);
+    EXPECT_EQ(&pool, &ThreadPool::getGlobalInstance());
+}
+
+// parallelFor() calls the task once per index, from outside the pool, from a
+// task and on a pool that is not started.
+//
+TEST(ThreadPool, parallelFor)
+{
+    ThreadPool pool(4);
+
+    const int kNumTasks = 1000;
+    vector<atomic<int>> calls(kNumTasks);
+    for (auto &c : calls) { c = 0; }
+    pool.parallelFor(kNumTasks, [&calls](int i) { calls[i]++; });
+    for (auto &c : calls) { EXPECT_EQ(c.load(), 1); }
+
+    atomic<int> nestedCounter(0);
+    pool.submit([&pool, &nestedCounter]() {
+        pool.parallelFor(64, [&pool, &nestedCounter](int) {
+            pool.parallelFor(4, [&nestedCounter](int) { nestedCounter++; });
+        });
+    });
+    pool.waitForAllTasksToFinish();
+    EXPECT_EQ(nestedCounter.load(), 256);
+
+    ThreadPool notStarted;
+    int counter = 0;
+    notStarted.parallelFor(10, [&counter](int) { counter++; });
+    EXPECT_EQ(counter, 10);
+}
@@ -0,0 +1,137 @@
+
+#include <atomic>
+#include "gtest/gtest.h"
+#include "Core/Timeline.h"
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+namespace
+{
+    const char* kTags[] = { "preUpdate", "update", "postUpdate", "swap" };
+}
+
+//------------------------------------------------------------------------------
+TEST(Timeline, record)
+{
+    Timeline timeline(8);
+    EXPECT_EQ(timeline.getCapacityPerThread(), 8);
+    EXPECT_TRUE(timeline.getEvents().empty());
+
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        timeline.record(kTags[i], 10 * i, 10 * i + 5);
+    }
+
+    vector<Timeline::Event> events = timeline.getEvents();
+    ASSERT_EQ(events.size(), 4u);
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(events[i].mBeginTick, 10 * i);
+        EXPECT_EQ(events[i].mEndTick, 10 * i + 5);
+        EXPECT_EQ(events[i].mTag, kTags[i]);
+        EXPECT_EQ(events[i].mThreadIndex, 0);
+    }
+
+    // only the most recent events are kept.
+    for (uint64_t i = 4; i < 20; ++i)
+    {
+        timeline.record(kTags[i % 4], 10 * i, 10 * i + 5);
+    }
+    events = timeline.getEvents();
+    ASSERT_EQ(events.size(), 8u);
+    EXPECT_EQ(events.front().mBeginTick, 120u);
+    EXPECT_EQ(events.back().mBeginTick, 190u);
+
+    // the capacity is rounded up to a power of two.
+    Timeline rounded(5);
+    EXPECT_EQ(rounded.getCapacityPerThread(), 8);
+}
+
+//------------------------------------------------------------------------------
+// Threads record continuously while the timeline is dumped. Every dumped
+// event must be whole and the events of a thread in order.
+//
+TEST(Timeline, concurrentDump)
+{
+    Timeline timeline(256);
+    const int kNumThreads = 4;
+    std::atomic<bool> isStopping(false);
+    std::atomic<int> numberOfRecordingThreads(0);
+
+    vector<thread> threads;
+    for (int t = 0; t < kNumThreads; ++t)
+    {
+        threads.push_back(thread([&timeline, &isStopping, &numberOfRecordingThreads]() {
+            uint64_t tick = 0;
+            while (!isStopping.load())
+            {
+                // the tag and the duration are derived from the begin tick.
+                timeline.record(kTags[tick % 4], tick, tick + tick % 7);
+                if (tick == 0)
+                { numberOfRecordingThreads.fetch_add(1); }
+                ++tick;
+            }
+        }));
+    }
+
+    while (numberOfRecordingThreads.load() < kNumThreads)
+    { this_thread::yield(); }
+
+    int numberOfDumps = 0;
+    size_t numberOfEvents = 0;
+    while (numberOfDumps < 200)
+    {
+        vector<Timeline::Event> events = timeline.getEvents();
+        vector<uint64_t> lastBeginTick(kNumThreads, 0);
+        vector<bool> hasEvent(kNumThreads, false);
+        for (auto &e : events)
+        {
+            ASSERT_TRUE(e.mThreadIndex >= 0 && e.mThreadIndex < kNumThreads);
+            EXPECT_EQ(e.mTag, kTags[e.mBeginTick % 4]);
+            EXPECT_EQ(e.mEndTick, e.mBeginTick + e.mBeginTick % 7);
+            if (hasEvent[e.mThreadIndex])
+            { EXPECT_GT(e.mBeginTick, lastBeginTick[e.mThreadIndex]); }
+            hasEvent[e.mThreadIndex] = true;
+            lastBeginTick[e.mThreadIndex] = e.mBeginTick;
+        }
+        EXPECT_LE(events.size(), (size_t)kNumThreads * 256);
+        numberOfEvents += events.size();
+        ++numberOfDumps;
+    }
+
+    isStopping.store(true);
+    for (auto &t : threads)
+    { t.join(); }
+    EXPECT_GT(numberOfEvents, 0u);
+}
+
+//------------------------------------------------------------------------------
+TEST(Timeline, chromeTrace)
+{
+    // the scopes record in the global timeline.
+    {
+        TimelineScope scope("timelineTest \"scope\"");
+        this_thread::sleep_for(chrono::milliseconds(2));
+    }
+
+    bool isFound = false;
+    for (auto &e : Timeline::getInstance().getEvents())
+    {
+        if (strcmp(e.mTag, "timelineTest \"scope\"") == 0)
+        {
+            isFound = true;
+            EXPECT_GE(CycleCounter::toNanoseconds(e.mEndTick - e.mBeginTick), 2000000);
+        }
+    }
+    EXPECT_TRUE(isFound);
+
+    const string json = Timeline::getInstance().toChromeTraceJson();
+    EXPECT_EQ(json.find("{\"traceEvents\":["), 0u);
+    EXPECT_NE(json.find("\"name\":\"timelineTest \\\"scope\\\"\",\"ph\":\"X\""), string::npos);
+}
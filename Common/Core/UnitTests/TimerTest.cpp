@@ -1,4 +1,6 @@
+#include <chrono>
 #include "gtest/gtest.h"
+#include "Core/CycleCounter.h"
 #include "Core/Timer.h"
 
 #include <thread>
@@ -32,3 +34,26 @@ TEST(Timer, test)
         EXPECT_GE(e, 1);
     }
 }
+
+
+TEST(Timer, cycleCounter)
+{
+    EXPECT_GT(CycleCounter::getNanosecondsPerTick(), 0.0);
+
+    // the calibrated counter must agree with steady_clock.
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const uint64_t startTick = CycleCounter::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const uint64_t endTick = CycleCounter::now();
+    const int64_t elapsedInNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_NEAR((double)CycleCounter::toNanoseconds(endTick - startTick), (double)elapsedInNs, elapsedInNs * 0.02);
+    EXPECT_NEAR(CycleCounter::toSeconds(endTick - startTick), elapsedInNs * 1e-9, elapsedInNs * 1e-9 * 0.02);
+
+    Timer t;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    t.stop();
+    EXPECT_GE(t.elapsedInNanoseconds(), 10000000);
+    EXPECT_EQ(t.elapsed(), t.elapsed());
+}
\ No newline at end of file
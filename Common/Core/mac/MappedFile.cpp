@@ -0,0 +1,60 @@
+
+#include <fcntl.h>
+#include "Core/MappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+//-----------------------------------------------------------------------------
+MappedFile::MappedFile() :
+    mpData(nullptr),
+    mSize(0)
+{}
+
+//-----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------
+void MappedFile::close()
+{
+    if (mpData != nullptr)
+    {
+        munmap((void*)mpData, (size_t)mSize);
+    }
+    mpData = nullptr;
+    mSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Returns false when the file can't be opened or is empty, empty files can't
+// be mapped.
+//
+bool MappedFile::open(const std::string& iFilenamePath)
+{
+    close();
+
+    const int fd = ::open(iFilenamePath.c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        void *p = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            mpData = (const char*)p;
+            mSize = (uint64_t)fileStat.st_size;
+        }
+    }
+
+    // the mapping stays valid once the file is closed.
+    ::close(fd);
+    return isOpen();
+}
@@ -2,6 +2,7 @@
 #include "Core/StringUtilities.h"
 #include <cassert>
 #include <cstdarg>
+#include <cstdlib>
 #include "Path.h"
 #include <regex>
 #include <sstream>
@@ -46,6 +47,16 @@ string Path::getCurrentWorkingDirectory()
 	return r;
 }
 
+//-----------------------------------------------------------------------------
+// Returns the folder for temporary files, TMPDIR when it is set and /tmp
+// otherwise.
+//
+string Path::getTemporaryFolderPath()
+{
+    const char* tmpDir = getenv("TMPDIR");
+    return sanitize(tmpDir != nullptr && *tmpDir != '\0' ? tmpDir : "/tmp");
+}
+
 //-----------------------------------------------------------------------------
 
 string Path::join(const string& iPath0, const string& iPath1)
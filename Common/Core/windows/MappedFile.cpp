@@ -0,0 +1,64 @@
+
+#include "Core/MappedFile.h"
+#include <windows.h>
+
+using namespace Realisim;
+    using namespace Core;
+using namespace std;
+
+//-----------------------------------------------------------------------------
+MappedFile::MappedFile() :
+    mpData(nullptr),
+    mSize(0)
+{}
+
+//-----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+//-----------------------------------------------------------------------------
+void MappedFile::close()
+{
+    if (mpData != nullptr)
+    {
+        UnmapViewOfFile(mpData);
+    }
+    mpData = nullptr;
+    mSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Returns false when the file can't be opened or is empty, empty files can't
+// be mapped.
+//
+bool MappedFile::open(const std::string& iFilenamePath)
+{
+    close();
+
+    HANDLE file = CreateFileA(iFilenamePath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr)
+        {
+            void *p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (p != nullptr)
+            {
+                mpData = (const char*)p;
+                mSize = (uint64_t)size.QuadPart;
+            }
+
+            // the view keeps the mapping alive.
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+    return isOpen();
+}
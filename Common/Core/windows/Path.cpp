@@ -50,6 +50,16 @@ string Path::getCurrentWorkingDirectory()
 	return r;
 }
 
+//-----------------------------------------------------------------------------
+// Returns the folder for temporary files, see GetTempPath().
+//
+string Path::getTemporaryFolderPath()
+{
+    CHAR path[MAX_PATH + 1];
+    const DWORD length = GetTempPathA(MAX_PATH + 1, path);
+    return length > 0 && length <= MAX_PATH ? sanitize(string(path, length)) : string();
+}
+
 //-----------------------------------------------------------------------------
 
 string Path::join(const string& iPath0, const string& iPath1)
@@ -12,16 +12,19 @@ MaterialNode::~MaterialNode()
 {}
 
 //----------------------------------------------------------------------
-const Core::Image& MaterialNode::getDiffuse() const
-{ return mDiffuse; }
+const Core::ImageSampler& MaterialNode::getDiffuseSampler() const
+{ return mDiffuseSampler; }
 
 //----------------------------------------------------------------------
 const ThreeD::Material& MaterialNode::getMaterial() const
 { return mMaterial; }
 
 //----------------------------------------------------------------------
-void MaterialNode::setDiffuse(const Core::Image& iV)
-{ mDiffuse = iV; }
+// The sampler is usually shared by all materials using the same image, see
+// Scene::importObj().
+//
+void MaterialNode::setDiffuseSampler(const Core::ImageSampler& iV)
+{ mDiffuseSampler = iV; }
 
 //----------------------------------------------------------------------
 void MaterialNode::setMaterial(const ThreeD::Material& iV)
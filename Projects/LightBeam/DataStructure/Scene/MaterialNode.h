@@ -1,6 +1,7 @@
 #pragma once
 
 #include "3d/Material.h"
+#include "Core/ImageSampler.h"
 #include "DataStructure/Scene/Interfaces.h"
 
 
@@ -16,15 +17,15 @@ namespace LightBeam
         MaterialNode& operator=(const MaterialNode&) = default;
         virtual ~MaterialNode();
         
-        const Core::Image& getDiffuse() const;
+        const Core::ImageSampler& getDiffuseSampler() const;
         const ThreeD::Material& getMaterial() const;
-        void setDiffuse(const Core::Image&);
+        void setDiffuseSampler(const Core::ImageSampler&);
         void setMaterial(const ThreeD::Material& iV);
 
     protected:
         ThreeD::Material mMaterial;
 
-        Core::Image mDiffuse;
+        Core::ImageSampler mDiffuseSampler; // owns its data, shared between copies (see ByteArray)
     };
 
 }
@@ -1,10 +1,13 @@
 
+#include <algorithm>
 #include <cassert>
 #include "Core/FileInfo.h"
+#include "Core/ImageManifest.h"
 #include "Core/Path.h"
 #include <memory>
 #include <regex>
 #include "Scene.h"
+#include <vector>
 #include "3d/Scene/SceneNode.h"
 
 // temporary until we can read scene from files...
@@ -141,6 +144,7 @@ void Scene::clear()
     mMaterials.clear();
 
     mKeyToImage.clear();
+    mKeyToDiffuseSampler.clear();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -173,46 +177,63 @@ void Scene::importObj(const std::string &iFilenamePath)
         fi.setFile(iFilenamePath);
         const string folderPath = fi.getCanonicalPath();
 
-        // add materials
-        auto itMeshIndexToMaterial = objAsset.mMeshIndexToMaterial.begin();
-        for (; itMeshIndexToMaterial != objAsset.mMeshIndexToMaterial.end(); ++itMeshIndexToMaterial)
+        // gather the images that are not in the store yet, read their headers
+        // and load the valid ones all at once, in parallel, largest first.
+        vector<string> imagePaths;
+        for (const auto &meshIndexAndMaterial : objAsset.mMeshIndexToMaterial)
         {
-            const Material &mat = itMeshIndexToMaterial->second;
+            const Material &mat = meshIndexAndMaterial.second;
             for (int i = 0; i < (int)Material::ImageLayer::ilNumberOfLayers; ++i)
             {
-                // load and store images if necessary...
                 Material::ImageLayer imageLayer = (Material::ImageLayer)i;
                 if (mat.hasImageLayer(imageLayer))
                 {
                     const std::string filePath = Path::join(folderPath, mat.getImagePath(imageLayer) );
-
-                    //check if already in store...
-                    if (mKeyToImage.find(filePath) == mKeyToImage.end())
+                    if (mKeyToImage.find(filePath) == mKeyToImage.end() &&
+                        find(imagePaths.begin(), imagePaths.end(), filePath) == imagePaths.end())
                     {
-                        Core::Image im;
-
-                        im.setFilenamePath(filePath);
-                        im.load();
-                        im.setWrapType(Image::wtRepeat);
-
-                        if (im.isValid())
-                        {
-                            mKeyToImage[filePath] = im;
-                        }
+                        imagePaths.push_back(filePath);
                     }
                 }
             }
+        }
+
+        const Core::ImageManifest manifest = Core::ImageManifest::scan(imagePaths);
+        imagePaths = manifest.getFilenamePathsBySize();
+        vector<Core::Image> images = Core::Image::loadAll(imagePaths);
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            if (images[i].isValid())
+            {
+                images[i].setWrapType(Image::wtRepeat);
+                mKeyToImage[imagePaths[i]] = images[i];
+            }
+        }
+
+        // add materials
+        auto itMeshIndexToMaterial = objAsset.mMeshIndexToMaterial.begin();
+        for (; itMeshIndexToMaterial != objAsset.mMeshIndexToMaterial.end(); ++itMeshIndexToMaterial)
+        {
+            const Material &mat = itMeshIndexToMaterial->second;
 
             //create the materialNode.
             shared_ptr<MaterialNode> matNode = make_shared<MaterialNode>();
             matNode->setMaterial(mat);
 
-            // grab the diffuse image from the store.
+            // grab the diffuse sampler from the store, it is built once per
+            // image and shared by all the materials using that image.
             //
             if (mat.hasImageLayer(Material::ImageLayer::ilDiffuse))
             {
                 const std::string filePath = Path::join(folderPath, mat.getImagePath(Material::ImageLayer::ilDiffuse));
-                matNode->setDiffuse(mKeyToImage[filePath]);
+                auto itSampler = mKeyToDiffuseSampler.find(filePath);
+                if (itSampler == mKeyToDiffuseSampler.end())
+                {
+                    // texture lookups of rays are scattered, see ImageSampler::slTiled.
+                    itSampler = mKeyToDiffuseSampler.emplace(filePath,
+                        Core::ImageSampler(mKeyToImage[filePath], Core::ImageSampler::slTiled)).first;
+                }
+                matNode->setDiffuseSampler(itSampler->second);
             }
                 
 
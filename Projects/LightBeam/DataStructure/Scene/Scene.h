@@ -2,6 +2,7 @@
 
 
 #include "Core/Image.h"
+#include "Core/ImageSampler.h"
 #include "DataStructure/Scene/IRenderable.h"
 #include "DataStructure/Scene/MaterialNode.h"
 #include "DataStructure/Scene/Interfaces.h"
@@ -40,6 +41,7 @@ void importObj(const std::string &iFilenamePath);
         std::vector< std::shared_ptr<MaterialNode> > mMaterials;
 
         std::map<std::string, Core::Image> mKeyToImage; //the key is the full canninical path
+        std::map<std::string, Core::ImageSampler> mKeyToDiffuseSampler; // same keys as mKeyToImage
     };
 
 }
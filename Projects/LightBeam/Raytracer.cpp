@@ -1,6 +1,7 @@
 
 #include "Broker.h"
 #include <cassert>
+#include "Core/ThreadPool.h"
 #include "Core/Timer.h"
 #include "Core/Unused.h"
 #include "Geometry/Intersections.h"
@@ -24,11 +25,18 @@ namespace  {
     const int kMaxRecursionDepth = 5;
     const int kTileSize = 16;
     int kNumThreads = 1;
+
+    // enough room for all the tiles of a 4k frame. Replies are posted by
+    // many threads, the lock free queue avoids contention on the queue mutex.
+    const int kQueueCapacity = 1 << 16;
+    const int kMaximumBatchSize = 4;
 }
 
 //-----------------------------------------------------------------------------
 RayTracer::RayTracer(Broker *ipBroker) :
-    mBrokerRef(*ipBroker)
+    mBrokerRef(*ipBroker),
+    mMessageQueue(),
+    mReplyQueue(MessageQueue::stLockFreeRingBuffer, kQueueCapacity)
 {
     // set max number of threads
 #ifdef NDEBUG
@@ -44,8 +52,13 @@ RayTracer::RayTracer(Broker *ipBroker) :
         bind(&RayTracer::processMessage, this, _1);
     mMessageQueue.setOneByOneProcessingFunction(f);
     mMessageQueue.setMaximumSize(-1);
+    mMessageQueue.setThreadPool(&ThreadPool::getGlobalInstance());
     mMessageQueue.setNumberOfThreads(kNumThreads);
-    mMessageQueue.setBehavior(MessageQueue::bFifo);
+    // small batches, so that tiles taken by a worker before the camera
+    // moves are not all rendered for nothing.
+    mMessageQueue.setMaximumBatchSize(kMaximumBatchSize);
+    // tiles close to the center of the screen are rendered first.
+    mMessageQueue.setBehavior(MessageQueue::bPriority);
     mMessageQueue.startInThread();
     
     function<void( const std::vector<MessageQueue::Message*>& )> f2 =
@@ -91,29 +104,24 @@ void RayTracer::debugRayCast(const Vector2i &iPixelPosition)
 }
 
 //-----------------------------------------------------------------------------
-int RayTracer::fillPixels(Core::Image *opImage,
+int RayTracer::fillPixels(Core::ImageView<Core::iifRgbaUint8> *opView,
                            const ImageCells& iCells,
                            const Math::Vector2i& iCellIndex,
                            const Geometry::Rectangle& iCellCoverage)
 {
     const Vector2 bl = iCellCoverage.getBottomLeft();
     const Vector2 tr = iCellCoverage.getTopRight();
+    const Vector2i origin((int)bl.x(), (int)bl.y());
+    const Vector2i size((int)tr.x() - origin.x(), (int)tr.y() - origin.y());
     
-    Color c;
-    for(int y = (int)bl.y(); y < (int)tr.y(); ++y)
-    {
-        for(int x = (int)bl.x(); x < (int)tr.x(); ++x)
-        {
-            c = iCells.getCellColor(iCellIndex);
-            opImage->setPixelColor(Vector2i(x,y), c);
-        }
-    }
+    // the cell color is converted once and the rectangle is filled row by row.
+    opView->fill(origin, size, opView->makePixel(iCells.getCellColor(iCellIndex)));
     
     return 1;
 }
 
 //-----------------------------------------------------------------------------
-int RayTracer::fillPixel(Core::Image *opImage,
+int RayTracer::fillPixel(Core::ImageView<Core::iifRgbaUint8> *opView,
                           const ImageCells& iCells,
                           const Math::Vector2i& iCellIndex,
                           const Geometry::Rectangle& iCellCoverage)
@@ -130,7 +138,11 @@ int RayTracer::fillPixel(Core::Image *opImage,
         }
     
     c /= (double)(increment*increment);
-    opImage->setPixelColor(iCellIndex/increment, c);
+    const Vector2i pixel = iCellIndex/increment;
+    if (pixel >= Vector2i(0, 0) && pixel < opView->getSizeInPixels())
+    {
+        opView->setPixelColor(pixel.x(), pixel.y(), c);
+    }
 
     return increment;
 }
@@ -167,6 +179,10 @@ void RayTracer::mergeImage(Core::Image *opImage, ImageCells& iCells)
 
     Geometry::Rectangle coverage = iCells.getCoverage();
 
+    // a single copy-on-write detach for the whole merge.
+    ImageView<iifRgbaUint8> view(*opImage);
+    if (!view.isValid()) { return; }
+
     // reconstruct image from cells and merge into finalImage
     int cellIncrement = 1;
     for (int cellY = 0; cellY < iCells.getHeightInCells(); cellY += cellIncrement)
@@ -177,11 +193,11 @@ void RayTracer::mergeImage(Core::Image *opImage, ImageCells& iCells)
 
             if (cellCoverage.getWidth() >= 1)  // cell bigger than 1 px, undersampling
             {
-                cellIncrement = fillPixels(opImage, iCells, cellIndex, cellCoverage);
+                cellIncrement = fillPixels(&view, iCells, cellIndex, cellCoverage);
             }
             else // more than 1 cell per pixels, supersampling
             {
-                cellIncrement = fillPixel(opImage, iCells, cellIndex, cellCoverage);
+                cellIncrement = fillPixel(&view, iCells, cellIndex, cellCoverage);
             }
         }
 
@@ -225,6 +241,7 @@ void RayTracer::processMessage(MessageQueue::Message* ipM)
         done->mCoverage = m->mCoverage;
         done->mRenderedCells = cells;
         done->mId = m->mId;
+        done->mEpoch = m->mEpoch;
         mReplyQueue.post(done);
     }
 }
@@ -304,8 +321,14 @@ void RayTracer::render(int iLevelOfDetail, bool iClearIterativeRendering)
 
     printf("lod: %d\n", iLevelOfDetail);
 
+    // Tiles and replies of the previous epoch are discarded by the
+    // queues instead of being rendered and merged.
     if(iClearIterativeRendering)
-        mMessageQueue.clear();
+    {
+        mMessageQueue.incrementEpoch();
+        mReplyQueue.incrementEpoch();
+    }
+    const int epoch = mMessageQueue.getEpoch();
 
     mDesiredLevelOfDetail = iLevelOfDetail;
 
@@ -319,9 +342,13 @@ void RayTracer::render(int iLevelOfDetail, bool iClearIterativeRendering)
     const double vh = im.getSizeInPixels().y();
     int numberOfCellsX = (int)ceil(vw / (double)kTileSize);
     int numberOfCellsY = (int)ceil(vh / (double)kTileSize);
+    const Vector2 screenCenter(vw / 2.0, vh / 2.0);
 
-    // prepare all the rendering tiles
+    // prepare all the rendering tiles and send them to compute
+    // in a single batch.
     //
+    std::vector<MessageQueue::Message*> requests;
+    requests.reserve(numberOfCellsX * numberOfCellsY);
     for (int j = 0; j < numberOfCellsY; ++j)
     {
         for (int i = 0; i < numberOfCellsX; ++i)
@@ -334,10 +361,12 @@ void RayTracer::render(int iLevelOfDetail, bool iClearIterativeRendering)
             m->mCoverage = coverage;
             m->mTileSizeInPixel = kTileSize / mDesiredLevelOfDetail;
             m->mId = i + j*numberOfCellsX;
-            // send request to compute.
-            mMessageQueue.post(m);
+            m->mEpoch = epoch;
+            m->mPriority = -(int)(coverage.getCenter() - screenCenter).normSquared();
+            requests.push_back(m);
         }
     }
+    mMessageQueue.postBatch(requests);
 
 
     //----- DEBUG CODE' RENDER ONLY ONE TILE
@@ -1,5 +1,6 @@
 #pragma once
 #include "Core/Image.h"
+#include "Core/ImageView.h"
 #include "Core/MessageQueue.h"
 #include "DataStructure/ImageCells.h"
 #include "Geometry/Frustum.h"
@@ -50,8 +51,8 @@ namespace LightBeam
             int mId;
         };
     
-        int fillPixels(Core::Image *opImage, const ImageCells& iCells, const Math::Vector2i& iCellIndex, const Geometry::Rectangle& iCellCoverage);
-        int fillPixel(Core::Image *opImage, const ImageCells& iCells, const Math::Vector2i& iCellIndex, const Geometry::Rectangle& iCellCoverage);
+        int fillPixels(Core::ImageView<Core::iifRgbaUint8> *opView, const ImageCells& iCells, const Math::Vector2i& iCellIndex, const Geometry::Rectangle& iCellCoverage);
+        int fillPixel(Core::ImageView<Core::iifRgbaUint8> *opView, const ImageCells& iCells, const Math::Vector2i& iCellIndex, const Geometry::Rectangle& iCellCoverage);
         void mergeImage(Core::Image *opImage, ImageCells&);
         void processReplies( const std::vector<Core::MessageQueue::Message*>& );
         void processMessage(Core::MessageQueue::Message*);
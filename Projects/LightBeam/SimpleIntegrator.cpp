@@ -1,5 +1,6 @@
 
 #include <cmath>
+#include "Core/ColorRgbaF.h"
 #include "DataStructure/IntersectionResult.h"
 #include "DataStructure/Scene/Interfaces.h"
 #include "DataStructure/Scene/LightNode.h"
@@ -15,6 +16,7 @@
 #include "Utilities.h"
 
 using namespace Realisim;
+    using namespace Core;
     using namespace Geometry;
     using namespace LightBeam;
     using namespace Math;
@@ -35,7 +37,8 @@ Core::Color SimpleIntegrator::computeLi(const Line &iLine,
     IntersectionResult *opResult,
     VisibilityTester *opVisibilityTester)
 {
-    Core::Color spectrum;
+    // accumulated in floats, see ColorRgbaF.
+    ColorRgbaF spectrum;
     
     // collect all intersections from ray with scene
     IntersectionResult ir;
@@ -86,10 +89,8 @@ Core::Color SimpleIntegrator::computeLi(const Line &iLine,
         const double nDotLAmbient = ir.mNormal * ambientDirection;
         spectrum += ambient * fabs(nDotLAmbient);*/
 
-        Core::Color perLightSpectrum;
         for(auto lightNode : lights)
         {
-            perLightSpectrum.set(0, 0, 0, 0);
             const Light &light = lightNode->getLight();
             
             Vector3 lightDirection; // wi
@@ -112,10 +113,8 @@ Core::Color SimpleIntegrator::computeLi(const Line &iLine,
                 lightDirection = iLine.getDirection();
                 const double nDotLAmbient = ir.mNormal * lightDirection;
 
-                //CACA ICI!!! ajouter une methode getPixelColorFromUV()...
-                const Core::Image &im = ir.mpMaterialNode->getDiffuse();
-                Core::Color matDiffuseC = im.getPixelColor(ir.mUV .multiplyComponents(toVector2(im.getSizeInPixels())) );
-                spectrum += light.getColor() * fabs(nDotLAmbient) * matDiffuseC;;
+                const ColorRgbaF matDiffuseC(ir.mpMaterialNode->getDiffuseSampler().sampleUV(ir.mUV));
+                spectrum.addScaled(ColorRgbaF(light.getColor()) * matDiffuseC, (float)fabs(nDotLAmbient));
                 continue;
             } break;
             default: break;
@@ -140,31 +139,27 @@ Core::Color SimpleIntegrator::computeLi(const Line &iLine,
             opVisibilityTester->set(p, lightPosition, &iScene);
 
             // diffuse C
-            Core::Color lightColor(1.0, 1.0, 1.0, 0.0);
+            const ColorRgbaF lightColor(1.0f, 1.0f, 1.0f, 0.0f);
             //Core::Color matDiffuseC; matDiffuseC.setRgb(ir.mpMaterialNode->getMaterial().getDiffuseColor());
             
-            //!!!!! Corriger le get Color.
-            const Core::Image& im = ir.mpMaterialNode->getDiffuse();
-            Core::Color matDiffuseC = im.getPixelColor(ir.mUV.multiplyComponents(toVector2(im.getSizeInPixels())));
+            const ColorRgbaF matDiffuseC(ir.mpMaterialNode->getDiffuseSampler().sampleUV(ir.mUV));
 
-            Core::Color matSpecularC; matSpecularC.setRgb(ir.mpMaterialNode->getMaterial().getSpecularColor());
+            Core::Color matSpecular; matSpecular.setRgb(ir.mpMaterialNode->getMaterial().getSpecularColor());
+            const ColorRgbaF matSpecularC(matSpecular);
             const double nDotL = ir.mNormal * lightDirection;
-            Core::Color diffuse = lightColor * fabs(nDotL) * matDiffuseC;
+            const ColorRgbaF diffuse = lightColor * matDiffuseC * (float)fabs(nDotL);
             
             // compute the specular factor
             const double kShininess = ir.mpMaterialNode->getMaterial().getShininess();
             const double energyConservation = 8.0 * kShininess / (8.0 * M_PI);
             Vector3 halfDir = (lightDirection + ir.mW0).normalize();
             double specularFactor = energyConservation * pow( max(halfDir.dot(ir.mNormal), 0.0), kShininess);
-            Core::Color specular = lightColor * specularFactor * matSpecularC;
+            const ColorRgbaF specular = lightColor * matSpecularC * (float)specularFactor;
 
             const double intensity = 100.0;
-            perLightSpectrum = (diffuse + specular) * intensity * attenuation;
-
-            spectrum += perLightSpectrum;
-            if (opVisibilityTester->isOccluded())
+            if (!opVisibilityTester->isOccluded())
             {
-                spectrum -= perLightSpectrum;
+                spectrum.addScaled(diffuse + specular, (float)(intensity * attenuation));
             }
 
             //fill the results.
@@ -176,5 +171,5 @@ Core::Color SimpleIntegrator::computeLi(const Line &iLine,
         
     }
 
-    return spectrum;
+    return spectrum.toColor();
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 
 #include <cassert>
 #include "Core/Logger.h"
+#include "Core/Timeline.h"
 #include "Engine.h"
 #include "Systems/Renderer/Renderer.h"
 #include "Systems/CameraController.h"
@@ -73,18 +74,29 @@ void Engine::update()
     Broker& b = getBrokerRef();
     b.setStartOfFrameTime();
 
-    for (auto s : mSystems)
-        s->preUpdate();
+    // each phase is recorded in the timeline, see Core::Timeline.
+    {
+        Core::TimelineScope scope("preUpdate");
+        for (auto s : mSystems)
+            s->preUpdate();
+    }
 
-    for (auto s : mSystems)
-        s->update();
+    {
+        Core::TimelineScope scope("update");
+        for (auto s : mSystems)
+            s->update();
+    }
 
-    for (auto s : mSystems)
-        s->postUpdate();
+    {
+        Core::TimelineScope scope("postUpdate");
+        for (auto s : mSystems)
+            s->postUpdate();
+    }
 
     // important
     // after all systems have been updated, we swapbuffers, this will sync with the screen refresh rate
     //
+    Core::TimelineScope scope("swap");
     Reactor::Renderer& r = getHubRef().getRendererRef();
     r.swapBuffers();
 }